@@ -6,6 +6,7 @@
 #include <QObject>
 #include <QString>
 #include <QList>
+#include <QStringList>
 #include <QVariantMap>
 #include <QMutex>
 
@@ -68,6 +69,23 @@ public:
      */
     virtual QString backendName() const = 0;
 
+    /**
+     * @brief Open the connection to the service ahead of the first request.
+     * Called when a project loads or the prompt editor gains focus; the default does nothing.
+     */
+    virtual void prewarm() {}
+
+    /**
+     * @brief The exact request body this backend would send for these messages and params.
+     * Used to key cached responses; empty (the default) means requests can't be cached.
+     */
+    virtual QByteArray requestPayload(const QList<Message> &messages, const QVariantMap &params) const
+    {
+        Q_UNUSED(messages);
+        Q_UNUSED(params);
+        return QByteArray();
+    }
+
     /**
      * @brief Get current global config parameters (e.g., API key, default model).
      */
@@ -75,8 +93,9 @@ public:
 
     /**
      * @brief Set global config parameters.
+     * Virtual so wrapping backends (e.g. RequestScheduler) can pass them on.
      */
-    void setConfig(const QVariantMap &config);
+    virtual void setConfig(const QVariantMap &config);
 
 signals:
     /**
@@ -86,6 +105,15 @@ signals:
      */
     void partialResponse(const QString &requestId, const QString &text);
 
+    /**
+     * @brief Emitted for every streamed chunk of every choice of a request (params "n" > 1
+     * asks for several alternative completions). partialResponse only covers choice 0.
+     * @param requestId Identifies which request this belongs to.
+     * @param choiceIndex Index of the choice the chunk belongs to.
+     * @param text Partial text chunk.
+     */
+    void choicePartialResponse(const QString &requestId, int choiceIndex, const QString &text);
+
     /**
      * @brief Emitted when a full response is ready for a request.
      * @param requestId Identifies which request this belongs to.
@@ -93,6 +121,13 @@ signals:
      */
     void finished(const QString &requestId, const QString &fullResponse);
 
+    /**
+     * @brief Emitted right before finished when a request produced more than one choice.
+     * @param requestId Identifies which request this belongs to.
+     * @param responses Full text of every choice, by choice index.
+     */
+    void choicesFinished(const QString &requestId, const QStringList &responses);
+
     /**
      * @brief Emitted on error for a request.
      * @param requestId Identifies which request this belongs to.
@@ -107,6 +142,36 @@ signals:
      */
     void statusChanged(const QString &requestId, const QString &status);
 
+    /**
+     * @brief Emitted when the HTTP response headers of a request arrive.
+     * @param requestId Identifies which request this belongs to.
+     * @param httpStatus HTTP status code (0 if unknown).
+     * @param headers Response headers, keyed by lower-case header name.
+     */
+    void responseMetadata(const QString &requestId, int httpStatus, const QVariantMap &headers);
+
+    /**
+     * @brief Emitted when the service reports token usage for a request (before finished).
+     * @param requestId Identifies which request this belongs to.
+     * @param usage Usage fields as reported, e.g. prompt_tokens, completion_tokens, total_tokens.
+     */
+    void usageReported(const QString &requestId, const QVariantMap &usage);
+
+    /**
+     * @brief Emitted (before the replayed partialResponse/finished) when a request is
+     * answered from the response cache instead of the service.
+     * @param requestId Identifies which request this belongs to.
+     */
+    void servedFromCache(const QString &requestId);
+
+    /**
+     * @brief Emitted (before finished) when the service stored the completed response
+     * server-side, so a follow-up request can continue from it instead of resending history.
+     * @param requestId Identifies which request this belongs to.
+     * @param responseId Server-side id of the response (Responses API "resp_...").
+     */
+    void responseStored(const QString &requestId, const QString &responseId);
+
 protected:
     QVariantMap m_config;
     mutable QMutex m_configMutex;
@@ -0,0 +1,605 @@
+#include "batchclient.h"
+#include "aibackend.h"
+#include "project.h"
+#include "session.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QNetworkRequest>
+#include <QNetworkReply>
+#include <QRandomGenerator>
+#include <QDebug>
+
+namespace {
+
+// The Batch API runs requests against this endpoint on our behalf
+const char kBatchEndpoint[] = "/v1/chat/completions";
+
+const int kDefaultPollIntervalMs = 30000;
+
+bool isTerminalStatus(const QString &status)
+{
+    return status == QLatin1String("completed") || status == QLatin1String("failed")
+           || status == QLatin1String("expired") || status == QLatin1String("cancelled");
+}
+
+} // namespace
+
+NetworkBatchTransport::NetworkBatchTransport(const QString &accessToken, const QString &baseUrl)
+    : m_accessToken(accessToken)
+    , m_baseUrl(baseUrl.endsWith('/') ? baseUrl.chopped(1) : baseUrl)
+{
+}
+
+void NetworkBatchTransport::send(const QByteArray &verb, const QString &path, const QByteArray &body,
+                                 const QByteArray &contentType, Callback done)
+{
+    QNetworkRequest request(QUrl(m_baseUrl + path));
+    request.setRawHeader("Authorization", "Bearer " + m_accessToken.toUtf8());
+    if (!contentType.isEmpty())
+        request.setHeader(QNetworkRequest::ContentTypeHeader, contentType);
+
+    QNetworkReply *reply = m_networkManager.sendCustomRequest(request, verb, body);
+    QObject::connect(reply, &QNetworkReply::finished, reply, [reply, done]() {
+        Response response;
+        response.status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+        response.body = reply->readAll();
+        // HTTP error statuses are reported through 'status'; only keep transport failures here
+        if (reply->error() != QNetworkReply::NoError && response.status == 0)
+            response.error = reply->errorString();
+        reply->deleteLater();
+        done(response);
+    });
+}
+
+BatchClient::BatchClient(Project *project, BatchTransport *transport, QObject *parent)
+    : QObject(parent)
+    , m_project(project)
+    , m_transport(transport)
+{
+    m_pollTimer.setInterval(kDefaultPollIntervalMs);
+    connect(&m_pollTimer, &QTimer::timeout, this, &BatchClient::poll);
+}
+
+BatchClient::~BatchClient()
+{
+    delete m_transport;
+}
+
+QString BatchClient::batchesFolder(const QString &sessionsFolder)
+{
+    return QDir(sessionsFolder).filePath(".batches");
+}
+
+QStringList BatchClient::pendingStateFiles(const QString &sessionsFolder)
+{
+    QStringList states;
+    QDir dir(batchesFolder(sessionsFolder));
+    const QFileInfoList files = dir.entryInfoList({"*.json"}, QDir::Files, QDir::Name);
+    for (const QFileInfo &fi : files)
+        states << fi.absoluteFilePath();
+    return states;
+}
+
+QByteArray BatchClient::buildRequestLine(const QString &customId, const QString &sessionPath,
+                                         const QVariantMap &params, PendingSession &pending, QString *errorOut) const
+{
+    Session session(m_project);
+    if (!session.load(sessionPath)) {
+        *errorOut = QString("%1: failed to load session").arg(QFileInfo(sessionPath).fileName());
+        return QByteArray();
+    }
+
+    if (session.slices().isEmpty() || session.slices().constLast().role != MessageRole::User) {
+        *errorOut = QString("%1: the last slice is not a user prompt").arg(QFileInfo(sessionPath).fileName());
+        return QByteArray();
+    }
+
+    pending.path = QFileInfo(sessionPath).absoluteFilePath();
+    pending.sliceCount = session.slices().size();
+    pending.promptDigest = promptDigest(session.slices().constLast().content);
+
+    // Same include caching an interactive send does, but the session file is left as it is:
+    // it may be open in a tab. Command pipe markers are sent as-is
+    session.refreshCache();
+
+    QJsonArray messages;
+    const QVector<PromptSlice> slices = session.expandedSlices();
+    for (const PromptSlice &slice : slices) {
+        AIBackend::Message::Role role;
+        switch (slice.role) {
+        case MessageRole::System: role = AIBackend::Message::System; break;
+        case MessageRole::User: role = AIBackend::Message::User; break;
+        case MessageRole::Assistant: role = AIBackend::Message::Assistant; break;
+        default: role = AIBackend::Message::Unknown; break;
+        }
+        QJsonObject msgObj;
+        msgObj["role"] = AIBackend::Message::roleToString(role);
+        msgObj["content"] = slice.content;
+        messages.append(msgObj);
+    }
+
+    QJsonObject body;
+    body["model"] = params.value("model", "gpt-4.1-mini").toString();
+    body["messages"] = messages;
+    body["max_tokens"] = params.value("max_tokens", 800).toInt();
+    body["temperature"] = params.value("temperature", 0.3).toDouble();
+    body["top_p"] = params.value("top_p", 1.0).toDouble();
+    body["frequency_penalty"] = params.value("frequency_penalty", 0.0).toDouble();
+    body["presence_penalty"] = params.value("presence_penalty", 0.0).toDouble();
+
+    QJsonObject line;
+    line["custom_id"] = customId;
+    line["method"] = "POST";
+    line["url"] = QString::fromLatin1(kBatchEndpoint);
+    line["body"] = body;
+    return QJsonDocument(line).toJson(QJsonDocument::Compact) + '\n';
+}
+
+bool BatchClient::submit(const QStringList &sessionPaths, const QString &sessionsFolder, const QVariantMap &params,
+                         QString *errorOut)
+{
+    if (isRunning()) {
+        if (errorOut)
+            *errorOut = "A batch is already running.";
+        return false;
+    }
+
+    reset();
+
+    QByteArray jsonl;
+    QStringList skipped;
+    for (const QString &path : sessionPaths) {
+        const QString customId = QString("session-%1").arg(m_sessions.size() + 1);
+        QString error;
+        PendingSession pending;
+        QByteArray line = buildRequestLine(customId, path, params, pending, &error);
+        if (line.isEmpty()) {
+            skipped << error;
+            continue;
+        }
+        jsonl += line;
+        m_sessions.insert(customId, pending);
+    }
+
+    if (errorOut)
+        *errorOut = skipped.join('\n');
+
+    if (m_sessions.isEmpty()) {
+        qWarning() << "[BatchClient::submit] Nothing to send:" << skipped;
+        return false;
+    }
+
+    QDir dir(batchesFolder(sessionsFolder));
+    if (!dir.exists() && !dir.mkpath(".")) {
+        if (errorOut)
+            *errorOut = QString("Failed to create batch folder: %1").arg(dir.absolutePath());
+        m_sessions.clear();
+        return false;
+    }
+
+    const QString baseName = QString("batch_%1_%2")
+                                 .arg(QDateTime::currentDateTime().toString("yyyyMMdd_HHmmss"))
+                                 .arg(QRandomGenerator::global()->bounded(10000), 4, 10, QChar('0'));
+    QSaveFile inputFile(dir.filePath(baseName + ".jsonl"));
+    if (!inputFile.open(QIODevice::WriteOnly) || inputFile.write(jsonl) != jsonl.size() || !inputFile.commit()) {
+        if (errorOut)
+            *errorOut = QString("Failed to write batch input: %1").arg(inputFile.fileName());
+        m_sessions.clear();
+        return false;
+    }
+    m_statePath = dir.filePath(baseName + ".json");
+
+    qDebug() << "[BatchClient::submit] Wrote" << m_sessions.size() << "requests (" << jsonl.size() << "bytes) to"
+             << inputFile.fileName();
+
+    uploadInputFile(jsonl);
+    return true;
+}
+
+bool BatchClient::resume(const QString &statePath, QString *errorOut)
+{
+    if (isRunning()) {
+        if (errorOut)
+            *errorOut = "A batch is already running.";
+        return false;
+    }
+
+    QFile file(statePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        if (errorOut)
+            *errorOut = QString("Failed to open batch state: %1").arg(statePath);
+        return false;
+    }
+    const QJsonObject state = QJsonDocument::fromJson(file.readAll()).object();
+    file.close();
+
+    reset();
+    m_statePath = statePath;
+    m_batchId = state.value("batch_id").toString();
+    m_inputFileId = state.value("input_file_id").toString();
+    m_status = state.value("status").toString();
+    const QJsonObject sessions = state.value("sessions").toObject();
+    for (auto it = sessions.constBegin(); it != sessions.constEnd(); ++it) {
+        PendingSession pending;
+        if (it.value().isString()) {
+            // Older state files only kept the path
+            pending.path = it.value().toString();
+        } else {
+            const QJsonObject session = it.value().toObject();
+            pending.path = session.value("path").toString();
+            pending.sliceCount = session.value("slices").toInt(-1);
+            pending.promptDigest = session.value("prompt_digest").toString();
+        }
+        m_sessions.insert(it.key(), pending);
+    }
+
+    if (m_batchId.isEmpty()) {
+        // The upload or batch creation never completed; nothing to wait for
+        if (errorOut)
+            *errorOut = QString("Batch state has no batch id: %1").arg(statePath);
+        removeBatchFiles();
+        reset();
+        return false;
+    }
+
+    qDebug() << "[BatchClient::resume] Resuming batch" << m_batchId << "with" << m_sessions.size() << "sessions";
+    emit statusChanged(QString("Batch %1: %2").arg(m_batchId, m_status));
+    poll();
+    m_pollTimer.start();
+    return true;
+}
+
+void BatchClient::cancel()
+{
+    m_pollTimer.stop();
+    if (m_batchId.isEmpty())
+        return;
+
+    m_transport->send("POST", QString("/v1/batches/%1/cancel").arg(m_batchId), QByteArray(), "application/json",
+                      [](const BatchTransport::Response &response) {
+        if (!response.error.isEmpty() || response.status >= 300)
+            qWarning() << "[BatchClient::cancel] Cancel failed:" << responseError(response);
+    });
+
+    // The state file stays, so the partial results can still be collected with resume()
+    emit statusChanged(QString("Batch %1: cancelling").arg(m_batchId));
+    reset();
+}
+
+void BatchClient::uploadInputFile(const QByteArray &jsonl)
+{
+    m_uploading = true;
+    emit statusChanged(QString("Uploading batch of %1 sessions...").arg(m_sessions.size()));
+
+    const QByteArray boundary = "----VibeKoderBatch" + QByteArray::number(QRandomGenerator::global()->generate64(), 16);
+    QByteArray body;
+    body += "--" + boundary + "\r\n";
+    body += "Content-Disposition: form-data; name=\"purpose\"\r\n\r\nbatch\r\n";
+    body += "--" + boundary + "\r\n";
+    body += "Content-Disposition: form-data; name=\"file\"; filename=\""
+            + QFileInfo(m_statePath).completeBaseName().toUtf8() + ".jsonl\"\r\n";
+    body += "Content-Type: application/jsonl\r\n\r\n";
+    body += jsonl;
+    body += "\r\n--" + boundary + "--\r\n";
+
+    m_transport->send("POST", "/v1/files", body, "multipart/form-data; boundary=" + boundary,
+                      [this](const BatchTransport::Response &response) {
+        m_uploading = false;
+        if (!response.error.isEmpty() || response.status >= 300) {
+            removeBatchFiles();
+            fail("Batch upload failed: " + responseError(response));
+            return;
+        }
+        const QString fileId = QJsonDocument::fromJson(response.body).object().value("id").toString();
+        if (fileId.isEmpty()) {
+            removeBatchFiles();
+            fail("Batch upload returned no file id.");
+            return;
+        }
+        createBatch(fileId);
+    });
+}
+
+void BatchClient::createBatch(const QString &inputFileId)
+{
+    m_inputFileId = inputFileId;
+
+    QJsonObject request;
+    request["input_file_id"] = inputFileId;
+    request["endpoint"] = QString::fromLatin1(kBatchEndpoint);
+    request["completion_window"] = "24h";
+
+    m_uploading = true;
+    m_transport->send("POST", "/v1/batches", QJsonDocument(request).toJson(QJsonDocument::Compact),
+                      "application/json", [this](const BatchTransport::Response &response) {
+        m_uploading = false;
+        if (!response.error.isEmpty() || response.status >= 300) {
+            removeBatchFiles();
+            fail("Batch creation failed: " + responseError(response));
+            return;
+        }
+        const QJsonObject batch = QJsonDocument::fromJson(response.body).object();
+        m_batchId = batch.value("id").toString();
+        if (m_batchId.isEmpty()) {
+            removeBatchFiles();
+            fail("Batch creation returned no batch id.");
+            return;
+        }
+        m_status = batch.value("status").toString();
+        if (!saveState())
+            qWarning() << "[BatchClient::createBatch] Failed to write batch state:" << m_statePath;
+
+        qDebug() << "[BatchClient::createBatch] Created batch" << m_batchId;
+        emit statusChanged(QString("Batch %1: %2").arg(m_batchId, m_status));
+        m_pollTimer.start();
+    });
+}
+
+void BatchClient::poll()
+{
+    if (m_batchId.isEmpty() || m_downloading)
+        return;
+
+    const QString batchId = m_batchId;
+    m_transport->send("GET", QString("/v1/batches/%1").arg(batchId), QByteArray(), QByteArray(),
+                      [this, batchId](const BatchTransport::Response &response) {
+        // Cancelled or replaced meanwhile
+        if (batchId != m_batchId)
+            return;
+        if (!response.error.isEmpty() || response.status >= 300) {
+            // Transient; try again on the next tick
+            qWarning() << "[BatchClient::poll] Polling" << batchId << "failed:" << responseError(response);
+            return;
+        }
+        onBatchStatus(QJsonDocument::fromJson(response.body).object());
+    });
+}
+
+void BatchClient::onBatchStatus(const QJsonObject &batch)
+{
+    const QString status = batch.value("status").toString();
+    const QJsonObject counts = batch.value("request_counts").toObject();
+
+    if (status != m_status) {
+        m_status = status;
+        saveState();
+    }
+    emit statusChanged(QString("Batch %1: %2 (%3/%4 done, %5 failed)")
+                           .arg(m_batchId, status)
+                           .arg(counts.value("completed").toInt())
+                           .arg(counts.value("total").toInt())
+                           .arg(counts.value("failed").toInt()));
+
+    if (!isTerminalStatus(status))
+        return;
+
+    m_pollTimer.stop();
+
+    if (status == QLatin1String("failed")) {
+        QStringList messages;
+        const QJsonArray errors = batch.value("errors").toObject().value("data").toArray();
+        for (const QJsonValue &error : errors)
+            messages << error.toObject().value("message").toString();
+        // Nothing ran, so there is nothing to collect later either
+        removeBatchFiles();
+        fail(QString("Batch %1 failed: %2").arg(m_batchId, messages.join("; ")));
+        return;
+    }
+
+    // Expired and cancelled batches still return the requests that did complete
+    downloadResults(batch.value("output_file_id").toString(), batch.value("error_file_id").toString());
+}
+
+void BatchClient::downloadResults(const QString &outputFileId, const QString &errorFileId)
+{
+    m_downloading = true;
+    emit statusChanged(QString("Batch %1: downloading results...").arg(m_batchId));
+
+    auto fetch = [this](const QString &fileId, std::function<void(const QByteArray &)> next) {
+        if (fileId.isEmpty()) {
+            next(QByteArray());
+            return;
+        }
+        m_transport->send("GET", QString("/v1/files/%1/content").arg(fileId), QByteArray(), QByteArray(),
+                          [this, fileId, next](const BatchTransport::Response &response) {
+            if (!response.error.isEmpty() || response.status >= 300) {
+                m_downloading = false;
+                fail(QString("Failed to download %1: %2").arg(fileId, responseError(response)));
+                return;
+            }
+            next(response.body);
+        });
+    };
+
+    fetch(outputFileId, [this, fetch, errorFileId](const QByteArray &output) {
+        fetch(errorFileId, [this, output](const QByteArray &errors) {
+            m_downloading = false;
+            applyResults(output, errors);
+        });
+    });
+}
+
+void BatchClient::applyResults(const QByteArray &output, const QByteArray &errors)
+{
+    int updated = 0;
+
+    // Both files hold one JSON object per line, keyed by custom_id
+    const QList<QByteArray> lines = output.split('\n') + errors.split('\n');
+    for (const QByteArray &line : lines) {
+        if (line.trimmed().isEmpty())
+            continue;
+
+        const QJsonObject result = QJsonDocument::fromJson(line).object();
+        const QString customId = result.value("custom_id").toString();
+        if (!m_sessions.contains(customId)) {
+            // Unknown or already written back by an earlier run
+            continue;
+        }
+        const PendingSession pending = m_sessions.value(customId);
+        const QString sessionPath = pending.path;
+        const QString name = QFileInfo(sessionPath).fileName();
+
+        const QJsonObject response = result.value("response").toObject();
+        const int statusCode = response.value("status_code").toInt();
+        if (!result.value("error").isNull() || statusCode != 200) {
+            QString message = result.value("error").toObject().value("message").toString();
+            if (message.isEmpty())
+                message = response.value("body").toObject().value("error").toObject().value("message").toString();
+            m_errors << QString("%1: %2").arg(name, message.isEmpty() ? QString("HTTP %1").arg(statusCode) : message);
+            m_sessions.remove(customId);
+            continue;
+        }
+
+        const QJsonArray choices = response.value("body").toObject().value("choices").toArray();
+        const QString content = choices.at(0).toObject().value("message").toObject().value("content").toString();
+
+        Session session(m_project);
+        if (!session.load(sessionPath)) {
+            m_errors << QString("%1: failed to load session for writing the answer").arg(name);
+            m_sessions.remove(customId);
+            continue;
+        }
+
+        // Appending to a conversation that moved on would answer the wrong prompt
+        const QVector<PromptSlice> &slices = session.slices();
+        const bool unchanged = pending.sliceCount < 0
+                               || (slices.size() == pending.sliceCount
+                                   && slices.constLast().role == MessageRole::User
+                                   && promptDigest(slices.constLast().content) == pending.promptDigest);
+        if (!unchanged) {
+            const QString answerPath = saveOrphanedAnswer(customId, pending, content);
+            m_errors << (answerPath.isEmpty()
+                             ? QString("%1: changed since the batch was sent, and its answer could not be saved").arg(name)
+                             : QString("%1: changed since the batch was sent; the answer was saved to %2")
+                                   .arg(name, QDir::toNativeSeparators(answerPath)));
+            m_sessions.remove(customId);
+            saveState();
+            continue;
+        }
+
+        session.appendAssistantSlice(content);
+        if (!session.save(sessionPath)) {
+            m_errors << QString("%1: failed to save the answer").arg(name);
+            m_sessions.remove(customId);
+            continue;
+        }
+
+        // Written back: never append it again, even if this run is interrupted and resumed
+        m_sessions.remove(customId);
+        saveState();
+        ++updated;
+        emit sessionUpdated(sessionPath);
+    }
+
+    // Requests with neither an answer nor an error (e.g. an expired batch)
+    for (auto it = m_sessions.constBegin(); it != m_sessions.constEnd(); ++it)
+        m_errors << QString("%1: no result (%2)").arg(QFileInfo(it.value().path).fileName(), m_status);
+
+    // Everything is collected; the input file and state are no longer needed
+    removeBatchFiles();
+
+    qDebug() << "[BatchClient::applyResults] Batch" << m_batchId << "updated" << updated << "sessions,"
+             << m_errors.size() << "errors";
+
+    const QStringList errorList = m_errors;
+    reset();
+    emit finished(updated, errorList);
+}
+
+QString BatchClient::saveOrphanedAnswer(const QString &customId, const PendingSession &pending,
+                                       const QString &content) const
+{
+    if (m_statePath.isEmpty())
+        return QString();
+
+    // Next to the batch files, which are removed; answers stay until the user deals with them
+    const QFileInfo state(m_statePath);
+    const QString path = state.dir().filePath(QString("%1_%2_%3.md")
+                                                  .arg(QFileInfo(pending.path).completeBaseName(),
+                                                       state.completeBaseName(), customId));
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly) || file.write(content.toUtf8()) < 0 || !file.commit()) {
+        qWarning() << "[BatchClient::saveOrphanedAnswer] Failed to write" << path;
+        return QString();
+    }
+    return path;
+}
+
+bool BatchClient::saveState() const
+{
+    if (m_statePath.isEmpty())
+        return false;
+
+    QJsonObject sessions;
+    for (auto it = m_sessions.constBegin(); it != m_sessions.constEnd(); ++it) {
+        sessions.insert(it.key(), QJsonObject{
+            {"path", it->path},
+            {"slices", it->sliceCount},
+            {"prompt_digest", it->promptDigest},
+        });
+    }
+
+    QJsonObject state;
+    state["batch_id"] = m_batchId;
+    state["input_file_id"] = m_inputFileId;
+    state["status"] = m_status;
+    state["sessions"] = sessions;
+
+    QSaveFile file(m_statePath);
+    if (!file.open(QIODevice::WriteOnly))
+        return false;
+    file.write(QJsonDocument(state).toJson(QJsonDocument::Indented));
+    return file.commit();
+}
+
+void BatchClient::removeBatchFiles() const
+{
+    if (m_statePath.isEmpty())
+        return;
+    const QFileInfo state(m_statePath);
+    QFile::remove(state.dir().filePath(state.completeBaseName() + ".jsonl"));
+    QFile::remove(m_statePath);
+}
+
+void BatchClient::fail(const QString &error)
+{
+    qWarning() << "[BatchClient]" << error;
+    m_pollTimer.stop();
+    reset();
+    emit failed(error);
+}
+
+void BatchClient::reset()
+{
+    m_statePath.clear();
+    m_batchId.clear();
+    m_inputFileId.clear();
+    m_status.clear();
+    m_uploading = false;
+    m_downloading = false;
+    m_sessions.clear();
+    m_errors.clear();
+}
+
+QString BatchClient::promptDigest(const QString &prompt)
+{
+    return QString::fromLatin1(QCryptographicHash::hash(prompt.toUtf8(), QCryptographicHash::Sha1).toHex());
+}
+
+QString BatchClient::responseError(const BatchTransport::Response &response)
+{
+    if (!response.error.isEmpty())
+        return response.error;
+
+    const QString message = QJsonDocument::fromJson(response.body).object()
+                                .value("error").toObject().value("message").toString();
+    return message.isEmpty() ? QString("HTTP %1").arg(response.status) : QString("HTTP %1: %2").arg(response.status).arg(message);
+}
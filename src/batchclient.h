@@ -0,0 +1,158 @@
+#ifndef BATCHCLIENT_H
+#define BATCHCLIENT_H
+
+#pragma once
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QByteArray>
+#include <QVariantMap>
+#include <QJsonObject>
+#include <QMap>
+#include <QTimer>
+#include <QNetworkAccessManager>
+
+#include <functional>
+
+class Project;
+
+/**
+ * @brief HTTP layer used by BatchClient.
+ *
+ * Paths are relative to the API root ("/v1/files", "/v1/batches/<id>", ...).
+ * The default implementation talks to the OpenAI API; a local stand-in server
+ * can be used by pointing NetworkBatchTransport at another base URL, or by
+ * plugging in a different implementation altogether.
+ */
+class BatchTransport
+{
+public:
+    struct Response {
+        int status = 0;         // HTTP status; 0 when no response was received
+        QByteArray body;
+        QString error;          // Network error, empty on success
+    };
+    using Callback = std::function<void(const Response &response)>;
+
+    virtual ~BatchTransport() = default;
+
+    // Send one request; 'done' is called exactly once, on the caller's thread
+    virtual void send(const QByteArray &verb, const QString &path, const QByteArray &body,
+                      const QByteArray &contentType, Callback done) = 0;
+};
+
+class NetworkBatchTransport : public BatchTransport
+{
+public:
+    static QString defaultBaseUrl() { return QStringLiteral("https://api.openai.com"); }
+
+    explicit NetworkBatchTransport(const QString &accessToken, const QString &baseUrl = defaultBaseUrl());
+
+    void send(const QByteArray &verb, const QString &path, const QByteArray &body,
+              const QByteArray &contentType, Callback done) override;
+
+private:
+    QNetworkAccessManager m_networkManager;
+    QString m_accessToken;
+    QString m_baseUrl;
+};
+
+/**
+ * @brief Sends sessions through the OpenAI Batch API instead of interactively.
+ *
+ * submit() compiles every session with Session::expandedSlices(), writes one
+ * chat completion request per session to a JSONL file under
+ * <sessions>/.batches/, uploads it and creates a batch. The batch is polled
+ * until it ends; every answer is then appended to its session as an
+ * assistant slice. A small state file next to the JSONL keeps the batch id
+ * and the session of every request, so resume() can pick a batch up again
+ * after a restart.
+ *
+ * Submitting never writes the session files. Every request remembers the
+ * slice count and a digest of the prompt it was built from; if the session
+ * was changed while the batch was pending, its answer is written to a file
+ * in the batches folder instead and reported in finished()'s errors.
+ */
+class BatchClient : public QObject
+{
+    Q_OBJECT
+public:
+    // Takes ownership of 'transport'
+    BatchClient(Project *project, BatchTransport *transport, QObject *parent = nullptr);
+    ~BatchClient() override;
+
+    static QString batchesFolder(const QString &sessionsFolder);
+
+    // State files of batches that were submitted but not written back yet
+    static QStringList pendingStateFiles(const QString &sessionsFolder);
+
+    void setPollInterval(int msec) { m_pollTimer.setInterval(msec); }
+
+    // Compile, write, upload and create the batch. Sessions that cannot be sent
+    // (no trailing user prompt, unreadable) are reported in 'errorOut' and skipped.
+    bool submit(const QStringList &sessionPaths, const QString &sessionsFolder, const QVariantMap &params,
+                QString *errorOut = nullptr);
+
+    // Continue polling a batch submitted earlier
+    bool resume(const QString &statePath, QString *errorOut = nullptr);
+
+    // Stop polling and ask the server to cancel the batch
+    void cancel();
+
+    bool isRunning() const { return !m_batchId.isEmpty() || m_uploading; }
+    QString batchId() const { return m_batchId; }
+
+signals:
+    void statusChanged(const QString &status);
+    // An answer was appended to the session file
+    void sessionUpdated(const QString &sessionPath);
+    void finished(int updatedSessions, const QStringList &errors);
+    void failed(const QString &error);
+
+private:
+    // What a request was built from, to check the session before writing its answer back
+    struct PendingSession {
+        QString path;
+        int sliceCount = -1;        // -1: unknown (state written by an older version), not checked
+        QString promptDigest;       // of the trailing user slice
+    };
+
+    // JSONL line for one session; empty with 'errorOut' set when it cannot be sent
+    QByteArray buildRequestLine(const QString &customId, const QString &sessionPath, const QVariantMap &params,
+                                PendingSession &pending, QString *errorOut) const;
+
+    void uploadInputFile(const QByteArray &jsonl);
+    void createBatch(const QString &inputFileId);
+    void poll();
+    void onBatchStatus(const QJsonObject &batch);
+    void downloadResults(const QString &outputFileId, const QString &errorFileId);
+    void applyResults(const QByteArray &output, const QByteArray &errors);
+    // Keep an answer whose session changed meanwhile; returns the file it was written to
+    QString saveOrphanedAnswer(const QString &customId, const PendingSession &pending, const QString &content) const;
+
+    bool saveState() const;
+    // Delete the input JSONL and the state file of the current batch
+    void removeBatchFiles() const;
+    void fail(const QString &error);
+    void reset();
+
+    static QString responseError(const BatchTransport::Response &response);
+    static QString promptDigest(const QString &prompt);
+
+    Project *m_project = nullptr;
+    BatchTransport *m_transport = nullptr;
+    QTimer m_pollTimer;
+
+    QString m_statePath;
+    QString m_batchId;
+    QString m_inputFileId;
+    QString m_status;
+    bool m_uploading = false;
+    bool m_downloading = false;
+    // custom_id -> session of the request
+    QMap<QString, PendingSession> m_sessions;
+    QStringList m_errors;
+};
+
+#endif // BATCHCLIENT_H
@@ -1,14 +1,21 @@
 #include "commandpipemanager.h"
 #include "project.h"
+#include "sourceamalgamator.h"
 
 #include <QDir>
-#include <QDirIterator>
 #include <QFile>
 #include <QFileInfo>
-#include <QTextStream>
+#include <QSaveFile>
+#include <QProcess>
+#include <QTimer>
+#include <QFutureWatcher>
+#include <QtConcurrent/QtConcurrentRun>
+#include <QRegularExpression>
 #include <QDebug>
 #include <functional>
 
+static const QString kAmalgamateSrc = QStringLiteral("amalgamateSrc");
+
 CommandPipeManager::CommandPipeManager(Project *project, const QString &sessionCacheFolder, QObject *parent)
     : QObject(parent)
     , m_project(project)
@@ -17,225 +24,306 @@ CommandPipeManager::CommandPipeManager(Project *project, const QString &sessionC
     qDebug() << "[CommandPipeManager] Initialized with session cache folder:" << m_sessionCacheFolder;
 }
 
-QString CommandPipeManager::runCommandPipe(const QString &name)
+CommandPipeManager::~CommandPipeManager()
 {
-    qDebug() << "[CommandPipeManager] runCommandPipe called with name:" << name;
-
-    if (name == "amalgamateSrc") {
-        QString result = runSrcAmalgamate();
-        if (result.isEmpty()) {
-            qDebug() << "[CommandPipeManager] runSrcAmalgamate succeeded";
-        } else {
-            qWarning() << "[CommandPipeManager] runSrcAmalgamate failed with error:" << result;
+    // Never leave a child process behind a closed session
+    for (RunningPipe &pipe : m_running) {
+        if (pipe.process) {
+            pipe.process->disconnect(this);
+            pipe.process->kill();
         }
-        return result;
     }
-
-    QString unknownCmd = QString("Unknown command pipe: %1").arg(name);
-    qWarning() << "[CommandPipeManager]" << unknownCmd;
-    return unknownCmd;
 }
 
-QString CommandPipeManager::runSrcAmalgamate()
+QString CommandPipeManager::outputPathFor(const QString &name)
 {
-    if (!m_project) {
-        QString err = "No project set in CommandPipeManager";
-        qWarning() << "[runSrcAmalgamate]" << err;
-        return err;
-    }
+    if (name == kAmalgamateSrc)
+        return QStringLiteral("src/src.txt");
 
-    QString srcFolder = m_project->srcFolder();
-    if (!QDir(srcFolder).isAbsolute()) {
-        srcFolder = QDir(m_project->rootFolder()).filePath(srcFolder);
-    }    if (srcFolder.isEmpty()) {
-        QString err = "Project source folder is empty";
-        qWarning() << "[runSrcAmalgamate]" << err;
-        return err;
-    }
+    static const QRegularExpression unsafeRe(QStringLiteral("[^A-Za-z0-9_.-]"));
+    QString fileName = name;
+    fileName.replace(unsafeRe, QStringLiteral("_"));
+    return QStringLiteral("pipes/%1.txt").arg(fileName);
+}
 
-    QDir srcDir(srcFolder);
-    if (!srcDir.exists()) {
-        QString err = QString("Source folder does not exist: %1").arg(srcFolder);
-        qWarning() << "[runSrcAmalgamate]" << err;
-        return err;
+void CommandPipeManager::runPipes(const QStringList &names)
+{
+    if (isRunning()) {
+        qWarning() << "[CommandPipeManager::runPipes] Pipes already running, ignoring new run";
+        return;
     }
 
-    qDebug() << "[runSrcAmalgamate] Scanning source files in:" << srcFolder;
+    m_succeeded.clear();
+    m_errors.clear();
+    m_cancelled = false;
+    ++m_generation;
 
-    QStringList sourceFiles = scanSourceFiles();
+    QStringList unique = names;
+    unique.removeDuplicates();
+    m_total = unique.size();
 
-    if (sourceFiles.isEmpty()) {
-        QString err = "No source files found in source folder";
-        qWarning() << "[runSrcAmalgamate]" << err;
-        return err;
+    if (unique.isEmpty()) {
+        emit finished(m_succeeded, m_errors, false);
+        return;
     }
 
-    qDebug() << "[runSrcAmalgamate] Found" << sourceFiles.size() << "source files.";
+    // Register every pipe before starting any, so an early failure can't end the run prematurely
+    for (const QString &name : unique)
+        m_running.insert(name, RunningPipe());
 
-    QString errorStr;
-    if (!writeAmalgamatedSource(sourceFiles, errorStr)) {
-        qWarning() << "[runSrcAmalgamate] Failed to write amalgamated source:" << errorStr;
-        return errorStr;
-    }
+    emit progress(0, m_total);
 
-    qDebug() << "[runSrcAmalgamate] Amalgamated source written successfully.";
+    // A pipe that fails synchronously reports it right away; a handler may cancel the run
+    // (or cancel and start another) before the loop gets to the next pipe
+    const quint64 generation = m_generation;
 
-    return QString(); // success
-}
+    for (const QString &name : unique) {
+        if (generation != m_generation)
+            return;
 
-QStringList CommandPipeManager::scanSourceFiles() const
-{
-    QStringList results;
+        qDebug() << "[CommandPipeManager::runPipes] Starting command pipe:" << name;
 
-    if (!m_project) {
-        qWarning() << "[scanSourceFiles] No project set";
-        return results;
+        if (name == kAmalgamateSrc) {
+            startAmalgamatePipe();
+        } else if (m_project && m_project->config().commandPipes.contains(name)) {
+            startProcessPipe(name, m_project->config().commandPipes.value(name));
+        } else {
+            completePipe(name, QString("Unknown command pipe: %1").arg(name));
+        }
     }
+}
 
-    QString srcFolder = m_project->srcFolder();
-    if (!QDir(srcFolder).isAbsolute()) {
-        srcFolder = QDir(m_project->rootFolder()).filePath(srcFolder);
-    }    QStringList sourceFileTypes = m_project->getValue("filetypes.source").toStringList();
+void CommandPipeManager::cancel()
+{
+    if (!isRunning())
+        return;
 
-    if (srcFolder.isEmpty()) {
-        qWarning() << "[scanSourceFiles] Source folder is empty";
-        return results;
-    }
+    qDebug() << "[CommandPipeManager::cancel] Cancelling" << m_running.size() << "running pipe(s)";
 
-    QDir dir(srcFolder);
-    if (!dir.exists()) {
-        qWarning() << "[scanSourceFiles] Source folder does not exist:" << srcFolder;
-        return results;
+    for (auto it = m_running.begin(); it != m_running.end(); ++it) {
+        if (it->process) {
+            it->process->disconnect(this);
+            it->process->kill();
+            it->process->deleteLater();
+        }
+        if (it->timeoutTimer)
+            it->timeoutTimer->deleteLater();
+        m_errors.insert(it.key(), QStringLiteral("Cancelled"));
     }
+    m_running.clear();
+    m_cancelled = true;
+    ++m_generation;
 
-    // We want to include CMakeLists.txt and .ui files as well, so add them explicitly
-    QStringList extraPatterns = { "CMakeLists.txt", "*.ui" };
+    emit finished(m_succeeded, m_errors, true);
+}
 
-    // Combine sourceFileTypes and extraPatterns
-    QStringList allPatterns = sourceFileTypes;
-    for (const QString &pat : extraPatterns) {
-        if (!allPatterns.contains(pat))
-            allPatterns.append(pat);
+void CommandPipeManager::startProcessPipe(const QString &name, const QStringList &command)
+{
+    // Accept both ["git", "diff", "."] and ["git diff", "."]
+    QStringList args = command;
+    QStringList program = args.isEmpty() ? QStringList() : QProcess::splitCommand(args.takeFirst());
+    if (program.isEmpty()) {
+        completePipe(name, QString("Command pipe %1 has no command").arg(name));
+        return;
     }
+    args = program.mid(1) + args;
 
-    qDebug() << "[scanSourceFiles] Using patterns:" << allPatterns;
+    const ProjectConfig &config = m_project->config();
 
-    // Recursive iterator excluding "build" folder
-    QDirIterator it(dir.absolutePath(), allPatterns, QDir::Files | QDir::NoSymLinks | QDir::Readable,
-                    QDirIterator::Subdirectories);
+    QProcess *process = new QProcess(this);
+    process->setProcessChannelMode(QProcess::MergedChannels);
+    process->setWorkingDirectory(m_project->rootFolder());
 
-    while (it.hasNext()) {
-        QString filePath = it.next();
+    QTimer *timeoutTimer = new QTimer(this);
+    timeoutTimer->setSingleShot(true);
+    timeoutTimer->setInterval(config.commandPipeTimeoutSecs * 1000);
 
-        //TODO: REPLACE THIS WITH EXCLUDE SETTINGS
-        // Exclude any path containing build
-        QString normalizedPath = QDir::toNativeSeparators(filePath).toLower();
-        if (normalizedPath.contains(QDir::toNativeSeparators("/qmarkdowntextedit/")) ||
-            normalizedPath.contains(QDir::toNativeSeparators("\\qmarkdowntextedit\\"))) {
-            qDebug() << "[scanSourceFiles] Skipping file in qmarkdowntextedit folder:" << filePath;
-            continue;
-        }
+    RunningPipe &pipe = m_running[name];
+    pipe.process = process;
+    pipe.timeoutTimer = timeoutTimer;
 
-        if (normalizedPath.contains(QDir::toNativeSeparators("/build/")) ||
-            normalizedPath.contains(QDir::toNativeSeparators("\\build\\"))) {
-            qDebug() << "[scanSourceFiles] Skipping file in build folder:" << filePath;
-            continue;
-        }
+    const qint64 maxOutput = qint64(config.commandPipeMaxOutputKB) * 1024;
 
-        // Also exclude if path ends with build folder (e.g. .../build or ...\build)
-        QFileInfo fi(filePath);
-        QStringList parts = fi.absoluteFilePath().split(QDir::separator());
-        if (parts.contains("build")) {
-            qDebug() << "[scanSourceFiles] Skipping file due to build folder in path:" << filePath;
-            continue;
-        }
+    connect(process, &QProcess::readyReadStandardOutput, this, [this, name, process, maxOutput]() {
+        auto it = m_running.find(name);
+        if (it == m_running.end())
+            return;
 
-        if (parts.contains("newconfig.json")) {
-            qDebug() << "skipping VK:" << filePath;
-            continue;
+        QByteArray chunk = process->readAllStandardOutput();
+        const qint64 room = maxOutput - it->output.size();
+        if (chunk.size() > room) {
+            // Keep draining the pipe so the process doesn't block, but stop storing
+            chunk.truncate(qMax<qint64>(room, 0));
+            it->truncated = true;
         }
+        it->output.append(chunk);
+    });
+
+    connect(timeoutTimer, &QTimer::timeout, this, [this, name, process]() {
+        auto it = m_running.find(name);
+        if (it == m_running.end())
+            return;
+        qWarning() << "[CommandPipeManager] Command pipe" << name << "timed out, killing it";
+        it->timedOut = true;
+        process->kill();
+    });
+
+    connect(process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
+            this, [this, name](int exitCode, QProcess::ExitStatus status) {
+                onProcessFinished(name, exitCode, status == QProcess::CrashExit);
+            });
+
+    connect(process, &QProcess::errorOccurred, this, [this, name, process](QProcess::ProcessError error) {
+        if (error != QProcess::FailedToStart)
+            return; // crashes and kills are reported through finished()
+        completePipe(name, QString("Failed to start %1: %2").arg(process->program(), process->errorString()));
+    });
+
+    emit pipeStarted(name);
+    timeoutTimer->start();
+    process->start(program.first(), args);
+}
 
-        results.append(filePath);
+void CommandPipeManager::onProcessFinished(const QString &name, int exitCode, bool crashed)
+{
+    auto it = m_running.find(name);
+    if (it == m_running.end())
+        return;
+
+    it->timeoutTimer->stop();
+
+    QByteArray rest = it->process->readAllStandardOutput();
+    const qint64 maxOutput = qint64(m_project->config().commandPipeMaxOutputKB) * 1024;
+    const qint64 room = maxOutput - it->output.size();
+    if (rest.size() > room) {
+        rest.truncate(qMax<qint64>(room, 0));
+        it->truncated = true;
+    }
+    it->output.append(rest);
+
+    QByteArray data = it->output;
+    if (it->truncated)
+        data += QString("\n[output truncated at %1 KB]\n").arg(data.size() / 1024).toUtf8();
+
+    QString error;
+    if (it->timedOut) {
+        error = QString("Command pipe %1 timed out").arg(name);
+        data += "\n[timed out]\n";
+    } else if (crashed) {
+        error = QString("Command pipe %1 crashed").arg(name);
+        data += "\n[crashed]\n";
+    } else if (exitCode != 0) {
+        // A failing build is still useful context: not an error for the pipe itself
+        data += QString("\n[exit code %1]\n").arg(exitCode).toUtf8();
     }
 
-    // Sort alphabetically for consistent output
-    results.sort();
-
-    qDebug() << "[scanSourceFiles] Total files found:" << results.size();
+    QString writeError;
+    if (!writePipeOutput(name, data, writeError) && error.isEmpty())
+        error = writeError;
 
-    return results;
+    completePipe(name, error);
 }
 
-bool CommandPipeManager::writeAmalgamatedSource(const QStringList &filePaths, QString &errorOut) const
+void CommandPipeManager::startAmalgamatePipe()
 {
-
-    if (filePaths.isEmpty()) {
-        errorOut = "No files to write in amalgamated source";
-        qWarning() << "[writeAmalgamatedSource]" << errorOut;
-        return false;
-    }
-
-    QDir cacheDir(m_sessionCacheFolder);
-    if (!cacheDir.exists()) {
-        qDebug() << "[writeAmalgamatedSource] Creating session cache folder:" << m_sessionCacheFolder;
-        if (!QDir().mkpath(m_sessionCacheFolder)) {
-            errorOut = QString("Failed to create session cache folder: %1").arg(m_sessionCacheFolder);
-            qWarning() << "[writeAmalgamatedSource]" << errorOut;
-            return false;
-        }
+    if (!m_project) {
+        completePipe(kAmalgamateSrc, "No project set in CommandPipeManager");
+        return;
     }
 
-    QString srcCacheDirPath = cacheDir.filePath("src");
-    QDir srcCacheDir(srcCacheDirPath);
-    if (!srcCacheDir.exists()) {
-        qDebug() << "[writeAmalgamatedSource] Creating src cache folder:" << srcCacheDirPath;
-        if (!QDir().mkpath(srcCacheDirPath)) {
-            errorOut = QString("Failed to create src cache folder: %1").arg(srcCacheDirPath);
-            qWarning() << "[writeAmalgamatedSource]" << errorOut;
-            return false;
+    // Scanning and concatenating the source tree is file I/O bound: keep it off the GUI thread.
+    // With source watching enabled the output is already current and this is just the write.
+    // A cancelled run's worker can't be stopped; its result must not complete the next run's entry
+    auto *watcher = new QFutureWatcher<QString>(this);
+    const quint64 generation = m_generation;
+    connect(watcher, &QFutureWatcher<QString>::finished, this, [this, watcher, generation]() {
+        watcher->deleteLater();
+        if (generation == m_generation && m_running.contains(kAmalgamateSrc))
+            completePipe(kAmalgamateSrc, watcher->result());
+    });
+
+    emit pipeStarted(kAmalgamateSrc);
+
+    const std::function<SourceAmalgamator::Result()> amalgamate =
+        m_project->sourceAmalgamator()->task(m_project->config());
+    const QString outputPath = QDir(m_sessionCacheFolder).filePath(outputPathFor(kAmalgamateSrc));
+
+    watcher->setFuture(QtConcurrent::run([amalgamate, outputPath]() -> QString {
+        const SourceAmalgamator::Result result = amalgamate();
+        if (!result.error.isEmpty()) {
+            qWarning() << "[runSrcAmalgamate]" << result.error;
+            return result.error;
         }
-    }
 
-    QString outputFilePath = srcCacheDir.filePath("src.txt");
-    qDebug() << "[writeAmalgamatedSource] Absolute output file path:" << QFileInfo(outputFilePath).absoluteFilePath();
+        // One bulk write of the whole output
+        QDir outputDir = QFileInfo(outputPath).dir();
+        if (!outputDir.exists() && !outputDir.mkpath("."))
+            return QString("Failed to create src cache folder: %1").arg(outputDir.absolutePath());
+
+        QSaveFile outFile(outputPath);
+        if (!outFile.open(QIODevice::WriteOnly))
+            return QString("Failed to open output file for writing: %1").arg(outputPath);
+        outFile.write(result.data);
+        if (!outFile.commit())
+            return QString("Failed to write output file: %1").arg(outputPath);
+
+        qDebug() << "[runSrcAmalgamate] Wrote" << result.fileCount << "files (" << result.readCount << "re-read,"
+                 << result.data.size() << "bytes) to" << outputPath;
+        return QString(); // success
+    }));
+}
 
-    QFile outFile(outputFilePath);
-    if (!outFile.open(QIODevice::WriteOnly | QIODevice::Text)) {
-        errorOut = QString("Failed to open output file for writing: %1").arg(outputFilePath);
-        qWarning() << "[writeAmalgamatedSource]" << errorOut;
-        return false;
+void CommandPipeManager::completePipe(const QString &name, const QString &error)
+{
+    auto it = m_running.find(name);
+    if (it == m_running.end())
+        return;
+
+    if (it->process)
+        it->process->deleteLater();
+    if (it->timeoutTimer)
+        it->timeoutTimer->deleteLater();
+    m_running.erase(it);
+
+    if (error.isEmpty()) {
+        qDebug() << "[CommandPipeManager] Command pipe" << name << "succeeded";
+        m_succeeded.append(name);
+    } else {
+        qWarning() << "[CommandPipeManager] Command pipe" << name << "failed:" << error;
+        m_errors.insert(name, error);
     }
 
-    QTextStream out(&outFile);
+    emit pipeFinished(name, error);
+    emit progress(m_total - m_running.size(), m_total);
 
-    qDebug() << "[writeAmalgamatedSource] Writing amalgamated source to:" << outputFilePath;
-
-    for (const QString &filePath : filePaths) {
-        QFileInfo fi(filePath);
-        QString relativePath = QDir(m_project->rootFolder()).relativeFilePath(filePath);
-
-        out << "### `" << relativePath << "`\n";
-        out << "```cpp\n";
+    if (m_running.isEmpty())
+        emit finished(m_succeeded, m_errors, false);
+}
 
-        QFile inFile(filePath);
-        if (!inFile.open(QIODevice::ReadOnly | QIODevice::Text)) {
-            out << "[Error: Could not open file]\n";
-            qWarning() << "[writeAmalgamatedSource] Failed to open source file for reading:" << filePath;
-        } else {
-            QTextStream in(&inFile);
-            while (!in.atEnd()) {
-                QString line = in.readLine();
-                out << line << "\n";
-            }
-            inFile.close();
-        }
+bool CommandPipeManager::writePipeOutput(const QString &name, const QByteArray &data, QString &errorOut) const
+{
+    const QString outputPath = QDir(m_sessionCacheFolder).filePath(outputPathFor(name));
 
-        out << "```\n\n";
+    QDir outputDir = QFileInfo(outputPath).dir();
+    if (!outputDir.exists() && !outputDir.mkpath(".")) {
+        errorOut = QString("Failed to create pipe output folder: %1").arg(outputDir.absolutePath());
+        qWarning() << "[writePipeOutput]" << errorOut;
+        return false;
     }
 
-    outFile.close();
-
-    qDebug() << "[writeAmalgamatedSource] Finished writing amalgamated source.";
+    QSaveFile outFile(outputPath);
+    if (!outFile.open(QIODevice::WriteOnly)) {
+        errorOut = QString("Failed to open output file for writing: %1").arg(outputPath);
+        qWarning() << "[writePipeOutput]" << errorOut;
+        return false;
+    }
+    outFile.write(data);
+    if (!outFile.commit()) {
+        errorOut = QString("Failed to write output file: %1").arg(outputPath);
+        qWarning() << "[writePipeOutput]" << errorOut;
+        return false;
+    }
 
+    qDebug() << "[writePipeOutput] Wrote" << data.size() << "bytes of" << name << "output to" << outputPath;
     return true;
 }
@@ -6,29 +6,76 @@
 #include <QObject>
 #include <QString>
 #include <QStringList>
+#include <QMap>
+#include <QByteArray>
+
+#include "projectconfig.h"
 
 class Project;
+class QProcess;
+class QTimer;
 
+/**
+ * @brief Runs command pipes (<!-- command: name -->) asynchronously.
+ *
+ * "amalgamateSrc" takes the project's SourceAmalgamator output on a worker thread; every
+ * other name runs the matching ProjectConfig::commandPipes entry through
+ * QProcess. All pipes of one run execute concurrently. Each process is bounded
+ * by the project's timeout and output cap, and its combined stdout/stderr is
+ * written into the session cache at outputPathFor(name), to be included through
+ * a <!-- cached: --> marker.
+ */
 class CommandPipeManager : public QObject
 {
     Q_OBJECT
 public:
     explicit CommandPipeManager(Project *project, const QString &sessionCacheFolder, QObject *parent = nullptr);
+    ~CommandPipeManager() override;
+
+    // Session cache relative path a pipe's output is written to
+    static QString outputPathFor(const QString &name);
+
+    // Start the named pipes concurrently; duplicates run once.
+    // pipeFinished() is emitted per pipe and finished() once all are done.
+    void runPipes(const QStringList &names);
+
+    // Stop every running pipe; finished() reports the run as cancelled
+    void cancel();
 
-    // Runs the named command pipe synchronously.
-    // Returns empty string on success, or error message on failure.
-    QString runCommandPipe(const QString &name);
+    bool isRunning() const { return !m_running.isEmpty(); }
+
+signals:
+    void pipeStarted(const QString &name);
+    // Empty error on success
+    void pipeFinished(const QString &name, const QString &error);
+    void progress(int finishedCount, int totalCount);
+    // Names of the pipes that succeeded, and the errors of those that did not
+    void finished(const QStringList &succeeded, const QMap<QString, QString> &errors, bool cancelled);
 
 private:
-    QString runSrcAmalgamate();
+    struct RunningPipe {
+        QProcess *process = nullptr;
+        QTimer *timeoutTimer = nullptr;
+        QByteArray output;
+        bool truncated = false;
+        bool timedOut = false;
+    };
+
+    void startProcessPipe(const QString &name, const QStringList &command);
+    void startAmalgamatePipe();
+    void onProcessFinished(const QString &name, int exitCode, bool crashed);
+    void completePipe(const QString &name, const QString &error);
+    bool writePipeOutput(const QString &name, const QByteArray &data, QString &errorOut) const;
 
     Project *m_project;
     QString m_sessionCacheFolder;
 
-    // Helper to recursively scan source folder, excluding "build" folder
-    QStringList scanSourceFiles() const;
-
-    // Helper to write amalgamated source to src/src.txt in session cache
-    bool writeAmalgamatedSource(const QStringList &filePaths, QString &errorOut) const;
+    QMap<QString, RunningPipe> m_running;
+    QStringList m_succeeded;
+    QMap<QString, QString> m_errors;
+    int m_total = 0;
+    bool m_cancelled = false;
+    // Bumped by every run and cancel; work that outlives its run (the amalgamate worker) checks it
+    quint64 m_generation = 0;
 };
 #endif // COMMANDPIPEMANAGER_H
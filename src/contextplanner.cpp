@@ -0,0 +1,284 @@
+#include "contextplanner.h"
+#include "project.h"
+#include "promptcompiler.h"
+#include "tokenizer.h"
+
+#include <QDir>
+#include <QHash>
+#include <QLocale>
+#include <QSet>
+#include <QDebug>
+
+namespace {
+
+// Includes shorter than this are left alone; their text may occur by chance
+const int kMinDedupeChars = 256;
+// Start of an old answer kept when shortening it
+const int kShortenedChars = 600;
+
+QString roleName(MessageRole role)
+{
+    switch (role) {
+    case MessageRole::User: return QStringLiteral("user");
+    case MessageRole::Assistant: return QStringLiteral("assistant");
+    case MessageRole::System: return QStringLiteral("system");
+    }
+    return QString();
+}
+
+} // namespace
+
+ContextPlanner::Policy ContextPlanner::Policy::forProject(const Project *project)
+{
+    Policy policy;
+    if (!project)
+        return policy;
+
+    const QString history = project->config().apiContextPolicy;
+    if (history == QLatin1String("off"))
+        policy.history = Off;
+    else if (history == QLatin1String("drop"))
+        policy.history = Drop;
+    policy.commandOutputMaxTokens = qMax(0, project->config().apiCommandOutputMaxTokens);
+    return policy;
+}
+
+QStringList ContextPlanner::Plan::report() const
+{
+    QLocale locale;
+    QStringList lines;
+    for (const Removal &removal : removals) {
+        lines << QString("slice %1 (%2): %3, %4 tokens")
+                     .arg(removal.sliceIndex + 1)
+                     .arg(roleName(removal.role), removal.description, locale.toString(removal.tokens));
+    }
+    return lines;
+}
+
+ContextPlanner::ContextPlanner(const Session &session, const Tokenizer &tokenizer, const Policy &policy)
+    : m_session(session)
+    , m_tokenizer(tokenizer)
+    , m_policy(policy)
+{
+}
+
+ContextPlanner::Plan ContextPlanner::plan(const QVector<PromptSlice> &expandedSlices, int budget) const
+{
+    Plan plan;
+    plan.budget = budget;
+    plan.slices = expandedSlices;
+
+    QVector<int> tokens;
+    tokens.reserve(plan.slices.size());
+    for (const PromptSlice &slice : plan.slices)
+        tokens.append(countSlice(slice.content));
+
+    QVector<bool> dropped(plan.slices.size(), false);
+    auto total = [&]() {
+        int sum = Tokenizer::kReplyPrimingTokens;
+        for (int i = 0; i < tokens.size(); ++i) {
+            if (!dropped.at(i))
+                sum += tokens.at(i) + Tokenizer::kTokensPerMessage;
+        }
+        return sum;
+    };
+    plan.tokensBefore = total();
+    plan.tokensAfter = plan.tokensBefore;
+
+    // The markers are read from the session's slices; anything else is only counted
+    if (expandedSlices.size() != m_session.slices().size())
+        return plan;
+
+    auto remove = [&plan](int i, const QString &what, int saved) {
+        plan.removals.append({i, plan.slices.at(i).role, what, saved});
+    };
+
+    truncateCommandOutput(plan, tokens);
+
+    if (m_policy.history != Off) {
+        // The latest prompt and the exchange it follows (the answer it replies to and that
+        // answer's prompt) stay as they are
+        int protectedFrom = plan.slices.size() - 1;
+        while (protectedFrom > 0 && plan.slices.at(protectedFrom - 1).role == MessageRole::Assistant)
+            --protectedFrom;
+        if (protectedFrom > 0 && protectedFrom < plan.slices.size() - 1
+            && plan.slices.at(protectedFrom - 1).role == MessageRole::User)
+            --protectedFrom;
+
+        for (int i = 0; i < protectedFrom && total() > budget; ++i) {
+            const PromptSlice &slice = plan.slices.at(i);
+            if (slice.role != MessageRole::Assistant)
+                continue;
+
+            if (m_policy.history == Drop) {
+                dropped[i] = true;
+                remove(i, QStringLiteral("dropped"), tokens.at(i) + Tokenizer::kTokensPerMessage);
+                continue;
+            }
+
+            const QString content = shortened(slice.content);
+            const int shortenedTokens = countSlice(content);
+            if (shortenedTokens >= tokens.at(i))
+                continue;
+            plan.slices[i].content = content;
+            remove(i, QStringLiteral("shortened"), tokens.at(i) - shortenedTokens);
+            tokens[i] = shortenedTokens;
+        }
+
+        // Still too large: whole exchanges (a prompt and the answers that follow it) go, oldest first
+        for (int i = 0; i < protectedFrom && total() > budget; ++i) {
+            if (plan.slices.at(i).role == MessageRole::System)
+                continue;
+            int end = i + 1;
+            while (end < protectedFrom && plan.slices.at(end).role == MessageRole::Assistant)
+                ++end;
+            for (int j = i; j < end; ++j) {
+                if (dropped.at(j))
+                    continue;
+                dropped[j] = true;
+                remove(j, QStringLiteral("dropped"), tokens.at(j) + Tokenizer::kTokensPerMessage);
+            }
+            i = end - 1;
+        }
+    }
+
+    // Last, so a reference never points at a copy that was dropped or shortened away
+    dedupeIncludes(plan, tokens, dropped);
+
+    plan.tokensAfter = total();
+
+    QVector<PromptSlice> kept;
+    kept.reserve(plan.slices.size());
+    for (int i = 0; i < plan.slices.size(); ++i) {
+        if (!dropped.at(i))
+            kept.append(plan.slices.at(i));
+    }
+    plan.slices = kept;
+
+    qDebug() << "[ContextPlanner::plan]" << plan.tokensBefore << "->" << plan.tokensAfter
+             << "tokens, budget" << budget << "," << plan.removals.size() << "removals";
+    return plan;
+}
+
+int ContextPlanner::countSlice(const QString &content) const
+{
+    // Slices are recounted on every send; only the changed ones are tokenized again
+    return m_tokenizer.countCached(content);
+}
+
+void ContextPlanner::dedupeIncludes(Plan &plan, QVector<int> &tokens, const QVector<bool> &dropped) const
+{
+    // Every marker of a path expands to the same snapshot; the first copy that is sent stays, so
+    // the prompt prefix (and the service's prompt cache) is not disturbed by later turns
+    QSet<QString> seen;
+    for (int i = 0; i < plan.slices.size(); ++i) {
+        if (dropped.at(i))
+            continue;
+        QString &content = plan.slices[i].content;
+        QHash<QString, int> firstCopyEnd;   // paths first included by this very slice
+        bool changed = false;
+
+        const QVector<PromptCompiler::Segment> segments =
+            PromptCompiler::tokenize(m_session.slices().at(i).content, {QStringLiteral("cached")});
+        for (const PromptCompiler::Segment &segment : segments) {
+            if (segment.type != PromptCompiler::Segment::Marker)
+                continue;
+
+            const QString relPath = QDir::cleanPath(segment.argument);
+            const QString text = m_session.cachedIncludeContent(relPath);
+            if (text.size() < kMinDedupeChars)
+                continue;
+
+            if (!seen.contains(relPath)) {
+                // A shortened slice may have lost its copy; the next one is the first then
+                const int first = content.indexOf(text);
+                if (first >= 0) {
+                    seen.insert(relPath);
+                    firstCopyEnd.insert(relPath, first + text.size());
+                }
+                continue;
+            }
+
+            const int pos = content.indexOf(text, firstCopyEnd.value(relPath, 0));
+            if (pos < 0)
+                continue;
+            const QString reference = QString("[%1: unchanged, see the copy above]").arg(relPath);
+            content.replace(pos, text.size(), reference);
+            plan.removals.append({i, plan.slices.at(i).role, QString("repeated include %1").arg(relPath),
+                                  m_session.includeTokenCount(relPath, m_tokenizer) - m_tokenizer.count(reference)});
+            changed = true;
+        }
+
+        if (changed)
+            tokens[i] = countSlice(content);
+    }
+}
+
+void ContextPlanner::truncateCommandOutput(Plan &plan, QVector<int> &tokens) const
+{
+    if (m_policy.commandOutputMaxTokens <= 0)
+        return;
+
+    for (int i = 0; i < plan.slices.size(); ++i) {
+        QString &content = plan.slices[i].content;
+        bool changed = false;
+
+        const QVector<PromptCompiler::Segment> segments =
+            PromptCompiler::tokenize(m_session.slices().at(i).content, {QStringLiteral("cached")});
+        for (const PromptCompiler::Segment &segment : segments) {
+            const QString relPath = QDir::cleanPath(segment.argument);
+            // Command pipe outputs (CommandPipeManager::outputPathFor)
+            if (segment.type != PromptCompiler::Segment::Marker || !relPath.startsWith(QLatin1String("pipes/")))
+                continue;
+
+            const int outputTokens = m_session.includeTokenCount(relPath, m_tokenizer);
+            if (outputTokens <= m_policy.commandOutputMaxTokens)
+                continue;
+            const QString text = m_session.cachedIncludeContent(relPath);
+            const int pos = content.indexOf(text);
+            if (text.isEmpty() || pos < 0)
+                continue;
+
+            const int keepChars = int(qint64(text.size()) * m_policy.commandOutputMaxTokens / outputTokens);
+            const QString truncated = truncatedMiddle(text, keepChars, relPath);
+            content.replace(pos, text.size(), truncated);
+            plan.removals.append({i, plan.slices.at(i).role, QString("truncated command output %1").arg(relPath),
+                                  outputTokens - m_tokenizer.count(truncated)});
+            changed = true;
+        }
+
+        if (changed)
+            tokens[i] = countSlice(content);
+    }
+}
+
+QString ContextPlanner::shortened(const QString &content)
+{
+    if (content.size() <= kShortenedChars)
+        return content;
+
+    // Cut at a paragraph or line end so the kept start reads as a whole
+    int cut = content.lastIndexOf(QLatin1String("\n\n"), kShortenedChars);
+    if (cut < kShortenedChars / 2)
+        cut = content.lastIndexOf(QLatin1Char('\n'), kShortenedChars);
+    if (cut < kShortenedChars / 2)
+        cut = kShortenedChars;
+
+    return content.left(cut).trimmed() + QLatin1String("\n\n[... rest of this earlier answer left out to fit the context ...]");
+}
+
+QString ContextPlanner::truncatedMiddle(const QString &text, int keepChars, const QString &relPath)
+{
+    // Errors and summaries of builds and tests are at the start and the end
+    int headEnd = text.lastIndexOf(QLatin1Char('\n'), qMax(0, keepChars / 2));
+    if (headEnd < 0)
+        headEnd = keepChars / 2;
+    int tailStart = text.indexOf(QLatin1Char('\n'), qMax(headEnd, int(text.size()) - keepChars / 2));
+    if (tailStart < 0)
+        tailStart = qMax(headEnd, int(text.size()) - keepChars / 2);
+
+    const int omittedLines = text.mid(headEnd, tailStart - headEnd).count(QLatin1Char('\n'));
+    return text.left(headEnd)
+           + QString("\n[... %1 lines of %2 left out to fit the context ...]").arg(omittedLines).arg(relPath)
+           + text.mid(tailStart);
+}
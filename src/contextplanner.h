@@ -0,0 +1,84 @@
+#ifndef CONTEXTPLANNER_H
+#define CONTEXTPLANNER_H
+
+#pragma once
+
+#include "session.h"
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+class Project;
+class Tokenizer;
+
+/**
+ * @brief Fits an expanded prompt stack into a token budget before it is sent.
+ *
+ * Runs between Session::expandedSlices() and AIBackend::startRequest(). In order:
+ *  - command pipe output over the configured size keeps its head and tail
+ *  - while over budget, the oldest assistant answers are shortened or dropped,
+ *    per the project's context policy (Off leaves the history as it is)
+ *  - as a last resort, the oldest exchanges (a prompt and its answers) are dropped
+ *  - repeated includes: later copies of a cached include among the slices that
+ *    are sent are replaced by a reference to the first one (always, not only
+ *    over budget)
+ * The system slices, the latest prompt and the exchange before it are never
+ * shortened or dropped. Every change is listed in the plan with the tokens it
+ * saved; the token totals are filled in on every policy.
+ */
+class ContextPlanner
+{
+public:
+    enum HistoryPolicy {
+        Off,        // leave the history as it is
+        Shorten,    // keep the start of old answers
+        Drop        // leave old answers out
+    };
+
+    struct Policy {
+        HistoryPolicy history = Shorten;
+        int commandOutputMaxTokens = 0;     // 0: no limit
+
+        static Policy forProject(const Project *project);
+    };
+
+    struct Removal {
+        int sliceIndex = -1;    // in the session
+        MessageRole role = MessageRole::User;
+        QString description;    // e.g. "repeated include docs/Vision.md"
+        int tokens = 0;         // tokens saved
+    };
+
+    struct Plan {
+        QVector<PromptSlice> slices;    // to send; dropped slices are left out
+        QVector<Removal> removals;
+        int budget = 0;
+        int tokensBefore = 0;
+        int tokensAfter = 0;
+
+        bool fits() const { return tokensAfter <= budget; }
+        int tokensSaved() const { return tokensBefore - tokensAfter; }
+        // One line per removal, e.g. "slice 4 (assistant): shortened, 1,200 tokens"
+        QStringList report() const;
+    };
+
+    ContextPlanner(const Session &session, const Tokenizer &tokenizer, const Policy &policy);
+
+    // 'expandedSlices' must be the session's slices, expanded, in session order
+    Plan plan(const QVector<PromptSlice> &expandedSlices, int budget) const;
+
+private:
+    int countSlice(const QString &content) const;
+    void dedupeIncludes(Plan &plan, QVector<int> &tokens, const QVector<bool> &dropped) const;
+    void truncateCommandOutput(Plan &plan, QVector<int> &tokens) const;
+
+    static QString shortened(const QString &content);
+    static QString truncatedMiddle(const QString &text, int keepChars, const QString &relPath);
+
+    const Session &m_session;
+    const Tokenizer &m_tokenizer;
+    Policy m_policy;
+};
+
+#endif // CONTEXTPLANNER_H
@@ -132,8 +132,10 @@ void DescriptionGenerator::generateTitleAndDescription()
     messages.append({AIBackend::Message::System, systemPrompt});
 
     // this should be specified in app settings (or maybe even project settings)
-    QVariantMap params;
+    QVariantMap params = m_requestParams;
     params["model"] = "gpt-4.1-nano";
+    // Queued behind interactive sends when rate limits bite
+    params["priority"] = "background";
 
     m_currentRequestId = QStringLiteral("generateTitleDesc_%1").arg(QDateTime::currentMSecsSinceEpoch());
 
@@ -3,6 +3,7 @@
 
 #include <QObject>
 #include <QString>
+#include <QVariantMap>
 
 class Session;
 class AIBackend;
@@ -13,6 +14,9 @@ class DescriptionGenerator : public QObject
 public:
     explicit DescriptionGenerator(Session* session, AIBackend* aiBackend, QObject* parent = nullptr);
 
+    // Params sent with the generation request (e.g. the session's project settings)
+    void setRequestParams(const QVariantMap& params) { m_requestParams = params; }
+
     // Run generation invisibly, emits signals on completion or error
     void generateTitleAndDescription();
 
@@ -33,6 +37,7 @@ private:
     AIBackend* m_aiBackend = nullptr;
 
     QString m_currentRequestId;
+    QVariantMap m_requestParams;
 
     // UI pointers for dialog mode
     class DialogUi;
@@ -0,0 +1,146 @@
+#include "includestore.h"
+
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QCryptographicHash>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QDebug>
+
+IncludeStore::IncludeStore(const QString &sessionsFolder)
+    : m_sessionsFolder(sessionsFolder)
+    , m_rootFolder(QDir(sessionsFolder).filePath(".objects"))
+{
+}
+
+QString IncludeStore::hashData(const QByteArray &data)
+{
+    return QString::fromLatin1(QCryptographicHash::hash(data, QCryptographicHash::Sha256).toHex());
+}
+
+QString IncludeStore::objectPath(const QString &hash) const
+{
+    if (hash.size() < 3)
+        return QString();
+    return QDir(m_rootFolder).filePath(hash.left(2) + "/" + hash.mid(2));
+}
+
+bool IncludeStore::contains(const QString &hash) const
+{
+    QString path = objectPath(hash);
+    return !path.isEmpty() && QFileInfo::exists(path);
+}
+
+QString IncludeStore::storeFile(const QString &srcPath, QString *errorOut)
+{
+    QFile srcFile(srcPath);
+    if (!srcFile.open(QIODevice::ReadOnly)) {
+        QString err = QString("Failed to open file for storing: %1").arg(srcPath);
+        qWarning() << "[IncludeStore::storeFile]" << err;
+        if (errorOut)
+            *errorOut = err;
+        return QString();
+    }
+
+    QByteArray data = srcFile.readAll();
+    srcFile.close();
+
+    return storeData(data, errorOut);
+}
+
+QString IncludeStore::storeData(const QByteArray &data, QString *errorOut)
+{
+    QString hash = hashData(data);
+    QString path = objectPath(hash);
+
+    if (QFileInfo::exists(path)) {
+        qDebug() << "[IncludeStore::storeData] Object already stored:" << hash;
+        return hash;
+    }
+
+    QDir objectDir = QFileInfo(path).dir();
+    if (!objectDir.exists() && !objectDir.mkpath(".")) {
+        QString err = QString("Failed to create object folder: %1").arg(objectDir.absolutePath());
+        qWarning() << "[IncludeStore::storeData]" << err;
+        if (errorOut)
+            *errorOut = err;
+        return QString();
+    }
+
+    // Write atomically so a crash never leaves a truncated object behind its hash
+    QSaveFile objectFile(path);
+    if (!objectFile.open(QIODevice::WriteOnly)) {
+        QString err = QString("Failed to open object for writing: %1").arg(path);
+        qWarning() << "[IncludeStore::storeData]" << err;
+        if (errorOut)
+            *errorOut = err;
+        return QString();
+    }
+    objectFile.write(data);
+    if (!objectFile.commit()) {
+        QString err = QString("Failed to write object: %1").arg(path);
+        qWarning() << "[IncludeStore::storeData]" << err;
+        if (errorOut)
+            *errorOut = err;
+        return QString();
+    }
+
+    qDebug() << "[IncludeStore::storeData] Stored object" << hash << "(" << data.size() << "bytes)";
+    return hash;
+}
+
+QSet<QString> IncludeStore::referencedHashes() const
+{
+    QSet<QString> hashes;
+
+    QDir sessionsDir(m_sessionsFolder);
+    const QFileInfoList cacheFolders = sessionsDir.entryInfoList(QDir::Dirs | QDir::NoDotAndDotDot);
+    for (const QFileInfo &folder : cacheFolders) {
+        QFile manifestFile(QDir(folder.absoluteFilePath()).filePath(manifestFileName()));
+        if (!manifestFile.open(QIODevice::ReadOnly))
+            continue;
+
+        QJsonDocument doc = QJsonDocument::fromJson(manifestFile.readAll());
+        manifestFile.close();
+
+        const QJsonObject entries = doc.object().value("entries").toObject();
+        for (auto it = entries.constBegin(); it != entries.constEnd(); ++it) {
+            QString hash = it.value().toObject().value("hash").toString();
+            if (!hash.isEmpty())
+                hashes.insert(hash);
+        }
+    }
+
+    return hashes;
+}
+
+int IncludeStore::collectGarbage() const
+{
+    if (!QDir(m_rootFolder).exists())
+        return 0;
+
+    const QSet<QString> referenced = referencedHashes();
+    int removed = 0;
+
+    QDirIterator it(m_rootFolder, QDir::Files, QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        QString path = it.next();
+        QFileInfo fi(path);
+        QString hash = fi.dir().dirName() + fi.fileName();
+
+        if (referenced.contains(hash))
+            continue;
+
+        if (QFile::remove(path)) {
+            ++removed;
+        } else {
+            qWarning() << "[IncludeStore::collectGarbage] Failed to remove object:" << path;
+        }
+    }
+
+    qDebug() << "[IncludeStore::collectGarbage] Removed" << removed << "unreferenced objects";
+    return removed;
+}
@@ -0,0 +1,52 @@
+#ifndef INCLUDESTORE_H
+#define INCLUDESTORE_H
+
+#pragma once
+
+#include <QString>
+#include <QByteArray>
+#include <QSet>
+
+/**
+ * @brief Content-addressed object store shared by all sessions of a project.
+ *
+ * Included files are stored once under <sessions>/.objects/ab/cdef..., keyed by
+ * the SHA-256 of their contents. Session cache folders only keep a small
+ * manifest (includes.json) mapping each cached path to an object hash, so
+ * identical documents are never duplicated across sessions.
+ */
+class IncludeStore
+{
+public:
+    explicit IncludeStore(const QString &sessionsFolder);
+
+    // Name of the per-session manifest file inside a session cache folder
+    static QString manifestFileName() { return QStringLiteral("includes.json"); }
+
+    QString rootFolder() const { return m_rootFolder; }
+
+    // Absolute path of the object for a content hash (may not exist)
+    QString objectPath(const QString &hash) const;
+    bool contains(const QString &hash) const;
+
+    // Store the contents of a file; returns its hash, or an empty string on failure.
+    // Nothing is written when an object with the same contents already exists.
+    QString storeFile(const QString &srcPath, QString *errorOut = nullptr);
+
+    // Store raw data; returns its hash, or an empty string on failure.
+    QString storeData(const QByteArray &data, QString *errorOut = nullptr);
+
+    static QString hashData(const QByteArray &data);
+
+    // Hashes referenced by every session manifest in the sessions folder
+    QSet<QString> referencedHashes() const;
+
+    // Delete objects no session manifest references any more; returns the number removed
+    int collectGarbage() const;
+
+private:
+    QString m_sessionsFolder;
+    QString m_rootFolder;
+};
+
+#endif // INCLUDESTORE_H
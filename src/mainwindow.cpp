@@ -7,7 +7,14 @@
 #include "applicationsettingsdialog.h"
 #include "project.h"
 #include "openaibackend.h"
+#include "openairesponsesbackend.h"
+#include "requestscheduler.h"
+#include "responsecache.h"
+#include "requesttelemetry.h"
+#include "batchclient.h"
 #include "session.h"
+#include "includestore.h"
+#include "sessionindex.h"
 
 #include <QMenuBar>
 #include <QMenu>
@@ -20,6 +27,7 @@
 #include <QListWidget>
 #include <QTreeWidget>
 #include <QPushButton>
+#include <QComboBox>
 #include <QFileDialog>
 #include <QFileInfo>
 #include <QDir>
@@ -75,9 +83,24 @@ MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
 {
     this->resize(700, 1200);
+
+    // One backend (and one connection pool) for every tab, window and generator,
+    // behind a scheduler that respects the API rate limits and the (opt-in) response cache;
+    // projects on the Responses API are sent there, the rest to chat completions.
+    // Telemetry sits outermost so it sees what the user waits for, queueing and cache hits included
+    OpenAIBackend* chatBackend = new OpenAIBackend();
+    RequestScheduler* scheduler = new RequestScheduler(new OpenAIResponsesBackend(chatBackend, chatBackend->networkManager()));
+    m_aiBackend = new RequestTelemetry(new ResponseCache(scheduler), this);
+
     setupUi();
+
+    connect(scheduler, &RequestScheduler::queueChanged, this, [this](int depth, qint64 oldestWaitMs) {
+        m_requestQueueLabel->setVisible(depth > 0);
+        m_requestQueueLabel->setText(QString("Queued requests: %1 (waiting %2 s)").arg(depth).arg(oldestWaitMs / 1000));
+    });
+
     tryAutoLoadProject();
-    m_tabManager = new TabManager(m_tabWidget, m_projectTab, m_project, this);
+    m_tabManager = new TabManager(m_tabWidget, m_projectTab, m_project, m_aiBackend, this);
 }
 
 MainWindow::~MainWindow()
@@ -92,21 +115,23 @@ MainWindow::~MainWindow()
     delete m_project;
 }
 
-AIBackend* createBackendForProject(Project* project, QObject* parent = nullptr)
+QVariantMap backendConfigForProject(Project* project)
 {
-    OpenAIBackend* backend = new OpenAIBackend(parent);
-    if (project) {
-        QVariantMap apiConfig;
-        apiConfig["access_token"] = project->accessToken();
-        apiConfig["model"] = project->model();
-        apiConfig["max_tokens"] = project->maxTokens();
-        apiConfig["temperature"] = project->temperature();
-        apiConfig["top_p"] = project->topP();
-        apiConfig["frequency_penalty"] = project->frequencyPenalty();
-        apiConfig["presence_penalty"] = project->presencePenalty();
-        backend->setConfig(apiConfig);
-    }
-    return backend;
+    QVariantMap apiConfig;
+    apiConfig["access_token"] = project->accessToken();
+    apiConfig["model"] = project->model();
+    apiConfig["max_tokens"] = project->maxTokens();
+    apiConfig["temperature"] = project->temperature();
+    apiConfig["top_p"] = project->topP();
+    apiConfig["frequency_penalty"] = project->frequencyPenalty();
+    apiConfig["presence_penalty"] = project->presencePenalty();
+    apiConfig["response_cache"] = project->responseCache();
+    apiConfig["response_cache_max_mb"] = project->responseCacheMaxMB();
+    apiConfig["stream_journal"] = project->streamJournal();
+    apiConfig["endpoint"] = project->apiEndpoint();
+    apiConfig["max_concurrent_requests"] = project->maxConcurrentRequests();
+    apiConfig["telemetry_file"] = RequestTelemetry::telemetryFile(QDir(project->rootFolder()).filePath(project->sessionsFolder()));
+    return apiConfig;
 }
 
 void MainWindow::setupUi()
@@ -172,6 +197,11 @@ void MainWindow::setupUi()
 
     statusBar();
 
+    // Shown while the request scheduler holds back requests (rate limits, retries)
+    m_requestQueueLabel = new QLabel(this);
+    m_requestQueueLabel->setVisible(false);
+    statusBar()->addPermanentWidget(m_requestQueueLabel);
+
     // === Central Tabs ===
     m_tabWidget = new DraggableTabWidget(this);
     setCentralWidget(m_tabWidget);
@@ -208,7 +238,8 @@ void MainWindow::setupUi()
     m_sessionList->setColumnCount(4);
     m_sessionList->setHeaderLabels(QStringList() << "#" << "Name" << "Slices" << "Size (KB)");
     m_sessionList->setRootIsDecorated(false);
-    m_sessionList->setSelectionMode(QAbstractItemView::SingleSelection);
+    // Several sessions can be selected for a batch send
+    m_sessionList->setSelectionMode(QAbstractItemView::ExtendedSelection);
     projLayout->addWidget(m_sessionList);
     connect(m_sessionList, &QTreeWidget::itemDoubleClicked, this, &MainWindow::onOpenSelectedSession);
     m_openSessionBtn = new QPushButton("Open Session");
@@ -221,6 +252,11 @@ void MainWindow::setupUi()
     m_describeSessionBtn = new QPushButton("Describe", m_projectTab);
     sessionButtonsLayout->addWidget(m_describeSessionBtn);
 
+    m_batchSendBtn = new QPushButton("Batch Send", m_projectTab);
+    m_batchSendBtn->setToolTip("Send the selected sessions through the Batch API. Answers arrive within "
+                               "24 hours at a lower cost and are appended to the sessions.");
+    sessionButtonsLayout->addWidget(m_batchSendBtn);
+
     sessionButtonsLayout->addStretch();
 
     m_deleteSessionBtn = new QPushButton("Delete", m_projectTab);
@@ -234,6 +270,37 @@ void MainWindow::setupUi()
     // Connect describe button
     connect(m_describeSessionBtn, &QPushButton::clicked, this, &MainWindow::onDescribeSelectedSession);
 
+    connect(m_batchSendBtn, &QPushButton::clicked, this, &MainWindow::onBatchSendSelectedSessions);
+
+    // Usage and latency of the project's requests, from the telemetry file
+    projLayout->addSpacing(10);
+    QHBoxLayout* telemetryHeaderLayout = new QHBoxLayout();
+    telemetryHeaderLayout->addWidget(new QLabel("Request Telemetry:"));
+    m_telemetryGroupCombo = new QComboBox(m_projectTab);
+    m_telemetryGroupCombo->addItem("Per Session", RequestTelemetry::BySession);
+    m_telemetryGroupCombo->addItem("Per Model", RequestTelemetry::ByModel);
+    m_telemetryGroupCombo->addItem("Per Day", RequestTelemetry::ByDay);
+    telemetryHeaderLayout->addWidget(m_telemetryGroupCombo);
+    telemetryHeaderLayout->addStretch();
+    m_refreshTelemetryBtn = new QPushButton("Refresh", m_projectTab);
+    telemetryHeaderLayout->addWidget(m_refreshTelemetryBtn);
+    projLayout->addLayout(telemetryHeaderLayout);
+
+    m_telemetryTree = new QTreeWidget(m_projectTab);
+    m_telemetryTree->setHeaderLabels(QStringList() << "Group" << "Requests" << "Errors" << "Cached"
+                                                   << "TTFT p50 (ms)" << "TTFT p95 (ms)" << "Token Gap p95 (ms)"
+                                                   << "Avg Duration (ms)" << "Prompt Tokens" << "Prompt Cache"
+                                                   << "Completion Tokens");
+    m_telemetryTree->setRootIsDecorated(false);
+    projLayout->addWidget(m_telemetryTree);
+
+    connect(m_telemetryGroupCombo, QOverload<int>::of(&QComboBox::currentIndexChanged), this, &MainWindow::refreshTelemetry);
+    connect(m_refreshTelemetryBtn, &QPushButton::clicked, this, &MainWindow::refreshTelemetry);
+    // New requests were probably recorded while a session tab was in front
+    connect(m_tabWidget, &QTabWidget::currentChanged, this, [this](int index) {
+        if (m_tabWidget->widget(index) == m_projectTab)
+            refreshTelemetry();
+    });
 
 
 
@@ -383,10 +450,140 @@ void MainWindow::onDeleteSelectedSession()
         cacheDir.removeRecursively();
     }
 
+    // Drop included documents no remaining session refers to
+    IncludeStore(fi.absolutePath()).collectGarbage();
+
     refreshSessionList();
     statusBar()->showMessage("Session deleted.", 3000);
 }
 
+BatchClient* MainWindow::batchClient()
+{
+    if (m_batchClient || !m_project)
+        return m_batchClient;
+
+    // The API root can be pointed at a local stand-in server
+    QString baseUrl = qEnvironmentVariable("VIBEKODER_API_BASE_URL");
+    if (baseUrl.isEmpty())
+        baseUrl = NetworkBatchTransport::defaultBaseUrl();
+
+    m_batchClient = new BatchClient(m_project, new NetworkBatchTransport(m_project->accessToken(), baseUrl), this);
+
+    connect(m_batchClient, &BatchClient::statusChanged, this, [this](const QString &status) {
+        statusBar()->showMessage(status);
+    });
+    connect(m_batchClient, &BatchClient::sessionUpdated, this, [this](const QString &sessionPath) {
+        // An open tab still holds the session without the answer; its next save would rewrite
+        // the file without it, so a tab without edits of its own reloads right away
+        SessionTabWidget *tab = m_tabManager ? m_tabManager->openSessions().value(sessionPath) : nullptr;
+        if (!tab)
+            return;
+        const QString name = QFileInfo(sessionPath).fileName();
+        if (!tab->hasUnsavedChanges() && !tab->isBusy() && tab->reloadSession()) {
+            statusBar()->showMessage(QString("Batch answer loaded into %1.").arg(name), 5000);
+            return;
+        }
+        QMessageBox::warning(this, "Batch Send",
+                             QString("The batch answer was written to %1, but its tab has unsaved changes.\n\n"
+                                     "Refresh the tab to load the answer; saving the tab first drops it from the file.")
+                                 .arg(name));
+    });
+    connect(m_batchClient, &BatchClient::finished, this, [this](int updatedSessions, const QStringList &errors) {
+        refreshSessionList();
+        QString message = QString("Batch finished: %1 sessions answered.").arg(updatedSessions);
+        if (!errors.isEmpty()) {
+            message += "\n\n" + errors.join("\n");
+            QMessageBox::warning(this, "Batch Send", message);
+        } else {
+            statusBar()->showMessage(message, 5000);
+        }
+        resumePendingBatches();
+    });
+    connect(m_batchClient, &BatchClient::failed, this, [this](const QString &error) {
+        QMessageBox::warning(this, "Batch Send", error);
+        resumePendingBatches();
+    });
+
+    return m_batchClient;
+}
+
+void MainWindow::resumePendingBatches()
+{
+    if (!m_project || !m_sessionIndex || m_sessionIndex->folder().isEmpty())
+        return;
+
+    const QStringList states = BatchClient::pendingStateFiles(m_sessionIndex->folder());
+    if (states.isEmpty() || !batchClient() || m_batchClient->isRunning())
+        return;
+
+    // One batch at a time; the next one is picked up when this one ends
+    for (const QString &statePath : states) {
+        QString error;
+        if (m_batchClient->resume(statePath, &error))
+            return;
+        qWarning() << "[MainWindow::resumePendingBatches]" << error;
+    }
+}
+
+void MainWindow::onBatchSendSelectedSessions()
+{
+    if (!m_project) {
+        QMessageBox::warning(this, "No Project", "Load a project before sending sessions.");
+        return;
+    }
+
+    QStringList sessionPaths;
+    const QList<QTreeWidgetItem*> selItems = m_sessionList->selectedItems();
+    for (QTreeWidgetItem* item : selItems) {
+        QString path = item->data(0, Qt::UserRole).toString();
+        if (!path.isEmpty())
+            sessionPaths << path;
+    }
+    if (sessionPaths.isEmpty()) {
+        QMessageBox::warning(this, "No Selection", "Select the sessions to send.");
+        return;
+    }
+
+    if (!batchClient())
+        return;
+    if (m_batchClient->isRunning()) {
+        QMessageBox::information(this, "Batch Send",
+                                 QString("Batch %1 is still running.").arg(m_batchClient->batchId()));
+        return;
+    }
+
+    QMessageBox::StandardButton reply = QMessageBox::question(
+        this, "Batch Send",
+        QString("Send %1 sessions through the Batch API? Answers can take up to 24 hours and are appended "
+                "to the sessions when the batch completes.").arg(sessionPaths.size()),
+        QMessageBox::Yes | QMessageBox::No, QMessageBox::Yes);
+    if (reply != QMessageBox::Yes)
+        return;
+
+    // A tab with edits of its own would overwrite the answer with its next save
+    QStringList busy;
+    if (m_tabManager) {
+        const QMap<QString, SessionTabWidget*> openSessions = m_tabManager->openSessions();
+        for (auto it = openSessions.constBegin(); it != openSessions.constEnd(); ++it) {
+            if (sessionPaths.contains(it.key()) && (it.value()->hasUnsavedChanges() || it.value()->isBusy())) {
+                sessionPaths.removeAll(it.key());
+                busy << QString("%1: open with unsaved changes or a running request").arg(QFileInfo(it.key()).fileName());
+            }
+        }
+    }
+
+    QString skipped;
+    bool started = !sessionPaths.isEmpty()
+                   && m_batchClient->submit(sessionPaths, m_sessionIndex->folder(),
+                                            backendConfigForProject(m_project), &skipped);
+    skipped = (busy + (skipped.isEmpty() ? QStringList() : QStringList{skipped})).join('\n');
+    if (!skipped.isEmpty()) {
+        QMessageBox::warning(this, "Batch Send",
+                             (started ? QString("Some sessions were skipped:\n\n") : QString("Nothing was sent:\n\n"))
+                                 + skipped);
+    }
+}
+
 void MainWindow::onDescribeSelectedSession()
 {
     if (!m_project) {
@@ -412,11 +609,8 @@ void MainWindow::onDescribeSelectedSession()
         return;
     }
 
-    // Create AI backend configured for current project
-    AIBackend* backend = createBackendForProject(m_project, this);
-
-    // Create DescriptionGenerator with session and backend
-    DescriptionGenerator* gen = new DescriptionGenerator(session, backend, this);
+    // Create DescriptionGenerator with session and the shared backend
+    DescriptionGenerator* gen = new DescriptionGenerator(session, m_aiBackend, this);
 
     // Connect signals to handle completion and errors
 connect(gen, &DescriptionGenerator::generationFinished, this, [this, session, sessionPath, gen](const QString& title, const QString&){        // Save updated session metadata
@@ -494,7 +688,7 @@ void MainWindow::onNewTempSession()
     setRec(defaultProjectSettings, QString());
 
     // Create the SessionTabWidget with the tempProject and mark it as a temp session
-    SessionTabWidget* tempTab = new SessionTabWidget(tempFilePath, tempProject, m_tabWidget, true);
+    SessionTabWidget* tempTab = new SessionTabWidget(tempFilePath, tempProject, m_aiBackend, m_tabWidget, true);
 
     // Add tab and select it
     m_tabWidget->addTab(tempTab, "Temp");
@@ -610,6 +804,8 @@ void MainWindow::onNewProject()
     }
 
     // 14. Replace current project pointer with new project
+    delete m_batchClient;
+    m_batchClient = nullptr;
     if (m_project)
         delete m_project;
     m_project = newProject;
@@ -663,7 +859,9 @@ void MainWindow::tryAutoLoadProject()
 
         loadProjectDataToUi();
         refreshSessionList();
+        updateBackendConfigForAllSessions();
         statusBar()->showMessage("Project auto-loaded.");
+        resumePendingBatches();
     } else if (jsonFiles.isEmpty()) {
         qDebug() << "No project files found in VK folder.";
     } else {
@@ -676,14 +874,11 @@ void MainWindow::updateBackendConfigForAllSessions()
     if (!m_project)
         return;
 
-    QVariantMap config;
-    config["access_token"] = m_project->accessToken();
-    config["model"] = m_project->model();
-    config["max_tokens"] = m_project->maxTokens();
-    config["temperature"] = m_project->temperature();
-    config["top_p"] = m_project->topP();
-    config["frequency_penalty"] = m_project->frequencyPenalty();
-    config["presence_penalty"] = m_project->presencePenalty();
+    QVariantMap config = backendConfigForProject(m_project);
+
+    // Fallback for requests without their own params; also warm up the connection for the first send
+    m_aiBackend->setConfig(config);
+    m_aiBackend->prewarm();
 
     // Use TabManager's list of open sessions, not MainWindow's stale m_openSessions
     if (m_tabManager) {
@@ -711,6 +906,10 @@ void MainWindow::onOpenProject()
         }
     }
 
+    // A running batch keeps its state file and is resumed when its project is opened again
+    delete m_batchClient;
+    m_batchClient = nullptr;
+
     if (m_project)
         m_project->deleteLater();
 
@@ -729,6 +928,7 @@ void MainWindow::onOpenProject()
     updateBackendConfigForAllSessions();
 
     statusBar()->showMessage("Project loaded.");
+    resumePendingBatches();
 }
 
 void MainWindow::loadProjectDataToUi()
@@ -737,6 +937,8 @@ void MainWindow::loadProjectDataToUi()
         m_projectInfoLabel->setText("No project loaded");
         m_templateList->clear();
         m_sessionList->clear();
+        m_sessionItems.clear();
+        m_telemetryTree->clear();
         return;
     }
 
@@ -776,6 +978,42 @@ void MainWindow::loadProjectDataToUi()
 
     if (m_projectSettingsAction)
         m_projectSettingsAction->setEnabled(true);
+
+    refreshTelemetry();
+}
+
+void MainWindow::refreshTelemetry()
+{
+    if (!m_telemetryTree)
+        return;
+    m_telemetryTree->clear();
+    if (!m_project)
+        return;
+
+    const QString path = RequestTelemetry::telemetryFile(QDir(m_project->rootFolder()).filePath(m_project->sessionsFolder()));
+    const auto groupBy = RequestTelemetry::GroupBy(m_telemetryGroupCombo->currentData().toInt());
+    const QVector<RequestTelemetry::Aggregate> aggregates = RequestTelemetry::aggregate(path, groupBy);
+
+    auto msText = [](qint64 ms) { return ms < 0 ? QStringLiteral("-") : QString::number(ms); };
+    for (const RequestTelemetry::Aggregate &agg : aggregates) {
+        auto item = new QTreeWidgetItem(m_telemetryTree);
+        item->setText(0, agg.key);
+        item->setText(1, QString::number(agg.requests));
+        item->setText(2, QString::number(agg.errors));
+        item->setText(3, QString::number(agg.fromCache));
+        item->setText(4, msText(agg.ttftP50Ms));
+        item->setText(5, msText(agg.ttftP95Ms));
+        item->setText(6, msText(agg.itlP95Ms));
+        item->setText(7, QString::number(agg.avgDurationMs));
+        item->setText(8, QString::number(agg.promptTokens));
+        item->setText(9, agg.promptTokens > 0 ? QString("%1%").arg(agg.cachedTokens * 100 / agg.promptTokens)
+                                              : QStringLiteral("-"));
+        item->setText(10, QString::number(agg.completionTokens));
+        for (int column = 1; column < m_telemetryTree->columnCount(); ++column)
+            item->setTextAlignment(column, Qt::AlignRight | Qt::AlignVCenter);
+    }
+    for (int column = 0; column < m_telemetryTree->columnCount(); ++column)
+        m_telemetryTree->resizeColumnToContents(column);
 }
 
 void MainWindow::onProjectSettingsClicked()
@@ -789,6 +1027,7 @@ void MainWindow::onProjectSettingsClicked()
     if (dlg.exec() == QDialog::Accepted) {
         ProjectConfig newConfig = dlg.getSettings();
         m_project->config() = newConfig;
+        m_project->applyConfig();
 
         if (!m_project->save(m_project->projectFilePath())) {
             QMessageBox::warning(this, "Save Failed", "Failed to save project file.");
@@ -806,7 +1045,12 @@ void MainWindow::refreshSessionList()
     if (!m_sessionList)
         return;
 
+    // Keep the selection across refreshes
+    if (QTreeWidgetItem *current = m_sessionList->currentItem())
+        m_pendingSelectedSessionPath = current->data(0, Qt::UserRole).toString();
+
     m_sessionList->clear();
+    m_sessionItems.clear();
 
     if (!m_project)
         return;
@@ -824,127 +1068,129 @@ void MainWindow::refreshSessionList()
     if (!sessionsDir.exists())
         return;
 
-    QStringList filters{"*.md", "*.markdown"};
-    QFileInfoList files = sessionsDir.entryInfoList(filters, QDir::Files, QDir::Name);
+    // Set column count to 5 for new column
+    m_sessionList->setColumnCount(5);
+    m_sessionList->setHeaderLabels(QStringList() << "#" << "Name" << "Slices" << "Size (KB)" << "Last Modified");
+    m_sessionList->setRootIsDecorated(false);
 
-    struct SessionInfo {
-        QTreeWidgetItem* item;
-        QDateTime lastSliceTimestamp;
-    };
+    // Summaries come from the persistent index; new or changed files are parsed on a
+    // worker pool and stream into the list in batches (addSessionEntries)
+    if (!m_sessionIndex) {
+        m_sessionIndex = new SessionIndex(this);
+        connect(m_sessionIndex, &SessionIndex::entriesChanged, this, &MainWindow::updateSessionEntries);
+        connect(m_sessionIndex, &SessionIndex::entriesRemoved, this, &MainWindow::removeSessionEntries);
+        connect(m_sessionIndex, &SessionIndex::entriesReady, this, &MainWindow::addSessionEntries);
+        connect(m_sessionIndex, &SessionIndex::updateFinished, this, &MainWindow::onSessionScanFinished);
+    }
+    m_sessionIndex->setFolder(sessionsFolder);
+    m_sessionIndex->update();
+}
 
-    QList<SessionInfo> sessionItems;
-
-    QRegularExpression delimiterRe(
-        R"(^==\{\s*(System|User|Assistant)\s*(?:\|\s*([0-9]{4}-[0-9]{2}-[0-9]{2} [0-9]{2}:[0-9]{2}:[0-9]{2}))?\s*\}==\s*$)",
-        QRegularExpression::MultilineOption | QRegularExpression::CaseInsensitiveOption);
-
-    for (const QFileInfo &fi : files) {
-        QString fileName = fi.fileName();
-        QString baseName = fi.completeBaseName(); // e.g. "001"
-
-        // Trim leading zeros for session number display
-        QString sessionNumber = baseName;
-        sessionNumber.remove(QRegularExpression("^0+"));
-        if (sessionNumber.isEmpty())
-            sessionNumber = "0";
-
-        // Open file and parse slices and last timestamp
-        int sliceCount = 0;
-        QDateTime lastTimestamp;
-        QString title;
-        QString description;
-
-        QFile file(fi.absoluteFilePath());
-        if (file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-            QTextStream in(&file);
-            QString content = in.readAll();
-            file.close();
-
-            QRegularExpressionMatchIterator it = delimiterRe.globalMatch(content);
-            while (it.hasNext()) {
-                QRegularExpressionMatch match = it.next();
-                ++sliceCount;
-
-                QString tsStr = match.captured(2);
-                if (!tsStr.isEmpty()) {
-                    QDateTime ts = QDateTime::fromString(tsStr, "yyyy-MM-dd HH:mm:ss");
-                    if (ts.isValid() && (lastTimestamp.isNull() || ts > lastTimestamp)) {
-                        lastTimestamp = ts;
-                    }
-                }
-            }
+static void fillSessionItem(QTreeWidgetItem *item, const SessionIndex::Entry &entry)
+{
+    static const QRegularExpression leadingZerosRe("^0+");
 
-            QRegularExpression yamlRe(R"(^---\s*\n(.*?)\n---\s*\n)", QRegularExpression::DotMatchesEverythingOption);
-            QRegularExpressionMatch match = yamlRe.match(content);
-            if (match.hasMatch()) {
-                QString yamlBlock = match.captured(1);
-
-                // Parse title
-                QRegularExpression titleRe(R"(^title:\s*(.*)$)", QRegularExpression::MultilineOption);
-                QRegularExpressionMatch titleMatch = titleRe.match(yamlBlock);
-                if (titleMatch.hasMatch()) {
-                    title = titleMatch.captured(1).trimmed();
-                    // Remove quotes if any
-                    if ((title.startsWith('"') && title.endsWith('"')) || (title.startsWith('\'') && title.endsWith('\''))) {
-                        title = title.mid(1, title.length() - 2);
-                    }
-                }
-
-                // Parse description
-                QRegularExpression descRe(R"(^description:\s*(.*)$)", QRegularExpression::MultilineOption);
-                QRegularExpressionMatch descMatch = descRe.match(yamlBlock);
-                if (descMatch.hasMatch()) {
-                    description = descMatch.captured(1).trimmed();
-                    // Remove quotes if any
-                    if ((description.startsWith('"') && description.endsWith('"')) || (description.startsWith('\'') && description.endsWith('\''))) {
-                        description = description.mid(1, description.length() - 2);
-                    }
-                }
-            }
-        }
+    QFileInfo fi(entry.filePath);
+    QString baseName = fi.completeBaseName(); // e.g. "001"
+
+    // Trim leading zeros for session number display
+    QString sessionNumber = baseName;
+    sessionNumber.remove(leadingZerosRe);
+    if (sessionNumber.isEmpty())
+        sessionNumber = "0";
+
+    // File size in KB
+    double sizeKB = entry.size / 1024.0;
+
+    item->setText(0, sessionNumber);
+    item->setText(1, entry.title);
+    item->setText(2, QString::number(entry.sliceCount));
+    item->setText(3, QString::number(sizeKB, 'f', 2));
+    item->setText(4, entry.lastTimestamp.isNull() ? "" : entry.lastTimestamp.toString("yyyy-MM-dd HH:mm:ss"));
 
-        // File size in KB
-        qint64 sizeBytes = fi.size();
-        double sizeKB = sizeBytes / 1024.0;
+    // Store full file path for retrieval on selection
+    item->setData(0, Qt::UserRole, fi.absoluteFilePath());
 
+    // Set tooltip on "Name" column (index 1) with wrapped description if not empty
+    item->setToolTip(1, entry.description.isEmpty() ? QString() : wrapText(entry.description));
+}
+
+void MainWindow::addSessionEntries(const QVector<SessionIndex::Entry> &entries)
+{
+    for (const SessionIndex::Entry &entry : entries) {
         // Create tree widget item
         QTreeWidgetItem *item = new QTreeWidgetItem();
-        item->setText(0, sessionNumber);
-        item->setText(1, title); // Name column empty for now
-        item->setText(2, QString::number(sliceCount));
-        item->setText(3, QString::number(sizeKB, 'f', 2));
-        item->setText(4, lastTimestamp.isNull() ? "" : lastTimestamp.toString("yyyy-MM-dd HH:mm:ss"));
-
-        // Store full file path for retrieval on selection
-        item->setData(0, Qt::UserRole, fi.absoluteFilePath());
-
-        // Set tooltip on "Name" column (index 1) with wrapped description if not empty
-        if (!description.isEmpty()) {
-            item->setToolTip(1, wrapText(description));
-        }
+        fillSessionItem(item, entry);
+        m_sessionList->addTopLevelItem(item);
+        m_sessionItems.insert(item->data(0, Qt::UserRole).toString(), item);
 
-        sessionItems.append({item, lastTimestamp});
+        if (!m_pendingSelectedSessionPath.isEmpty() && entry.filePath == m_pendingSelectedSessionPath) {
+            m_sessionList->setCurrentItem(item);
+            m_pendingSelectedSessionPath.clear();
+        }
     }
+    // A scan sorts once, when its last batch is in (onSessionScanFinished)
+}
 
-    // Sort by last slice timestamp descending (most recent first)
-    std::sort(sessionItems.begin(), sessionItems.end(), [](const SessionInfo &a, const SessionInfo &b) {
-        return a.lastSliceTimestamp > b.lastSliceTimestamp;
-    });
+void MainWindow::sortSessionList()
+{
+    // Last slice timestamp descending (most recent first); the format sorts chronologically
+    m_sessionList->sortItems(4, Qt::DescendingOrder);
+}
 
-    // Set column count to 5 for new column
-    m_sessionList->setColumnCount(5);
-    m_sessionList->setHeaderLabels(QStringList() << "#" << "Name" << "Slices" << "Size (KB)" << "Last Modified");
-    m_sessionList->setRootIsDecorated(false);
+QTreeWidgetItem *MainWindow::findSessionItem(const QString &filePath) const
+{
+    return m_sessionItems.value(QFileInfo(filePath).absoluteFilePath());
+}
 
-    // Add items to tree widget
-    for (const SessionInfo &info : sessionItems) {
-        m_sessionList->addTopLevelItem(info.item);
+void MainWindow::updateSessionEntries(const QVector<SessionIndex::Entry> &entries)
+{
+    // Only the changed rows are touched, so the selection and scroll position stay
+    QVector<SessionIndex::Entry> added;
+    for (const SessionIndex::Entry &entry : entries) {
+        if (QTreeWidgetItem *item = findSessionItem(entry.filePath))
+            fillSessionItem(item, entry);
+        else
+            added.append(entry);
     }
 
+    addSessionEntries(added);
+    sortSessionList();
+}
+
+void MainWindow::removeSessionEntries(const QStringList &filePaths)
+{
+    for (const QString &filePath : filePaths)
+        delete m_sessionItems.take(QFileInfo(filePath).absoluteFilePath());
+}
+
+void MainWindow::onSessionScanFinished(int totalFiles, int parsedFiles, qint64 parsedBytes, qint64 elapsedMs)
+{
+    m_pendingSelectedSessionPath.clear();
+    sortSessionList();
+
     // Resize columns to contents
     for (int col = 0; col < m_sessionList->columnCount(); ++col) {
         m_sessionList->resizeColumnToContents(col);
     }
+
+#ifndef QT_NO_DEBUG
+    if (parsedFiles > 0) {
+        const double seconds = qMax<qint64>(elapsedMs, 1) / 1000.0;
+        statusBar()->showMessage(QString("Scanned %1 of %2 sessions in %3 ms (%4 files/s, %5 MB/s)")
+                                     .arg(parsedFiles)
+                                     .arg(totalFiles)
+                                     .arg(elapsedMs)
+                                     .arg(parsedFiles / seconds, 0, 'f', 0)
+                                     .arg(parsedBytes / (1024.0 * 1024.0) / seconds, 0, 'f', 1),
+                                 5000);
+    }
+#else
+    Q_UNUSED(totalFiles);
+    Q_UNUSED(parsedFiles);
+    Q_UNUSED(parsedBytes);
+    Q_UNUSED(elapsedMs);
+#endif
 }
 
 void MainWindow::onCreateSessionFromTemplate()
@@ -2,6 +2,7 @@
 #define MAINWINDOW_H
 
 #include <QMainWindow>
+#include <QHash>
 #include <QMap>
 #include <QToolTip>
 #include "draggabletabwidget.h"
@@ -10,10 +11,13 @@ class QLabel;
 class QListWidget;
 class QPushButton;
 class QTreeWidget;
+class QComboBox;
+class BatchClient;
 
 #include "project.h"
 #include "sessiontabwidget.h"
 #include "tabmanager.h"
+#include "sessionindex.h"
 
 
 class MainWindow : public QMainWindow
@@ -38,12 +42,22 @@ private:
     void setupUi();
     void loadProjectDataToUi();
     void refreshSessionList();
+    void addSessionEntries(const QVector<SessionIndex::Entry> &entries);
+    void updateSessionEntries(const QVector<SessionIndex::Entry> &entries);
+    void removeSessionEntries(const QStringList &filePaths);
+    QTreeWidgetItem *findSessionItem(const QString &filePath) const;
+    void sortSessionList();
+    void onSessionScanFinished(int totalFiles, int parsedFiles, qint64 parsedBytes, qint64 elapsedMs);
     void tryAutoLoadProject();
     void updateBackendConfigForAllSessions();
     void onProjectSettingsClicked();
 
     void onDescribeSelectedSession();
     void onDeleteSelectedSession();
+    void onBatchSendSelectedSessions();
+    BatchClient* batchClient();
+    void resumePendingBatches();
+    void refreshTelemetry();
 
     bool m_verticalTabs = false;
     void toggleVerticalTabs();
@@ -64,9 +78,26 @@ private:
     QPushButton* m_projectSettingsBtn = nullptr;
     QPushButton* m_deleteSessionBtn = nullptr;
     QPushButton* m_describeSessionBtn = nullptr;
+    QPushButton* m_batchSendBtn = nullptr;
+    QComboBox* m_telemetryGroupCombo = nullptr;
+    QPushButton* m_refreshTelemetryBtn = nullptr;
+    QTreeWidget* m_telemetryTree = nullptr;
 
     TabManager* m_tabManager = nullptr;
 
+    // Shared by all session tabs, detached windows and description generators
+    AIBackend* m_aiBackend = nullptr;
+    QLabel* m_requestQueueLabel = nullptr;
+
+    // Offline Batch API sends of the project's sessions; created on first use per project
+    BatchClient* m_batchClient = nullptr;
+
+    // Cached session summaries for the project tab's session list
+    SessionIndex* m_sessionIndex = nullptr;
+    QString m_pendingSelectedSessionPath;
+    // Rows of the session list by absolute file path
+    QHash<QString, QTreeWidgetItem*> m_sessionItems;
+
     // Map session file paths to session tab widgets (avoid duplicates)
     QMap<QString, SessionTabWidget*> m_openSessions;
 
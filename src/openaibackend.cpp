@@ -3,33 +3,77 @@
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QJsonArray>
-#include <QJsonParseError>
 #include <QDateTime>
 #include <QDir>
 #include <QStandardPaths>
-#include <QTemporaryFile>
+#include <QFile>
 #include <QDebug>
 #include <QRandomGenerator>
+#include <QSslConfiguration>
+#include <QtConcurrent/QtConcurrentRun>
 
+#include <memory>
+#include <utility>
+
+namespace {
+
+const char *kDefaultApiBaseUrl = "https://api.openai.com";
+const char *kChatCompletionsPath = "/v1/chat/completions";
+
+// Idle connections are dropped by the server after a while; prewarm again past this age
+const qint64 kPrewarmIntervalMs = 60 * 1000;
+
+// Journal appends are batched; a crash loses at most this much streamed text
+const int kJournalFlushIntervalMs = 250;
+
+// Upper bound for the up-front reservation of a response buffer (characters)
+const qsizetype kMaxResponseReserve = 1 << 20;
+
+// Upper bound for choices[i].index; anything above is treated as garbage
+const int kMaxChoices = 128;
+
+void appendToJournal(const QString &path, const QByteArray &data)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        qWarning() << "[OpenAIBackend::appendToJournal] Failed to open stream journal:" << path;
+        return;
+    }
+    file.write(data);
+    file.close();
+}
+
+void removeJournal(const QString &path)
+{
+    QFile::remove(path);
+}
+
+} // namespace
 
 OpenAIBackend::OpenAIBackend(QObject *parent)
     : AIBackend(parent)
 {
+    m_journalPool.setMaxThreadCount(1);
+
+    m_journalFlushTimer.setInterval(kJournalFlushIntervalMs);
+    connect(&m_journalFlushTimer, &QTimer::timeout, this, &OpenAIBackend::flushJournals);
 }
 
 OpenAIBackend::~OpenAIBackend()
 {
-    // Cancel and cleanup all active requests
-    for (auto &reqData : m_activeRequests) {
+    // Cancel and cleanup all active requests; abort() calls back into the reply lambdas,
+    // which must not find them anymore
+    const QHash<QString, RequestData*> requests = std::exchange(m_activeRequests, {});
+    for (RequestData *reqData : requests) {
         if (reqData->reply) {
             reqData->reply->abort();
             reqData->reply->deleteLater();
         }
-        if (reqData->tempFile.isOpen()) {
-            reqData->tempFile.close();
-        }
+        discardJournal(*reqData);
     }
-    m_activeRequests.clear();
+    qDeleteAll(requests);
+
+    m_journalPool.waitForDone();
 }
 
 QString OpenAIBackend::generateRequestId()
@@ -46,6 +90,24 @@ QVariant OpenAIBackend::getConfigValue(const QString &key, const QVariant &defau
     return m_config.value(key, defaultValue);
 }
 
+QString OpenAIBackend::apiBaseUrl(const QString &configured)
+{
+    // A local stand-in server (e.g. tests/mock_openai_server) can replace the API
+    QString baseUrl = configured;
+    if (baseUrl.isEmpty())
+        baseUrl = qEnvironmentVariable("VIBEKODER_API_BASE_URL");
+    if (baseUrl.isEmpty())
+        baseUrl = QString::fromLatin1(kDefaultApiBaseUrl);
+    if (baseUrl.endsWith('/'))
+        baseUrl.chop(1);
+    return baseUrl;
+}
+
+QUrl OpenAIBackend::chatCompletionsUrl() const
+{
+    return QUrl(apiBaseUrl(getConfigValue("api_base_url").toString()) + QLatin1String(kChatCompletionsPath));
+}
+
 QByteArray OpenAIBackend::buildRequestPayload(const QList<Message> &messages, const QVariantMap &params) const
 {
     QJsonObject rootObj;
@@ -82,11 +144,37 @@ QByteArray OpenAIBackend::buildRequestPayload(const QList<Message> &messages, co
     rootObj["max_tokens"] = getIntParam("max_tokens", 800);
     rootObj["temperature"] = getDoubleParam("temperature", 0.3);
     rootObj["top_p"] = getDoubleParam("top_p", 1.0);
-    rootObj["frequency_penalty"] = getDoubleParam("frequency_penalty", 0.0);
-    rootObj["presence_penalty"] = getDoubleParam("presence_penalty", 0.0);
+    // Predicted outputs reject positive penalties; the defaults (0) are simply left out
+    const bool predicted = !params.value("prediction").toString().isEmpty() && params.value("n").toInt() <= 1;
+    const double frequencyPenalty = getDoubleParam("frequency_penalty", 0.0);
+    const double presencePenalty = getDoubleParam("presence_penalty", 0.0);
+    if (!predicted) {
+        rootObj["frequency_penalty"] = frequencyPenalty;
+        rootObj["presence_penalty"] = presencePenalty;
+    } else if (frequencyPenalty != 0.0 || presencePenalty != 0.0) {
+        qWarning() << "[OpenAIBackend::buildRequestPayload] Ignoring frequency_penalty" << frequencyPenalty
+                   << "and presence_penalty" << presencePenalty << "for a predicted output";
+    }
 
-    // Enable streaming
+    // Enable streaming; the last chunk then reports token usage
     rootObj["stream"] = true;
+    QJsonObject streamOptions;
+    streamOptions["include_usage"] = true;
+    rootObj["stream_options"] = streamOptions;
+
+    // Several alternative completions for the same prompt, streamed as separate choices
+    if (params.value("n").toInt() > 1) {
+        rootObj["n"] = params.value("n").toInt();
+    }
+
+    // Expected output (e.g. the current file for a rewrite): matching tokens are accepted
+    // instead of generated one by one
+    if (predicted) {
+        QJsonObject prediction;
+        prediction["type"] = "content";
+        prediction["content"] = params.value("prediction").toString();
+        rootObj["prediction"] = prediction;
+    }
 
     // Optional parameters (stop sequences, user, logit_bias, etc.)
     if (params.contains("stop")) {
@@ -103,6 +191,27 @@ QByteArray OpenAIBackend::buildRequestPayload(const QList<Message> &messages, co
     return doc.toJson(QJsonDocument::Compact);
 }
 
+void OpenAIBackend::prewarm()
+{
+#ifndef QT_NO_SSL
+    if (m_lastPrewarm.isValid() && m_lastPrewarm.elapsed() < kPrewarmIntervalMs)
+        return;
+    m_lastPrewarm.start();
+
+    // DNS, TCP and TLS (negotiating HTTP/2) happen now instead of on the first send
+    const QUrl url = chatCompletionsUrl();
+    if (url.scheme() != QLatin1String("https")) {
+        m_networkManager.connectToHost(url.host(), quint16(url.port(80)));
+        return;
+    }
+    QSslConfiguration sslConfig = QSslConfiguration::defaultConfiguration();
+    sslConfig.setAllowedNextProtocols({QSslConfiguration::ALPNProtocolHTTP2, QSslConfiguration::NextProtocolHttp1_1});
+    m_networkManager.connectToHostEncrypted(url.host(), quint16(url.port(443)), sslConfig);
+
+    qDebug() << "[OpenAIBackend::prewarm] Connecting to" << url.host();
+#endif
+}
+
 void OpenAIBackend::startRequest(const QList<Message> &messages,
                                  const QVariantMap &params,
                                  const QString &requestId)
@@ -114,10 +223,12 @@ void OpenAIBackend::startRequest(const QList<Message> &messages,
         return;
     }
 
-    QNetworkRequest request(QUrl("https://api.openai.com/v1/chat/completions"));
+    QNetworkRequest request(chatCompletionsUrl());
     request.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
+    request.setAttribute(QNetworkRequest::Http2AllowedAttribute, true);
 
-    QString apiKey = getConfigValue("access_token").toString();
+    QString apiKey = params.contains("access_token") ? params.value("access_token").toString()
+                                                     : getConfigValue("access_token").toString();
     if (apiKey.isEmpty()) {
         emit errorOccurred(reqId, QStringLiteral("API key is not set"));
         return;
@@ -132,18 +243,21 @@ void OpenAIBackend::startRequest(const QList<Message> &messages,
     RequestData* reqData = new RequestData();
     reqData->reply = reply;
     reqData->requestId = reqId;
-
-    // Create a temporary file for streaming buffer
-    QString tempDir = QStandardPaths::writableLocation(QStandardPaths::TempLocation);
-    QString tempFileName = QString("vibekoder_openai_%1.txt").arg(reqId);
-    QString tempFilePath = QDir(tempDir).filePath(tempFileName);
-
-    reqData->tempFile.setFileName(tempFilePath);
-    if (!reqData->tempFile.open(QIODevice::WriteOnly | QIODevice::Text)) {
-        emit errorOccurred(reqId, QStringLiteral("Failed to open temporary file for streaming"));
-        reply->abort();
-        reply->deleteLater();
-        return;
+    reqData->elapsed.start();
+
+    // Reserve roughly max_tokens worth of characters so appends rarely reallocate
+    int maxTokens = params.contains("max_tokens") ? params.value("max_tokens").toInt()
+                                                  : getConfigValue("max_tokens", 800).toInt();
+    reqData->responses.append(QString());
+    reqData->responses[0].reserve(qBound<qsizetype>(0, qsizetype(maxTokens) * 4, kMaxResponseReserve));
+
+    // Optional crash-recovery journal of the streamed text
+    if (getConfigValue("stream_journal", false).toBool()) {
+        QString tempDir = QStandardPaths::writableLocation(QStandardPaths::TempLocation);
+        QString journalFileName = QString("vibekoder_openai_%1.txt").arg(reqId);
+        reqData->journalPath = QDir(tempDir).filePath(journalFileName);
+        if (!m_journalFlushTimer.isActive())
+            m_journalFlushTimer.start();
     }
 
     m_activeRequests.insert(reqId, reqData);
@@ -157,11 +271,29 @@ void OpenAIBackend::startRequest(const QList<Message> &messages,
         processStreamData(*rd, chunk);
     });
 
+    connect(reply, &QNetworkReply::metaDataChanged, this, [this, reqId]() {
+        RequestData* rd = m_activeRequests.value(reqId, nullptr);
+        if (!rd || !rd->reply)
+            return;
+        QVariantMap headers;
+        const QList<QNetworkReply::RawHeaderPair> pairs = rd->reply->rawHeaderPairs();
+        for (const QNetworkReply::RawHeaderPair &pair : pairs)
+            headers.insert(QString::fromLatin1(pair.first).toLower(), QString::fromLatin1(pair.second));
+        int httpStatus = rd->reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+        emit responseMetadata(reqId, httpStatus, headers);
+    });
+
     connect(reply, &QNetworkReply::finished, this, [this, reqId]() {
+        // Completed requests left the map at [DONE] and failed ones in errorOccurred; a request
+        // still here ended cleanly without [DONE], e.g. a connection closed mid-stream
         if (!m_activeRequests.contains(reqId))
             return;
-        RequestData* rd = m_activeRequests[reqId];
-        onNetworkFinished();
+        std::unique_ptr<RequestData> rd(m_activeRequests.take(reqId));
+        rd->reply->deleteLater();
+        discardJournal(*rd);
+        qWarning() << "[OpenAIBackend::startRequest] Stream of" << reqId << "ended without [DONE] after"
+                   << rd->elapsed.elapsed() << "ms";
+        emit errorOccurred(reqId, QStringLiteral("The response stream ended before the response completed"));
     });
 
     connect(reply, QOverload<QNetworkReply::NetworkError>::of(&QNetworkReply::errorOccurred),
@@ -169,15 +301,14 @@ void OpenAIBackend::startRequest(const QList<Message> &messages,
                 Q_UNUSED(code);
                 if (!m_activeRequests.contains(reqId))
                     return;
-                RequestData* rd = m_activeRequests.value(reqId, nullptr);
+                // Out of the map before emitting, so receivers can't reach it while it is deleted
+                std::unique_ptr<RequestData> rd(m_activeRequests.take(reqId));
                 if (!rd)
-                    return; // or handle error
+                    return;
                 QString err = rd->reply->errorString();
-                emit errorOccurred(rd->requestId, err);
                 rd->reply->deleteLater();
-                if (rd->tempFile.isOpen())
-                    rd->tempFile.close();
-                m_activeRequests.remove(rd->requestId);
+                discardJournal(*rd);
+                emit errorOccurred(reqId, err);
             });
 
     emit statusChanged(reqId, QStringLiteral("started"));
@@ -199,103 +330,128 @@ void OpenAIBackend::processStreamData(RequestData &reqData, const QByteArray &ch
     // data: {json}\n\n
     // The last message is "data: [DONE]\n\n"
 
-    reqData.buffer.append(chunk);
-
-    while (true) {
-        int newlineIndex = reqData.buffer.indexOf("\n");
-        if (newlineIndex == -1)
-            break;
+    reqData.parser.append(chunk);
 
-        QByteArray line = reqData.buffer.left(newlineIndex).trimmed();
-        reqData.buffer.remove(0, newlineIndex + 1);
-
-        if (line.isEmpty())
-            continue;
-
-        if (line == "data: [DONE]") {
+    QByteArray data;
+    QVector<SseStreamParser::ChoiceDelta> deltas;
+    QVariantMap usage;
+    while (reqData.parser.nextData(data)) {
+        QString error;
+        switch (SseStreamParser::decodeChatFrame(data, deltas, usage, &error)) {
+        case SseStreamParser::ChatDone:
             // Stream finished
             reqData.finished = true;
-
-            if (reqData.tempFile.isOpen())
-                reqData.tempFile.close();
-
-            // Read full content from temp file
-            QString fullResponse;
-            QFile file(reqData.tempFile.fileName());
-            if (file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-                fullResponse = QString::fromUtf8(file.readAll());
-                file.close();
-            }
-
-            finalizeRequest(reqData, fullResponse);
+            finalizeRequest(reqData);
             return;
-        }
-
-        if (!line.startsWith("data: ")) {
-            // Ignore non-data lines
-            continue;
-        }
-
-        QByteArray jsonData = line.mid(6); // after "data: "
-
-        QJsonParseError parseError;
-        QJsonDocument doc = QJsonDocument::fromJson(jsonData, &parseError);
-        if (parseError.error != QJsonParseError::NoError) {
+        case SseStreamParser::ChatInvalid:
             // Parsing error, emit error and abort
-            emit errorOccurred(reqData.requestId, QString("JSON parse error in stream: %1").arg(parseError.errorString()));
+            emit errorOccurred(reqData.requestId, QString("JSON parse error in stream: %1").arg(error));
             reqData.reply->abort();
             return;
+        case SseStreamParser::ChatChunk:
+            break;
         }
 
-        if (!doc.isObject())
-            continue;
+        if (!usage.isEmpty())
+            emit usageReported(reqData.requestId, usage);
 
-        QJsonObject obj = doc.object();
+        for (const SseStreamParser::ChoiceDelta &delta : std::as_const(deltas)) {
+            if (!delta.content.isEmpty())
+                appendChoiceContent(reqData, delta.index, delta.content);
+        }
+    }
+}
 
-        // Extract content delta from choices array
-        QJsonArray choices = obj.value("choices").toArray();
-        if (choices.isEmpty())
-            continue;
+void OpenAIBackend::appendChoiceContent(RequestData &reqData, int choiceIndex, const QString &contentPart)
+{
+    if (choiceIndex < 0 || choiceIndex >= kMaxChoices) {
+        qWarning() << "[OpenAIBackend::appendChoiceContent] Ignoring content for choice" << choiceIndex;
+        return;
+    }
 
-        QJsonObject firstChoice = choices.at(0).toObject();
-        QJsonObject delta = firstChoice.value("delta").toObject();
+    if (!reqData.receivedContent) {
+        reqData.receivedContent = true;
+        qDebug() << "[OpenAIBackend::appendChoiceContent] Time to first token for" << reqData.requestId
+                 << ":" << reqData.elapsed.elapsed() << "ms";
+    }
 
-        QString contentPart = delta.value("content").toString();
+    while (reqData.responses.size() <= choiceIndex)
+        reqData.responses.append(QString());
+    reqData.responses[choiceIndex].append(contentPart);
 
-        if (!contentPart.isEmpty()) {
-            // Append to temp file
-            if (reqData.tempFile.isOpen()) {
-                QTextStream out(&reqData.tempFile);
-                out << contentPart;
-                out.flush();
-            }
+    if (choiceIndex == 0) {
+        // Journal writes are batched by the flush timer; only the first choice is journaled
+        if (!reqData.journalPath.isEmpty())
+            reqData.journalPending.append(contentPart.toUtf8());
 
-            // Emit partial response signal
-            emit partialResponse(reqData.requestId, contentPart);
-        }
+        emit partialResponse(reqData.requestId, contentPart);
     }
+
+    emit choicePartialResponse(reqData.requestId, choiceIndex, contentPart);
 }
 
-void OpenAIBackend::finalizeRequest(RequestData &reqData, const QString &fullResponse)
+void OpenAIBackend::finalizeRequest(RequestData &reqData)
 {
-    emit finished(reqData.requestId, fullResponse);
+    // Owned here from now on; receivers of the signals below no longer find it in the map
+    const std::unique_ptr<RequestData> owned(m_activeRequests.take(reqData.requestId));
+
+    discardJournal(reqData);
+
+    qDebug() << "[OpenAIBackend::finalizeRequest] Request" << reqData.requestId << "completed in"
+             << reqData.elapsed.elapsed() << "ms";
+
+    // Hand the buffers over; receivers share them instead of copying
+    const QStringList responses = std::move(reqData.responses);
+    if (responses.size() > 1)
+        emit choicesFinished(reqData.requestId, responses);
+    emit finished(reqData.requestId, responses.value(0));
 
     if (reqData.reply) {
         reqData.reply->deleteLater();
         reqData.reply = nullptr;
     }
 
-    m_activeRequests.remove(reqData.requestId);
-
     emit statusChanged(reqData.requestId, QStringLiteral("completed"));
 }
 
+void OpenAIBackend::flushJournals()
+{
+    bool journaling = false;
+
+    for (RequestData *rd : std::as_const(m_activeRequests)) {
+        if (!rd || rd->journalPath.isEmpty())
+            continue;
+        journaling = true;
+
+        if (rd->journalPending.isEmpty())
+            continue;
+
+        QByteArray batch;
+        batch.swap(rd->journalPending);
+        QtConcurrent::run(&m_journalPool, appendToJournal, rd->journalPath, batch);
+    }
+
+    if (!journaling)
+        m_journalFlushTimer.stop();
+}
+
+void OpenAIBackend::discardJournal(RequestData &reqData)
+{
+    if (reqData.journalPath.isEmpty())
+        return;
+
+    // Queued behind any pending append, so the file cannot reappear afterwards
+    QtConcurrent::run(&m_journalPool, removeJournal, reqData.journalPath);
+    reqData.journalPath.clear();
+    reqData.journalPending.clear();
+}
+
 void OpenAIBackend::cancelRequest(const QString &requestId)
 {
     if (requestId.isEmpty()) {
-        // Cancel all
-        for (auto it = m_activeRequests.begin(); it != m_activeRequests.end(); ++it) {
-            RequestData* rd = it.value();
+        // Cancel all; taken out first, abort() emits errorOccurred synchronously
+        const QHash<QString, RequestData*> requests = std::exchange(m_activeRequests, {});
+        for (RequestData *rd : requests) {
             if (!rd)
                 continue;
 
@@ -304,28 +460,24 @@ void OpenAIBackend::cancelRequest(const QString &requestId)
                 rd->reply->deleteLater();
                 rd->reply = nullptr;
             }
-            if (rd->tempFile.isOpen())
-                rd->tempFile.close();
+            discardJournal(*rd);
 
             delete rd;
         }
-        m_activeRequests.clear();
         return;
     }
 
     if (!m_activeRequests.contains(requestId))
         return;
 
-    RequestData* reqData = m_activeRequests[requestId];
+    // Taken out first: abort() emits errorOccurred synchronously
+    std::unique_ptr<RequestData> reqData(m_activeRequests.take(requestId));
     if (reqData->reply) {
         reqData->reply->abort();
         reqData->reply->deleteLater();
         reqData->reply = nullptr;
     }
-    if (reqData->tempFile.isOpen())
-        reqData->tempFile.close();
-
-    m_activeRequests.remove(requestId);
+    discardJournal(*reqData);
 
     emit statusChanged(requestId, QStringLiteral("cancelled"));
 }
@@ -333,6 +485,6 @@ void OpenAIBackend::cancelRequest(const QString &requestId)
 void OpenAIBackend::onNetworkFinished()
 {
     // This slot is connected per request via lambda, so no generic implementation here.
-    // All finalization is handled in processStreamData when [DONE] is received.
-    // This slot can be left empty or used for fallback if needed.
+    // Finalization is handled in processStreamData when [DONE] is received; the per-request
+    // finished lambda fails streams that end without it.
 }
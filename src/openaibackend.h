@@ -4,17 +4,25 @@
 #pragma once
 
 #include "aibackend.h"
+#include "ssestreamparser.h"
 
 #include <QNetworkAccessManager>
 #include <QNetworkReply>
-#include <QFile>
 #include <QHash>
+#include <QElapsedTimer>
+#include <QThreadPool>
 #include <QTimer>
 
 /**
  * @brief Concrete AIBackend implementation for OpenAI API.
  *
  * Supports streaming chat completions with incremental partial responses.
+ * One instance is shared by the whole application so every request reuses the
+ * same HTTP/2 connection; per-request params (including "access_token") take
+ * precedence over the backend config.
+ * Deltas are accumulated in memory; with the "stream_journal" config option
+ * they are also appended to a crash-recovery journal in batches, written on
+ * a background thread so the streaming path never waits on disk.
  */
 class OpenAIBackend : public AIBackend
 {
@@ -32,6 +40,20 @@ public:
     bool supportsStreaming() const override { return true; }
     QString backendName() const override { return QStringLiteral("OpenAI"); }
 
+    void prewarm() override;
+
+    QByteArray requestPayload(const QList<Message> &messages, const QVariantMap &params) const override
+    {
+        return buildRequestPayload(messages, params);
+    }
+
+    // The connection pool every request goes through; wrapping backends share it
+    QNetworkAccessManager *networkManager() { return &m_networkManager; }
+
+    // API root without trailing slash: 'configured' (the "api_base_url" config key),
+    // else the VIBEKODER_API_BASE_URL environment variable, else the OpenAI API
+    static QString apiBaseUrl(const QString &configured);
+
 private slots:
     void onNetworkReadyRead();
     void onNetworkFinished();
@@ -40,14 +62,25 @@ private slots:
 private:
     struct RequestData {
         QNetworkReply *reply = nullptr;
-        QByteArray buffer; // Buffer for partial data parsing
+        SseStreamParser parser; // Buffers partial SSE lines between network chunks
         QString requestId;
-        QFile tempFile;
+        QStringList responses;   // Accumulated content per choice; the first is reserved up front
+        QString journalPath;     // Empty unless the stream journal is enabled
+        QByteArray journalPending; // UTF-8 deltas not yet handed to the journal thread
+        QElapsedTimer elapsed;   // Started when the request is sent, for time-to-first-token
+        bool receivedContent = false;
         bool finished = false;
     };
 
     QNetworkAccessManager m_networkManager;
 
+    // Last connection prewarm; repeated prewarms while the connection is fresh are skipped
+    QElapsedTimer m_lastPrewarm;
+
+    // Single worker so journal appends and removals run in submission order
+    QThreadPool m_journalPool;
+    QTimer m_journalFlushTimer;
+
     // Map requestId -> RequestData
     QHash<QString, RequestData*> m_activeRequests;
 
@@ -57,12 +90,24 @@ private:
     // Helper to parse streaming chunks from OpenAI chunked response
     void processStreamData(RequestData &reqData, const QByteArray &chunk);
 
-    // Helper to finalize request: close temp file, emit finished signal, atomic save
-    void finalizeRequest(RequestData &reqData, const QString &fullResponse);
+    // Helper to route a content delta to its choice buffer and emit the partial signals
+    void appendChoiceContent(RequestData &reqData, int choiceIndex, const QString &contentPart);
+
+    // Helper to finalize request: emit finished signal with the accumulated response
+    void finalizeRequest(RequestData &reqData);
+
+    // Hand pending journal bytes of every request to the journal thread
+    void flushJournals();
+
+    // Delete the request's journal once the response is delivered or abandoned
+    void discardJournal(RequestData &reqData);
 
     // Helper to build JSON payload for chat completion request
     QByteArray buildRequestPayload(const QList<Message> &messages, const QVariantMap &params) const;
 
+    // Endpoint for chat completions under apiBaseUrl()
+    QUrl chatCompletionsUrl() const;
+
     // Helper to get config parameters with fallback
     QVariant getConfigValue(const QString &key, const QVariant &defaultValue = QVariant()) const;
 
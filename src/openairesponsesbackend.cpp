@@ -0,0 +1,424 @@
+#include "openairesponsesbackend.h"
+#include "openaibackend.h"
+
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QJsonParseError>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QRandomGenerator>
+#include <QDebug>
+
+#include <utility>
+
+namespace {
+
+const char *kResponsesPath = "/v1/responses";
+
+// Value of the "endpoint" param/config key that selects this backend
+const char *kResponsesEndpoint = "responses";
+
+} // namespace
+
+OpenAIResponsesBackend::OpenAIResponsesBackend(AIBackend *chatBackend, QNetworkAccessManager *networkManager,
+                                               QObject *parent)
+    : AIBackend(parent)
+    , m_chatBackend(chatBackend)
+    , m_networkManager(networkManager)
+{
+    Q_ASSERT(m_chatBackend);
+    Q_ASSERT(m_networkManager);
+    m_chatBackend->setParent(this);
+
+    // Requests passed on keep their ids, so the chat backend's signals go out unchanged
+    connect(m_chatBackend, &AIBackend::partialResponse, this, &AIBackend::partialResponse);
+    connect(m_chatBackend, &AIBackend::choicePartialResponse, this, &AIBackend::choicePartialResponse);
+    connect(m_chatBackend, &AIBackend::finished, this, &AIBackend::finished);
+    connect(m_chatBackend, &AIBackend::choicesFinished, this, &AIBackend::choicesFinished);
+    connect(m_chatBackend, &AIBackend::errorOccurred, this, &AIBackend::errorOccurred);
+    connect(m_chatBackend, &AIBackend::statusChanged, this, &AIBackend::statusChanged);
+    connect(m_chatBackend, &AIBackend::responseMetadata, this, &AIBackend::responseMetadata);
+    connect(m_chatBackend, &AIBackend::usageReported, this, &AIBackend::usageReported);
+    connect(m_chatBackend, &AIBackend::servedFromCache, this, &AIBackend::servedFromCache);
+    connect(m_chatBackend, &AIBackend::responseStored, this, &AIBackend::responseStored);
+}
+
+OpenAIResponsesBackend::~OpenAIResponsesBackend()
+{
+    const QList<RequestData *> requests = m_activeRequests.values();
+    for (RequestData *reqData : requests)
+        releaseRequest(reqData);
+}
+
+void OpenAIResponsesBackend::setConfig(const QVariantMap &config)
+{
+    AIBackend::setConfig(config);
+    m_chatBackend->setConfig(config);
+}
+
+QVariant OpenAIResponsesBackend::getConfigValue(const QString &key, const QVariant &defaultValue) const
+{
+    QMutexLocker locker(&m_configMutex);
+    return m_config.value(key, defaultValue);
+}
+
+QUrl OpenAIResponsesBackend::responsesUrl() const
+{
+    return QUrl(OpenAIBackend::apiBaseUrl(getConfigValue("api_base_url").toString()) + QLatin1String(kResponsesPath));
+}
+
+bool OpenAIResponsesBackend::handlesRequest(const QVariantMap &params) const
+{
+    const QString endpoint = params.contains("endpoint") ? params.value("endpoint").toString()
+                                                         : getConfigValue("endpoint").toString();
+    // The Responses API produces one answer per request and has no predicted outputs
+    return endpoint == QLatin1String(kResponsesEndpoint) && params.value("n", 1).toInt() <= 1
+           && !params.contains("prediction");
+}
+
+bool OpenAIResponsesBackend::continuesResponse(const QList<Message> &messages, const QVariantMap &params)
+{
+    const int previousCount = params.value("previous_message_count").toInt();
+    return !params.value("previous_response_id").toString().isEmpty()
+           && previousCount > 0 && previousCount < messages.size();
+}
+
+QString OpenAIResponsesBackend::conversationDigest(const QList<Message> &messages, int count)
+{
+    // Whitespace at the ends is not significant: saved slices are trimmed
+    QCryptographicHash hash(QCryptographicHash::Sha256);
+    const int end = qMin(count, int(messages.size()));
+    for (int i = 0; i < end; ++i) {
+        hash.addData(Message::roleToString(messages.at(i).role).toUtf8());
+        hash.addData(QByteArray(1, '\n'));
+        hash.addData(messages.at(i).content.trimmed().toUtf8());
+        hash.addData(QByteArray(1, '\0'));
+    }
+    return QString::fromLatin1(hash.result().toHex());
+}
+
+QByteArray OpenAIResponsesBackend::requestPayload(const QList<Message> &messages, const QVariantMap &params) const
+{
+    if (!handlesRequest(params))
+        return m_chatBackend->requestPayload(messages, params);
+    return buildRequestPayload(messages, params, continuesResponse(messages, params));
+}
+
+QByteArray OpenAIResponsesBackend::buildRequestPayload(const QList<Message> &messages, const QVariantMap &params,
+                                                       bool chained) const
+{
+    QJsonObject rootObj;
+
+    QString model = params.value("model").toString();
+    if (model.isEmpty())
+        model = getConfigValue("model", "gpt-4.1-mini").toString();
+    rootObj["model"] = model;
+
+    // A continuation only carries what the previous response has not seen
+    int first = 0;
+    if (chained) {
+        rootObj["previous_response_id"] = params.value("previous_response_id").toString();
+        first = params.value("previous_message_count").toInt();
+    }
+
+    QJsonArray input;
+    for (int i = first; i < messages.size(); ++i) {
+        QJsonObject msgObj;
+        msgObj["role"] = Message::roleToString(messages.at(i).role);
+        msgObj["content"] = messages.at(i).content;
+        input.append(msgObj);
+    }
+    rootObj["input"] = input;
+
+    auto getDoubleParam = [&](const QString &key, double def) -> double {
+        if (params.contains(key))
+            return params.value(key).toDouble();
+        return getConfigValue(key, def).toDouble();
+    };
+
+    auto getIntParam = [&](const QString &key, int def) -> int {
+        if (params.contains(key))
+            return params.value(key).toInt();
+        return getConfigValue(key, def).toInt();
+    };
+
+    // No frequency/presence penalties in the Responses API
+    rootObj["max_output_tokens"] = getIntParam("max_tokens", 800);
+    rootObj["temperature"] = getDoubleParam("temperature", 0.3);
+    rootObj["top_p"] = getDoubleParam("top_p", 1.0);
+
+    // Stored responses are what the next request continues from
+    rootObj["stream"] = true;
+    rootObj["store"] = true;
+
+    if (params.contains("user")) {
+        rootObj["user"] = params.value("user").toString();
+    }
+
+    return QJsonDocument(rootObj).toJson(QJsonDocument::Compact);
+}
+
+void OpenAIResponsesBackend::prewarm()
+{
+    // Both APIs live on the same host and share the chat backend's connection
+    m_chatBackend->prewarm();
+}
+
+void OpenAIResponsesBackend::startRequest(const QList<Message> &messages,
+                                          const QVariantMap &params,
+                                          const QString &requestId)
+{
+    if (!handlesRequest(params)) {
+        m_chatBackend->startRequest(messages, params, requestId);
+        return;
+    }
+
+    const QString reqId = requestId.isEmpty()
+                              ? QStringLiteral("req_%1_%2")
+                                    .arg(QDateTime::currentMSecsSinceEpoch())
+                                    .arg(QRandomGenerator::global()->bounded(INT_MAX))
+                              : requestId;
+
+    if (m_activeRequests.contains(reqId)) {
+        emit errorOccurred(reqId, QStringLiteral("Request ID already in use"));
+        return;
+    }
+
+    RequestData *reqData = new RequestData();
+    reqData->requestId = reqId;
+    reqData->messages = messages;
+    reqData->params = params;
+    reqData->chained = continuesResponse(messages, params);
+    m_activeRequests.insert(reqId, reqData);
+
+    sendRequest(reqData);
+}
+
+void OpenAIResponsesBackend::sendRequest(RequestData *reqData)
+{
+    const QString reqId = reqData->requestId;
+
+    QString apiKey = reqData->params.contains("access_token") ? reqData->params.value("access_token").toString()
+                                                              : getConfigValue("access_token").toString();
+    if (apiKey.isEmpty()) {
+        failRequest(reqData, QStringLiteral("API key is not set"));
+        return;
+    }
+
+    QNetworkRequest request(responsesUrl());
+    request.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
+    request.setAttribute(QNetworkRequest::Http2AllowedAttribute, true);
+    request.setRawHeader("Authorization", ("Bearer " + apiKey).toUtf8());
+
+    const QByteArray payload = buildRequestPayload(reqData->messages, reqData->params, reqData->chained);
+    qDebug() << "[OpenAIResponsesBackend::sendRequest]" << reqId << "uploads" << payload.size() << "bytes"
+             << (reqData->chained ? "continuing the previous response" : "with the full conversation");
+
+    reqData->elapsed.start();
+    reqData->reply = m_networkManager->post(request, payload);
+    QNetworkReply *reply = reqData->reply;
+
+    connect(reply, &QNetworkReply::metaDataChanged, this, [this, reqId, reply]() {
+        RequestData *rd = m_activeRequests.value(reqId, nullptr);
+        if (!rd || rd->reply != reply)
+            return;
+        QVariantMap headers;
+        const QList<QNetworkReply::RawHeaderPair> pairs = reply->rawHeaderPairs();
+        for (const QNetworkReply::RawHeaderPair &pair : pairs)
+            headers.insert(QString::fromLatin1(pair.first).toLower(), QString::fromLatin1(pair.second));
+        rd->httpStatus = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+        emit responseMetadata(reqId, rd->httpStatus, headers);
+    });
+
+    connect(reply, &QNetworkReply::readyRead, this, [this, reqId, reply]() {
+        RequestData *rd = m_activeRequests.value(reqId, nullptr);
+        if (!rd || rd->reply != reply)
+            return;
+        // Failed requests answer with a JSON error document instead of a stream
+        if (rd->httpStatus >= 300)
+            rd->errorBody += reply->readAll();
+        else
+            processStreamData(*rd, reply->readAll());
+    });
+
+    connect(reply, &QNetworkReply::finished, this, [this, reqId, reply]() {
+        RequestData *rd = m_activeRequests.value(reqId, nullptr);
+        if (!rd || rd->reply != reply)
+            return;
+        onReplyFinished(reqId);
+    });
+
+    emit statusChanged(reqId, QStringLiteral("started"));
+}
+
+void OpenAIResponsesBackend::processStreamData(RequestData &reqData, const QByteArray &chunk)
+{
+    // Every event is "event: <type>" followed by "data: {json}" repeating the type;
+    // the stream ends with response.completed rather than a [DONE] marker
+    reqData.parser.append(chunk);
+
+    QByteArray data;
+    while (reqData.parser.nextData(data)) {
+        if (data.isEmpty())
+            continue;
+
+        QJsonParseError parseError;
+        const QJsonDocument doc = QJsonDocument::fromJson(data, &parseError);
+        if (parseError.error != QJsonParseError::NoError) {
+            failRequest(&reqData, QString("JSON parse error in stream: %1").arg(parseError.errorString()));
+            return;
+        }
+
+        if (doc.isObject() && !handleEvent(reqData, doc.object()))
+            return;
+    }
+}
+
+bool OpenAIResponsesBackend::handleEvent(RequestData &reqData, const QJsonObject &event)
+{
+    const QString type = event.value("type").toString();
+
+    if (type == QLatin1String("response.output_text.delta")) {
+        const QString delta = event.value("delta").toString();
+        if (delta.isEmpty())
+            return true;
+
+        if (!reqData.receivedContent) {
+            reqData.receivedContent = true;
+            qDebug() << "[OpenAIResponsesBackend::handleEvent] Time to first token for" << reqData.requestId
+                     << ":" << reqData.elapsed.elapsed() << "ms";
+        }
+
+        reqData.response.append(delta);
+        emit partialResponse(reqData.requestId, delta);
+        emit choicePartialResponse(reqData.requestId, 0, delta);
+        return true;
+    }
+
+    if (type == QLatin1String("response.completed") || type == QLatin1String("response.incomplete")) {
+        completeRequest(&reqData, event.value("response").toObject());
+        return false;
+    }
+
+    if (type == QLatin1String("response.failed")) {
+        const QString message = event.value("response").toObject().value("error").toObject().value("message").toString();
+        failRequest(&reqData, message.isEmpty() ? QStringLiteral("The response failed") : message);
+        return false;
+    }
+
+    if (type == QLatin1String("error")) {
+        const QString message = event.value("message").toString();
+        failRequest(&reqData, message.isEmpty() ? QStringLiteral("Error in response stream") : message);
+        return false;
+    }
+
+    return true;
+}
+
+void OpenAIResponsesBackend::onReplyFinished(const QString &requestId)
+{
+    RequestData *reqData = m_activeRequests.value(requestId, nullptr);
+    if (!reqData)
+        return;
+
+    QNetworkReply *reply = reqData->reply;
+    reqData->reply = nullptr;
+    reply->deleteLater();
+
+    if (reply->error() == QNetworkReply::NoError) {
+        failRequest(reqData, QStringLiteral("The response stream ended before the response completed"));
+        return;
+    }
+
+    // Stored responses expire (or were never stored): start over from the full conversation
+    if (reqData->chained && !reqData->receivedContent
+        && (reqData->httpStatus == 400 || reqData->httpStatus == 404)) {
+        qWarning() << "[OpenAIResponsesBackend::onReplyFinished] Previous response unavailable for" << requestId
+                   << "- resending the full conversation";
+        reqData->chained = false;
+        reqData->httpStatus = 0;
+        reqData->errorBody.clear();
+        reqData->parser.reset();
+        sendRequest(reqData);
+        return;
+    }
+
+    QString errorString = reply->errorString();
+    const QJsonObject error = QJsonDocument::fromJson(reqData->errorBody).object().value("error").toObject();
+    if (!error.value("message").toString().isEmpty())
+        errorString = error.value("message").toString();
+    failRequest(reqData, errorString);
+}
+
+void OpenAIResponsesBackend::completeRequest(RequestData *reqData, const QJsonObject &response)
+{
+    const QString requestId = reqData->requestId;
+
+    qDebug() << "[OpenAIResponsesBackend::completeRequest] Request" << requestId << "completed in"
+             << reqData->elapsed.elapsed() << "ms";
+
+    if (response.value("status").toString() == QLatin1String("incomplete")) {
+        qWarning() << "[OpenAIResponsesBackend::completeRequest] Response incomplete:"
+                   << response.value("incomplete_details").toObject().value("reason").toString();
+    }
+
+    const QJsonObject usage = response.value("usage").toObject();
+    if (!usage.isEmpty()) {
+        // Also under the chat completions names the receivers read
+        QVariantMap usageMap = usage.toVariantMap();
+        usageMap["prompt_tokens"] = usage.value("input_tokens").toInt();
+        usageMap["completion_tokens"] = usage.value("output_tokens").toInt();
+        usageMap["prompt_tokens_details"] = usage.value("input_tokens_details").toObject().toVariantMap();
+        emit usageReported(requestId, usageMap);
+    }
+
+    const QString responseId = response.value("id").toString();
+    if (!responseId.isEmpty() && response.value("store").toBool(true))
+        emit responseStored(requestId, responseId);
+
+    const QString text = std::move(reqData->response);
+    releaseRequest(reqData);
+
+    emit finished(requestId, text);
+    emit statusChanged(requestId, QStringLiteral("completed"));
+}
+
+void OpenAIResponsesBackend::failRequest(RequestData *reqData, const QString &errorString)
+{
+    const QString requestId = reqData->requestId;
+    releaseRequest(reqData);
+    emit errorOccurred(requestId, errorString);
+}
+
+void OpenAIResponsesBackend::releaseRequest(RequestData *reqData)
+{
+    m_activeRequests.remove(reqData->requestId);
+
+    if (reqData->reply) {
+        reqData->reply->disconnect(this);
+        reqData->reply->abort();
+        reqData->reply->deleteLater();
+    }
+    delete reqData;
+}
+
+void OpenAIResponsesBackend::cancelRequest(const QString &requestId)
+{
+    if (requestId.isEmpty()) {
+        m_chatBackend->cancelRequest();
+        const QList<RequestData *> requests = m_activeRequests.values();
+        for (RequestData *reqData : requests)
+            releaseRequest(reqData);
+        return;
+    }
+
+    RequestData *reqData = m_activeRequests.value(requestId, nullptr);
+    if (!reqData) {
+        m_chatBackend->cancelRequest(requestId);
+        return;
+    }
+
+    releaseRequest(reqData);
+    emit statusChanged(requestId, QStringLiteral("cancelled"));
+}
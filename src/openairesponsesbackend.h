@@ -0,0 +1,97 @@
+#ifndef OPENAIRESPONSESBACKEND_H
+#define OPENAIRESPONSESBACKEND_H
+
+#pragma once
+
+#include "aibackend.h"
+#include "ssestreamparser.h"
+
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QHash>
+#include <QElapsedTimer>
+
+class QJsonObject;
+
+/**
+ * @brief AIBackend for the OpenAI Responses API (/v1/responses).
+ *
+ * Requests whose params (or config) set "endpoint" to "responses" are sent
+ * here; everything else, and requests for several choices ("n" > 1) or with
+ * a "prediction" (both lacking in the Responses API), is passed on to the
+ * wrapped chat completions backend. The backend takes ownership of it.
+ * Requests are sent through 'networkManager', normally the chat backend's
+ * (OpenAIBackend::networkManager()), so both APIs share one connection; it
+ * must outlive this backend.
+ *
+ * Responses are stored server-side and reported through responseStored().
+ * A request with "previous_response_id" and "previous_message_count" params
+ * only uploads the messages after the first previous_message_count ones,
+ * which that response already holds; if the service no longer knows the id,
+ * the request is sent again with the full conversation.
+ */
+class OpenAIResponsesBackend : public AIBackend
+{
+    Q_OBJECT
+public:
+    OpenAIResponsesBackend(AIBackend *chatBackend, QNetworkAccessManager *networkManager,
+                           QObject *parent = nullptr);
+    ~OpenAIResponsesBackend() override;
+
+    void startRequest(const QList<Message> &messages,
+                      const QVariantMap &params = QVariantMap(),
+                      const QString &requestId = QString()) override;
+
+    void cancelRequest(const QString &requestId = QString()) override;
+
+    bool supportsStreaming() const override { return true; }
+    QString backendName() const override { return m_chatBackend->backendName(); }
+
+    void prewarm() override;
+    void setConfig(const QVariantMap &config) override;
+    QByteArray requestPayload(const QList<Message> &messages, const QVariantMap &params) const override;
+
+    // Digest of the first 'count' messages; a stored response can only be continued
+    // while the conversation still starts with exactly these messages
+    static QString conversationDigest(const QList<Message> &messages, int count);
+
+private:
+    struct RequestData {
+        QNetworkReply *reply = nullptr;
+        SseStreamParser parser;
+        QString requestId;
+        QList<Message> messages;    // Full conversation, for the unchained retry
+        QVariantMap params;
+        bool chained = false;       // Sent as a continuation of previous_response_id
+        int httpStatus = 0;
+        QByteArray errorBody;       // Body of a failed (non-2xx) response
+        QString response;
+        QElapsedTimer elapsed;
+        bool receivedContent = false;
+    };
+
+    // True if the request goes to the Responses API rather than the chat backend
+    bool handlesRequest(const QVariantMap &params) const;
+    // True if the request can continue its previous_response_id instead of sending everything
+    static bool continuesResponse(const QList<Message> &messages, const QVariantMap &params);
+
+    void sendRequest(RequestData *reqData);
+    void processStreamData(RequestData &reqData, const QByteArray &chunk);
+    // Returns false once the event ended the request (reqData is gone)
+    bool handleEvent(RequestData &reqData, const QJsonObject &event);
+    void onReplyFinished(const QString &requestId);
+    void completeRequest(RequestData *reqData, const QJsonObject &response);
+    void failRequest(RequestData *reqData, const QString &errorString);
+    // Forget the request and drop its reply without emitting anything
+    void releaseRequest(RequestData *reqData);
+
+    QByteArray buildRequestPayload(const QList<Message> &messages, const QVariantMap &params, bool chained) const;
+    QUrl responsesUrl() const;
+    QVariant getConfigValue(const QString &key, const QVariant &defaultValue = QVariant()) const;
+
+    AIBackend *m_chatBackend = nullptr;
+    QNetworkAccessManager *m_networkManager = nullptr;   // Not owned
+    QHash<QString, RequestData *> m_activeRequests;
+};
+
+#endif // OPENAIRESPONSESBACKEND_H
@@ -1,11 +1,13 @@
 #include "project.h"
 #include "appconfig.h"
+#include "sourceamalgamator.h"
 #include <QFileInfo>
 #include <QDir>
 #include <QDebug>
 
 Project::Project(QObject *parent)
     : QObject(parent)
+    , m_sourceAmalgamator(new SourceAmalgamator(this))
 {
 }
 
@@ -22,9 +24,15 @@ bool Project::load(const QString &filepath)
         return false;
     }
 
+    applyConfig();
     return true;
 }
 
+void Project::applyConfig()
+{
+    m_sourceAmalgamator->configure(m_config);
+}
+
 bool Project::save(const QString &filepath)
 {
     QString savePath = filepath.isEmpty() ? m_projectFilePath : filepath;
@@ -54,6 +62,14 @@ QVariant Project::getValue(const QString &keyPath, const QVariant &defaultValue)
     if (keyPath == "api.top_p") return m_config.apiTopP;
     if (keyPath == "api.frequency_penalty") return m_config.apiFrequencyPenalty;
     if (keyPath == "api.presence_penalty") return m_config.apiPresencePenalty;
+    if (keyPath == "api.response_cache") return m_config.apiResponseCache;
+    if (keyPath == "api.response_cache_max_mb") return m_config.apiResponseCacheMaxMB;
+    if (keyPath == "api.stream_journal") return m_config.apiStreamJournal;
+    if (keyPath == "api.endpoint") return m_config.apiEndpoint;
+    if (keyPath == "api.prompt_layout") return m_config.apiPromptLayout;
+    if (keyPath == "api.context_policy") return m_config.apiContextPolicy;
+    if (keyPath == "api.command_output_max_tokens") return m_config.apiCommandOutputMaxTokens;
+    if (keyPath == "api.max_concurrent_requests") return m_config.apiMaxConcurrentRequests;
 
     if (keyPath == "folders.root") return m_config.rootFolder;
     if (keyPath == "folders.docs") return m_config.docsFolder;
@@ -88,6 +104,14 @@ void Project::setValue(const QString &keyPath, const QVariant &value)
     if (keyPath == "api.top_p") { m_config.apiTopP = value.toDouble(); return; }
     if (keyPath == "api.frequency_penalty") { m_config.apiFrequencyPenalty = value.toDouble(); return; }
     if (keyPath == "api.presence_penalty") { m_config.apiPresencePenalty = value.toDouble(); return; }
+    if (keyPath == "api.response_cache") { m_config.apiResponseCache = value.toBool(); return; }
+    if (keyPath == "api.response_cache_max_mb") { m_config.apiResponseCacheMaxMB = value.toInt(); return; }
+    if (keyPath == "api.stream_journal") { m_config.apiStreamJournal = value.toBool(); return; }
+    if (keyPath == "api.endpoint") { m_config.apiEndpoint = value.toString(); return; }
+    if (keyPath == "api.prompt_layout") { m_config.apiPromptLayout = value.toString(); return; }
+    if (keyPath == "api.context_policy") { m_config.apiContextPolicy = value.toString(); return; }
+    if (keyPath == "api.command_output_max_tokens") { m_config.apiCommandOutputMaxTokens = value.toInt(); return; }
+    if (keyPath == "api.max_concurrent_requests") { m_config.apiMaxConcurrentRequests = value.toInt(); return; }
 
     if (keyPath == "folders.root") { m_config.rootFolder = value.toString(); return; }
     if (keyPath == "folders.docs") { m_config.docsFolder = value.toString(); return; }
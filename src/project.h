@@ -7,6 +7,8 @@
 #include <QStringList>
 #include "projectconfig.h"
 
+class SourceAmalgamator;
+
 class Project : public QObject
 {
     Q_OBJECT
@@ -44,13 +46,25 @@ public:
     double topP() const { return m_config.apiTopP; }
     double frequencyPenalty() const { return m_config.apiFrequencyPenalty; }
     double presencePenalty() const { return m_config.apiPresencePenalty; }
+    bool responseCache() const { return m_config.apiResponseCache; }
+    int responseCacheMaxMB() const { return m_config.apiResponseCacheMaxMB; }
+    bool streamJournal() const { return m_config.apiStreamJournal; }
+    QString apiEndpoint() const { return m_config.apiEndpoint; }
+    int maxConcurrentRequests() const { return m_config.apiMaxConcurrentRequests; }
 
     // Get project config file path
     QString projectFilePath() const { return m_projectFilePath; }
 
+    // Incremental source amalgamation shared by all sessions of the project
+    SourceAmalgamator* sourceAmalgamator() const { return m_sourceAmalgamator; }
+
+    // Push config changes to project services (call after editing config())
+    void applyConfig();
+
 private:
     QString m_projectFilePath;
     ProjectConfig m_config;
+    SourceAmalgamator* m_sourceAmalgamator = nullptr;
 };
 
 #endif // PROJECT_H
@@ -19,6 +19,14 @@ ProjectConfig ProjectConfig::fromJson(const QJsonObject &obj)
         config.apiPresencePenalty = api.value("presence_penalty").toDouble(config.apiPresencePenalty);
         config.apiStream = api.value("stream").toBool(config.apiStream);
         config.apiProprietary = api.value("proprietary").toBool(config.apiProprietary);
+        config.apiResponseCache = api.value("response_cache").toBool(config.apiResponseCache);
+        config.apiResponseCacheMaxMB = api.value("response_cache_max_mb").toInt(config.apiResponseCacheMaxMB);
+        config.apiStreamJournal = api.value("stream_journal").toBool(config.apiStreamJournal);
+        config.apiEndpoint = api.value("endpoint").toString(config.apiEndpoint);
+        config.apiPromptLayout = api.value("prompt_layout").toString(config.apiPromptLayout);
+        config.apiContextPolicy = api.value("context_policy").toString(config.apiContextPolicy);
+        config.apiCommandOutputMaxTokens = api.value("command_output_max_tokens").toInt(config.apiCommandOutputMaxTokens);
+        config.apiMaxConcurrentRequests = api.value("max_concurrent_requests").toInt(config.apiMaxConcurrentRequests);
     }
 
     // Folder Settings
@@ -72,6 +80,26 @@ ProjectConfig ProjectConfig::fromJson(const QJsonObject &obj)
         }
     }
 
+    if (obj.contains("command_pipe_options") && obj["command_pipe_options"].isObject()) {
+        QJsonObject options = obj["command_pipe_options"].toObject();
+        config.commandPipeTimeoutSecs = options.value("timeout_secs").toInt(config.commandPipeTimeoutSecs);
+        config.commandPipeMaxOutputKB = options.value("max_output_kb").toInt(config.commandPipeMaxOutputKB);
+        config.watchSources = options.value("watch_sources").toBool(config.watchSources);
+    }
+
+    // Strike Variants
+    if (obj.contains("strike_variants") && obj["strike_variants"].isArray()) {
+        for (const QJsonValue &val : obj["strike_variants"].toArray()) {
+            QJsonObject variantObj = val.toObject();
+            StrikeVariant variant;
+            variant.label = variantObj.value("label").toString();
+            variant.model = variantObj.value("model").toString();
+            variant.temperature = variantObj.value("temperature").toDouble(variant.temperature);
+            variant.topP = variantObj.value("top_p").toDouble(variant.topP);
+            config.strikeVariants.append(variant);
+        }
+    }
+
     return config;
 }
 
@@ -90,6 +118,14 @@ QJsonObject ProjectConfig::toJson() const
     api["presence_penalty"] = apiPresencePenalty;
     api["stream"] = apiStream;
     api["proprietary"] = apiProprietary;
+    api["response_cache"] = apiResponseCache;
+    api["response_cache_max_mb"] = apiResponseCacheMaxMB;
+    api["stream_journal"] = apiStreamJournal;
+    api["endpoint"] = apiEndpoint;
+    api["prompt_layout"] = apiPromptLayout;
+    api["context_policy"] = apiContextPolicy;
+    api["command_output_max_tokens"] = apiCommandOutputMaxTokens;
+    api["max_concurrent_requests"] = apiMaxConcurrentRequests;
     obj["api"] = api;
 
     // Folder Settings
@@ -134,6 +170,27 @@ QJsonObject ProjectConfig::toJson() const
     }
     obj["command_pipes"] = pipes;
 
+    QJsonObject pipeOptions;
+    pipeOptions["timeout_secs"] = commandPipeTimeoutSecs;
+    pipeOptions["max_output_kb"] = commandPipeMaxOutputKB;
+    pipeOptions["watch_sources"] = watchSources;
+    obj["command_pipe_options"] = pipeOptions;
+
+    // Strike Variants (unset fields are left out so they keep following the API settings)
+    QJsonArray variants;
+    for (const StrikeVariant &variant : strikeVariants) {
+        QJsonObject variantObj;
+        variantObj["label"] = variant.label;
+        if (!variant.model.isEmpty())
+            variantObj["model"] = variant.model;
+        if (variant.temperature >= 0.0)
+            variantObj["temperature"] = variant.temperature;
+        if (variant.topP >= 0.0)
+            variantObj["top_p"] = variant.topP;
+        variants.append(variantObj);
+    }
+    obj["strike_variants"] = variants;
+
     return obj;
 }
 
@@ -194,6 +251,13 @@ void ProjectConfig::mergeFrom(const ProjectConfig &other)
     apiPresencePenalty = other.apiPresencePenalty;
     apiStream = other.apiStream;
     apiProprietary = other.apiProprietary;
+    apiResponseCache = other.apiResponseCache;
+    apiResponseCacheMaxMB = other.apiResponseCacheMaxMB;
+    apiStreamJournal = other.apiStreamJournal;
+    if (!other.apiEndpoint.isEmpty()) apiEndpoint = other.apiEndpoint;
+    if (!other.apiPromptLayout.isEmpty()) apiPromptLayout = other.apiPromptLayout;
+    if (!other.apiContextPolicy.isEmpty()) apiContextPolicy = other.apiContextPolicy;
+    apiCommandOutputMaxTokens = other.apiCommandOutputMaxTokens;
 
     if (!other.rootFolder.isEmpty()) rootFolder = other.rootFolder;
     if (!other.docsFolder.isEmpty()) docsFolder = other.docsFolder;
@@ -205,6 +269,10 @@ void ProjectConfig::mergeFrom(const ProjectConfig &other)
     if (!other.sourceFileTypes.isEmpty()) sourceFileTypes = other.sourceFileTypes;
     if (!other.docFileTypes.isEmpty()) docFileTypes = other.docFileTypes;
     if (!other.commandPipes.isEmpty()) commandPipes = other.commandPipes;
+    commandPipeTimeoutSecs = other.commandPipeTimeoutSecs;
+    commandPipeMaxOutputKB = other.commandPipeMaxOutputKB;
+    watchSources = other.watchSources;
+    if (!other.strikeVariants.isEmpty()) strikeVariants = other.strikeVariants;
 }
 
 ProjectConfig ProjectConfig::createDefault()
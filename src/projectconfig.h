@@ -8,6 +8,7 @@
 #include <QJsonArray>
 #include <QJsonDocument>
 #include <QVariant>
+#include <QVector>
 
 /**
  * @brief Configuration structure for a VibeKoder project.
@@ -17,6 +18,14 @@
  */
 struct ProjectConfig
 {
+    // One way of "striking" the prompt stack; unset fields use the API settings
+    struct StrikeVariant {
+        QString label;
+        QString model;              // empty: apiModel
+        double temperature = -1.0;  // negative: apiTemperature
+        double topP = -1.0;         // negative: apiTopP
+    };
+
     // === API Settings ===
     QString apiAccessToken;
     QString apiModel = "gpt-4.1-mini";
@@ -27,6 +36,14 @@ struct ProjectConfig
     double apiPresencePenalty = 0.0;
     bool apiStream = false;
     bool apiProprietary = true;
+    bool apiResponseCache = false;         // answer repeated identical requests from disk
+    int apiResponseCacheMaxMB = 64;
+    bool apiStreamJournal = false;         // journal streamed answers to a temp file for crash recovery
+    QString apiEndpoint = "chat_completions"; // or "responses": continue stored responses
+    QString apiPromptLayout = "inline";       // or "stable": included content ordered by volatility
+    QString apiContextPolicy = "shorten";     // or "drop", "off": fitting old answers into the context window
+    int apiCommandOutputMaxTokens = 8000;     // command pipe output beyond this keeps head and tail; 0: no limit
+    int apiMaxConcurrentRequests = 8;         // requests in flight at once, the rest wait in the queue; 0: no limit
 
     // === Folder Settings ===
     QString rootFolder;
@@ -46,6 +63,12 @@ struct ProjectConfig
         {"make_output", {"make", "build"}},
         {"execute", {"VibeKoder", "build"}}
     };
+    int commandPipeTimeoutSecs = 120;      // a pipe still running after this is killed
+    int commandPipeMaxOutputKB = 1024;     // output beyond this is dropped
+    bool watchSources = false;             // keep the amalgamated source current in the background
+
+    // === Strike ===
+    QVector<StrikeVariant> strikeVariants; // sent concurrently by the session tab's Strike button
 
     /**
      * @brief Load configuration from a JSON object
@@ -7,6 +7,8 @@
 #include <QTabWidget>
 #include <QLineEdit>
 #include <QSpinBox>
+#include <QCheckBox>
+#include <QComboBox>
 #include <QDoubleSpinBox>
 #include <QListWidget>
 #include <QTableWidget>
@@ -43,6 +45,7 @@ void ProjectSettingsDialog::setupUi()
     m_tabWidget->addTab(createFoldersTab(), "Folders");
     m_tabWidget->addTab(createFiletypesTab(), "File Types");
     m_tabWidget->addTab(createCommandPipesTab(), "Command Pipes");
+    m_tabWidget->addTab(createStrikeTab(), "Strike");
     mainLayout->addWidget(m_tabWidget);
 
     // Dialog buttons
@@ -101,6 +104,44 @@ QWidget* ProjectSettingsDialog::createApiTab()
     m_apiPresencePenalty->setValue(0.0);
     layout->addRow("Presence Penalty:", m_apiPresencePenalty);
 
+    m_apiResponseCache = new QCheckBox("Answer identical repeated requests from the response cache", tab);
+    layout->addRow("Response Cache:", m_apiResponseCache);
+
+    m_apiResponseCacheMaxMB = new QSpinBox(tab);
+    m_apiResponseCacheMaxMB->setRange(1, 10240);
+    m_apiResponseCacheMaxMB->setSuffix(" MB");
+    m_apiResponseCacheMaxMB->setValue(64);
+    layout->addRow("Response Cache Size:", m_apiResponseCacheMaxMB);
+
+    m_apiStreamJournal = new QCheckBox("Journal streamed answers to a temporary file for crash recovery", tab);
+    layout->addRow("Stream Journal:", m_apiStreamJournal);
+
+    m_apiResponsesEndpoint = new QCheckBox("Use the Responses API and send only new slices after a stored response", tab);
+    layout->addRow("Responses API:", m_apiResponsesEndpoint);
+
+    m_apiStablePromptLayout = new QCheckBox("Put included files first, static docs before source before command output", tab);
+    layout->addRow("Prompt Layout:", m_apiStablePromptLayout);
+
+    m_apiContextPolicy = new QComboBox(tab);
+    m_apiContextPolicy->addItem("Shorten the oldest answers to fit", "shorten");
+    m_apiContextPolicy->addItem("Leave out the oldest answers to fit", "drop");
+    m_apiContextPolicy->addItem("Send everything", "off");
+    layout->addRow("Context Window:", m_apiContextPolicy);
+
+    m_apiCommandOutputMaxTokens = new QSpinBox(tab);
+    m_apiCommandOutputMaxTokens->setRange(0, 1000000);
+    m_apiCommandOutputMaxTokens->setSingleStep(1000);
+    m_apiCommandOutputMaxTokens->setSpecialValueText("No limit");
+    m_apiCommandOutputMaxTokens->setSuffix(" tokens");
+    m_apiCommandOutputMaxTokens->setValue(8000);
+    layout->addRow("Command Output Limit:", m_apiCommandOutputMaxTokens);
+
+    m_apiMaxConcurrentRequests = new QSpinBox(tab);
+    m_apiMaxConcurrentRequests->setRange(0, 256);
+    m_apiMaxConcurrentRequests->setSpecialValueText("No limit");
+    m_apiMaxConcurrentRequests->setValue(8);
+    layout->addRow("Concurrent Requests:", m_apiMaxConcurrentRequests);
+
     return tab;
 }
 
@@ -209,6 +250,50 @@ QWidget* ProjectSettingsDialog::createCommandPipesTab()
     buttonsLayout->addStretch();
     layout->addLayout(buttonsLayout);
 
+    QFormLayout* limitsLayout = new QFormLayout();
+    m_pipeTimeoutSecs = new QSpinBox(tab);
+    m_pipeTimeoutSecs->setRange(1, 3600);
+    m_pipeTimeoutSecs->setSuffix(" s");
+    limitsLayout->addRow("Timeout:", m_pipeTimeoutSecs);
+    m_pipeMaxOutputKB = new QSpinBox(tab);
+    m_pipeMaxOutputKB->setRange(1, 1024 * 1024);
+    m_pipeMaxOutputKB->setSuffix(" KB");
+    limitsLayout->addRow("Max Output:", m_pipeMaxOutputKB);
+    m_watchSources = new QCheckBox("Keep amalgamated source (amalgamateSrc) current in the background", tab);
+    limitsLayout->addRow(m_watchSources);
+    layout->addLayout(limitsLayout);
+
+    return tab;
+}
+
+QWidget* ProjectSettingsDialog::createStrikeTab()
+{
+    QWidget* tab = new QWidget(this);
+    QVBoxLayout* layout = new QVBoxLayout(tab);
+
+    QLabel* info = new QLabel(
+        "<b>Strike Variants:</b> Models and sampling settings the prompt stack is sent to at once. "
+        "Empty cells use the API settings.", tab);
+    info->setWordWrap(true);
+    layout->addWidget(info);
+
+    m_strikeVariantsTable = new QTableWidget(tab);
+    m_strikeVariantsTable->setColumnCount(4);
+    m_strikeVariantsTable->setHorizontalHeaderLabels(QStringList() << "Label" << "Model" << "Temperature" << "Top P");
+    m_strikeVariantsTable->horizontalHeader()->setStretchLastSection(true);
+    m_strikeVariantsTable->setSelectionBehavior(QAbstractItemView::SelectRows);
+    layout->addWidget(m_strikeVariantsTable);
+
+    QHBoxLayout* buttonsLayout = new QHBoxLayout();
+    m_addVariantBtn = new QPushButton("Add Variant", tab);
+    m_removeVariantBtn = new QPushButton("Remove Variant", tab);
+    connect(m_addVariantBtn, &QPushButton::clicked, this, &ProjectSettingsDialog::onAddStrikeVariant);
+    connect(m_removeVariantBtn, &QPushButton::clicked, this, &ProjectSettingsDialog::onRemoveStrikeVariant);
+    buttonsLayout->addWidget(m_addVariantBtn);
+    buttonsLayout->addWidget(m_removeVariantBtn);
+    buttonsLayout->addStretch();
+    layout->addLayout(buttonsLayout);
+
     return tab;
 }
 
@@ -222,6 +307,14 @@ void ProjectSettingsDialog::loadSettings(const ProjectConfig &config)
     m_apiTopP->setValue(config.apiTopP);
     m_apiFrequencyPenalty->setValue(config.apiFrequencyPenalty);
     m_apiPresencePenalty->setValue(config.apiPresencePenalty);
+    m_apiResponseCache->setChecked(config.apiResponseCache);
+    m_apiResponseCacheMaxMB->setValue(config.apiResponseCacheMaxMB);
+    m_apiStreamJournal->setChecked(config.apiStreamJournal);
+    m_apiResponsesEndpoint->setChecked(config.apiEndpoint == "responses");
+    m_apiStablePromptLayout->setChecked(config.apiPromptLayout == "stable");
+    m_apiContextPolicy->setCurrentIndex(qMax(0, m_apiContextPolicy->findData(config.apiContextPolicy)));
+    m_apiCommandOutputMaxTokens->setValue(config.apiCommandOutputMaxTokens);
+    m_apiMaxConcurrentRequests->setValue(config.apiMaxConcurrentRequests);
 
     // Folders tab
     m_rootFolder->setText(config.rootFolder);
@@ -245,6 +338,22 @@ void ProjectSettingsDialog::loadSettings(const ProjectConfig &config)
         m_commandPipesTable->setItem(row, 0, new QTableWidgetItem(it.key()));
         m_commandPipesTable->setItem(row, 1, new QTableWidgetItem(it.value().join(" ")));
     }
+    m_pipeTimeoutSecs->setValue(config.commandPipeTimeoutSecs);
+    m_pipeMaxOutputKB->setValue(config.commandPipeMaxOutputKB);
+    m_watchSources->setChecked(config.watchSources);
+
+    // Strike tab
+    m_strikeVariantsTable->setRowCount(0);
+    for (const ProjectConfig::StrikeVariant &variant : config.strikeVariants) {
+        int row = m_strikeVariantsTable->rowCount();
+        m_strikeVariantsTable->insertRow(row);
+        m_strikeVariantsTable->setItem(row, 0, new QTableWidgetItem(variant.label));
+        m_strikeVariantsTable->setItem(row, 1, new QTableWidgetItem(variant.model));
+        m_strikeVariantsTable->setItem(row, 2, new QTableWidgetItem(
+            variant.temperature >= 0.0 ? QString::number(variant.temperature) : QString()));
+        m_strikeVariantsTable->setItem(row, 3, new QTableWidgetItem(
+            variant.topP >= 0.0 ? QString::number(variant.topP) : QString()));
+    }
 }
 
 ProjectConfig ProjectSettingsDialog::getSettings() const
@@ -259,6 +368,14 @@ ProjectConfig ProjectSettingsDialog::getSettings() const
     config.apiTopP = m_apiTopP->value();
     config.apiFrequencyPenalty = m_apiFrequencyPenalty->value();
     config.apiPresencePenalty = m_apiPresencePenalty->value();
+    config.apiResponseCache = m_apiResponseCache->isChecked();
+    config.apiResponseCacheMaxMB = m_apiResponseCacheMaxMB->value();
+    config.apiStreamJournal = m_apiStreamJournal->isChecked();
+    config.apiEndpoint = m_apiResponsesEndpoint->isChecked() ? "responses" : "chat_completions";
+    config.apiPromptLayout = m_apiStablePromptLayout->isChecked() ? "stable" : "inline";
+    config.apiContextPolicy = m_apiContextPolicy->currentData().toString();
+    config.apiCommandOutputMaxTokens = m_apiCommandOutputMaxTokens->value();
+    config.apiMaxConcurrentRequests = m_apiMaxConcurrentRequests->value();
 
     // Folders tab
     config.rootFolder = m_rootFolder->text();
@@ -286,6 +403,28 @@ ProjectConfig ProjectSettingsDialog::getSettings() const
         QStringList cmdParts = cmdStr.split(' ', Qt::SkipEmptyParts);
         config.commandPipes.insert(name, cmdParts);
     }
+    config.commandPipeTimeoutSecs = m_pipeTimeoutSecs->value();
+    config.commandPipeMaxOutputKB = m_pipeMaxOutputKB->value();
+    config.watchSources = m_watchSources->isChecked();
+
+    // Strike tab
+    auto cellText = [this](int row, int column) {
+        QTableWidgetItem* item = m_strikeVariantsTable->item(row, column);
+        return item ? item->text().trimmed() : QString();
+    };
+    for (int row = 0; row < m_strikeVariantsTable->rowCount(); ++row) {
+        ProjectConfig::StrikeVariant variant;
+        variant.label = cellText(row, 0);
+        variant.model = cellText(row, 1);
+        bool ok = false;
+        double temperature = cellText(row, 2).toDouble(&ok);
+        if (ok)
+            variant.temperature = temperature;
+        double topP = cellText(row, 3).toDouble(&ok);
+        if (ok)
+            variant.topP = topP;
+        config.strikeVariants.append(variant);
+    }
 
     return config;
 }
@@ -363,3 +502,22 @@ void ProjectSettingsDialog::onRemoveCommandPipe()
         m_commandPipesTable->removeRow(row);
     }
 }
+
+void ProjectSettingsDialog::onAddStrikeVariant()
+{
+    int row = m_strikeVariantsTable->rowCount();
+    m_strikeVariantsTable->insertRow(row);
+    m_strikeVariantsTable->setItem(row, 0, new QTableWidgetItem(QString("Variant %1").arg(row + 1)));
+    for (int column = 1; column < m_strikeVariantsTable->columnCount(); ++column)
+        m_strikeVariantsTable->setItem(row, column, new QTableWidgetItem());
+    m_strikeVariantsTable->setCurrentCell(row, 1);
+    m_strikeVariantsTable->editItem(m_strikeVariantsTable->item(row, 1));
+}
+
+void ProjectSettingsDialog::onRemoveStrikeVariant()
+{
+    int row = m_strikeVariantsTable->currentRow();
+    if (row >= 0) {
+        m_strikeVariantsTable->removeRow(row);
+    }
+}
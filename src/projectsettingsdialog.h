@@ -11,6 +11,8 @@ class QDoubleSpinBox;
 class QListWidget;
 class QTableWidget;
 class QPushButton;
+class QCheckBox;
+class QComboBox;
 
 class ProjectSettingsDialog : public QDialog
 {
@@ -32,6 +34,8 @@ private slots:
     void onRemoveDocFileType();
     void onAddCommandPipe();
     void onRemoveCommandPipe();
+    void onAddStrikeVariant();
+    void onRemoveStrikeVariant();
 
 private:
     void setupUi();
@@ -39,6 +43,7 @@ private:
     QWidget* createFoldersTab();
     QWidget* createFiletypesTab();
     QWidget* createCommandPipesTab();
+    QWidget* createStrikeTab();
 
     // API tab widgets
     QLineEdit* m_apiAccessToken;
@@ -48,6 +53,14 @@ private:
     QDoubleSpinBox* m_apiTopP;
     QDoubleSpinBox* m_apiFrequencyPenalty;
     QDoubleSpinBox* m_apiPresencePenalty;
+    QCheckBox* m_apiResponseCache;
+    QSpinBox* m_apiResponseCacheMaxMB;
+    QCheckBox* m_apiStreamJournal;
+    QCheckBox* m_apiResponsesEndpoint;
+    QCheckBox* m_apiStablePromptLayout;
+    QComboBox* m_apiContextPolicy;
+    QSpinBox* m_apiCommandOutputMaxTokens;
+    QSpinBox* m_apiMaxConcurrentRequests;
 
     // Folders tab widgets
     QLineEdit* m_rootFolder;
@@ -68,6 +81,14 @@ private:
     QTableWidget* m_commandPipesTable;
     QPushButton* m_addPipeBtn;
     QPushButton* m_removePipeBtn;
+    QSpinBox* m_pipeTimeoutSecs;
+    QSpinBox* m_pipeMaxOutputKB;
+    QCheckBox* m_watchSources;
+
+    // Strike tab widgets
+    QTableWidget* m_strikeVariantsTable;
+    QPushButton* m_addVariantBtn;
+    QPushButton* m_removeVariantBtn;
 
     QTabWidget* m_tabWidget;
 };
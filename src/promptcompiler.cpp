@@ -0,0 +1,119 @@
+#include "promptcompiler.h"
+
+#include <QStringView>
+
+QVector<PromptCompiler::Segment> PromptCompiler::tokenize(const QString &text, const QStringList &kinds)
+{
+    QVector<Segment> segments;
+
+    const int len = text.size();
+    int literalStart = 0;
+    int pos = 0;
+
+    auto flushLiteral = [&](int end) {
+        if (end > literalStart) {
+            Segment literal;
+            literal.type = Segment::Literal;
+            literal.start = literalStart;
+            literal.length = end - literalStart;
+            segments.append(literal);
+        }
+    };
+
+    while (pos < len) {
+        const int open = text.indexOf(QLatin1String("<!--"), pos);
+        if (open < 0)
+            break;
+
+        // Hand-written equivalent of <!--\s*(kind):\s*(.*?)\s*-->
+        int p = open + 4;
+        while (p < len && text.at(p).isSpace())
+            ++p;
+
+        const int kindStart = p;
+        while (p < len && (text.at(p).isLetter() || text.at(p) == QLatin1Char('_')))
+            ++p;
+
+        if (p == kindStart || p >= len || text.at(p) != QLatin1Char(':')) {
+            pos = open + 4;
+            continue;
+        }
+
+        const QString kind = text.mid(kindStart, p - kindStart).toLower();
+        if (!kinds.contains(kind, Qt::CaseInsensitive)) {
+            pos = open + 4;
+            continue;
+        }
+
+        const int close = text.indexOf(QLatin1String("-->"), p + 1);
+        if (close < 0)
+            break;
+
+        // The argument itself may not span lines (only the surrounding whitespace may)
+        const QStringView argument = QStringView(text).mid(p + 1, close - p - 1).trimmed();
+        if (argument.contains(QLatin1Char('\n'))) {
+            pos = open + 4;
+            continue;
+        }
+
+        flushLiteral(open);
+
+        Segment marker;
+        marker.type = Segment::Marker;
+        marker.start = open;
+        marker.length = close + 3 - open;
+        marker.kind = kind;
+        marker.argument = argument.toString();
+        segments.append(marker);
+
+        literalStart = close + 3;
+        pos = literalStart;
+    }
+
+    flushLiteral(len);
+
+    return segments;
+}
+
+QString PromptCompiler::compile(const QString &text, const QStringList &kinds, const Resolver &resolver)
+{
+    const QVector<Segment> segments = tokenize(text, kinds);
+
+    bool hasMarker = false;
+    for (const Segment &segment : segments) {
+        if (segment.type == Segment::Marker) {
+            hasMarker = true;
+            break;
+        }
+    }
+    if (!hasMarker)
+        return text;
+
+    // Resolve all markers first so the output size is known up front
+    QVector<QString> replacements(segments.size());
+    QVector<bool> resolved(segments.size(), false);
+    qsizetype totalLength = 0;
+
+    for (int i = 0; i < segments.size(); ++i) {
+        const Segment &segment = segments.at(i);
+        if (segment.type == Segment::Marker && resolver && resolver(segment, replacements[i])) {
+            resolved[i] = true;
+            totalLength += replacements.at(i).size();
+        } else {
+            totalLength += segment.length;
+        }
+    }
+
+    QString result;
+    result.reserve(totalLength);
+
+    for (int i = 0; i < segments.size(); ++i) {
+        const Segment &segment = segments.at(i);
+        if (resolved.at(i))
+            result.append(replacements.at(i));
+        else
+            result.append(QStringView(text).mid(segment.start, segment.length));
+    }
+
+    return result;
+}
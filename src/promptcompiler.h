@@ -0,0 +1,55 @@
+#ifndef PROMPTCOMPILER_H
+#define PROMPTCOMPILER_H
+
+#pragma once
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <functional>
+
+/**
+ * @brief Single-pass compiler for marker comments in prompt slices.
+ *
+ * A slice is tokenized once into literal and marker segments
+ * (<!-- kind: argument -->). Every marker is resolved first and the output
+ * is then assembled into one exactly-sized allocation, instead of splicing
+ * the string (and moving its tail) once per marker.
+ */
+class PromptCompiler
+{
+public:
+    struct Segment {
+        enum Type {
+            Literal,
+            Marker
+        };
+
+        Type type = Literal;
+        int start = 0;      // offset into the source text
+        int length = 0;     // length in the source text (whole comment for markers)
+        QString kind;       // lower-case marker kind, e.g. "include", "cached", "command"
+        QString argument;   // trimmed marker argument, e.g. "docs/Vision.md"
+    };
+
+    /**
+     * @brief Produces the replacement text for a marker.
+     * Return false to keep the marker text unchanged in the output.
+     */
+    using Resolver = std::function<bool(const Segment &marker, QString &replacement)>;
+
+    /**
+     * @brief Split text into literal and marker segments.
+     * Only markers whose kind is listed in 'kinds' are recognised (case-insensitive);
+     * anything else stays part of the surrounding literal.
+     */
+    static QVector<Segment> tokenize(const QString &text, const QStringList &kinds);
+
+    /**
+     * @brief Tokenize, resolve every marker and assemble the result in one allocation.
+     * Text without any recognised marker is returned as-is (implicitly shared, no copy).
+     */
+    static QString compile(const QString &text, const QStringList &kinds, const Resolver &resolver);
+};
+
+#endif // PROMPTCOMPILER_H
@@ -0,0 +1,420 @@
+#include "requestscheduler.h"
+
+#include <QRandomGenerator>
+#include <QRegularExpression>
+#include <QDebug>
+
+#include <algorithm>
+
+namespace {
+
+const int kMaxRetries = 4;
+const qint64 kBackoffBaseMs = 1000;
+const qint64 kBackoffMaxMs = 60 * 1000;
+const int kQueueStatusIntervalMs = 1000;
+
+// Rough characters-per-token ratio for budgeting before the real count is known
+const qint64 kCharsPerToken = 4;
+
+} // namespace
+
+RequestScheduler::RequestScheduler(AIBackend *backend, QObject *parent)
+    : AIBackend(parent)
+    , m_backend(backend)
+{
+    Q_ASSERT(m_backend);
+    m_backend->setParent(this);
+
+    connect(m_backend, &AIBackend::partialResponse, this, &RequestScheduler::onPartialResponse);
+    connect(m_backend, &AIBackend::finished, this, &RequestScheduler::onFinished);
+    connect(m_backend, &AIBackend::errorOccurred, this, &RequestScheduler::onErrorOccurred);
+    connect(m_backend, &AIBackend::statusChanged, this, &AIBackend::statusChanged);
+    connect(m_backend, &AIBackend::usageReported, this, &AIBackend::usageReported);
+    connect(m_backend, &AIBackend::choicesFinished, this, &AIBackend::choicesFinished);
+    connect(m_backend, &AIBackend::choicePartialResponse, this, &RequestScheduler::onChoicePartialResponse);
+    connect(m_backend, &AIBackend::servedFromCache, this, &AIBackend::servedFromCache);
+    connect(m_backend, &AIBackend::responseStored, this, &AIBackend::responseStored);
+    connect(m_backend, &AIBackend::responseMetadata, this, &RequestScheduler::onResponseMetadata);
+
+    m_wakeTimer.setSingleShot(true);
+    connect(&m_wakeTimer, &QTimer::timeout, this, &RequestScheduler::dispatch);
+
+    // Keeps the displayed wait time current while something is queued
+    m_queueStatusTimer.setInterval(kQueueStatusIntervalMs);
+    connect(&m_queueStatusTimer, &QTimer::timeout, this, &RequestScheduler::emitQueueChanged);
+}
+
+RequestScheduler::~RequestScheduler()
+{
+}
+
+void RequestScheduler::setConfig(const QVariantMap &config)
+{
+    AIBackend::setConfig(config);
+    m_backend->setConfig(config);
+
+    // A raised concurrency limit may admit queued requests right away
+    if (!m_queue.isEmpty())
+        QTimer::singleShot(0, this, &RequestScheduler::dispatch);
+}
+
+QByteArray RequestScheduler::requestPayload(const QList<Message> &messages, const QVariantMap &params) const
+{
+    // Priority only orders the queue; it is never sent
+    QVariantMap innerParams = params;
+    innerParams.remove("priority");
+    return m_backend->requestPayload(messages, innerParams);
+}
+
+qint64 RequestScheduler::oldestWaitMs() const
+{
+    qint64 oldest = 0;
+    const QDateTime now = QDateTime::currentDateTimeUtc();
+    for (const Job &job : m_queue)
+        oldest = qMax(oldest, job.enqueuedAt.msecsTo(now));
+    return oldest;
+}
+
+void RequestScheduler::startRequest(const QList<Message> &messages,
+                                    const QVariantMap &params,
+                                    const QString &requestId)
+{
+    QString reqId = requestId;
+    if (reqId.isEmpty()) {
+        reqId = QStringLiteral("req_%1_%2")
+                    .arg(QDateTime::currentMSecsSinceEpoch())
+                    .arg(QRandomGenerator::global()->bounded(INT_MAX));
+    }
+
+    bool queued = std::any_of(m_queue.cbegin(), m_queue.cend(),
+                              [&](const Job &queuedJob) { return queuedJob.requestId == reqId; });
+    if (queued || m_inFlight.contains(reqId)) {
+        emit errorOccurred(reqId, QStringLiteral("Request ID already in use"));
+        return;
+    }
+
+    const QVariantMap cfg = config();
+
+    Job job;
+    job.messages = messages;
+    job.params = params;
+    job.requestId = reqId;
+    job.priority = params.value("priority").toString() == QLatin1String("background") ? Background : Interactive;
+    job.params.remove("priority");
+    job.model = params.value("model", cfg.value("model", "gpt-4.1-mini")).toString();
+    // Every choice of an n > 1 request can use up to max_tokens
+    job.estimatedTokens = estimateTokens(messages, params.value("max_tokens", cfg.value("max_tokens", 800)).toInt()
+                                                       * qMax(1, params.value("n", 1).toInt()));
+    job.sequence = m_nextSequence++;
+    job.enqueuedAt = QDateTime::currentDateTimeUtc();
+
+    enqueue(job);
+    dispatch();
+
+    queued = std::any_of(m_queue.cbegin(), m_queue.cend(),
+                         [&](const Job &queuedJob) { return queuedJob.requestId == reqId; });
+    if (queued) {
+        qDebug() << "[RequestScheduler::startRequest] Queued" << reqId << "for" << job.model
+                 << "(queue depth" << m_queue.size() << ")";
+        emit statusChanged(reqId, QStringLiteral("queued"));
+    }
+}
+
+void RequestScheduler::cancelRequest(const QString &requestId)
+{
+    if (requestId.isEmpty()) {
+        const QList<Job> queue = m_queue;
+        m_queue.clear();
+        m_inFlight.clear();
+        m_backend->cancelRequest();
+        for (const Job &job : queue)
+            emit statusChanged(job.requestId, QStringLiteral("cancelled"));
+        emitQueueChanged();
+        return;
+    }
+
+    for (int i = 0; i < m_queue.size(); ++i) {
+        if (m_queue.at(i).requestId == requestId) {
+            m_queue.removeAt(i);
+            emit statusChanged(requestId, QStringLiteral("cancelled"));
+            emitQueueChanged();
+            return;
+        }
+    }
+
+    if (m_inFlight.remove(requestId) > 0)
+        QTimer::singleShot(0, this, &RequestScheduler::dispatch);
+    m_backend->cancelRequest(requestId);
+}
+
+void RequestScheduler::enqueue(Job job)
+{
+    // Ordered by priority, then by original submission (retries keep their place)
+    auto pos = std::upper_bound(m_queue.begin(), m_queue.end(), job, [](const Job &a, const Job &b) {
+        if (a.priority != b.priority)
+            return a.priority < b.priority;
+        return a.sequence < b.sequence;
+    });
+    m_queue.insert(pos, std::move(job));
+}
+
+void RequestScheduler::dispatch()
+{
+    const QDateTime now = QDateTime::currentDateTimeUtc();
+    QDateTime nextWake;
+    QSet<QString> blockedModels;
+    // The rest waits for a request to end (onFinished, onErrorOccurred, cancelRequest)
+    const int limit = concurrencyLimit();
+
+    int i = 0;
+    while (i < m_queue.size() && (limit == 0 || m_inFlight.size() < limit)) {
+        const Job &candidate = m_queue.at(i);
+
+        // Later jobs of a blocked model wait too, so priority order holds within a model
+        if (blockedModels.contains(candidate.model)) {
+            ++i;
+            continue;
+        }
+
+        QDateTime admitAt = admissionTime(candidate);
+        if (candidate.notBefore.isValid() && candidate.notBefore > admitAt)
+            admitAt = candidate.notBefore;
+
+        if (admitAt > now) {
+            blockedModels.insert(candidate.model);
+            if (!nextWake.isValid() || admitAt < nextWake)
+                nextWake = admitAt;
+            ++i;
+            continue;
+        }
+
+        Job job = m_queue.takeAt(i);
+
+        // Spend the budget locally until the next response reports the real numbers
+        Bucket &bucket = m_buckets[job.model];
+        if (bucket.remainingRequests > 0)
+            --bucket.remainingRequests;
+        if (bucket.remainingTokens > 0)
+            bucket.remainingTokens = qMax<qint64>(0, bucket.remainingTokens - job.estimatedTokens);
+
+        InFlight inFlight;
+        inFlight.job = job;
+        m_inFlight.insert(job.requestId, inFlight);
+
+        qDebug() << "[RequestScheduler::dispatch] Sending" << job.requestId << "after"
+                 << job.enqueuedAt.msecsTo(now) << "ms in queue, attempt" << job.attempts + 1;
+
+        // May report an error synchronously, which only ever touches m_inFlight
+        m_backend->startRequest(job.messages, job.params, job.requestId);
+    }
+
+    if (nextWake.isValid())
+        scheduleWakeUp(nextWake);
+    else
+        m_wakeTimer.stop();
+
+    emitQueueChanged();
+}
+
+int RequestScheduler::concurrencyLimit() const
+{
+    return qMax(0, config().value("max_concurrent_requests", 0).toInt());
+}
+
+void RequestScheduler::scheduleWakeUp(const QDateTime &when)
+{
+    qint64 delay = qMax<qint64>(0, QDateTime::currentDateTimeUtc().msecsTo(when));
+    if (m_wakeTimer.isActive() && m_wakeTimer.remainingTime() <= delay)
+        return;
+    m_wakeTimer.start(int(qMin<qint64>(delay, INT_MAX)));
+}
+
+void RequestScheduler::emitQueueChanged()
+{
+    if (m_queue.isEmpty())
+        m_queueStatusTimer.stop();
+    else if (!m_queueStatusTimer.isActive())
+        m_queueStatusTimer.start();
+
+    emit queueChanged(m_queue.size(), oldestWaitMs());
+}
+
+QDateTime RequestScheduler::admissionTime(const Job &job) const
+{
+    const QDateTime now = QDateTime::currentDateTimeUtc();
+    QDateTime admitAt = now;
+
+    auto it = m_buckets.constFind(job.model);
+    if (it == m_buckets.constEnd())
+        return admitAt;
+
+    const Bucket &bucket = it.value();
+
+    if (bucket.blockedUntil.isValid() && bucket.blockedUntil > admitAt)
+        admitAt = bucket.blockedUntil;
+
+    // A budget is only binding until its window resets
+    if (bucket.remainingRequests == 0 && bucket.requestsResetAt.isValid() && bucket.requestsResetAt > admitAt)
+        admitAt = bucket.requestsResetAt;
+
+    if (bucket.remainingTokens >= 0 && bucket.remainingTokens < job.estimatedTokens
+        && bucket.tokensResetAt.isValid() && bucket.tokensResetAt > admitAt)
+        admitAt = bucket.tokensResetAt;
+
+    return admitAt;
+}
+
+qint64 RequestScheduler::backoffDelayMs(int attempts, qint64 retryAfterMs) const
+{
+    // Small jitter on top of Retry-After so queued retries don't all fire at once
+    if (retryAfterMs >= 0)
+        return retryAfterMs + QRandomGenerator::global()->bounded(250);
+
+    qint64 delay = kBackoffBaseMs << qMin(attempts - 1, 16);
+    delay = qMin(delay, kBackoffMaxMs);
+
+    // Equal jitter: somewhere in the upper half of the exponential delay
+    return delay / 2 + QRandomGenerator::global()->bounded(delay / 2 + 1);
+}
+
+void RequestScheduler::onResponseMetadata(const QString &requestId, int httpStatus, const QVariantMap &headers)
+{
+    auto it = m_inFlight.find(requestId);
+    if (it != m_inFlight.end()) {
+        it->httpStatus = httpStatus;
+
+        if (headers.contains("retry-after-ms")) {
+            it->retryAfterMs = headers.value("retry-after-ms").toLongLong();
+        } else if (headers.contains("retry-after")) {
+            bool ok = false;
+            qint64 seconds = headers.value("retry-after").toLongLong(&ok);
+            if (ok)
+                it->retryAfterMs = seconds * 1000;
+        }
+
+        const QDateTime now = QDateTime::currentDateTimeUtc();
+        Bucket &bucket = m_buckets[it->job.model];
+
+        if (headers.contains("x-ratelimit-remaining-requests"))
+            bucket.remainingRequests = headers.value("x-ratelimit-remaining-requests").toLongLong();
+        if (headers.contains("x-ratelimit-remaining-tokens"))
+            bucket.remainingTokens = headers.value("x-ratelimit-remaining-tokens").toLongLong();
+
+        qint64 resetRequests = parseResetDuration(headers.value("x-ratelimit-reset-requests").toString());
+        if (resetRequests >= 0)
+            bucket.requestsResetAt = now.addMSecs(resetRequests);
+        qint64 resetTokens = parseResetDuration(headers.value("x-ratelimit-reset-tokens").toString());
+        if (resetTokens >= 0)
+            bucket.tokensResetAt = now.addMSecs(resetTokens);
+
+        if (httpStatus == 429) {
+            bucket.blockedUntil = now.addMSecs(it->retryAfterMs >= 0 ? it->retryAfterMs
+                                                                      : backoffDelayMs(it->job.attempts + 1, -1));
+        }
+    }
+
+    emit responseMetadata(requestId, httpStatus, headers);
+}
+
+void RequestScheduler::onPartialResponse(const QString &requestId, const QString &text)
+{
+    auto it = m_inFlight.find(requestId);
+    if (it != m_inFlight.end())
+        it->receivedContent = true;
+
+    emit partialResponse(requestId, text);
+}
+
+void RequestScheduler::onChoicePartialResponse(const QString &requestId, int choiceIndex, const QString &text)
+{
+    // Any choice that streamed makes a retry unsafe, not only the first
+    auto it = m_inFlight.find(requestId);
+    if (it != m_inFlight.end())
+        it->receivedContent = true;
+
+    emit choicePartialResponse(requestId, choiceIndex, text);
+}
+
+void RequestScheduler::onFinished(const QString &requestId, const QString &fullResponse)
+{
+    // Deferred like a retry: the backend is still inside its completion handler
+    if (m_inFlight.remove(requestId) > 0 && !m_queue.isEmpty())
+        QTimer::singleShot(0, this, &RequestScheduler::dispatch);
+    emit finished(requestId, fullResponse);
+}
+
+void RequestScheduler::onErrorOccurred(const QString &requestId, const QString &errorString)
+{
+    auto it = m_inFlight.find(requestId);
+    if (it == m_inFlight.end()) {
+        emit errorOccurred(requestId, errorString);
+        return;
+    }
+
+    InFlight inFlight = it.value();
+    m_inFlight.erase(it);
+
+    // Retrying after content streamed would duplicate text in the receiver
+    const bool retryable = (inFlight.httpStatus == 429 || inFlight.httpStatus >= 500)
+                           && !inFlight.receivedContent
+                           && inFlight.job.attempts < kMaxRetries;
+
+    if (!retryable) {
+        // Its slot is free for the next queued request
+        if (!m_queue.isEmpty())
+            QTimer::singleShot(0, this, &RequestScheduler::dispatch);
+        emit errorOccurred(requestId, errorString);
+        return;
+    }
+
+    Job job = inFlight.job;
+    ++job.attempts;
+    const qint64 delay = backoffDelayMs(job.attempts, inFlight.retryAfterMs);
+    job.notBefore = QDateTime::currentDateTimeUtc().addMSecs(delay);
+
+    qWarning() << "[RequestScheduler::onErrorOccurred] HTTP" << inFlight.httpStatus << "for" << requestId
+               << "- retry" << job.attempts << "of" << kMaxRetries << "in" << delay << "ms";
+
+    enqueue(job);
+    emit statusChanged(requestId, QStringLiteral("retrying"));
+
+    // Deferred: the backend is still inside its error handler
+    QTimer::singleShot(0, this, &RequestScheduler::dispatch);
+}
+
+qint64 RequestScheduler::parseResetDuration(const QString &value)
+{
+    // OpenAI reports reset windows like "1s", "6m0s", "1h2m3.5s" or "20ms"
+    if (value.isEmpty())
+        return -1;
+
+    static const QRegularExpression re(QStringLiteral("(\\d+(?:\\.\\d+)?)(ms|h|m|s)"));
+
+    double totalMs = 0;
+    bool matched = false;
+    QRegularExpressionMatchIterator it = re.globalMatch(value);
+    while (it.hasNext()) {
+        QRegularExpressionMatch match = it.next();
+        double amount = match.captured(1).toDouble();
+        const QString unit = match.captured(2);
+        if (unit == QLatin1String("ms"))
+            totalMs += amount;
+        else if (unit == QLatin1String("s"))
+            totalMs += amount * 1000;
+        else if (unit == QLatin1String("m"))
+            totalMs += amount * 60 * 1000;
+        else
+            totalMs += amount * 60 * 60 * 1000;
+        matched = true;
+    }
+
+    return matched ? qint64(totalMs) : -1;
+}
+
+qint64 RequestScheduler::estimateTokens(const QList<Message> &messages, int maxTokens)
+{
+    qint64 chars = 0;
+    for (const Message &msg : messages)
+        chars += msg.content.size();
+    return chars / kCharsPerToken + qMax(0, maxTokens);
+}
@@ -0,0 +1,130 @@
+#ifndef REQUESTSCHEDULER_H
+#define REQUESTSCHEDULER_H
+
+#pragma once
+
+#include "aibackend.h"
+
+#include <QHash>
+#include <QList>
+#include <QSet>
+#include <QTimer>
+#include <QDateTime>
+
+/**
+ * @brief AIBackend decorator that queues, admits and retries requests.
+ *
+ * Requests are queued by priority (interactive before background, then FIFO)
+ * and only handed to the wrapped backend while the per-model request and
+ * token budgets reported by the x-ratelimit-* response headers allow it.
+ * Requests rejected with 429 or 5xx before any content streamed are retried
+ * with exponential backoff and jitter (or after Retry-After when given).
+ * At most "max_concurrent_requests" (config, 0: no limit) are in flight at once.
+ *
+ * Priority is taken from the "priority" request param ("interactive" or
+ * "background"); it is not forwarded to the wrapped backend.
+ */
+class RequestScheduler : public AIBackend
+{
+    Q_OBJECT
+public:
+    enum Priority {
+        Interactive = 0,
+        Background = 1
+    };
+
+    // Takes ownership of 'backend'
+    explicit RequestScheduler(AIBackend *backend, QObject *parent = nullptr);
+    ~RequestScheduler() override;
+
+    void startRequest(const QList<Message> &messages,
+                      const QVariantMap &params = QVariantMap(),
+                      const QString &requestId = QString()) override;
+
+    void cancelRequest(const QString &requestId = QString()) override;
+
+    bool supportsStreaming() const override { return m_backend->supportsStreaming(); }
+    QString backendName() const override { return m_backend->backendName(); }
+    void prewarm() override { m_backend->prewarm(); }
+    void setConfig(const QVariantMap &config) override;
+    QByteArray requestPayload(const QList<Message> &messages, const QVariantMap &params) const override;
+
+    AIBackend *backend() const { return m_backend; }
+
+    int queueDepth() const { return m_queue.size(); }
+
+    // How long the oldest queued request has been waiting
+    qint64 oldestWaitMs() const;
+
+signals:
+    /**
+     * @brief Emitted whenever requests are queued, dispatched, retried or cancelled.
+     * @param depth Number of requests waiting (including scheduled retries).
+     * @param oldestWaitMs How long the oldest waiting request has been queued.
+     */
+    void queueChanged(int depth, qint64 oldestWaitMs);
+
+private:
+    struct Job {
+        QList<Message> messages;
+        QVariantMap params;
+        QString requestId;
+        QString model;
+        Priority priority = Interactive;
+        qint64 estimatedTokens = 0;
+        quint64 sequence = 0;
+        int attempts = 0;
+        QDateTime enqueuedAt;
+        QDateTime notBefore;    // Backoff: not dispatched before this time
+    };
+
+    // Budget last reported by the server for one model, decremented locally per dispatch
+    struct Bucket {
+        qint64 remainingRequests = -1;  // -1: unknown
+        qint64 remainingTokens = -1;
+        QDateTime requestsResetAt;
+        QDateTime tokensResetAt;
+        QDateTime blockedUntil;         // Retry-After of the last 429
+    };
+
+    struct InFlight {
+        Job job;
+        int httpStatus = 0;
+        qint64 retryAfterMs = -1;
+        bool receivedContent = false;   // of any choice
+    };
+
+    void enqueue(Job job);
+    void dispatch();
+    void scheduleWakeUp(const QDateTime &when);
+    void emitQueueChanged();
+
+    // When 'job' may be sent under its model's budget (now or earlier means admit)
+    QDateTime admissionTime(const Job &job) const;
+
+    qint64 backoffDelayMs(int attempts, qint64 retryAfterMs) const;
+
+    void onResponseMetadata(const QString &requestId, int httpStatus, const QVariantMap &headers);
+    void onPartialResponse(const QString &requestId, const QString &text);
+    void onChoicePartialResponse(const QString &requestId, int choiceIndex, const QString &text);
+    void onFinished(const QString &requestId, const QString &fullResponse);
+    void onErrorOccurred(const QString &requestId, const QString &errorString);
+
+    // Requests allowed in flight at once; 0: no limit
+    int concurrencyLimit() const;
+
+    static qint64 parseResetDuration(const QString &value);
+    static qint64 estimateTokens(const QList<Message> &messages, int maxTokens);
+
+    AIBackend *m_backend = nullptr;
+
+    QList<Job> m_queue;
+    QHash<QString, InFlight> m_inFlight;
+    QHash<QString, Bucket> m_buckets;
+
+    QTimer m_wakeTimer;
+    QTimer m_queueStatusTimer;
+    quint64 m_nextSequence = 0;
+};
+
+#endif // REQUESTSCHEDULER_H
@@ -0,0 +1,281 @@
+#include "requesttelemetry.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QRandomGenerator>
+#include <QDebug>
+
+#include <algorithm>
+
+namespace {
+
+qint64 percentile(QVector<qint64> values, double q)
+{
+    if (values.isEmpty())
+        return -1;
+    std::sort(values.begin(), values.end());
+    const int index = qBound(0, int(q * (values.size() - 1) + 0.5), int(values.size()) - 1);
+    return values.at(index);
+}
+
+} // namespace
+
+RequestTelemetry::RequestTelemetry(AIBackend *backend, QObject *parent)
+    : AIBackend(parent)
+    , m_backend(backend)
+{
+    Q_ASSERT(m_backend);
+    m_backend->setParent(this);
+
+    connect(m_backend, &AIBackend::partialResponse, this, &RequestTelemetry::onPartialResponse);
+    connect(m_backend, &AIBackend::statusChanged, this, &RequestTelemetry::onStatusChanged);
+    connect(m_backend, &AIBackend::choicePartialResponse, this, &AIBackend::choicePartialResponse);
+    connect(m_backend, &AIBackend::choicesFinished, this, &AIBackend::choicesFinished);
+    connect(m_backend, &AIBackend::responseStored, this, &AIBackend::responseStored);
+
+    connect(m_backend, &AIBackend::finished, this, [this](const QString &requestId, const QString &fullResponse) {
+        complete(requestId, QStringLiteral("ok"));
+        emit finished(requestId, fullResponse);
+    });
+    connect(m_backend, &AIBackend::errorOccurred, this, [this](const QString &requestId, const QString &errorString) {
+        complete(requestId, QStringLiteral("error"));
+        emit errorOccurred(requestId, errorString);
+    });
+    connect(m_backend, &AIBackend::responseMetadata, this,
+            [this](const QString &requestId, int httpStatus, const QVariantMap &headers) {
+        auto it = m_records.find(requestId);
+        if (it != m_records.end() && it->firstByteMs < 0)
+            it->firstByteMs = it->clock.elapsed();
+        emit responseMetadata(requestId, httpStatus, headers);
+    });
+    connect(m_backend, &AIBackend::usageReported, this, [this](const QString &requestId, const QVariantMap &usage) {
+        auto it = m_records.find(requestId);
+        if (it != m_records.end())
+            it->usage = usage;
+        emit usageReported(requestId, usage);
+    });
+    connect(m_backend, &AIBackend::servedFromCache, this, [this](const QString &requestId) {
+        auto it = m_records.find(requestId);
+        if (it != m_records.end())
+            it->fromCache = true;
+        emit servedFromCache(requestId);
+    });
+}
+
+RequestTelemetry::~RequestTelemetry()
+{
+}
+
+void RequestTelemetry::setConfig(const QVariantMap &config)
+{
+    AIBackend::setConfig(config);
+    m_backend->setConfig(config);
+}
+
+QByteArray RequestTelemetry::requestPayload(const QList<Message> &messages, const QVariantMap &params) const
+{
+    // The session label is only for the record; it is never sent
+    QVariantMap innerParams = params;
+    innerParams.remove("session");
+    return m_backend->requestPayload(messages, innerParams);
+}
+
+QString RequestTelemetry::telemetryFile(const QString &sessionsFolder)
+{
+    return QDir(sessionsFolder).filePath(".telemetry/requests.jsonl");
+}
+
+void RequestTelemetry::startRequest(const QList<Message> &messages,
+                                    const QVariantMap &params,
+                                    const QString &requestId)
+{
+    // Records are keyed by id, so one is needed before the request goes on
+    const QString reqId = requestId.isEmpty()
+                              ? QStringLiteral("req_%1_%2")
+                                    .arg(QDateTime::currentMSecsSinceEpoch())
+                                    .arg(QRandomGenerator::global()->bounded(INT_MAX))
+                              : requestId;
+
+    // Rejected here: the backend's own rejection would close the running request's record
+    if (m_records.contains(reqId)) {
+        qWarning() << "[RequestTelemetry::startRequest] Request ID already in use:" << reqId;
+        emit errorOccurred(reqId, QStringLiteral("Request ID already in use"));
+        return;
+    }
+
+    QVariantMap innerParams = params;
+    const QString session = innerParams.take("session").toString();
+
+    Record record;
+    record.startedAt = QDateTime::currentDateTimeUtc();
+    record.session = session;
+    record.model = params.value("model", config().value("model")).toString();
+    record.choices = qMax(1, params.value("n", 1).toInt());
+    record.clock.start();
+    m_records.insert(reqId, record);
+
+    m_backend->startRequest(messages, innerParams, reqId);
+}
+
+void RequestTelemetry::cancelRequest(const QString &requestId)
+{
+    if (requestId.isEmpty()) {
+        const QStringList requestIds = m_records.keys();
+        for (const QString &id : requestIds)
+            complete(id, QStringLiteral("cancelled"));
+    } else {
+        complete(requestId, QStringLiteral("cancelled"));
+    }
+    m_backend->cancelRequest(requestId);
+}
+
+void RequestTelemetry::onPartialResponse(const QString &requestId, const QString &text)
+{
+    auto it = m_records.find(requestId);
+    if (it != m_records.end()) {
+        const qint64 now = it->clock.elapsed();
+        if (it->firstTokenMs < 0)
+            it->firstTokenMs = now;
+        else
+            it->tokenGapsMs.append(now - it->lastTokenMs);
+        it->lastTokenMs = now;
+    }
+
+    emit partialResponse(requestId, text);
+}
+
+void RequestTelemetry::onStatusChanged(const QString &requestId, const QString &status)
+{
+    // "started" comes from the network backend once the scheduler let the request go
+    auto it = m_records.find(requestId);
+    if (it != m_records.end() && it->queueMs < 0 && status == QLatin1String("started"))
+        it->queueMs = it->clock.elapsed();
+
+    emit statusChanged(requestId, status);
+}
+
+void RequestTelemetry::complete(const QString &requestId, const QString &status)
+{
+    auto it = m_records.find(requestId);
+    if (it == m_records.end())
+        return;
+
+    const Record record = it.value();
+    m_records.erase(it);
+
+    const QVariantMap promptDetails = record.usage.value("prompt_tokens_details").toMap();
+
+    QJsonObject line;
+    line["ts"] = record.startedAt.toString(Qt::ISODateWithMs);
+    line["session"] = record.session;
+    line["model"] = record.model;
+    line["status"] = status;
+    line["from_cache"] = record.fromCache;
+    line["choices"] = record.choices;
+    line["queue_ms"] = qMax<qint64>(0, record.queueMs);
+    line["ttfb_ms"] = record.firstByteMs;
+    line["ttft_ms"] = record.firstTokenMs;
+    line["duration_ms"] = record.clock.elapsed();
+    line["itl_p50_ms"] = percentile(record.tokenGapsMs, 0.50);
+    line["itl_p95_ms"] = percentile(record.tokenGapsMs, 0.95);
+    line["itl_p99_ms"] = percentile(record.tokenGapsMs, 0.99);
+    line["chunks"] = record.firstTokenMs < 0 ? 0 : int(record.tokenGapsMs.size()) + 1;
+    line["prompt_tokens"] = record.usage.value("prompt_tokens").toLongLong();
+    line["completion_tokens"] = record.usage.value("completion_tokens").toLongLong();
+    line["cached_tokens"] = promptDetails.value("cached_tokens").toLongLong();
+    append(line);
+}
+
+void RequestTelemetry::append(const QJsonObject &line)
+{
+    const QString path = config().value("telemetry_file").toString();
+    if (path.isEmpty())
+        return;
+
+    QDir().mkpath(QFileInfo(path).absolutePath());
+
+    // Append-only; one short write per request
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        qWarning() << "[RequestTelemetry::append] Failed to open" << path;
+        return;
+    }
+    file.write(QJsonDocument(line).toJson(QJsonDocument::Compact) + '\n');
+}
+
+QVector<RequestTelemetry::Aggregate> RequestTelemetry::aggregate(const QString &path, GroupBy groupBy)
+{
+    struct Samples {
+        Aggregate aggregate;
+        QVector<qint64> ttft;
+        QVector<qint64> itlP95;
+        qint64 totalDurationMs = 0;
+    };
+    QHash<QString, Samples> groups;
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+        return {};
+
+    while (!file.atEnd()) {
+        const QByteArray lineData = file.readLine().trimmed();
+        if (lineData.isEmpty())
+            continue;
+        const QJsonObject line = QJsonDocument::fromJson(lineData).object();
+        if (line.isEmpty())
+            continue;   // e.g. a torn last line
+
+        QString key;
+        switch (groupBy) {
+        case BySession: key = line.value("session").toString(); break;
+        case ByModel: key = line.value("model").toString(); break;
+        case ByDay:
+            key = QDateTime::fromString(line.value("ts").toString(), Qt::ISODateWithMs).toLocalTime().toString("yyyy-MM-dd");
+            break;
+        }
+        if (key.isEmpty())
+            key = QStringLiteral("(none)");
+
+        Samples &samples = groups[key];
+        Aggregate &agg = samples.aggregate;
+        agg.key = key;
+        ++agg.requests;
+        if (line.value("status").toString() != QLatin1String("ok"))
+            ++agg.errors;
+        if (line.value("from_cache").toBool())
+            ++agg.fromCache;
+        agg.promptTokens += line.value("prompt_tokens").toVariant().toLongLong();
+        agg.cachedTokens += line.value("cached_tokens").toVariant().toLongLong();
+        agg.completionTokens += line.value("completion_tokens").toVariant().toLongLong();
+        samples.totalDurationMs += line.value("duration_ms").toVariant().toLongLong();
+
+        const qint64 ttft = qint64(line.value("ttft_ms").toDouble(-1));
+        if (ttft >= 0)
+            samples.ttft.append(ttft);
+        const qint64 itl = qint64(line.value("itl_p95_ms").toDouble(-1));
+        if (itl >= 0)
+            samples.itlP95.append(itl);
+    }
+
+    QVector<Aggregate> result;
+    result.reserve(groups.size());
+    for (Samples &samples : groups) {
+        Aggregate agg = samples.aggregate;
+        agg.ttftP50Ms = percentile(samples.ttft, 0.50);
+        agg.ttftP95Ms = percentile(samples.ttft, 0.95);
+        agg.itlP95Ms = percentile(samples.itlP95, 0.50);
+        agg.avgDurationMs = agg.requests > 0 ? samples.totalDurationMs / agg.requests : 0;
+        result.append(agg);
+    }
+
+    std::sort(result.begin(), result.end(), [groupBy](const Aggregate &a, const Aggregate &b) {
+        // Days read best newest first
+        if (groupBy == ByDay)
+            return a.key > b.key;
+        return a.requests != b.requests ? a.requests > b.requests : a.key < b.key;
+    });
+    return result;
+}
@@ -0,0 +1,99 @@
+#ifndef REQUESTTELEMETRY_H
+#define REQUESTTELEMETRY_H
+
+#pragma once
+
+#include "aibackend.h"
+
+#include <QHash>
+#include <QVector>
+#include <QDateTime>
+#include <QElapsedTimer>
+
+class QJsonObject;
+
+/**
+ * @brief AIBackend decorator that records usage and latency of every request.
+ *
+ * For each request it measures the time spent queued, to the response
+ * headers (first byte) and to the first token, the inter-token latency
+ * percentiles and the total duration, and collects the reported prompt,
+ * completion and cached tokens. One JSON line per finished, failed or
+ * cancelled request is appended to the file named by the "telemetry_file"
+ * config key (nothing is recorded without one).
+ *
+ * The "session" request param labels the record; it is not forwarded.
+ */
+class RequestTelemetry : public AIBackend
+{
+    Q_OBJECT
+public:
+    enum GroupBy {
+        BySession,
+        ByModel,
+        ByDay
+    };
+
+    // Aggregated records of one session, model or day
+    struct Aggregate {
+        QString key;
+        int requests = 0;
+        int errors = 0;             // failed or cancelled
+        int fromCache = 0;
+        qint64 ttftP50Ms = 0;
+        qint64 ttftP95Ms = 0;
+        qint64 itlP95Ms = 0;        // median over the requests' inter-token p95
+        qint64 avgDurationMs = 0;
+        qint64 promptTokens = 0;
+        qint64 cachedTokens = 0;
+        qint64 completionTokens = 0;
+    };
+
+    // Takes ownership of 'backend'
+    explicit RequestTelemetry(AIBackend *backend, QObject *parent = nullptr);
+    ~RequestTelemetry() override;
+
+    void startRequest(const QList<Message> &messages,
+                      const QVariantMap &params = QVariantMap(),
+                      const QString &requestId = QString()) override;
+
+    void cancelRequest(const QString &requestId = QString()) override;
+
+    bool supportsStreaming() const override { return m_backend->supportsStreaming(); }
+    QString backendName() const override { return m_backend->backendName(); }
+    void prewarm() override { m_backend->prewarm(); }
+    void setConfig(const QVariantMap &config) override;
+    QByteArray requestPayload(const QList<Message> &messages, const QVariantMap &params) const override;
+
+    // Per-project telemetry file inside the sessions folder
+    static QString telemetryFile(const QString &sessionsFolder);
+
+    // Read a telemetry file and aggregate its records, busiest group first
+    static QVector<Aggregate> aggregate(const QString &path, GroupBy groupBy);
+
+private:
+    struct Record {
+        QDateTime startedAt;
+        QString session;
+        QString model;
+        int choices = 1;
+        QElapsedTimer clock;
+        qint64 queueMs = -1;
+        qint64 firstByteMs = -1;
+        qint64 firstTokenMs = -1;
+        qint64 lastTokenMs = -1;
+        QVector<qint64> tokenGapsMs;    // between consecutive content chunks of the first choice
+        QVariantMap usage;
+        bool fromCache = false;
+    };
+
+    void onPartialResponse(const QString &requestId, const QString &text);
+    void onStatusChanged(const QString &requestId, const QString &status);
+    void complete(const QString &requestId, const QString &status);
+    void append(const QJsonObject &line);
+
+    AIBackend *m_backend = nullptr;
+    QHash<QString, Record> m_records;
+};
+
+#endif // REQUESTTELEMETRY_H
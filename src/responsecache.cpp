@@ -0,0 +1,406 @@
+#include "responsecache.h"
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QRandomGenerator>
+#include <QStandardPaths>
+#include <QTimer>
+#include <QDebug>
+
+#include <algorithm>
+
+namespace {
+
+const int kDefaultMaxMB = 64;
+
+// Evict down to this share of the limit so every store doesn't evict again
+const double kEvictTargetRatio = 0.9;
+
+} // namespace
+
+ResponseCache::ResponseCache(AIBackend *backend, QObject *parent)
+    : AIBackend(parent)
+    , m_backend(backend)
+    , m_folder(QDir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation)).filePath("responses"))
+{
+    Q_ASSERT(m_backend);
+    m_backend->setParent(this);
+
+    connect(m_backend, &AIBackend::choicePartialResponse, this, &ResponseCache::onChoicePartialResponse);
+    connect(m_backend, &AIBackend::choicesFinished, this, &ResponseCache::onChoicesFinished);
+    connect(m_backend, &AIBackend::finished, this, &ResponseCache::onFinished);
+    connect(m_backend, &AIBackend::errorOccurred, this, &ResponseCache::onErrorOccurred);
+    connect(m_backend, &AIBackend::usageReported, this, &ResponseCache::onUsageReported);
+
+    connect(m_backend, &AIBackend::statusChanged, this, [this](const QString &innerId, const QString &status) {
+        const QStringList subscribers = m_inFlight.value(innerId).subscribers;
+        for (const QString &requestId : subscribers)
+            emit statusChanged(requestId, status);
+    });
+    connect(m_backend, &AIBackend::responseStored, this, [this](const QString &innerId, const QString &responseId) {
+        const QStringList subscribers = m_inFlight.value(innerId).subscribers;
+        for (const QString &requestId : subscribers)
+            emit responseStored(requestId, responseId);
+    });
+    connect(m_backend, &AIBackend::responseMetadata, this,
+            [this](const QString &innerId, int httpStatus, const QVariantMap &headers) {
+        const QStringList subscribers = m_inFlight.value(innerId).subscribers;
+        for (const QString &requestId : subscribers)
+            emit responseMetadata(requestId, httpStatus, headers);
+    });
+}
+
+ResponseCache::~ResponseCache()
+{
+}
+
+void ResponseCache::setConfig(const QVariantMap &config)
+{
+    AIBackend::setConfig(config);
+    m_backend->setConfig(config);
+
+    m_enabled = config.value("response_cache", false).toBool();
+    m_maxBytes = qint64(qMax(1, config.value("response_cache_max_mb", kDefaultMaxMB).toInt())) * 1024 * 1024;
+
+    if (m_enabled) {
+        loadIndex();
+        evict();
+    }
+}
+
+QString ResponseCache::cacheKey(const QList<Message> &messages, const QVariantMap &params) const
+{
+    // The body the wrapped backend would send; backends that can't tell are not cached
+    const QByteArray payload = m_backend->requestPayload(messages, params);
+    if (payload.isEmpty())
+        return QString();
+
+    QCryptographicHash hash(QCryptographicHash::Sha256);
+    hash.addData(m_backend->backendName().toUtf8());
+    hash.addData(QByteArray("\n"));
+    hash.addData(payload);
+    return QString::fromLatin1(hash.result().toHex());
+}
+
+QString ResponseCache::entryPath(const QString &key) const
+{
+    return QDir(m_folder).filePath(key + ".json");
+}
+
+void ResponseCache::loadIndex()
+{
+    if (m_indexLoaded)
+        return;
+    m_indexLoaded = true;
+
+    QDir dir(m_folder);
+    const QFileInfoList files = dir.entryInfoList({"*.json"}, QDir::Files);
+    for (const QFileInfo &fi : files) {
+        Entry entry;
+        entry.size = fi.size();
+        entry.lastUsed = fi.lastModified().toMSecsSinceEpoch();
+        m_entries.insert(fi.completeBaseName(), entry);
+        m_totalBytes += entry.size;
+    }
+
+    qDebug() << "[ResponseCache::loadIndex]" << m_entries.size() << "cached responses," << m_totalBytes << "bytes";
+}
+
+bool ResponseCache::lookup(const QString &key, QStringList *choices, QVariantMap *usage)
+{
+    auto it = m_entries.find(key);
+    if (it == m_entries.end())
+        return false;
+
+    QFile file(entryPath(key));
+    if (!file.open(QIODevice::ReadWrite)) {
+        m_totalBytes -= it->size;
+        m_entries.erase(it);
+        return false;
+    }
+    const QJsonObject obj = QJsonDocument::fromJson(file.readAll()).object();
+
+    const QJsonArray responses = obj.value("responses").toArray();
+    if (responses.isEmpty()) {
+        file.close();
+        file.remove();
+        m_totalBytes -= it->size;
+        m_entries.erase(it);
+        return false;
+    }
+
+    choices->clear();
+    for (const QJsonValue &response : responses)
+        choices->append(response.toString());
+    *usage = obj.value("usage").toObject().toVariantMap();
+
+    // The file mtime is the LRU clock, so recency survives restarts
+    it->lastUsed = QDateTime::currentMSecsSinceEpoch();
+    file.setFileTime(QDateTime::fromMSecsSinceEpoch(it->lastUsed), QFileDevice::FileModificationTime);
+    return true;
+}
+
+void ResponseCache::store(const QString &key, const QStringList &choices, const QVariantMap &usage)
+{
+    QDir dir(m_folder);
+    if (!dir.exists() && !dir.mkpath(".")) {
+        qWarning() << "[ResponseCache::store] Failed to create cache folder:" << m_folder;
+        return;
+    }
+
+    QJsonObject obj;
+    obj["responses"] = QJsonArray::fromStringList(choices);
+    obj["usage"] = QJsonObject::fromVariantMap(usage);
+    const QByteArray data = QJsonDocument(obj).toJson(QJsonDocument::Compact);
+
+    QSaveFile file(entryPath(key));
+    if (!file.open(QIODevice::WriteOnly) || file.write(data) != data.size() || !file.commit()) {
+        qWarning() << "[ResponseCache::store] Failed to write cache entry:" << file.fileName();
+        return;
+    }
+
+    Entry &entry = m_entries[key];
+    m_totalBytes += data.size() - entry.size;
+    entry.size = data.size();
+    entry.lastUsed = QDateTime::currentMSecsSinceEpoch();
+
+    evict();
+}
+
+void ResponseCache::evict()
+{
+    if (m_totalBytes <= m_maxBytes)
+        return;
+
+    QVector<QPair<qint64, QString>> byAge;
+    byAge.reserve(m_entries.size());
+    for (auto it = m_entries.constBegin(); it != m_entries.constEnd(); ++it)
+        byAge.append({it->lastUsed, it.key()});
+    std::sort(byAge.begin(), byAge.end());
+
+    const qint64 target = qint64(m_maxBytes * kEvictTargetRatio);
+    int removed = 0;
+    for (const auto &aged : std::as_const(byAge)) {
+        if (m_totalBytes <= target)
+            break;
+        QFile::remove(entryPath(aged.second));
+        m_totalBytes -= m_entries.take(aged.second).size;
+        ++removed;
+    }
+
+    qDebug() << "[ResponseCache::evict] Evicted" << removed << "responses," << m_totalBytes << "bytes left";
+}
+
+void ResponseCache::clear()
+{
+    for (auto it = m_entries.constBegin(); it != m_entries.constEnd(); ++it)
+        QFile::remove(entryPath(it.key()));
+    m_entries.clear();
+    m_totalBytes = 0;
+}
+
+void ResponseCache::startRequest(const QList<Message> &messages,
+                                 const QVariantMap &params,
+                                 const QString &requestId)
+{
+    QString reqId = requestId;
+    if (reqId.isEmpty()) {
+        reqId = QStringLiteral("req_%1_%2")
+                    .arg(QDateTime::currentMSecsSinceEpoch())
+                    .arg(QRandomGenerator::global()->bounded(INT_MAX));
+    }
+
+    if (m_subscriptions.contains(reqId) || m_inFlight.contains(reqId) || m_pendingReplays.contains(reqId)) {
+        emit errorOccurred(reqId, QStringLiteral("Request ID already in use"));
+        return;
+    }
+
+    QVariantMap innerParams = params;
+    const QVariant cacheParam = innerParams.take("cache");
+    const bool useCache = m_enabled && (!cacheParam.isValid() || cacheParam.toBool());
+
+    QString key;
+    if (useCache && !(key = cacheKey(messages, innerParams)).isEmpty()) {
+        QStringList choices;
+        QVariantMap usage;
+        if (lookup(key, &choices, &usage)) {
+            qDebug() << "[ResponseCache::startRequest] Cache hit for" << reqId;
+            // Deferred: callers may still be setting up when startRequest returns
+            m_pendingReplays.insert(reqId);
+            QTimer::singleShot(0, this, [this, reqId, choices, usage]() {
+                if (m_pendingReplays.remove(reqId))
+                    replay(reqId, choices, usage);
+            });
+            return;
+        }
+
+        auto shared = m_inFlightByKey.constFind(key);
+        if (shared != m_inFlightByKey.constEnd()) {
+            InFlight &call = m_inFlight[*shared];
+            call.subscribers.append(reqId);
+            m_subscriptions.insert(reqId, *shared);
+            qDebug() << "[ResponseCache::startRequest]" << reqId << "joins in-flight request" << *shared;
+
+            // Catch up on what the shared call streamed so far
+            emit statusChanged(reqId, QStringLiteral("shared"));
+            for (int i = 0; i < call.choices.size(); ++i) {
+                if (call.choices.at(i).isEmpty())
+                    continue;
+                if (i == 0)
+                    emit partialResponse(reqId, call.choices.at(i));
+                emit choicePartialResponse(reqId, i, call.choices.at(i));
+            }
+            return;
+        }
+    }
+
+    InFlight call;
+    call.key = key;
+    call.subscribers.append(reqId);
+    m_inFlight.insert(reqId, call);
+    m_subscriptions.insert(reqId, reqId);
+    if (!key.isEmpty())
+        m_inFlightByKey.insert(key, reqId);
+
+    m_backend->startRequest(messages, innerParams, reqId);
+}
+
+void ResponseCache::cancelRequest(const QString &requestId)
+{
+    if (requestId.isEmpty()) {
+        m_pendingReplays.clear();
+        m_inFlight.clear();
+        m_inFlightByKey.clear();
+        m_subscriptions.clear();
+        m_backend->cancelRequest();
+        return;
+    }
+
+    if (m_pendingReplays.remove(requestId)) {
+        emit statusChanged(requestId, QStringLiteral("cancelled"));
+        return;
+    }
+
+    const QString innerId = m_subscriptions.take(requestId);
+    auto it = m_inFlight.find(innerId);
+    if (it == m_inFlight.end())
+        return;
+
+    it->subscribers.removeAll(requestId);
+    if (it->subscribers.isEmpty()) {
+        // Nobody is waiting for the shared call any more
+        if (!it->key.isEmpty())
+            m_inFlightByKey.remove(it->key);
+        m_inFlight.erase(it);
+        m_backend->cancelRequest(innerId);
+    }
+
+    emit statusChanged(requestId, QStringLiteral("cancelled"));
+}
+
+void ResponseCache::replay(const QString &requestId, const QStringList &choices, const QVariantMap &usage)
+{
+    emit servedFromCache(requestId);
+
+    for (int i = 0; i < choices.size(); ++i) {
+        if (i == 0)
+            emit partialResponse(requestId, choices.at(i));
+        emit choicePartialResponse(requestId, i, choices.at(i));
+    }
+    if (!usage.isEmpty())
+        emit usageReported(requestId, usage);
+    if (choices.size() > 1)
+        emit choicesFinished(requestId, choices);
+    emit finished(requestId, choices.value(0));
+}
+
+void ResponseCache::onChoicePartialResponse(const QString &innerId, int choiceIndex, const QString &text)
+{
+    auto it = m_inFlight.find(innerId);
+    if (it == m_inFlight.end() || choiceIndex < 0)
+        return;
+
+    while (it->choices.size() <= choiceIndex)
+        it->choices.append(QString());
+    it->choices[choiceIndex].append(text);
+
+    const QStringList subscribers = it->subscribers;
+    for (const QString &requestId : subscribers) {
+        if (choiceIndex == 0)
+            emit partialResponse(requestId, text);
+        emit choicePartialResponse(requestId, choiceIndex, text);
+    }
+}
+
+void ResponseCache::onChoicesFinished(const QString &innerId, const QStringList &responses)
+{
+    auto it = m_inFlight.find(innerId);
+    if (it == m_inFlight.end())
+        return;
+
+    it->choices = responses;
+    const QStringList subscribers = it->subscribers;
+    for (const QString &requestId : subscribers)
+        emit choicesFinished(requestId, responses);
+}
+
+void ResponseCache::onFinished(const QString &innerId, const QString &fullResponse)
+{
+    auto it = m_inFlight.find(innerId);
+    if (it == m_inFlight.end())
+        return;
+
+    InFlight call = std::move(it.value());
+    m_inFlight.erase(it);
+    for (const QString &requestId : std::as_const(call.subscribers))
+        m_subscriptions.remove(requestId);
+
+    if (!call.key.isEmpty()) {
+        m_inFlightByKey.remove(call.key);
+
+        if (call.choices.isEmpty())
+            call.choices.append(QString());
+        call.choices[0] = fullResponse;
+        if (m_enabled && !fullResponse.isEmpty())
+            store(call.key, call.choices, call.usage);
+    }
+
+    for (const QString &requestId : std::as_const(call.subscribers))
+        emit finished(requestId, fullResponse);
+}
+
+void ResponseCache::onErrorOccurred(const QString &innerId, const QString &errorString)
+{
+    auto it = m_inFlight.find(innerId);
+    if (it == m_inFlight.end())
+        return;
+
+    // Errors are never cached
+    InFlight call = std::move(it.value());
+    m_inFlight.erase(it);
+    if (!call.key.isEmpty())
+        m_inFlightByKey.remove(call.key);
+    for (const QString &requestId : std::as_const(call.subscribers)) {
+        m_subscriptions.remove(requestId);
+        emit errorOccurred(requestId, errorString);
+    }
+}
+
+void ResponseCache::onUsageReported(const QString &innerId, const QVariantMap &usage)
+{
+    auto it = m_inFlight.find(innerId);
+    if (it == m_inFlight.end())
+        return;
+
+    it->usage = usage;
+    const QStringList subscribers = it->subscribers;
+    for (const QString &requestId : subscribers)
+        emit usageReported(requestId, usage);
+}
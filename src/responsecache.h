@@ -0,0 +1,106 @@
+#ifndef RESPONSECACHE_H
+#define RESPONSECACHE_H
+
+#pragma once
+
+#include "aibackend.h"
+
+#include <QHash>
+#include <QSet>
+#include <QStringList>
+
+/**
+ * @brief AIBackend decorator that answers repeated requests from an on-disk cache.
+ *
+ * Requests are keyed by the SHA-256 of the backend name and the exact request
+ * body the wrapped backend would send (AIBackend::requestPayload), so the key
+ * covers the model, sampling params and final message bytes. A hit replays
+ * the stored answer through the usual partialResponse/finished signals, after
+ * servedFromCache(). Identical requests already in flight share one call to
+ * the wrapped backend. Entries live under the application cache folder and
+ * are evicted least recently used first once the size limit is exceeded.
+ *
+ * Opt-in through the config keys "response_cache" (bool) and
+ * "response_cache_max_mb"; a request with params "cache" = false bypasses it.
+ */
+class ResponseCache : public AIBackend
+{
+    Q_OBJECT
+public:
+    // Takes ownership of 'backend'
+    explicit ResponseCache(AIBackend *backend, QObject *parent = nullptr);
+    ~ResponseCache() override;
+
+    void startRequest(const QList<Message> &messages,
+                      const QVariantMap &params = QVariantMap(),
+                      const QString &requestId = QString()) override;
+
+    void cancelRequest(const QString &requestId = QString()) override;
+
+    bool supportsStreaming() const override { return m_backend->supportsStreaming(); }
+    QString backendName() const override { return m_backend->backendName(); }
+    void prewarm() override { m_backend->prewarm(); }
+    void setConfig(const QVariantMap &config) override;
+    QByteArray requestPayload(const QList<Message> &messages, const QVariantMap &params) const override
+    {
+        return m_backend->requestPayload(messages, params);
+    }
+
+    AIBackend *backend() const { return m_backend; }
+
+    bool isEnabled() const { return m_enabled; }
+    QString cacheFolder() const { return m_folder; }
+
+    // Delete every stored response
+    void clear();
+
+private:
+    struct Entry {
+        qint64 size = 0;
+        qint64 lastUsed = 0;    // ms since epoch; the file mtime on disk
+    };
+
+    // One call to the wrapped backend, shared by every identical request
+    struct InFlight {
+        QString key;            // Empty: not cacheable
+        QStringList subscribers;
+        QStringList choices;    // Text received so far, by choice index
+        QVariantMap usage;
+    };
+
+    QString cacheKey(const QList<Message> &messages, const QVariantMap &params) const;
+    QString entryPath(const QString &key) const;
+
+    void loadIndex();
+    bool lookup(const QString &key, QStringList *choices, QVariantMap *usage);
+    void store(const QString &key, const QStringList &choices, const QVariantMap &usage);
+    void evict();
+
+    void replay(const QString &requestId, const QStringList &choices, const QVariantMap &usage);
+
+    void onChoicePartialResponse(const QString &innerId, int choiceIndex, const QString &text);
+    void onChoicesFinished(const QString &innerId, const QStringList &responses);
+    void onFinished(const QString &innerId, const QString &fullResponse);
+    void onErrorOccurred(const QString &innerId, const QString &errorString);
+    void onUsageReported(const QString &innerId, const QVariantMap &usage);
+
+    AIBackend *m_backend = nullptr;
+
+    bool m_enabled = false;
+    qint64 m_maxBytes = 0;
+    QString m_folder;
+    bool m_indexLoaded = false;
+    QHash<QString, Entry> m_entries;
+    qint64 m_totalBytes = 0;
+
+    // Wrapped request id -> call; the first subscriber's id is used for the call
+    QHash<QString, InFlight> m_inFlight;
+    // Cache key -> wrapped request id, for joining identical requests
+    QHash<QString, QString> m_inFlightByKey;
+    // Request id -> wrapped request id it is subscribed to
+    QHash<QString, QString> m_subscriptions;
+    // Cache hits not replayed yet (replay is deferred to the next event loop pass)
+    QSet<QString> m_pendingReplays;
+};
+
+#endif // RESPONSECACHE_H
@@ -1,15 +1,236 @@
 #include "session.h"
 #include "project.h"
 #include "commandpipemanager.h"  // Include CommandPipeManager
+#include "promptcompiler.h"
+#include "includestore.h"
+#include "tokenizer.h"
+#include "sessionindex.h"
 
 #include <QFile>
 #include <QFileInfo>
+#include <QSaveFile>
 #include <QTextStream>
 #include <QDateTime>
 #include <QDir>
 #include <QRegularExpression>
+#include <QJsonDocument>
+#include <QJsonObject>
 #include <QDebug>
 
+#include <cstring>
+
+#if defined(Q_OS_UNIX)
+#include <unistd.h>
+#elif defined(Q_OS_WIN)
+#include <io.h>
+#endif
+
+namespace {
+
+bool isAsciiSpace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f';
+}
+
+bool isAsciiDigit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+// 'word' must be lower-case
+bool startsWithNoCase(const char *p, const char *end, const char *word)
+{
+    for (; *word; ++p, ++word) {
+        if (p >= end)
+            return false;
+        char c = *p;
+        if (c >= 'A' && c <= 'Z')
+            c = char(c - 'A' + 'a');
+        if (c != *word)
+            return false;
+    }
+    return true;
+}
+
+// Hand-written equivalent of ^==\{\s*(System|User|Assistant)\s*(?:\|\s*(yyyy-MM-dd HH:mm:ss))?\s*\}==\s*$
+// (case-insensitive, matched against the trimmed line)
+bool matchDelimiterLine(const char *p, const char *end, MessageRole &role, QString &timestamp)
+{
+    while (p < end && isAsciiSpace(*p))
+        ++p;
+    if (end - p < 3 || p[0] != '=' || p[1] != '=' || p[2] != '{')
+        return false;
+    p += 3;
+
+    while (p < end && isAsciiSpace(*p))
+        ++p;
+    if (startsWithNoCase(p, end, "system")) {
+        role = MessageRole::System;
+        p += 6;
+    } else if (startsWithNoCase(p, end, "user")) {
+        role = MessageRole::User;
+        p += 4;
+    } else if (startsWithNoCase(p, end, "assistant")) {
+        role = MessageRole::Assistant;
+        p += 9;
+    } else {
+        return false;
+    }
+
+    while (p < end && isAsciiSpace(*p))
+        ++p;
+
+    timestamp.clear();
+    if (p < end && *p == '|') {
+        ++p;
+        while (p < end && isAsciiSpace(*p))
+            ++p;
+
+        static const char pattern[] = "dddd-dd-dd dd:dd:dd";
+        const int len = sizeof(pattern) - 1;
+        if (end - p < len)
+            return false;
+        for (int i = 0; i < len; ++i) {
+            if (pattern[i] == 'd' ? !isAsciiDigit(p[i]) : p[i] != pattern[i])
+                return false;
+        }
+        timestamp = QString::fromLatin1(p, len);
+        p += len;
+
+        while (p < end && isAsciiSpace(*p))
+            ++p;
+    }
+
+    if (end - p < 3 || p[0] != '}' || p[1] != '=' || p[2] != '=')
+        return false;
+    p += 3;
+
+    while (p < end && isAsciiSpace(*p))
+        ++p;
+    return p == end;
+}
+
+bool sameSlice(const PromptSlice &a, const PromptSlice &b)
+{
+    return a.role == b.role && a.timestamp == b.timestamp && a.content == b.content;
+}
+
+// The last block of a session file is written without its trailing blank lines
+QString terminalBlock(const QString &block)
+{
+    int end = block.size();
+    while (end > 0 && block.at(end - 1).isSpace())
+        --end;
+    return block.left(end) + "\n";
+}
+
+// Session files keep the platform's line endings, as the text-mode writes they replaced did
+QByteArray fileBytes(const QString &text)
+{
+    QByteArray bytes = text.toUtf8();
+#if defined(Q_OS_WIN)
+    bytes.replace("\n", "\r\n");
+#endif
+    return bytes;
+}
+
+// An in-place tail write goes here first, so a crash between truncating and writing can be replayed
+QString tailJournalPath(const QString &sessionPath)
+{
+    return sessionPath + QStringLiteral(".journal");
+}
+
+bool syncToDisk(QFile &file)
+{
+#if defined(Q_OS_UNIX)
+    return ::fsync(file.handle()) == 0;
+#elif defined(Q_OS_WIN)
+    return ::_commit(file.handle()) == 0;
+#else
+    Q_UNUSED(file);
+    return true;
+#endif
+}
+
+using IncludeManifest = QMap<QString, CachedInclude>;
+
+// Characters of include snapshots Session::cachedIncludeContent() keeps in memory
+const int kIncludeContentCacheChars = 32 * 1024 * 1024;
+
+// Stored includes resolve through the shared object store; command pipe outputs
+// and caches from before the store still live as plain files in the session cache
+QString resolveInclude(const IncludeManifest &manifest, const QString &relPath, const QString &cacheBaseFolder,
+                       const IncludeStore &store)
+{
+    auto it = manifest.constFind(relPath);
+    if (it != manifest.constEnd()) {
+        QString objectPath = store.objectPath(it->hash);
+        if (QFileInfo::exists(objectPath))
+            return objectPath;
+        qWarning() << "[resolveCachedInclude] Object missing from include store:" << it->hash << "for" << relPath;
+    }
+    return QDir(cacheBaseFolder).filePath(relPath);
+}
+
+// Key the snapshot an include resolved to is remembered under
+QString includeKey(const IncludeManifest &manifest, const QString &cleanPath, const QString &path,
+                   const QFileInfo &fi, const IncludeStore &store)
+{
+    // Stored objects are named by their content hash; plain cache files (command pipe outputs) change in place
+    auto it = manifest.constFind(cleanPath);
+    return (it != manifest.constEnd() && path == store.objectPath(it->hash))
+               ? it->hash
+               : QString("%1|%2|%3").arg(path).arg(fi.lastModified().toMSecsSinceEpoch()).arg(fi.size());
+}
+
+int includeTokens(const IncludeManifest &manifest, const QString &relPath, const Tokenizer &tokenizer,
+                  const QString &cacheBaseFolder, const IncludeStore &store)
+{
+    const QString cleanPath = QDir::cleanPath(relPath);
+    const QString path = resolveInclude(manifest, cleanPath, cacheBaseFolder, store);
+    QFileInfo fi(path);
+    if (!fi.isFile())
+        return -1;
+
+    const QString key = includeKey(manifest, cleanPath, path, fi, store);
+    const int known = tokenizer.cachedCount(key);
+    if (known >= 0)
+        return known;
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        qWarning() << "[Session::includeTokenCount] Could not open cached include file:" << path;
+        return -1;
+    }
+    return tokenizer.countCached(key, QString::fromUtf8(file.readAll()));
+}
+
+int contentTokens(const IncludeManifest &manifest, const QString &content, const Tokenizer &tokenizer,
+                  const QString &cacheBaseFolder, const IncludeStore &store, bool rememberText)
+{
+    // The text and every include are counted apart; merges across the seams are lost,
+    // which is off by a token or two per marker. Include markers that are not cached
+    // yet count as their snapshot from an earlier send, if there is one.
+    int tokens = 0;
+    const QVector<PromptCompiler::Segment> segments =
+        PromptCompiler::tokenize(content, {QStringLiteral("cached"), QStringLiteral("include")});
+    for (const PromptCompiler::Segment &segment : segments) {
+        if (segment.type == PromptCompiler::Segment::Marker) {
+            const int markerTokens = includeTokens(manifest, segment.argument, tokenizer, cacheBaseFolder, store);
+            if (markerTokens >= 0) {
+                tokens += markerTokens;
+                continue;
+            }
+        }
+
+        const QString text = content.mid(segment.start, segment.length);
+        tokens += rememberText ? tokenizer.countCached(text) : tokenizer.count(text);
+    }
+    return tokens;
+}
+
+} // namespace
+
 
 // Helper to copy files to the cache folder with overwrite
 static bool copyFileToCacheFolder(const QString &srcPath, const QString &cacheFolder, const QString &relPath)
@@ -47,6 +268,7 @@ static bool copyFileToCacheFolder(const QString &srcPath, const QString &cacheFo
 Session::Session(Project *project, QObject *parent)
     : QObject(parent)
     , m_project(project)
+    , m_includeContentCache(kIncludeContentCacheChars)
 {
 }
 
@@ -64,65 +286,79 @@ static QString messageRoleToString(MessageRole role)
     }
 }
 
-bool Session::runCommandPipes()
+QStringList Session::commandPipeNames() const
 {
-    if (!m_commandPipeManager) {
-        qWarning() << "[Session::runCommandPipes] CommandPipeManager not initialized";
-        return false;
+    QStringList names;
+    for (const PromptSlice &slice : m_slices) {
+        const QVector<PromptCompiler::Segment> segments =
+            PromptCompiler::tokenize(slice.content, {QStringLiteral("command")});
+        for (const PromptCompiler::Segment &segment : segments) {
+            if (segment.type == PromptCompiler::Segment::Marker && !names.contains(segment.argument))
+                names.append(segment.argument);
+        }
     }
+    return names;
+}
 
+bool Session::applyCommandPipeOutputs(const QStringList &succeeded)
+{
     bool modified = false;
-
-    // Regex to find command pipe markers: <!-- command: name -->
-    static const QRegularExpression commandRe(R"(<!--\s*command:\s*(\S+)\s*-->)", QRegularExpression::CaseInsensitiveOption);
+    bool manifestChanged = false;
+    const QString cacheBaseFolder = sessionCacheBaseFolder();
+    IncludeStore store(sessionFolder());
 
     for (int i = 0; i < m_slices.size(); ++i) {
-        QString content = m_slices[i].content;
-        int offset = 0;
-
-        while (true) {
-            QRegularExpressionMatch match = commandRe.match(content, offset);
-            if (!match.hasMatch())
-                break;
-
-            QString commandName = match.captured(1).trimmed();
-
-            qDebug() << "[Session::runCommandPipes] Found command pipe:" << commandName << "in slice" << i;
-
-            QString error = m_commandPipeManager->runCommandPipe(commandName);
-
-            if (!error.isEmpty()) {
-                qWarning() << "[Session::runCommandPipes] Command pipe" << commandName << "failed:" << error;
-                return false; // fail on first error
-            }
-
-            // Replace command marker with corresponding cached include marker
-            QString replacement;
-
-            if (commandName == "amalgamateSrc") {
-                replacement = "<!-- cached: src/src.txt -->";
-            } else {
-                // For unknown commands, just remove the command marker
-                replacement = "";
-            }
-
-            int start = match.capturedStart(0);
-            int length = match.capturedLength(0);
-            content.replace(start, length, replacement);
+        // Command pipe markers: <!-- command: name -->; markers of failed pipes stay for the next send
+        QString content = PromptCompiler::compile(m_slices[i].content, {QStringLiteral("command")},
+            [&](const PromptCompiler::Segment &marker, QString &replacement) {
+                const QString commandName = marker.argument;
+                if (!succeeded.contains(commandName))
+                    return false;
+
+                qDebug() << "[Session::applyCommandPipeOutputs] Replacing command pipe:" << commandName << "in slice" << i;
+
+                // The output file is overwritten by the next run; this turn keeps a snapshot of it,
+                // so earlier slices expand to the same text (and the same prompt prefix) every turn
+                const QString outputPath = CommandPipeManager::outputPathFor(commandName);
+                const QFileInfo outputFi(QDir(cacheBaseFolder).filePath(outputPath));
+                QString error;
+                const QString hash = store.storeFile(outputFi.absoluteFilePath(), &error);
+                if (hash.isEmpty()) {
+                    qWarning() << "[Session::applyCommandPipeOutputs] Failed storing output of" << commandName << error;
+                    replacement = QString("<!-- cached: %1 -->").arg(outputPath);
+                    return true;
+                }
 
-            offset = start + replacement.length();
-            modified = true;
-        }
+                const QString snapshotPath = QString("%1/%2@%3.%4")
+                    .arg(QFileInfo(outputPath).path(), outputFi.completeBaseName())
+                    .arg(i)
+                    .arg(outputFi.suffix());
+                CachedInclude entry;
+                entry.hash = hash;
+                entry.source = outputFi.absoluteFilePath();
+                entry.mtime = outputFi.lastModified().toMSecsSinceEpoch();
+                entry.size = outputFi.size();
+                m_includeManifest.insert(snapshotPath, entry);
+                manifestChanged = true;
+
+                // Replace command marker with the cached include marker of its snapshot
+                replacement = QString("<!-- cached: %1 -->").arg(snapshotPath);
+                return true;
+            });
 
-        if (modified) {
+        if (content != m_slices[i].content) {
             m_slices[i].content = content;
+            modified = true;
         }
     }
 
+    if (manifestChanged && !saveIncludeManifest())
+        qWarning() << "[Session::applyCommandPipeOutputs] Failed to save include manifest";
+
     if (modified) {
         // Save updated session file with replaced command pipes
         if (!save()) {
-            qWarning() << "[Session::runCommandPipes] Failed to save session after running command pipes";
+            qWarning() << "[Session::applyCommandPipeOutputs] Failed to save session after running command pipes";
             return false;
         }
     }
@@ -132,24 +368,41 @@ bool Session::runCommandPipes()
 
 bool Session::load(const QString &filepath)
 {
+    if (!replayTailJournal(filepath))
+        qWarning() << "[Session::load] Could not replay the pending tail write of" << filepath;
+
     QFile file(filepath);
-    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+    if (!file.open(QIODevice::ReadOnly)) {
         qWarning() << "Failed to open session file:" << filepath;
         return false;
     }
 
     m_filepath = filepath;
 
-    QTextStream in(&file);
-    QString data = in.readAll();
+    // The parsed layout may differ from ours; the first save rewrites it once
+    m_journal = Journal();
 
     m_slices.clear();
     m_metadata.clear();
 
-    bool ok = parseSessionFile(data);
+    // Scan the UTF-8 bytes in place; fall back to reading when the file can't be mapped
+    bool ok;
+    const qint64 fileSize = file.size();
+    uchar *mapped = fileSize > 0 ? file.map(0, fileSize) : nullptr;
+    if (mapped) {
+        ok = parseSessionFile(reinterpret_cast<const char *>(mapped), fileSize);
+        file.unmap(mapped);
+    } else {
+        const QByteArray data = file.readAll();
+        ok = parseSessionFile(data.constData(), data.size());
+    }
+    file.close();
+
     if (!ok)
         return false;
 
+    loadIncludeManifest();
+
     // Initialize or update CommandPipeManager with correct session cache folder
     if (m_commandPipeManager) {
         m_commandPipeManager->deleteLater();
@@ -158,7 +411,7 @@ bool Session::load(const QString &filepath)
 
     QString absCacheFolder = sessionCacheBaseFolder();
     qDebug() << "[Session::load] Initializing CommandPipeManager with cache folder:" << absCacheFolder;
-    m_commandPipeManager = new CommandPipeManager(m_project, absCacheFolder);
+    m_commandPipeManager = new CommandPipeManager(m_project, absCacheFolder, this);
 
     for (int i = 0; i < m_slices.size(); ++i) {
         const PromptSlice &slice = m_slices.at(i);
@@ -168,13 +421,8 @@ bool Session::load(const QString &filepath)
     return true; // or false on failure
 }
 
-bool Session::refreshCacheAndSave()
+void Session::refreshCache()
 {
-    if (m_slices.isEmpty()) {
-        qWarning() << "No prompt slices to refresh cache for.";
-        return false;
-    }
-
     QVector<PromptSlice> updatedSlices;
     for (auto &slice : m_slices) {
         // caching includes rewrites include->cached and copies files
@@ -182,6 +430,16 @@ bool Session::refreshCacheAndSave()
         updatedSlices.append({slice.role, cachedContent, slice.timestamp});
     }
     m_slices = updatedSlices;
+}
+
+bool Session::refreshCacheAndSave()
+{
+    if (m_slices.isEmpty()) {
+        qWarning() << "No prompt slices to refresh cache for.";
+        return false;
+    }
+
+    refreshCache();
 
     if (!save()) {
         qWarning() << "Failed to save session file during cache refresh.";
@@ -195,21 +453,250 @@ bool Session::save(const QString &filepath)
 {
     QString savePath = filepath.isEmpty() ? m_filepath : filepath;
 
-    QFile file(savePath);
-    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+    if (m_saveBatchDepth > 0) {
+        m_saveDeferred = true;
+        m_deferredSavePath = savePath;
+        return true;
+    }
+
+    return writeSessionFile(savePath);
+}
+
+bool Session::compact(const QString &filepath)
+{
+    QString savePath = filepath.isEmpty() ? m_filepath : filepath;
+    m_saveDeferred = false;
+    return rewriteSessionFile(savePath);
+}
+
+void Session::beginSaveBatch()
+{
+    ++m_saveBatchDepth;
+}
+
+bool Session::endSaveBatch()
+{
+    if (m_saveBatchDepth == 0)
+        return true;
+    if (--m_saveBatchDepth > 0 || !m_saveDeferred)
+        return true;
+
+    m_saveDeferred = false;
+    return writeSessionFile(m_deferredSavePath);
+}
+
+Session::SaveBatch::SaveBatch(Session *session)
+    : m_session(session)
+{
+    m_session->beginSaveBatch();
+}
+
+Session::SaveBatch::~SaveBatch()
+{
+    if (!m_committed && !m_session->endSaveBatch())
+        qWarning() << "[Session::SaveBatch] Failed to write deferred session save";
+}
+
+bool Session::SaveBatch::commit()
+{
+    if (m_committed)
+        return true;
+    m_committed = true;
+    return m_session->endSaveBatch();
+}
+
+bool Session::writeSessionFile(const QString &savePath)
+{
+    // Pin timestamps so the slices compare equal to what gets written
+    for (PromptSlice &slice : m_slices) {
+        if (slice.timestamp.isEmpty())
+            slice.timestamp = QDateTime::currentDateTime().toString("yyyy-MM-dd HH:mm:ss");
+    }
+
+    if (m_slices.isEmpty() || !journalMatchesFile(savePath) || serializeHeader() != m_journal.header)
+        return rewriteSessionFile(savePath);
+
+    const int persisted = m_journal.slices.size();
+    if (persisted == 0 || m_slices.size() < persisted)
+        return rewriteSessionFile(savePath);
+
+    int firstChanged = 0;
+    while (firstChanged < persisted && sameSlice(m_slices.at(firstChanged), m_journal.slices.at(firstChanged)))
+        ++firstChanged;
+
+    if (firstChanged == persisted && m_slices.size() == persisted) {
+        qDebug() << "[Session::save] No changes to write";
+        return true;
+    }
+
+    // Only the last stored slice may change in place; anything earlier needs a rewrite
+    if (firstChanged < persisted - 1)
+        return rewriteSessionFile(savePath);
+
+    return appendSessionTail(savePath, firstChanged);
+}
+
+bool Session::journalMatchesFile(const QString &savePath) const
+{
+    if (m_journal.size < 0 || m_journal.path != savePath)
+        return false;
+
+    // Someone else wrote the file since our last save: our offsets are meaningless
+    QFileInfo fi(savePath);
+    return fi.exists() && fi.size() == m_journal.size && fi.lastModified() == m_journal.modified;
+}
+
+bool Session::rewriteSessionFile(const QString &savePath)
+{
+    Journal journal;
+    journal.path = savePath;
+    journal.header = serializeHeader();
+    journal.slices = m_slices;
+
+    QByteArray data;
+    if (m_slices.isEmpty()) {
+        data = fileBytes(serializeSessionFile());
+    } else {
+        data = fileBytes(journal.header);
+        for (int i = 0; i < m_slices.size(); ++i) {
+            journal.offsets.append(data.size());
+            QString block = serializeSliceBlock(m_slices.at(i));
+            data += fileBytes(i == m_slices.size() - 1 ? terminalBlock(block) : block);
+        }
+    }
+
+    // QSaveFile writes to a temporary file, syncs it and renames it over the original
+    QSaveFile file(savePath);
+    if (!file.open(QIODevice::WriteOnly)) {
         qWarning() << "Failed to write session file:" << savePath;
+        m_journal = Journal();
         return false;
     }
+    file.write(data);
+    if (!file.commit()) {
+        qWarning() << "Failed to commit session file:" << savePath;
+        m_journal = Journal();
+        return false;
+    }
+    // A pending tail write must not be replayed over the file we just replaced
+    QFile::remove(tailJournalPath(savePath));
 
-    QTextStream out(&file);
+    if (!m_slices.isEmpty()) {
+        QFileInfo fi(savePath);
+        journal.size = fi.size();
+        journal.modified = fi.lastModified();
+    }
+    m_journal = journal;
+    SessionIndex::notifySaved(savePath);
 
-    out << serializeSessionFile();
+    qDebug() << "[Session::save] Rewrote session file" << savePath << "(" << data.size() << "bytes)";
+    return true;
+}
 
-    file.flush();
+bool Session::appendSessionTail(const QString &savePath, int firstChanged)
+{
+    const int persisted = m_journal.slices.size();
+    QVector<qint64> offsets = m_journal.offsets;
+    offsets.resize(m_slices.size());
+
+    qint64 writeStart;
+    QByteArray tail;
+
+    if (firstChanged < persisted) {
+        // The last stored slice changed (e.g. a streamed response): replace it from its offset
+        writeStart = m_journal.offsets.at(firstChanged);
+    } else {
+        // The last stored slice becomes a middle slice: restore the blank lines it was written without
+        writeStart = m_journal.size;
+        QString lastBlock = serializeSliceBlock(m_journal.slices.last());
+        tail = fileBytes(lastBlock.mid(terminalBlock(lastBlock).size()));
+    }
+
+    for (int i = firstChanged; i < m_slices.size(); ++i) {
+        offsets[i] = writeStart + tail.size();
+        QString block = serializeSliceBlock(m_slices.at(i));
+        tail += fileBytes(i == m_slices.size() - 1 ? terminalBlock(block) : block);
+    }
+
+    // Record the write before touching the file: if we crash after truncating, load() replays it
+    QSaveFile journalFile(tailJournalPath(savePath));
+    if (!journalFile.open(QIODevice::WriteOnly)
+        || journalFile.write(QByteArray::number(writeStart) + ' ' + QByteArray::number(tail.size()) + '\n') < 0
+        || journalFile.write(tail) != tail.size()
+        || !journalFile.commit()) {
+        qWarning() << "Failed to write session journal:" << journalFile.fileName();
+        m_journal = Journal();
+        return false;
+    }
 
+    if (!writeTail(savePath, writeStart, tail)) {
+        qWarning() << "Failed to append to session file:" << savePath;
+        m_journal = Journal();
+        return false;
+    }
+    QFile::remove(tailJournalPath(savePath));
+
+    QFileInfo fi(savePath);
+    m_journal.slices = m_slices;
+    m_journal.offsets = offsets;
+    m_journal.size = fi.size();
+    m_journal.modified = fi.lastModified();
+    // Appending in place raises no directory event; tell the session list directly
+    SessionIndex::notifySaved(savePath);
+
+    qDebug() << "[Session::save] Appended" << m_slices.size() - firstChanged << "slice(s) to" << savePath
+             << "(" << tail.size() << "bytes at offset" << writeStart << ")";
     return true;
 }
 
+bool Session::writeTail(const QString &savePath, qint64 offset, const QByteArray &tail)
+{
+    QFile file(savePath);
+    if (!file.open(QIODevice::ReadWrite))
+        return false;
+
+    bool ok = file.resize(offset)
+              && file.seek(offset)
+              && file.write(tail) == tail.size()
+              && file.flush()
+              && syncToDisk(file);
+    if (!ok)
+        qWarning() << "[Session::writeTail]" << savePath << file.errorString();
+    file.close();
+    return ok;
+}
+
+bool Session::replayTailJournal(const QString &savePath)
+{
+    QFile journalFile(tailJournalPath(savePath));
+    if (!journalFile.exists())
+        return true;
+    if (!journalFile.open(QIODevice::ReadOnly))
+        return false;
+
+    // "<offset> <length>\n" followed by the bytes that belong at that offset
+    const QList<QByteArray> header = journalFile.readLine().trimmed().split(' ');
+    const QByteArray tail = journalFile.readAll();
+    journalFile.close();
+
+    bool offsetOk = false;
+    bool lengthOk = false;
+    const qint64 offset = header.size() == 2 ? header.at(0).toLongLong(&offsetOk) : -1;
+    const qint64 length = header.size() == 2 ? header.at(1).toLongLong(&lengthOk) : -1;
+    if (!offsetOk || !lengthOk || offset < 0 || length != tail.size()) {
+        // QSaveFile never leaves a partial journal behind; this one is not ours
+        qWarning() << "[Session::replayTailJournal] Ignoring malformed journal" << journalFile.fileName();
+        return false;
+    }
+
+    if (!writeTail(savePath, offset, tail))
+        return false;
+
+    qDebug() << "[Session::replayTailJournal] Replayed" << tail.size() << "bytes at offset" << offset
+             << "into" << savePath;
+    return QFile::remove(journalFile.fileName());
+}
+
 QString Session::sessionFolder() const
 {
     QFileInfo fi(m_filepath);
@@ -260,113 +747,157 @@ QString Session::cacheIncludesInContent(const QString &content)
     }
 
     QString projectRoot = m_project->rootFolder();
-    QString sessionCacheRoot = sessionCacheBaseFolder();
-
-    static const QRegularExpression markerRe(R"(<!--\s*(include):\s*(.*?)\s*-->)", QRegularExpression::CaseInsensitiveOption);
-
-    int offset = 0;
-    while (true) {
-        QRegularExpressionMatch m = markerRe.match(result, offset);
-        if (!m.hasMatch())
-            break;
-
-        QString fullMatch = m.captured(0);
-        QString includePath = m.captured(2).trimmed();
-
-        qDebug() << "[cacheIncludesInContent] Found include marker:" << fullMatch
-                 << "| include path:" << includePath;
+    IncludeStore store(sessionFolder());
+    bool manifestChanged = false;
+
+    // Rewrite <!-- include: path --> markers to <!-- cached: path --> after storing the file
+    result = PromptCompiler::compile(content, {QStringLiteral("include")},
+        [&](const PromptCompiler::Segment &marker, QString &replacement) {
+            QString includePath = marker.argument;
+
+            qDebug() << "[cacheIncludesInContent] Found include marker:" << content.mid(marker.start, marker.length)
+                     << "| include path:" << includePath;
+
+            // Resolve absolute source file path
+            QString absSrcFile;
+            QFileInfo fi(includePath);
+            if (fi.isAbsolute()) {
+                absSrcFile = includePath;
+            } else {
+                // If includePath starts with a known folder prefix, resolve relative to project root
+                // Else, fallback to docs or src folder heuristics
+
+                QStringList knownPrefixes = {
+                    QFileInfo(m_project->docsFolder()).fileName(),
+                    QFileInfo(m_project->srcFolder()).fileName(),
+                    QFileInfo(m_project->sessionsFolder()).fileName(),
+                    QFileInfo(m_project->templatesFolder()).fileName()
+                };
+
+                bool hasKnownPrefix = false;
+                for (const QString &prefix : knownPrefixes) {
+                    if (includePath.startsWith(prefix + "/") || includePath.startsWith(prefix + "\\")) {
+                        absSrcFile = QDir(projectRoot).filePath(includePath);
+                        hasKnownPrefix = true;
+                        break;
+                    }
+                }
 
-        // Resolve absolute source file path
-        QString absSrcFile;
-        QFileInfo fi(includePath);
-        if (fi.isAbsolute()) {
-            absSrcFile = includePath;
-        } else {
-            // If includePath starts with a known folder prefix, resolve relative to project root
-            // Else, fallback to docs or src folder heuristics
-
-            QStringList knownPrefixes = {
-                QFileInfo(m_project->docsFolder()).fileName(),
-                QFileInfo(m_project->srcFolder()).fileName(),
-                QFileInfo(m_project->sessionsFolder()).fileName(),
-                QFileInfo(m_project->templatesFolder()).fileName()
-            };
-
-            bool hasKnownPrefix = false;
-            for (const QString &prefix : knownPrefixes) {
-                if (includePath.startsWith(prefix + "/") || includePath.startsWith(prefix + "\\")) {
-                    absSrcFile = QDir(projectRoot).filePath(includePath);
-                    hasKnownPrefix = true;
-                    break;
+                if (!hasKnownPrefix) {
+                    // Fallback heuristic: if extension is source code, use src folder, else docs folder
+                    const QString suffix = QFileInfo(includePath).suffix().toLower();
+                    if (suffix == "h" || suffix == "cpp" || suffix == "hpp" || suffix == "ui" || suffix == "txt") {
+                        absSrcFile = QDir(m_project->srcFolder()).filePath(includePath);
+                    } else {
+                        absSrcFile = QDir(m_project->docsFolder()).filePath(includePath);
+                    }
                 }
             }
 
-            if (!hasKnownPrefix) {
-                // Fallback heuristic: if extension is source code, use src folder, else docs folder
-                const QString suffix = QFileInfo(includePath).suffix().toLower();
-                if (suffix == "h" || suffix == "cpp" || suffix == "hpp" || suffix == "ui" || suffix == "txt") {
-                    absSrcFile = QDir(m_project->srcFolder()).filePath(includePath);
-                } else {
-                    absSrcFile = QDir(m_project->docsFolder()).filePath(includePath);
-                }
+            QFileInfo absFi(absSrcFile);
+            if (!absFi.exists() || !absFi.isFile()) {
+                qWarning() << "[cacheIncludesInContent] Source file missing:" << absSrcFile;
+                return false;
             }
-        }
 
-        QFileInfo absFi(absSrcFile);
-        if (!absFi.exists() || !absFi.isFile()) {
-            qWarning() << "[cacheIncludesInContent] Source file missing:" << absSrcFile;
-            offset = m.capturedEnd(0);
-            continue;
-        }
+            // The cached path keeps the folder prefix of the include path,
+            // e.g. "docs/Vision.md" stays "docs/Vision.md" in the session manifest
+            QString relPath = QDir::cleanPath(includePath);
 
-        // Compute relative path inside cache folder preserving folder prefix
-        // For example, if includePath is "docs/Vision.md", cache to sessionCache/docs/Vision.md
-        // So relPath = includePath itself (normalized)
+            const QString source = absFi.absoluteFilePath();
+            const qint64 mtime = absFi.lastModified().toMSecsSinceEpoch();
+            const qint64 size = absFi.size();
 
-        QString relPath = includePath;
-        relPath = QDir::cleanPath(relPath);
+            // Unchanged since it was last stored: nothing to read or copy
+            auto existing = m_includeManifest.constFind(relPath);
+            if (existing != m_includeManifest.constEnd()
+                && existing->source == source && existing->mtime == mtime && existing->size == size
+                && store.contains(existing->hash)) {
+                qDebug() << "[cacheIncludesInContent] Unchanged, reusing object" << existing->hash << "for" << relPath;
+            } else {
+                QString error;
+                QString hash = store.storeFile(source, &error);
+                if (hash.isEmpty()) {
+                    qWarning() << "[cacheIncludesInContent] Failed storing source file:" << source << error;
+                    return false;
+                }
 
-        // Determine cache destination path inside session cache folder
-        QString cacheDestPath = QDir(sessionCacheRoot).filePath(relPath);
+                CachedInclude entry;
+                entry.hash = hash;
+                entry.source = source;
+                entry.mtime = mtime;
+                entry.size = size;
+                m_includeManifest.insert(relPath, entry);
+                manifestChanged = true;
 
-        // Ensure cache destination directory exists
-        QFileInfo cacheDestInfo(cacheDestPath);
-        QDir cacheDestDir = cacheDestInfo.dir();
-        if (!cacheDestDir.exists()) {
-            if (!cacheDestDir.mkpath(".")) {
-                qWarning() << "[cacheIncludesInContent] Failed to create cache directory:" << cacheDestDir.absolutePath();
-                offset = m.capturedEnd(0);
-                continue;
+                qDebug() << "[cacheIncludesInContent] Cached file:" << source << "->" << hash;
             }
-        }
 
-        // Copy source file to cache destination (overwrite)
-        if (QFile::exists(cacheDestPath)) {
-            if (!QFile::remove(cacheDestPath)) {
-                qWarning() << "[cacheIncludesInContent] Cannot remove existing cached file:" << cacheDestPath;
-                offset = m.capturedEnd(0);
-                continue;
-            }
-        }
-        if (!QFile::copy(absSrcFile, cacheDestPath)) {
-            qWarning() << "[cacheIncludesInContent] Failed copying source file to cache:" << absSrcFile << "->" << cacheDestPath;
-            offset = m.capturedEnd(0);
-            continue;
-        }
+            // Replace include marker with cached marker, preserving folder prefix
+            replacement = QString("<!-- cached: %1 -->").arg(relPath);
+            return true;
+        });
 
-        qDebug() << "[cacheIncludesInContent] Cached file:" << absSrcFile << "->" << cacheDestPath;
+    if (manifestChanged && !saveIncludeManifest())
+        qWarning() << "[cacheIncludesInContent] Failed to save include manifest";
 
-        // Replace include marker with cached marker, preserving folder prefix
-        QString replacement = QString("<!-- cached: %1 -->").arg(relPath);
+    return result;
+}
 
-        int start = m.capturedStart(0);
-        int length = m.capturedLength(0);
-        result.replace(start, length, replacement);
+void Session::loadIncludeManifest()
+{
+    m_includeManifest.clear();
+
+    QFile manifestFile(QDir(sessionCacheBaseFolder()).filePath(IncludeStore::manifestFileName()));
+    if (!manifestFile.open(QIODevice::ReadOnly))
+        return; // no includes cached yet (or a session from before the include store)
+
+    QJsonDocument doc = QJsonDocument::fromJson(manifestFile.readAll());
+    manifestFile.close();
+
+    const QJsonObject entries = doc.object().value("entries").toObject();
+    for (auto it = entries.constBegin(); it != entries.constEnd(); ++it) {
+        const QJsonObject obj = it.value().toObject();
+        CachedInclude entry;
+        entry.hash = obj.value("hash").toString();
+        entry.source = obj.value("source").toString();
+        entry.mtime = obj.value("mtime").toVariant().toLongLong();
+        entry.size = obj.value("size").toVariant().toLongLong();
+        if (!entry.hash.isEmpty())
+            m_includeManifest.insert(it.key(), entry);
+    }
+
+    qDebug() << "[Session::loadIncludeManifest] Loaded" << m_includeManifest.size() << "cached include entries";
+}
 
-        offset = start + replacement.length();
+bool Session::saveIncludeManifest() const
+{
+    QJsonObject entries;
+    for (auto it = m_includeManifest.constBegin(); it != m_includeManifest.constEnd(); ++it) {
+        QJsonObject obj;
+        obj["hash"] = it->hash;
+        obj["source"] = it->source;
+        obj["mtime"] = it->mtime;
+        obj["size"] = it->size;
+        entries[it.key()] = obj;
     }
 
-    return result;
+    QJsonObject root;
+    root["entries"] = entries;
+
+    QSaveFile manifestFile(QDir(sessionCacheBaseFolder()).filePath(IncludeStore::manifestFileName()));
+    if (!manifestFile.open(QIODevice::WriteOnly)) {
+        qWarning() << "[Session::saveIncludeManifest] Failed to open manifest for writing:" << manifestFile.fileName();
+        return false;
+    }
+    manifestFile.write(QJsonDocument(root).toJson(QJsonDocument::Indented));
+    return manifestFile.commit();
+}
+
+QString Session::resolveCachedInclude(const QString &relPath, const QString &cacheBaseFolder,
+                                      const IncludeStore &store) const
+{
+    return resolveInclude(m_includeManifest, relPath, cacheBaseFolder, store);
 }
 
 QString Session::promptSliceContent(int index) const
@@ -383,6 +914,130 @@ void Session::setPromptSliceContent(int index, const QString &content)
     m_slices[index].content = content;
 }
 
+QString Session::predictedOutput(QString *relPathOut) const
+{
+    for (int i = m_slices.size() - 1; i >= 0; --i) {
+        if (m_slices[i].role != MessageRole::User)
+            continue;
+
+        const QVector<PromptCompiler::Segment> segments =
+            PromptCompiler::tokenize(m_slices[i].content, {QStringLiteral("predict")});
+        for (const PromptCompiler::Segment &segment : segments) {
+            if (segment.type != PromptCompiler::Segment::Marker || segment.argument.isEmpty())
+                continue;
+
+            // The same snapshot the model sees through the matching cached include
+            const QString relPath = QDir::cleanPath(segment.argument);
+            const QString path = resolveCachedInclude(relPath, sessionCacheBaseFolder(), IncludeStore(sessionFolder()));
+            QFile file(path);
+            if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+                qWarning() << "[Session::predictedOutput] Not cached in this session:" << relPath;
+                return QString();
+            }
+            if (relPathOut)
+                *relPathOut = relPath;
+            return QString::fromUtf8(file.readAll());
+        }
+        break;
+    }
+    return QString();
+}
+
+QVector<int> Session::sliceTokenCounts(const Tokenizer &tokenizer) const
+{
+    return sliceTokenCountTask(tokenizer)();
+}
+
+std::function<QVector<int>()> Session::sliceTokenCountTask(const Tokenizer &tokenizer) const
+{
+    // Copies (shared until the session changes them) of everything the counts read
+    const QVector<PromptSlice> slices = m_slices;
+    const IncludeManifest manifest = m_includeManifest;
+    const QString cacheBaseFolder = sessionCacheBaseFolder();
+    const QString storeFolder = sessionFolder();
+    const Tokenizer *counter = &tokenizer;
+
+    return [slices, manifest, cacheBaseFolder, storeFolder, counter]() {
+        const IncludeStore store(storeFolder);
+        QVector<int> counts;
+        counts.reserve(slices.size());
+        for (const PromptSlice &slice : slices)
+            counts.append(contentTokens(manifest, slice.content, *counter, cacheBaseFolder, store, true));
+        return counts;
+    };
+}
+
+int Session::promptTokenCount(const QString &content, const Tokenizer &tokenizer) const
+{
+    // Text being edited changes with every keystroke; not worth remembering
+    return contentTokens(m_includeManifest, content, tokenizer, sessionCacheBaseFolder(),
+                         IncludeStore(sessionFolder()), false);
+}
+
+int Session::includeTokenCount(const QString &relPath, const Tokenizer &tokenizer) const
+{
+    return includeTokens(m_includeManifest, relPath, tokenizer, sessionCacheBaseFolder(), IncludeStore(sessionFolder()));
+}
+
+QString Session::cachedIncludeContent(const QString &relPath) const
+{
+    const QString cleanPath = QDir::cleanPath(relPath);
+    const IncludeStore store(sessionFolder());
+    const QString path = resolveCachedInclude(cleanPath, sessionCacheBaseFolder(), store);
+    QFileInfo fi(path);
+    if (!fi.isFile())
+        return QString();
+
+    // The context planner asks for the same snapshots on every send; each is read once
+    const QString key = includeKey(m_includeManifest, cleanPath, path, fi, store);
+    if (const QString *cached = m_includeContentCache.object(key))
+        return *cached;
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+        return QString();
+    const QString content = QString::fromUtf8(file.readAll());
+    m_includeContentCache.insert(key, new QString(content), qMax(1, int(content.size())));
+    return content;
+}
+
+bool Session::alternativeRange(int index, int *first, int *last) const
+{
+    if (index < 0 || index >= m_slices.size() || m_slices[index].role != MessageRole::Assistant)
+        return false;
+
+    int begin = index;
+    while (begin > 0 && m_slices[begin - 1].role == MessageRole::Assistant)
+        --begin;
+    int end = index;
+    while (end + 1 < m_slices.size() && m_slices[end + 1].role == MessageRole::Assistant)
+        ++end;
+
+    if (first)
+        *first = begin;
+    if (last)
+        *last = end;
+    return true;
+}
+
+int Session::keepAlternative(int index)
+{
+    int first = 0;
+    int last = 0;
+    if (!alternativeRange(index, &first, &last) || first == last)
+        return index;
+
+    PromptSlice kept = m_slices[index];
+    m_slices.remove(first, last - first + 1);
+    m_slices.insert(first, kept);
+
+    // Slice indices after the run have shifted
+    m_expandedCache.clear();
+
+    qDebug() << "[Session::keepAlternative] Kept slice" << index << "of alternatives" << first << "-" << last;
+    return first;
+}
+
 QString Session::compilePrompt()
 {
     QStringList parts;
@@ -533,15 +1188,74 @@ QString Session::expandIncludesRecursive(const QString &content,
 
 QVector<PromptSlice> Session::expandedSlices() const
 {
+    const QString cacheBaseFolder = sessionCacheBaseFolder();
+    const IncludeStore store(sessionFolder());
+
+    // Expansions depend on the prompt layout; switching it recompiles every slice
+    const bool stable = stablePromptLayout();
+    if (stable != m_expandedStableLayout) {
+        m_expandedCache.clear();
+        m_expandedStableLayout = stable;
+    }
+
+    // Forget slices that no longer exist (e.g. after a refresh removed trailing slices)
+    for (auto it = m_expandedCache.begin(); it != m_expandedCache.end();) {
+        if (it.key() >= m_slices.size())
+            it = m_expandedCache.erase(it);
+        else
+            ++it;
+    }
+
     QVector<PromptSlice> expanded;
-    for (const auto &slice : m_slices) {
+    expanded.reserve(m_slices.size());
+    int recompiled = 0;
+
+    for (int i = 0; i < m_slices.size(); ++i) {
+        const PromptSlice &slice = m_slices.at(i);
         PromptSlice copy = slice;
-        copy.content = expandIncludesOnce(slice.content);
+
+        auto cached = m_expandedCache.constFind(i);
+        if (cached != m_expandedCache.constEnd()
+            && isExpandedEntryValid(*cached, slice.content, cacheBaseFolder, store)) {
+            copy.content = cached->expanded;
+        } else {
+            ExpandedSliceEntry entry;
+            entry.contentHash = qHash(slice.content);
+            entry.content = slice.content;
+            entry.expanded = expandIncludesOnce(slice.content, cacheBaseFolder, store, &entry.dependencies);
+            copy.content = entry.expanded;
+            m_expandedCache.insert(i, entry);
+            ++recompiled;
+        }
+
         expanded.append(copy);
     }
+
+    qDebug() << "[Session::expandedSlices] Recompiled" << recompiled << "of" << m_slices.size() << "slices";
     return expanded;
 }
 
+bool Session::isExpandedEntryValid(const ExpandedSliceEntry &entry, const QString &content,
+                                   const QString &cacheBaseFolder, const IncludeStore &store) const
+{
+    if (entry.contentHash != qHash(content) || entry.content != content)
+        return false;
+
+    // Stat, don't read: the manifest may point elsewhere now, or the cached file may have been rewritten
+    for (const ExpandedSliceEntry::Dependency &dep : entry.dependencies) {
+        if (resolveCachedInclude(dep.relPath, cacheBaseFolder, store) != dep.resolvedPath)
+            return false;
+
+        QFileInfo fi(dep.resolvedPath);
+        if (fi.exists() != dep.exists)
+            return false;
+        if (dep.exists && (fi.lastModified().toMSecsSinceEpoch() != dep.mtime || fi.size() != dep.size))
+            return false;
+    }
+
+    return true;
+}
+
 QVariantMap Session::headerMetadata() const
 {
     return m_metadata;
@@ -552,6 +1266,35 @@ void Session::setHeaderMetadata(const QVariantMap &metadata)
     m_metadata = metadata;
 }
 
+QVariantMap Session::storedResponse() const
+{
+    QFile file(QDir(sessionCacheBaseFolder()).filePath("response.json"));
+    if (file.open(QIODevice::ReadOnly))
+        return QJsonDocument::fromJson(file.readAll()).object().toVariantMap();
+
+    // Sessions from before the sidecar kept the stored response in the header
+    QVariantMap response;
+    for (const char *key : {"response_id", "response_messages", "response_digest"}) {
+        if (m_metadata.contains(key))
+            response[key] = m_metadata.value(key);
+    }
+    return response;
+}
+
+bool Session::setStoredResponse(const QVariantMap &response)
+{
+    for (const char *key : {"response_id", "response_messages", "response_digest"})
+        m_metadata.remove(key);
+
+    QSaveFile file(QDir(sessionCacheBaseFolder()).filePath("response.json"));
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "[Session::setStoredResponse] Failed to open for writing:" << file.fileName();
+        return false;
+    }
+    file.write(QJsonDocument(QJsonObject::fromVariantMap(response)).toJson(QJsonDocument::Indented));
+    return file.commit();
+}
+
 QString Session::headerTitle() const
 {
     return m_metadata.value("title").toString();
@@ -574,41 +1317,88 @@ void Session::setHeaderDescription(const QString &description)
 
 QString Session::expandIncludesOnce(const QString &content) const
 {
-    static const QRegularExpression cachedMarkerRe(R"(<!--\s*cached:\s*(.*?)\s*-->)", QRegularExpression::CaseInsensitiveOption);
-
-    QString result = content;
-    int offset = 0;
-
-    while (true) {
-        QRegularExpressionMatch m = cachedMarkerRe.match(result, offset);
-        if (!m.hasMatch())
-            break;
+    // Resolve the cache folder once, not once per marker
+    return expandIncludesOnce(content, sessionCacheBaseFolder(), IncludeStore(sessionFolder()), nullptr);
+}
 
-        QString includePath = m.captured(1).trimmed();
-        includePath = QDir::cleanPath(includePath);
+QString Session::expandIncludesOnce(const QString &content, const QString &cacheBaseFolder,
+                                    const IncludeStore &store,
+                                    QVector<ExpandedSliceEntry::Dependency> *dependencies) const
+{
+    // Stable layout: included files move to the front of the slice, least volatile first,
+    // so a changed diff no longer invalidates the server's prompt cache for the docs after it
+    const bool stable = stablePromptLayout();
+    QStringList hoisted[3];
+
+    QString result = PromptCompiler::compile(content, {QStringLiteral("cached")},
+        [&](const PromptCompiler::Segment &marker, QString &replacement) {
+            QString includePath = QDir::cleanPath(marker.argument);
+
+            // Resolve through the include store, or inside the session cache folder
+            QString absPath = resolveCachedInclude(includePath, cacheBaseFolder, store);
+
+            if (dependencies) {
+                // Record what was read so the expansion can be validated without reading it again
+                QFileInfo fi(absPath);
+                ExpandedSliceEntry::Dependency dep;
+                dep.relPath = includePath;
+                dep.resolvedPath = absPath;
+                dep.exists = fi.exists();
+                if (dep.exists) {
+                    dep.mtime = fi.lastModified().toMSecsSinceEpoch();
+                    dep.size = fi.size();
+                }
+                dependencies->append(dep);
+            }
 
-        // Resolve absolute path inside session cache folder (including folder prefix)
-        QString absPath = QDir(sessionCacheBaseFolder()).filePath(includePath);
+            QFile incFile(absPath);
+            if (incFile.open(QIODevice::ReadOnly | QIODevice::Text)) {
+                replacement = QString::fromUtf8(incFile.readAll());
+                incFile.close();
+            } else {
+                replacement = QString("[Could not read cached include file: %1]").arg(absPath);
+                qWarning() << "[expandIncludesOnce] Could not open cached include file:" << absPath;
+            }
 
-        QString includedContent;
-        QFile incFile(absPath);
-        if (incFile.open(QIODevice::ReadOnly | QIODevice::Text)) {
-            includedContent = incFile.readAll();
-            incFile.close();
-        } else {
-            includedContent = QString("[Could not read cached include file: %1]").arg(absPath);
-            qWarning() << "[expandIncludesOnce] Could not open cached include file:" << absPath;
-        }
+            if (stable) {
+                hoisted[int(includeVolatility(includePath))]
+                    << QString("--- begin %1 ---\n%2\n--- end %1 ---").arg(includePath, replacement);
+                replacement = QString("[%1, included above]").arg(includePath);
+            }
+            return true;
+        });
 
-        int start = m.capturedStart(0);
-        int length = m.capturedLength(0);
-        result.replace(start, length, includedContent);
-        offset = start + includedContent.length();
+    if (stable) {
+        const QStringList blocks = hoisted[0] + hoisted[1] + hoisted[2];
+        if (!blocks.isEmpty())
+            result = blocks.join("\n\n") + "\n\n" + result;
     }
 
     return result;
 }
 
+bool Session::stablePromptLayout() const
+{
+    return m_project && m_project->config().apiPromptLayout == QLatin1String("stable");
+}
+
+Session::IncludeVolatility Session::includeVolatility(const QString &relPath) const
+{
+    // Command pipe outputs (CommandPipeManager::outputPathFor) are new on every send; each turn has its own snapshot
+    if (relPath.startsWith(QLatin1String("pipes/")))
+        return IncludeVolatility::PerTurn;
+
+    // Source files and the source amalgamation change now and then; docs rarely
+    const QString srcPrefix = m_project ? QFileInfo(m_project->srcFolder()).fileName() : QStringLiteral("src");
+    if (relPath.startsWith(srcPrefix + "/"))
+        return IncludeVolatility::Source;
+    const QString suffix = QFileInfo(relPath).suffix().toLower();
+    if (suffix == "h" || suffix == "cpp" || suffix == "hpp" || suffix == "c" || suffix == "cc" || suffix == "ui")
+        return IncludeVolatility::Source;
+
+    return IncludeVolatility::Static;
+}
+
 QVector<PromptSlice>& Session::slices()
 {
     return m_slices;
@@ -693,10 +1483,11 @@ QString Session::sessionCacheFolder() const
 }
 
 
-bool Session::parseSessionFile(const QString &data)
+bool Session::parseSessionFile(const char *data, qsizetype size)
 {
     m_slices.clear();
     m_metadata.clear();
+    m_expandedCache.clear();
 
     auto roleStr = [](MessageRole role) -> QString {
         switch (role) {
@@ -707,29 +1498,37 @@ bool Session::parseSessionFile(const QString &data)
         }
     };
 
-    int pos = 0;
-    QString trimmedData = data.trimmed();
+    // Skip a UTF-8 byte order mark
+    if (size >= 3 && memcmp(data, "\xEF\xBB\xBF", 3) == 0) {
+        data += 3;
+        size -= 3;
+    }
+
+    // CR and CRLF line endings are rare; normalize them once so the scanner only deals with LF
+    QByteArray normalized;
+    if (memchr(data, '\r', size)) {
+        normalized = QByteArray(data, size);
+        normalized.replace("\r\n", "\n");
+        normalized.replace('\r', '\n');
+        data = normalized.constData();
+        size = normalized.size();
+    }
+
+    const char *const end = data + size;
+    const char *pos = data;
 
     // Parse optional YAML-like metadata block at the top
-    if (trimmedData.startsWith("---")) {
-        int metaStart = data.indexOf("---", pos);
-        if (metaStart == -1)
-            return false; // malformed
-
-        int metaEnd = data.indexOf("\n---", metaStart + 3);
-        if (metaEnd == -1)
-            metaEnd = data.indexOf("\r\n---", metaStart + 3);
-        if (metaEnd == -1) {
-            QRegularExpression metaEndRe(R"(^---\s*$)", QRegularExpression::MultilineOption);
-            QRegularExpressionMatch match = metaEndRe.match(data, metaStart + 3);
-            if (match.hasMatch())
-                metaEnd = match.capturedStart(0);
-        }
+    const char *firstText = data;
+    while (firstText < end && isAsciiSpace(*firstText))
+        ++firstText;
+
+    if (end - firstText >= 3 && memcmp(firstText, "---", 3) == 0) {
+        const QByteArray rest = QByteArray::fromRawData(firstText + 3, end - firstText - 3);
+        const qsizetype metaEndOffset = rest.indexOf("\n---");
 
-        if (metaEnd != -1) {
-            int metaContentStart = metaStart + 3;
-            int metaContentLength = metaEnd - metaContentStart;
-            QString metaBlock = data.mid(metaContentStart, metaContentLength).trimmed();
+        if (metaEndOffset != -1) {
+            const char *metaEnd = firstText + 3 + metaEndOffset;
+            QString metaBlock = QString::fromUtf8(firstText + 3, metaEnd - firstText - 3).trimmed();
 
             QTextStream metaStream(&metaBlock);
             while (!metaStream.atEnd()) {
@@ -752,73 +1551,74 @@ bool Session::parseSessionFile(const QString &data)
                 m_metadata.insert(key, value);
             }
 
-            pos = metaEnd + 4;
-            while (pos < data.length() && (data[pos] == '\n' || data[pos] == '\r')) {
+            pos = qMin(metaEnd + 4, end);
+            while (pos < end && *pos == '\n')
                 ++pos;
-            }
         }
     }
 
-    //QStringList lines = data.mid(pos).split(QRegularExpression("[\r\n]+"));
-    QStringList lines = data.mid(pos).split(QRegularExpression("\r\n|\n|\r"), Qt::KeepEmptyParts);
-
     QVector<PromptSlice> slices;
 
-    QString currentRole;
+    bool inSlice = false;
+    MessageRole currentRole = MessageRole::User;
     QString currentTimestamp;
-    QStringList currentContentLines;
-
-    static const QRegularExpression delimiterRe(
-        R"(^==\{\s*(System|User|Assistant)\s*(?:\|\s*([0-9]{4}-[0-9]{2}-[0-9]{2} [0-9]{2}:[0-9]{2}:[0-9]{2}))?\s*\}==\s*$)",
-        QRegularExpression::CaseInsensitiveOption);
+    const char *contentStart = nullptr;
 
-    auto addSlice = [&]() {
-        if (currentRole.isEmpty())
+    auto addSlice = [&](const char *contentEnd) {
+        if (!inSlice)
             return;
 
-        // Join content lines, trimming trailing empty lines
-        while (!currentContentLines.isEmpty() && currentContentLines.last().trimmed().isEmpty())
-            currentContentLines.removeLast();
+        // One UTF-8 decode per slice; trailing blank lines are dropped
+        QString content;
+        if (contentEnd > contentStart) {
+            content = QString::fromUtf8(contentStart, contentEnd - contentStart);
 
-        QString content = currentContentLines.join("\n");//.trimmed(); could be squishing my files together.
+            int last = content.size() - 1;
+            while (last >= 0 && content.at(last).isSpace())
+                --last;
+            if (last < 0) {
+                content.clear();
+            } else {
+                int lineEnd = content.indexOf('\n', last);
+                if (lineEnd != -1)
+                    content.truncate(lineEnd);
+            }
+        }
 
         if (currentTimestamp.isEmpty()) {
             currentTimestamp = QDateTime::currentDateTime().toString("yyyy-MM-dd HH:mm:ss");
         }
 
-        MessageRole role = MessageRole::User;
-        QString roleLower = currentRole.toLower();
-        if (roleLower == "system")
-            role = MessageRole::System;
-        else if (roleLower == "assistant")
-            role = MessageRole::Assistant;
-        else if (roleLower == "user")
-            role = MessageRole::User;
-
-        slices.append({role, content, currentTimestamp});
+        slices.append({currentRole, content, currentTimestamp});
 
-        currentRole.clear();
+        inSlice = false;
         currentTimestamp.clear();
-        currentContentLines.clear();
     };
 
-    for (const QString &line : lines) {
-        QRegularExpressionMatch delimMatch = delimiterRe.match(line.trimmed());
-        if (delimMatch.hasMatch()) {
-            // New slice delimiter found: save previous slice first
-            addSlice();
-
-            currentRole = delimMatch.captured(1);
-            currentTimestamp = delimMatch.captured(2);
-            continue; // delimiter line itself is not content
-        }
-
-        // Otherwise, accumulate content lines for current slice
-        currentContentLines.append(line);
+    // Single forward scan: one memchr per line, delimiter lines checked by hand
+    while (pos < end) {
+        const char *lineStart = pos;
+        const char *lineEnd = static_cast<const char *>(memchr(pos, '\n', end - pos));
+        if (!lineEnd)
+            lineEnd = end;
+        pos = lineEnd < end ? lineEnd + 1 : end;
+
+        MessageRole role;
+        QString timestamp;
+        if (!matchDelimiterLine(lineStart, lineEnd, role, timestamp))
+            continue; // content line, covered by the current slice's byte range
+
+        // New slice delimiter found: save previous slice first (content ends before this line's newline)
+        addSlice(lineStart > contentStart ? lineStart - 1 : lineStart);
+
+        inSlice = true;
+        currentRole = role;
+        currentTimestamp = timestamp;
+        contentStart = pos;
     }
 
     // Add last slice after loop ends
-    addSlice();
+    addSlice(end);
 
     if (slices.isEmpty()) {
         qWarning() << "No prompt slices found in session file.";
@@ -837,7 +1637,7 @@ bool Session::parseSessionFile(const QString &data)
     return true;
 }
 
-QString Session::serializeSessionFile() const
+QString Session::serializeHeader() const
 {
     QString result;
     if (!m_metadata.isEmpty()) {
@@ -852,25 +1652,34 @@ QString Session::serializeSessionFile() const
         }
         result += "---\n\n";
     }
+    return result;
+}
 
-    for (const PromptSlice &slice : m_slices) {
-        QString roleStr;
-        switch (slice.role) {
-        case MessageRole::User: roleStr = "User"; break;
-        case MessageRole::Assistant: roleStr = "Assistant"; break;
-        case MessageRole::System: roleStr = "System"; break;
-        }
-
-        QString timestampStr = slice.timestamp;
-        if (timestampStr.isEmpty()) {
-            timestampStr = QDateTime::currentDateTime().toString("yyyy-MM-dd HH:mm:ss");
-        }
+QString Session::serializeSliceBlock(const PromptSlice &slice)
+{
+    QString roleStr;
+    switch (slice.role) {
+    case MessageRole::User: roleStr = "User"; break;
+    case MessageRole::Assistant: roleStr = "Assistant"; break;
+    case MessageRole::System: roleStr = "System"; break;
+    }
 
-        result += QString("=={ %1 | %2 }==\n").arg(roleStr, timestampStr);
-        // Write content as top-level markdown, no fenced block
-        result += slice.content.trimmed() + "\n\n";
+    QString timestampStr = slice.timestamp;
+    if (timestampStr.isEmpty()) {
+        timestampStr = QDateTime::currentDateTime().toString("yyyy-MM-dd HH:mm:ss");
     }
 
+    // Write content as top-level markdown, no fenced block
+    return QString("=={ %1 | %2 }==\n").arg(roleStr, timestampStr) + slice.content.trimmed() + "\n\n";
+}
+
+QString Session::serializeSessionFile() const
+{
+    QString result = serializeHeader();
+
+    for (const PromptSlice &slice : m_slices)
+        result += serializeSliceBlock(slice);
+
     return result.trimmed() + "\n"; // Ensure trailing newline
 }
 
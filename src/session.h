@@ -4,9 +4,14 @@
 #include <QString>
 #include <QVector>
 #include <QMap>
+#include <QHash>
+#include <QCache>
 #include <QSet>
 #include <QVariantMap>
 #include <QDir>
+#include <QDateTime>
+
+#include <functional>
 
 #include "commandpipemanager.h"  // Add this include
 
@@ -26,7 +31,33 @@ struct PromptSlice {
         : role(r), content(c), timestamp(t) {}
 };
 
+// Manifest entry mapping a cached include path to an object in the project IncludeStore
+struct CachedInclude {
+    QString hash;       // content hash of the stored object
+    QString source;     // absolute source path the object was taken from
+    qint64 mtime = 0;   // source modification time (ms since epoch) when stored
+    qint64 size = 0;    // source size in bytes when stored
+};
+
+// In-memory expansion of one slice, valid while the slice text and every cached file it read are unchanged
+struct ExpandedSliceEntry {
+    struct Dependency {
+        QString relPath;        // cached include path as written in the marker
+        QString resolvedPath;   // file the marker resolved to when expanded
+        bool exists = false;
+        qint64 mtime = 0;       // ms since epoch
+        qint64 size = 0;
+    };
+
+    size_t contentHash = 0;
+    QString content;            // raw slice text the expansion was built from
+    QString expanded;
+    QVector<Dependency> dependencies;
+};
+
 class Project; // forward decl
+class IncludeStore;
+class Tokenizer;
 
 class Session : public QObject
 {
@@ -36,13 +67,44 @@ public:
     ~Session() override;
 
     bool load(const QString &filepath);
+
+    // Persist the session. Only new or changed trailing slices are appended to the file;
+    // the file is atomically rewritten when an earlier slice or the metadata changed.
     bool save(const QString &filepath = QString());
+
+    // Full atomic rewrite of the session file, regardless of what is already on disk
+    bool compact(const QString &filepath = QString());
+
+    // Saves issued between begin/end are deferred and written (and synced) once at the end
+    void beginSaveBatch();
+    bool endSaveBatch();
+
+    // Scoped save batch; ends on commit() or when it goes out of scope
+    class SaveBatch
+    {
+    public:
+        explicit SaveBatch(Session *session);
+        ~SaveBatch();
+        bool commit();
+
+    private:
+        Session *m_session;
+        bool m_committed = false;
+    };
+
+    // Copy included files into the session cache and rewrite their markers, in memory only
+    void refreshCache();
     bool refreshCacheAndSave();
     QString sessionCacheFolder() const;
 
 
-    // New method for running command pipes
-    bool runCommandPipes();
+    // Command pipes run asynchronously through commandPipeManager(); names of the pipes
+    // referenced by <!-- command: name --> markers, in order of first appearance
+    QStringList commandPipeNames() const;
+    // Replace the markers of pipes that succeeded with <!-- cached: --> markers of a snapshot of
+    // their output, stored in the IncludeStore under a per-slice path (e.g. "pipes/build@4.txt")
+    bool applyCommandPipeOutputs(const QStringList &succeeded);
+    CommandPipeManager* commandPipeManager() const { return m_commandPipeManager; }
 
     // Accessors
     QVector<PromptSlice>& slices();
@@ -56,6 +118,29 @@ public:
     QString promptSliceContent(int index) const;
     void setPromptSliceContent(int index, const QString &content);
 
+    // Alternative answers (strike variants, n > 1 choices) are stored as a run of consecutive
+    // assistant slices. Returns the [first, last] range of the run containing 'index'
+    // (first == last for a single answer), or false when 'index' is not an assistant slice.
+    bool alternativeRange(int index, int *first, int *last) const;
+    // Keep the alternative at 'index' and drop its siblings; returns the new index of the kept slice
+    int keepAlternative(int index);
+
+    // Contents of the cached file named by a <!-- predict: path --> marker in the last user
+    // slice, i.e. the expected answer of a whole-file rewrite; empty if there is none
+    QString predictedOutput(QString *relPathOut = nullptr) const;
+
+    // Token counts as the model sees the text, i.e. with cached includes expanded. Includes are
+    // counted once per stored object (content hash) and remembered by the tokenizer.
+    QVector<int> sliceTokenCounts(const Tokenizer &tokenizer) const;
+    // sliceTokenCounts() as a task for a worker thread; it works on a copy of the slices and the
+    // include manifest taken now, so the session may change (or go away) while it runs
+    std::function<QVector<int>()> sliceTokenCountTask(const Tokenizer &tokenizer) const;
+    int promptTokenCount(const QString &content, const Tokenizer &tokenizer) const;
+    // Tokens of the cached snapshot of an include path; -1 if it isn't cached in this session
+    int includeTokenCount(const QString &relPath, const Tokenizer &tokenizer) const;
+    // Contents of the cached snapshot of an include path, as expanded; null if it isn't cached
+    QString cachedIncludeContent(const QString &relPath) const;
+
     // Compile the prompt into a single markdown string expanded with recursive includes
     // Command pipe tokens (@diff etc.) remain as-is.
     QString compilePrompt();
@@ -79,6 +164,12 @@ public:
 
     QString headerDescription() const;
     void setHeaderDescription(const QString &description);
+
+    // Stored response the conversation continues from (api endpoint "responses"): "response_id",
+    // "response_messages" and "response_digest". Kept in <session cache>/response.json, not in
+    // the header, so that a new answer does not force a rewrite of the whole session file.
+    QVariantMap storedResponse() const;
+    bool setStoredResponse(const QVariantMap &response);
 private:
     QString m_filepath;
     Project* m_project; // used for base folder path to resolve includes
@@ -86,8 +177,32 @@ private:
     QVector<PromptSlice> m_slices;
     QMap<QString, QString> m_commandPipeOutputs;
 
-    bool parseSessionFile(const QString &data);
+    // Parses raw UTF-8 session file bytes (typically a memory-mapped file)
+    bool parseSessionFile(const char *data, qsizetype size);
     QString serializeSessionFile() const;
+    QString serializeHeader() const;
+    static QString serializeSliceBlock(const PromptSlice &slice);
+
+    // What the session file on disk currently holds, so saves can append instead of rewriting
+    struct Journal {
+        QString path;
+        QString header;
+        QVector<PromptSlice> slices;
+        QVector<qint64> offsets;    // byte offset of each slice block in the file
+        qint64 size = -1;           // file size after the last write; -1 = unknown, rewrite
+        QDateTime modified;
+    };
+    Journal m_journal;
+    int m_saveBatchDepth = 0;
+    bool m_saveDeferred = false;
+    QString m_deferredSavePath;
+
+    bool writeSessionFile(const QString &savePath);
+    bool rewriteSessionFile(const QString &savePath);
+    bool appendSessionTail(const QString &savePath, int firstChanged);
+    static bool writeTail(const QString &savePath, qint64 offset, const QByteArray &tail);
+    static bool replayTailJournal(const QString &savePath);
+    bool journalMatchesFile(const QString &savePath) const;
 
     // Internal helper to recursively expand includes in content
     QString expandIncludesRecursive(const QString &content,
@@ -95,8 +210,32 @@ private:
                                     bool expandIncludeMarkers = true);
 
     QString expandIncludesOnce(const QString &content) const;
+    QString expandIncludesOnce(const QString &content, const QString &cacheBaseFolder,
+                               const IncludeStore &store,
+                               QVector<ExpandedSliceEntry::Dependency> *dependencies) const;
+
+    // Expanded slices keyed by slice index; only stale entries are recompiled
+    mutable QHash<int, ExpandedSliceEntry> m_expandedCache;
+    mutable bool m_expandedStableLayout = false;    // prompt layout m_expandedCache was built with
+    bool isExpandedEntryValid(const ExpandedSliceEntry &entry, const QString &content,
+                              const QString &cacheBaseFolder, const IncludeStore &store) const;
 
     QString cacheIncludesInContent(const QString& content);
+
+    // Project prompt layout "stable": order included content by volatility (see expandIncludesOnce)
+    enum class IncludeVolatility { Static = 0, Source = 1, PerTurn = 2 };
+    bool stablePromptLayout() const;
+    IncludeVolatility includeVolatility(const QString &relPath) const;
+
+    // Cached include manifest (<session cache>/includes.json) resolving through the IncludeStore
+    QMap<QString, CachedInclude> m_includeManifest;
+    // Snapshot texts read by cachedIncludeContent(), keyed like the tokenizer's include counts
+    mutable QCache<QString, QString> m_includeContentCache;
+    void loadIncludeManifest();
+    bool saveIncludeManifest() const;
+    QString resolveCachedInclude(const QString &relPath, const QString &cacheBaseFolder,
+                                 const IncludeStore &store) const;
+
     QString sessionFolder() const;
     QString sessionDocCacheFolder() const;
     QString sessionSrcCacheFolder() const;
@@ -0,0 +1,422 @@
+#include "sessionindex.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QDataStream>
+#include <QFileSystemWatcher>
+#include <QTimer>
+#include <QRegularExpression>
+#include <QtConcurrent/QtConcurrentMap>
+#include <QSet>
+#include <QDebug>
+
+namespace {
+
+const quint32 kIndexMagic = 0x564B5349; // "VKSI"
+const quint32 kIndexVersion = 2;        // 2: QDataStream::Qt_5_15 encoding, readable by Qt5 builds
+
+const QStringList kSessionFilters{QStringLiteral("*.md"), QStringLiteral("*.markdown")};
+
+// Indexes that notifySaved() forwards to
+QList<SessionIndex *> &liveIndexes()
+{
+    static QList<SessionIndex *> indexes;
+    return indexes;
+}
+
+QString unquote(QString value)
+{
+    value = value.trimmed();
+    if ((value.startsWith('"') && value.endsWith('"')) || (value.startsWith('\'') && value.endsWith('\'')))
+        value = value.mid(1, value.length() - 2);
+    return value;
+}
+
+} // namespace
+
+SessionIndex::SessionIndex(QObject *parent)
+    : QObject(parent)
+    , m_watcher(new QFileSystemWatcher(this))
+    , m_changeTimer(new QTimer(this))
+{
+    // Saving a session touches the file several times; refresh it once
+    m_changeTimer->setSingleShot(true);
+    m_changeTimer->setInterval(250);
+    connect(m_changeTimer, &QTimer::timeout, this, &SessionIndex::refreshChangedFiles);
+
+    connect(m_watcher, &QFileSystemWatcher::directoryChanged, this, &SessionIndex::onFolderChanged);
+
+    // Parsed entries are handed out in batches rather than one signal per file
+    m_batchTimer = new QTimer(this);
+    m_batchTimer->setSingleShot(true);
+    m_batchTimer->setInterval(50);
+    connect(m_batchTimer, &QTimer::timeout, this, &SessionIndex::flushScanBatch);
+
+    m_scanWatcher = new QFutureWatcher<Entry>(this);
+    connect(m_scanWatcher, &QFutureWatcher<Entry>::resultsReadyAt, this, &SessionIndex::onScanResultsReady);
+    connect(m_scanWatcher, &QFutureWatcher<Entry>::finished, this, &SessionIndex::onScanFinished);
+
+    m_refreshWatcher = new QFutureWatcher<Entry>(this);
+    connect(m_refreshWatcher, &QFutureWatcher<Entry>::finished, this, &SessionIndex::onRefreshFinished);
+
+    liveIndexes().append(this);
+}
+
+SessionIndex::~SessionIndex()
+{
+    liveIndexes().removeAll(this);
+}
+
+void SessionIndex::notifySaved(const QString &filePath)
+{
+    const QFileInfo fi(filePath);
+    const QString folder = QDir::cleanPath(fi.absolutePath());
+    for (SessionIndex *index : std::as_const(liveIndexes())) {
+        if (index->m_folder == folder)
+            index->queueChangedFile(fi.absoluteFilePath());
+    }
+}
+
+void SessionIndex::setFolder(const QString &sessionsFolder)
+{
+    const QString folder = QDir::cleanPath(sessionsFolder);
+    if (folder == m_folder)
+        return;
+
+    if (!m_watcher->directories().isEmpty())
+        m_watcher->removePaths(m_watcher->directories());
+
+    cancel();
+
+    m_folder = folder;
+    m_entries.clear();
+
+    if (m_folder.isEmpty() || !QDir(m_folder).exists())
+        return;
+
+    loadIndex();
+    m_watcher->addPath(m_folder);
+}
+
+void SessionIndex::update()
+{
+    cancel();
+
+    QDir sessionsDir(m_folder);
+    if (m_folder.isEmpty() || !sessionsDir.exists())
+        return;
+
+    m_scanTimer.start();
+    m_scanEntries.clear();
+    m_scanParsed = 0;
+    m_scanParsedBytes = 0;
+
+    const QFileInfoList files = sessionsDir.entryInfoList(kSessionFilters, QDir::Files, QDir::Name);
+
+    QVector<Entry> upToDate;
+    QVector<Entry> stale;
+
+    for (const QFileInfo &fi : files) {
+        Entry stub;
+        stub.fileName = fi.fileName();
+        stub.filePath = fi.absoluteFilePath();
+        stub.mtime = fi.lastModified().toMSecsSinceEpoch();
+        stub.size = fi.size();
+
+        auto existing = m_entries.constFind(stub.fileName);
+        if (existing != m_entries.constEnd() && existing->mtime == stub.mtime && existing->size == stub.size) {
+            Entry entry = *existing;
+            entry.filePath = stub.filePath;
+            upToDate.append(entry);
+            m_scanEntries.insert(entry.fileName, entry);
+        } else {
+            stale.append(stub);
+            m_scanParsedBytes += stub.size;
+        }
+    }
+
+    if (!upToDate.isEmpty())
+        emit entriesReady(upToDate);
+
+    if (stale.isEmpty()) {
+        completeScan();
+        return;
+    }
+
+    m_scanParsed = stale.size();
+    m_scanWatcher->setFuture(QtConcurrent::mapped(stale, &SessionIndex::parseSessionFile));
+}
+
+void SessionIndex::cancel()
+{
+    if (m_scanWatcher->isRunning()) {
+        qDebug() << "[SessionIndex::cancel] Cancelling session scan in progress";
+        m_scanWatcher->cancel();
+    }
+    // A full update covers whatever single files were waiting to be refreshed
+    m_refreshWatcher->cancel();
+    m_changeTimer->stop();
+    m_changedFiles.clear();
+    m_folderChanged = false;
+    // Drop anything the cancelled scan still had queued; its pending signals are discarded on setFuture
+    m_batchTimer->stop();
+    m_scanBatch.clear();
+}
+
+void SessionIndex::onScanResultsReady(int begin, int end)
+{
+    for (int i = begin; i < end; ++i) {
+        const Entry entry = m_scanWatcher->resultAt(i);
+        m_scanEntries.insert(entry.fileName, entry);
+        m_scanBatch.append(entry);
+    }
+
+    if (!m_batchTimer->isActive())
+        m_batchTimer->start();
+}
+
+void SessionIndex::flushScanBatch()
+{
+    if (m_scanBatch.isEmpty())
+        return;
+
+    QVector<Entry> batch;
+    batch.swap(m_scanBatch);
+    emit entriesReady(batch);
+}
+
+void SessionIndex::onScanFinished()
+{
+    if (m_scanWatcher->isCanceled())
+        return;
+
+    completeScan();
+}
+
+void SessionIndex::completeScan()
+{
+    m_batchTimer->stop();
+    flushScanBatch();
+
+    const bool changed = m_scanParsed > 0 || m_scanEntries.size() != m_entries.size();
+    m_entries = m_scanEntries;
+    m_scanEntries.clear();
+
+    if (changed && !saveIndex())
+        qWarning() << "[SessionIndex::update] Failed to save session index in" << m_folder;
+
+    const qint64 elapsed = m_scanTimer.elapsed();
+    qDebug() << "[SessionIndex::update]" << m_entries.size() << "sessions," << m_scanParsed << "re-parsed ("
+             << m_scanParsedBytes << "bytes) in" << elapsed << "ms";
+
+    emit updateFinished(m_entries.size(), m_scanParsed, m_scanParsedBytes, elapsed);
+
+    // Saves reported while scanning may not be in what the workers read
+    if (m_folderChanged || !m_changedFiles.isEmpty())
+        m_changeTimer->start();
+}
+
+void SessionIndex::queueChangedFile(const QString &filePath)
+{
+    if (!QDir::match(kSessionFilters, QFileInfo(filePath).fileName()))
+        return;
+    m_changedFiles.insert(filePath);
+    m_changeTimer->start();
+}
+
+void SessionIndex::onFolderChanged()
+{
+    m_folderChanged = true;
+    m_changeTimer->start();
+}
+
+void SessionIndex::refreshChangedFiles()
+{
+    // A full update or a refresh in progress picks the pending changes up when it completes
+    if (m_folder.isEmpty() || m_scanWatcher->isRunning() || m_refreshWatcher->isRunning())
+        return;
+
+    const QDir sessionsDir(m_folder);
+    QStringList removed;
+
+    if (m_folderChanged) {
+        m_folderChanged = false;
+
+        // Files added, removed or renamed over; only the names are compared here, the
+        // changed files are told apart by mtime and size below
+        const QStringList names = sessionsDir.entryList(kSessionFilters, QDir::Files);
+        const QSet<QString> present(names.begin(), names.end());
+        for (auto it = m_entries.begin(); it != m_entries.end();) {
+            if (present.contains(it.key())) {
+                ++it;
+                continue;
+            }
+            removed.append(sessionsDir.filePath(it.key()));
+            it = m_entries.erase(it);
+        }
+        for (const QString &name : names)
+            m_changedFiles.insert(sessionsDir.filePath(name));
+    }
+
+    QVector<Entry> stale;
+    for (const QString &path : std::as_const(m_changedFiles)) {
+        const QFileInfo fi(path);
+        if (QDir::cleanPath(fi.absolutePath()) != m_folder)
+            continue;
+        if (!fi.isFile()) {
+            if (m_entries.remove(fi.fileName()) > 0)
+                removed.append(fi.absoluteFilePath());
+            continue;
+        }
+
+        Entry stub;
+        stub.fileName = fi.fileName();
+        stub.filePath = fi.absoluteFilePath();
+        stub.mtime = fi.lastModified().toMSecsSinceEpoch();
+        stub.size = fi.size();
+
+        auto existing = m_entries.constFind(stub.fileName);
+        if (existing != m_entries.constEnd() && existing->mtime == stub.mtime && existing->size == stub.size)
+            continue;
+        stale.append(stub);
+    }
+    m_changedFiles.clear();
+
+    if (!removed.isEmpty()) {
+        if (!saveIndex())
+            qWarning() << "[SessionIndex::refreshChangedFiles] Failed to save session index in" << m_folder;
+        emit entriesRemoved(removed);
+    }
+
+    if (!stale.isEmpty()) {
+        qDebug() << "[SessionIndex::refreshChangedFiles] Re-parsing" << stale.size() << "changed session file(s)";
+        m_refreshWatcher->setFuture(QtConcurrent::mapped(stale, &SessionIndex::parseSessionFile));
+    }
+}
+
+void SessionIndex::onRefreshFinished()
+{
+    if (m_refreshWatcher->isCanceled())
+        return;
+
+    QVector<Entry> entries;
+    const QList<Entry> results = m_refreshWatcher->future().results();
+    for (const Entry &entry : results) {
+        m_entries.insert(entry.fileName, entry);
+        entries.append(entry);
+    }
+
+    if (!saveIndex())
+        qWarning() << "[SessionIndex::onRefreshFinished] Failed to save session index in" << m_folder;
+    emit entriesChanged(entries);
+
+    if (m_folderChanged || !m_changedFiles.isEmpty())
+        m_changeTimer->start();
+}
+
+// Runs on a worker thread: touches nothing but its own entry
+SessionIndex::Entry SessionIndex::parseSessionFile(const Entry &stub)
+{
+    Entry entry = stub;
+
+    QFile file(entry.filePath);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+        return entry;
+
+    const QString content = QString::fromUtf8(file.readAll());
+    file.close();
+
+    static const QRegularExpression delimiterRe(
+        R"(^==\{\s*(System|User|Assistant)\s*(?:\|\s*([0-9]{4}-[0-9]{2}-[0-9]{2} [0-9]{2}:[0-9]{2}:[0-9]{2}))?\s*\}==\s*$)",
+        QRegularExpression::MultilineOption | QRegularExpression::CaseInsensitiveOption);
+    static const QRegularExpression yamlRe(R"(^---\s*\n(.*?)\n---\s*\n)", QRegularExpression::DotMatchesEverythingOption);
+    static const QRegularExpression titleRe(R"(^title:\s*(.*)$)", QRegularExpression::MultilineOption);
+    static const QRegularExpression descRe(R"(^description:\s*(.*)$)", QRegularExpression::MultilineOption);
+
+    QRegularExpressionMatchIterator it = delimiterRe.globalMatch(content);
+    while (it.hasNext()) {
+        QRegularExpressionMatch match = it.next();
+        ++entry.sliceCount;
+
+        QString tsStr = match.captured(2);
+        if (!tsStr.isEmpty()) {
+            QDateTime ts = QDateTime::fromString(tsStr, "yyyy-MM-dd HH:mm:ss");
+            if (ts.isValid() && (entry.lastTimestamp.isNull() || ts > entry.lastTimestamp))
+                entry.lastTimestamp = ts;
+        }
+    }
+
+    QRegularExpressionMatch match = yamlRe.match(content);
+    if (match.hasMatch()) {
+        const QString yamlBlock = match.captured(1);
+
+        QRegularExpressionMatch titleMatch = titleRe.match(yamlBlock);
+        if (titleMatch.hasMatch())
+            entry.title = unquote(titleMatch.captured(1));
+
+        QRegularExpressionMatch descMatch = descRe.match(yamlBlock);
+        if (descMatch.hasMatch())
+            entry.description = unquote(descMatch.captured(1));
+    }
+
+    return entry;
+}
+
+bool SessionIndex::loadIndex()
+{
+    QFile file(QDir(m_folder).filePath(indexFileName()));
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_5_15);
+
+    quint32 magic = 0;
+    quint32 version = 0;
+    qint32 count = 0;
+    in >> magic >> version >> count;
+    if (magic != kIndexMagic || version != kIndexVersion || count < 0) {
+        qWarning() << "[SessionIndex::loadIndex] Ignoring incompatible index file:" << file.fileName();
+        return false;
+    }
+
+    QHash<QString, Entry> entries;
+    entries.reserve(count);
+    for (qint32 i = 0; i < count; ++i) {
+        Entry entry;
+        qint32 sliceCount = 0;
+        in >> entry.fileName >> entry.mtime >> entry.size >> sliceCount
+            >> entry.lastTimestamp >> entry.title >> entry.description;
+        entry.sliceCount = sliceCount;
+        entries.insert(entry.fileName, entry);
+    }
+
+    if (in.status() != QDataStream::Ok) {
+        qWarning() << "[SessionIndex::loadIndex] Corrupt index file, rebuilding:" << file.fileName();
+        return false;
+    }
+
+    m_entries = entries;
+    qDebug() << "[SessionIndex::loadIndex] Loaded" << m_entries.size() << "entries from" << file.fileName();
+    return true;
+}
+
+bool SessionIndex::saveIndex() const
+{
+    QSaveFile file(QDir(m_folder).filePath(indexFileName()));
+    if (!file.open(QIODevice::WriteOnly))
+        return false;
+
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_5_15);
+
+    out << kIndexMagic << kIndexVersion << qint32(m_entries.size());
+    for (const Entry &entry : m_entries) {
+        out << entry.fileName << entry.mtime << entry.size << qint32(entry.sliceCount)
+            << entry.lastTimestamp << entry.title << entry.description;
+    }
+
+    return out.status() == QDataStream::Ok && file.commit();
+}
@@ -0,0 +1,110 @@
+#ifndef SESSIONINDEX_H
+#define SESSIONINDEX_H
+
+#pragma once
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QHash>
+#include <QSet>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QFutureWatcher>
+
+class QFileSystemWatcher;
+class QTimer;
+
+/**
+ * @brief Persistent summary index of the session files in a sessions folder.
+ *
+ * Slice count, last slice timestamp, title and description of every session
+ * are kept in a binary sidecar file (<sessions>/.sessionindex), keyed by file
+ * name, mtime and size. update() only re-parses files that are new or changed
+ * since they were indexed, on a QtConcurrent worker pool, and reports entries
+ * in batches as they become available.
+ *
+ * Afterwards the index follows changes file by file: Session reports its own
+ * saves through notifySaved(), and a QFileSystemWatcher on the folder (not on
+ * every file, which would run into inotify and descriptor limits) catches
+ * files added, removed or replaced by others. Only the affected entries are
+ * re-parsed and reported through entriesChanged()/entriesRemoved().
+ */
+class SessionIndex : public QObject
+{
+    Q_OBJECT
+public:
+    struct Entry {
+        QString fileName;
+        QString filePath;
+        qint64 mtime = 0;       // ms since epoch
+        qint64 size = 0;
+        int sliceCount = 0;
+        QDateTime lastTimestamp;
+        QString title;
+        QString description;
+    };
+
+    explicit SessionIndex(QObject *parent = nullptr);
+    ~SessionIndex() override;
+
+    // Switch to a sessions folder, loading its index file (no-op if unchanged)
+    void setFolder(const QString &sessionsFolder);
+    QString folder() const { return m_folder; }
+
+    // Bring the index up to date with the folder. Up-to-date entries are reported
+    // right away through entriesReady(), re-parsed ones in batches as workers finish.
+    // Starting a new update cancels one still in progress.
+    void update();
+    void cancel();
+    bool isScanning() const { return m_scanWatcher->isRunning(); }
+
+    static QString indexFileName() { return QStringLiteral(".sessionindex"); }
+
+    // A session file was written; every index of its folder refreshes its entry
+    static void notifySaved(const QString &filePath);
+
+signals:
+    void entriesReady(const QVector<SessionIndex::Entry> &entries);
+
+    // After an update: entries of files that were added or modified, and removed files (debounced)
+    void entriesChanged(const QVector<SessionIndex::Entry> &entries);
+    void entriesRemoved(const QStringList &filePaths);
+
+    // An update completed; parsed counts only the files that had to be re-read
+    void updateFinished(int totalFiles, int parsedFiles, qint64 parsedBytes, qint64 elapsedMs);
+
+private:
+    bool loadIndex();
+    bool saveIndex() const;
+    static Entry parseSessionFile(const Entry &stub);
+    void queueChangedFile(const QString &filePath);
+    void onFolderChanged();
+    void refreshChangedFiles();
+    void onRefreshFinished();
+    void onScanResultsReady(int begin, int end);
+    void flushScanBatch();
+    void onScanFinished();
+    void completeScan();
+
+    QString m_folder;
+    QHash<QString, Entry> m_entries;   // keyed by file name
+
+    QFileSystemWatcher *m_watcher = nullptr;
+    QTimer *m_changeTimer = nullptr;
+    bool m_folderChanged = false;       // directory listing must be compared with the index
+    QSet<QString> m_changedFiles;       // absolute paths to re-check
+    QFutureWatcher<Entry> *m_refreshWatcher = nullptr;
+
+    // State of the update in progress
+    QFutureWatcher<Entry> *m_scanWatcher = nullptr;
+    QTimer *m_batchTimer = nullptr;
+    QHash<QString, Entry> m_scanEntries;
+    QVector<Entry> m_scanBatch;
+    QElapsedTimer m_scanTimer;
+    int m_scanParsed = 0;
+    qint64 m_scanParsedBytes = 0;
+};
+
+#endif // SESSIONINDEX_H
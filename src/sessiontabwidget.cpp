@@ -1,6 +1,10 @@
 #include "sessiontabwidget.h"
 #include "appconfig.h"
 #include "descriptiongenerator.h"
+#include "openairesponsesbackend.h"
+#include "promptcompiler.h"
+#include "contextplanner.h"
+#include "tokenizer.h"
 
 #include <QVBoxLayout>
 #include <QHBoxLayout>
@@ -31,9 +35,14 @@
 #include <QJsonObject>
 #include <QJsonParseError>
 #include <QToolTip>
+#include <QHelpEvent>
+#include <QLocale>
+#include <QFutureWatcher>
+#include <QtConcurrent/QtConcurrentRun>
 
-SessionTabWidget::SessionTabWidget(const QString& sessionPath, Project* project, QWidget *parent, bool isTempSession, QStatusBar* statusBar)
+SessionTabWidget::SessionTabWidget(const QString& sessionPath, Project* project, AIBackend* aiBackend, QWidget *parent, bool isTempSession, QStatusBar* statusBar)
     : QWidget(parent)
+    , m_aiBackend(aiBackend)
     , m_sessionFilePath(sessionPath)
     , m_project(project)
     , m_session(project)
@@ -44,8 +53,7 @@ SessionTabWidget::SessionTabWidget(const QString& sessionPath, Project* project,
 {
     qDebug() << "[SessionTabWidget] Constructor for session:" << sessionPath << "Widget:" << this;
 
-    // Create OpenAIBackend instance
-    m_aiBackend = new OpenAIBackend(this);
+    Q_ASSERT(m_aiBackend);
 
     QVariantMap config;
 
@@ -57,7 +65,8 @@ SessionTabWidget::SessionTabWidget(const QString& sessionPath, Project* project,
         config["top_p"] = m_project->topP();
         config["frequency_penalty"] = m_project->frequencyPenalty();
         config["presence_penalty"] = m_project->presencePenalty();
-        qDebug() << "[SessionTabWidget] Loaded aiBackend config from Project config.";
+        config["endpoint"] = m_project->apiEndpoint();
+        qDebug() << "[SessionTabWidget] Loaded request params from Project config.";
 
     } else {
         QVariantMap appDefaults = AppConfig::instance().getConfigMap();
@@ -69,17 +78,33 @@ SessionTabWidget::SessionTabWidget(const QString& sessionPath, Project* project,
                 config = defaultProj;
             }
         }
-        qDebug() << "[SessionTabWidget] No Project found! Loaded aiBackend config from App Defaults";
+        qDebug() << "[SessionTabWidget] No Project found! Loaded request params from App Defaults";
 
     }
 
-    m_aiBackend->setConfig(config);
+    // The backend is shared, so this tab's settings travel with each request
+    m_backendParams = config;
 
-    // Connect AI backend signals
-    connect(m_aiBackend, &AIBackend::partialResponse, this, &SessionTabWidget::onPartialResponse);
+    // Connect AI backend signals (every tab sees every request; handlers filter by requestId)
+    connect(m_aiBackend, &AIBackend::choicePartialResponse, this, &SessionTabWidget::onChoicePartialResponse);
     connect(m_aiBackend, &AIBackend::finished, this, &SessionTabWidget::onFinished);
     connect(m_aiBackend, &AIBackend::errorOccurred, this, &SessionTabWidget::onErrorOccurred);
     connect(m_aiBackend, &AIBackend::statusChanged, this, &SessionTabWidget::onStatusChanged);
+    connect(m_aiBackend, &AIBackend::usageReported, this, &SessionTabWidget::onUsageReported);
+    connect(m_aiBackend, &AIBackend::servedFromCache, this, &SessionTabWidget::onServedFromCache);
+    connect(m_aiBackend, &AIBackend::responseStored, this, &SessionTabWidget::onResponseStored);
+
+    // Streamed deltas are coalesced and appended to the viewer at most once per display frame
+    m_streamFlushTimer = new QTimer(this);
+    m_streamFlushTimer->setSingleShot(true);
+    m_streamFlushTimer->setInterval(16);
+    m_streamFlushTimer->setTimerType(Qt::PreciseTimer);
+    connect(m_streamFlushTimer, &QTimer::timeout, this, &SessionTabWidget::flushPendingStream);
+
+    m_tokenCountTimer = new QTimer(this);
+    m_tokenCountTimer->setSingleShot(true);
+    m_tokenCountTimer->setInterval(300);
+    connect(m_tokenCountTimer, &QTimer::timeout, this, &SessionTabWidget::updateTokenBudget);
 
     // === UI setup ===
     // === New top button row above slice tree ===
@@ -125,7 +150,7 @@ SessionTabWidget::SessionTabWidget(const QString& sessionPath, Project* project,
     mainLayout->addWidget(mainSplitter);
 
     m_promptSliceTree = new QTreeWidget(mainSplitter);
-    m_promptSliceTree->setHeaderLabels({ "Timestamp", "Role", "Summary" });
+    m_promptSliceTree->setHeaderLabels({ "Timestamp", "Role", "Summary", "Tokens" });
     m_promptSliceTree->header()->setSectionResizeMode(QHeaderView::ResizeToContents);
     m_promptSliceTree->setContextMenuPolicy(Qt::CustomContextMenu);
     connect(m_promptSliceTree, &QWidget::customContextMenuRequested, this, [this](const QPoint &pos){
@@ -140,6 +165,15 @@ SessionTabWidget::SessionTabWidget(const QString& sessionPath, Project* project,
             connect(deleteAfterAction, &QAction::triggered, this, &SessionTabWidget::onDeleteAfterClicked);
         }
         m_promptSliceTree->setCurrentItem(item);
+
+        // Only offered on an assistant slice that has sibling alternatives
+        int first = 0;
+        int last = 0;
+        const int index = item->data(0, Qt::UserRole).toInt();
+        if (m_keepAlternativeAction) {
+            m_keepAlternativeAction->setEnabled(m_streams.isEmpty()
+                                                && m_session.alternativeRange(index, &first, &last) && first != last);
+        }
         m_contextMenu->exec(m_promptSliceTree->viewport()->mapToGlobal(pos));
     });
 
@@ -153,6 +187,9 @@ SessionTabWidget::SessionTabWidget(const QString& sessionPath, Project* project,
         // Add new action for saving slice as markdown
         QAction* saveSliceAsMarkdownAction = m_contextMenu->addAction("Export Slice");
         connect(saveSliceAsMarkdownAction, &QAction::triggered, this, &SessionTabWidget::onSaveSliceAsMarkdown);
+
+        m_keepAlternativeAction = m_contextMenu->addAction("Keep This Alternative");
+        connect(m_keepAlternativeAction, &QAction::triggered, this, &SessionTabWidget::onKeepAlternativeClicked);
     }
 
     // Bottom splitter for slice viewer and append user prompt
@@ -174,6 +211,13 @@ SessionTabWidget::SessionTabWidget(const QString& sessionPath, Project* project,
     auto bottomButtonLayout = new QHBoxLayout();
     m_sendButton = new QPushButton("Send All Slices", this);
     m_saveButton = new QPushButton("Save", this);
+    m_strikeButton = new QPushButton("Strike", this);
+    m_strikeButton->setToolTip("Send the prompt stack to every strike variant of the project at once");
+    m_choiceCountSpin = new QSpinBox(this);
+    m_choiceCountSpin->setRange(1, 8);
+    m_choiceCountSpin->setPrefix("Answers: ");
+    m_choiceCountSpin->setToolTip("Number of alternative answers per send. The prompt is processed once "
+                                  "and every answer becomes a sibling assistant slice.");
 
     // Edit tool button and space-reserver (initially hidden)
     m_editToolButton = new QToolButton(this);
@@ -198,9 +242,12 @@ SessionTabWidget::SessionTabWidget(const QString& sessionPath, Project* project,
     m_sendButton->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Preferred);
     // Save button minimum size only
     m_saveButton->setSizePolicy(QSizePolicy::Minimum, QSizePolicy::Preferred);
+    m_strikeButton->setSizePolicy(QSizePolicy::Minimum, QSizePolicy::Preferred);
     m_editToolButton->setSizePolicy(QSizePolicy::Minimum, QSizePolicy::Preferred);
 
     bottomButtonLayout->addWidget(m_sendButton);
+    bottomButtonLayout->addWidget(m_strikeButton);
+    bottomButtonLayout->addWidget(m_choiceCountSpin);
     bottomButtonLayout->addWidget(m_editSpacer);
     bottomButtonLayout->addWidget(m_editToolButton);
     bottomButtonLayout->addWidget(m_saveButton);
@@ -208,6 +255,11 @@ SessionTabWidget::SessionTabWidget(const QString& sessionPath, Project* project,
 
     // Connect bottom buttons
     connect(m_sendButton, &QPushButton::clicked, this, &SessionTabWidget::onSendClicked);
+    connect(m_strikeButton, &QPushButton::clicked, this, &SessionTabWidget::onStrikeClicked);
+
+    // The strike button follows the send button's enabled state
+    m_sendButton->installEventFilter(this);
+    updateStrikeButton();
     connect(m_saveButton, &QPushButton::clicked, this, &SessionTabWidget::onSaveClicked);
 
     // Connect slice tree selection
@@ -224,11 +276,17 @@ SessionTabWidget::SessionTabWidget(const QString& sessionPath, Project* project,
         // Enable Send button if non-empty
         bool hasText = !currentText.trimmed().isEmpty();
         m_sendButton->setEnabled(hasText);
+
+        m_tokenCountTimer->start();
     });
 
     // Install event filter for Shift+Enter send shortcut
     m_appendUserPrompt->installEventFilter(this);
 
+    // Hovering an include marker shows its token count
+    m_appendUserPrompt->viewport()->installEventFilter(this);
+    m_sliceViewer->viewport()->installEventFilter(this);
+
     // Load session file and build UI
     loadSession();
 }
@@ -308,6 +366,13 @@ void SessionTabWidget::saveHeaderMetadataFromUi()
 SessionTabWidget::~SessionTabWidget()
 {
     qDebug() << "[SessionTabWidget] Destructor for session:" << m_sessionFilePath << "Widget:" << this;
+
+    // The shared backend outlives this tab; don't leave its requests streaming into nothing
+    if (m_aiBackend) {
+        const QStringList requestIds = m_streams.keys();
+        for (const QString &requestId : requestIds)
+            m_aiBackend->cancelRequest(requestId);
+    }
 }
 
 
@@ -526,6 +591,9 @@ void SessionTabWidget::buildPromptSliceTree()
 
     const auto &slices = m_session.slices();
     qDebug() << "[buildPromptSliceTree] Total slices:" << slices.size();
+    // Counted on a worker; until then the tree and the budget show the previous counts
+    const int counted = qMin(int(m_sliceTokenCounts.size()), int(slices.size()));
+    m_sliceTokenCounts.resize(slices.size());
 
     for (int i = 0; i < slices.size(); ++i) {
         const PromptSlice &slice = slices[i];
@@ -538,6 +606,8 @@ void SessionTabWidget::buildPromptSliceTree()
         case MessageRole::System: item->setText(1, "System"); break;
         }
         item->setText(2, promptSliceSummary(slice));
+        item->setText(3, i < counted ? QLocale().toString(m_sliceTokenCounts.value(i)) : QString());
+        item->setTextAlignment(3, Qt::AlignRight | Qt::AlignVCenter);
     }
 
     // Optionally, select last slice by default after rebuild
@@ -549,6 +619,96 @@ void SessionTabWidget::buildPromptSliceTree()
     // Reset unsaved changes tracking since we just rebuilt UI from saved state
     m_unsavedChanges = false;
     m_saveButton->setEnabled(false);
+
+    updateTokenBudget();
+    countSliceTokens();
+}
+
+void SessionTabWidget::countSliceTokens()
+{
+    // Tokenizing a long session and its includes would stall the tab; a count started before the
+    // latest rebuild is out of date and dropped
+    auto *watcher = new QFutureWatcher<QVector<int>>(this);
+    const quint64 generation = ++m_sliceTokenCountGeneration;
+    connect(watcher, &QFutureWatcher<QVector<int>>::finished, this, [this, watcher, generation]() {
+        watcher->deleteLater();
+        if (generation != m_sliceTokenCountGeneration)
+            return;
+
+        m_sliceTokenCounts = watcher->result();
+        QLocale locale;
+        for (int i = 0; i < m_promptSliceTree->topLevelItemCount(); ++i)
+            m_promptSliceTree->topLevelItem(i)->setText(3, locale.toString(m_sliceTokenCounts.value(i)));
+        updateTokenBudget();
+    });
+
+    watcher->setFuture(QtConcurrent::run(m_session.sliceTokenCountTask(tokenizer())));
+}
+
+const Tokenizer &SessionTabWidget::tokenizer() const
+{
+    return Tokenizer::forModel(m_project ? m_project->model() : QString());
+}
+
+void SessionTabWidget::updateTokenBudget()
+{
+    m_tokenCountTimer->stop();
+    if (m_runningCommandPipes)
+        return;
+
+    // What the next send uploads: the slices, with the last user slice replaced by the editor text
+    const auto &slices = m_session.slices();
+    int sliceCount = slices.size();
+    if (sliceCount > 0 && slices.last().role == MessageRole::User)
+        --sliceCount;
+
+    qint64 promptTokens = Tokenizer::kReplyPrimingTokens;
+    for (int i = 0; i < sliceCount; ++i)
+        promptTokens += m_sliceTokenCounts.value(i) + Tokenizer::kTokensPerMessage;
+    const QString prompt = m_appendUserPrompt->toPlainText();
+    if (!prompt.trimmed().isEmpty())
+        promptTokens += m_session.promptTokenCount(prompt.trimmed(), tokenizer()) + Tokenizer::kTokensPerMessage;
+
+    const QString model = m_project ? m_project->model() : QString();
+    const int contextWindow = Tokenizer::contextWindow(model);
+    const int maxTokens = m_project ? m_project->maxTokens() : 0;
+    const qint64 overflow = promptTokens + maxTokens - contextWindow;
+
+    QLocale locale;
+    m_sendButton->setText(QString("Send All Slices (%1 / %2 tokens)")
+                              .arg(locale.toString(promptTokens), locale.toString(contextWindow)));
+
+    QStringList tip;
+    tip << QString("Prompt: %1 tokens").arg(locale.toString(promptTokens));
+    tip << QString("Reserved for the answer (max tokens): %1").arg(locale.toString(maxTokens));
+    tip << QString("Context window of %1: %2 tokens").arg(model, locale.toString(contextWindow));
+    if (overflow > 0)
+        tip << QString("The prompt and answer exceed the context window by %1 tokens.").arg(locale.toString(overflow));
+    if (!tokenizer().isExact())
+        tip << QString("Estimated at 4 bytes per token: %1 was not found.").arg(Tokenizer::rankFileName(tokenizer().encoding()));
+    m_sendButton->setToolTip(tip.join('\n'));
+    m_sendButton->setStyleSheet(overflow > 0 ? "color: #c00000;" : QString());
+}
+
+QString SessionTabWidget::includeTokenToolTip(const QTextCursor &cursor) const
+{
+    const QString text = cursor.block().text();
+    const int position = cursor.positionInBlock();
+
+    const QVector<PromptCompiler::Segment> segments =
+        PromptCompiler::tokenize(text, {QStringLiteral("cached"), QStringLiteral("include")});
+    for (const PromptCompiler::Segment &segment : segments) {
+        if (segment.type != PromptCompiler::Segment::Marker
+            || position < segment.start || position >= segment.start + segment.length)
+            continue;
+
+        const int tokens = m_session.includeTokenCount(segment.argument, tokenizer());
+        if (tokens < 0)
+            return QString("%1: not cached in this session yet").arg(segment.argument);
+        return QString("%1: %2 tokens%3").arg(segment.argument, QLocale().toString(tokens),
+                                              tokenizer().isExact() ? QString() : QStringLiteral(" (estimated)"));
+    }
+    return QString();
 }
 
 QString SessionTabWidget::promptSliceSummary(const PromptSlice &slice) const
@@ -612,7 +772,18 @@ void SessionTabWidget::updateUiForSelectedSlice(int selectedIndex)
     const PromptSlice &lastSlice = slices[lastIndex];
 
     m_updatingEditor = true;
-    m_partialResponseBuffer.clear();
+
+    // The viewer is repopulated from scratch below; anything not yet flushed is part of the buffer
+    const ResponseStream::Choice *selectedChoice = nullptr;
+    for (auto it = m_streams.begin(); it != m_streams.end(); ++it) {
+        for (ResponseStream::Choice &choice : it->choices) {
+            choice.pending.clear();
+            if (choice.sliceIndex == selectedIndex)
+                selectedChoice = &choice;
+        }
+    }
+    // While streaming, the slice content is only committed when its stream ends
+    const QString &selectedContent = selectedChoice ? selectedChoice->buffer : selectedSlice.content;
 
     // Save current user input if m_appendUserPrompt is visible and enabled before changing UI
     if (m_appendUserPrompt->isVisible() && m_appendUserPrompt->isEnabled()) {
@@ -673,7 +844,7 @@ void SessionTabWidget::updateUiForSelectedSlice(int selectedIndex)
             // Last slice is assistant-role: split view with m_sliceViewer and m_appendUserPrompt
             m_sliceViewer->show();
             m_sliceViewer->setEnabled(true);
-            m_sliceViewer->setPlainText(selectedSlice.content);
+            m_sliceViewer->setPlainText(selectedContent);
 
             m_appendUserPrompt->show();
             m_appendUserPrompt->setEnabled(true);
@@ -724,7 +895,7 @@ void SessionTabWidget::updateUiForSelectedSlice(int selectedIndex)
         // Any other slice selected: show m_sliceViewer read-only, hide m_appendUserPrompt
         m_sliceViewer->show();
         m_sliceViewer->setEnabled(true);
-        m_sliceViewer->setPlainText(selectedSlice.content);
+        m_sliceViewer->setPlainText(selectedContent);
 
         // Save current user input before hiding
         if (m_appendUserPrompt->isVisible() && m_appendUserPrompt->isEnabled()) {
@@ -816,8 +987,9 @@ void SessionTabWidget::onSaveClicked()
         }
     }
 
-    // Save the entire session slices, including any deletions already applied
-    if (!m_session.save(m_sessionFilePath)) {
+    // Save the entire session slices, including any deletions already applied.
+    // An explicit save also compacts the file with a full atomic rewrite.
+    if (!m_session.compact(m_sessionFilePath)) {
         QMessageBox::warning(this, "Save Failed", "Failed to save session file.");
         return;
     }
@@ -845,12 +1017,40 @@ void SessionTabWidget::onSaveClicked()
 
 void SessionTabWidget::onSendClicked()
 {
+    sendSession(false);
+}
+
+void SessionTabWidget::onStrikeClicked()
+{
+    sendSession(true);
+}
+
+void SessionTabWidget::sendSession(bool strike)
+{
+    // While command pipes run, the send button cancels them
+    if (m_runningCommandPipes) {
+        if (CommandPipeManager *pipes = m_session.commandPipeManager())
+            pipes->cancel();
+        return;
+    }
+
+    // Read by sendPreparedSession(), possibly after the command pipes finished
+    m_strikeRequested = strike;
+
     QString newPrompt = m_appendUserPrompt->toPlainText().trimmed();
     if (newPrompt.isEmpty()) {
         qDebug() << "[onSendClicked] Empty prompt, ignoring send.";
         return;
     }
 
+    if (!m_streams.isEmpty()) {
+        QMessageBox::information(this, "Send", "Wait for the current response to finish before sending again.");
+        return;
+    }
+
+    // Saves up to the assistant slices are deferred and written once, also across command pipes
+    m_sendSaveBatch = std::make_unique<Session::SaveBatch>(&m_session);
+
     auto &slices = m_session.slices();
     int lastIndex = slices.size() - 1;
 
@@ -865,6 +1065,7 @@ void SessionTabWidget::onSendClicked()
 
     // Save session after updating or appending user slice
     if (!m_session.save(m_sessionFilePath)) {
+        m_sendSaveBatch.reset();
         QMessageBox::warning(this, "Error", "Failed to save session after adding prompt.");
         return;
     }
@@ -873,59 +1074,134 @@ void SessionTabWidget::onSendClicked()
     m_lastSavedUserPromptText = newPrompt;
     markUnsavedChanges(false);
 
-    // Run command pipes and refresh cache
-    if (!m_session.runCommandPipes()) {
-        QMessageBox::warning(this, "Error", "Failed to run command pipes in session.");
-        return;
-    }
-    if (!m_session.refreshCacheAndSave()) {
-        QMessageBox::warning(this, "Error", "Failed to cache includes in session after running command pipes.");
+    // Command pipes (builds, diffs, ...) can take a while: run them without blocking the UI
+    // and continue in onCommandPipesFinished()
+    const QStringList pipeNames = m_session.commandPipeNames();
+    CommandPipeManager *pipes = m_session.commandPipeManager();
+    if (!pipeNames.isEmpty() && pipes) {
+        connect(pipes, &CommandPipeManager::progress, this, &SessionTabWidget::onCommandPipeProgress, Qt::UniqueConnection);
+        connect(pipes, &CommandPipeManager::finished, this, &SessionTabWidget::onCommandPipesFinished, Qt::UniqueConnection);
+
+        m_runningCommandPipes = true;
+        m_appendUserPrompt->setReadOnly(true);
+        m_sendButton->setText("Cancel Command Pipes");
+        m_sendButton->setEnabled(true);
+        updateStrikeButton();
+
+        pipes->runPipes(pipeNames);
         return;
     }
 
-    // Clear input after saving
-    m_appendUserPrompt->clear();
-
-    buildPromptSliceTree();
+    sendPreparedSession();
+}
 
-    // Append empty assistant slice for streaming response
-    m_session.appendAssistantSlice(QString());
+void SessionTabWidget::onCommandPipeProgress(int finishedCount, int totalCount)
+{
+    if (m_statusBar) {
+        m_statusBar->showMessage(QString("Running command pipes (%1/%2)...").arg(finishedCount).arg(totalCount));
+    }
+}
 
-    if (!m_session.save(m_sessionFilePath)) {
-        QMessageBox::warning(this, "Error", "Failed to save session after adding assistant slice.");
+void SessionTabWidget::onCommandPipesFinished(const QStringList &succeeded, const QMap<QString, QString> &errors,
+                                              bool cancelled)
+{
+    m_runningCommandPipes = false;
+    m_appendUserPrompt->setReadOnly(false);
+    m_sendButton->setEnabled(!m_appendUserPrompt->toPlainText().trimmed().isEmpty());
+    updateTokenBudget();
+    updateStrikeButton();
+
+    if (cancelled) {
+        // Writes the prompt that was deferred by sendSession()
+        if (m_sendSaveBatch && !m_sendSaveBatch->commit())
+            QMessageBox::warning(this, "Error", "Failed to save session after adding prompt.");
+        m_sendSaveBatch.reset();
+        if (m_statusBar)
+            m_statusBar->showMessage("Command pipes cancelled.", 3000);
         return;
     }
 
-    if (!m_session.runCommandPipes()) {
-        QMessageBox::warning(this, "Error", "Failed to run command pipes in session.");
+    if (!errors.isEmpty()) {
+        QStringList lines;
+        for (auto it = errors.constBegin(); it != errors.constEnd(); ++it)
+            lines << QString("%1: %2").arg(it.key(), it.value());
+
+        auto reply = QMessageBox::question(this, "Command Pipes Failed",
+                                           lines.join("\n") + "\n\nSend anyway? The markers of failed pipes are left in place.",
+                                           QMessageBox::Yes | QMessageBox::No, QMessageBox::No);
+        if (reply != QMessageBox::Yes) {
+            // Keep the outputs of the pipes that did succeed
+            m_session.applyCommandPipeOutputs(succeeded);
+            if (m_sendSaveBatch && !m_sendSaveBatch->commit())
+                QMessageBox::warning(this, "Error", "Failed to save session after running command pipes.");
+            m_sendSaveBatch.reset();
+            return;
+        }
+    }
+
+    if (!m_session.applyCommandPipeOutputs(succeeded)) {
+        m_sendSaveBatch.reset();
+        QMessageBox::warning(this, "Error", "Failed to save session after running command pipes.");
         return;
     }
 
+    if (m_statusBar)
+        m_statusBar->showMessage("Command pipes finished.", 3000);
+
+    sendPreparedSession();
+}
+
+void SessionTabWidget::sendPreparedSession()
+{
+    // All saves since sendSession() (prompt, pipe outputs, include caching, assistant slices)
+    // hit the disk once; early returns write them when the batch goes out of scope
+    std::unique_ptr<Session::SaveBatch> saveBatch = std::move(m_sendSaveBatch);
+    if (!saveBatch)
+        saveBatch = std::make_unique<Session::SaveBatch>(&m_session);
+
     if (!m_session.refreshCacheAndSave()) {
         QMessageBox::warning(this, "Error", "Failed to cache includes in session after running command pipes.");
         return;
     }
 
-    // Update UI with assistant slice
-    int newLastIndex = m_session.slices().size() - 1;
-    if (newLastIndex >= 0) {
-        auto slice = m_session.slices().at(newLastIndex);
-        auto item = new QTreeWidgetItem(m_promptSliceTree);
-        item->setData(0, Qt::UserRole, newLastIndex);
-        item->setText(0, slice.timestamp);
-        switch (slice.role) {
-        case MessageRole::User: item->setText(1, "User"); break;
-        case MessageRole::Assistant: item->setText(1, "Assistant"); break;
-        case MessageRole::System: item->setText(1, "System"); break;
+    buildPromptSliceTree();
+
+    // Compile the prompt stack once; every variant of a strike sends the same messages
+    QVector<PromptSlice> slicesExpanded = m_session.expandedSlices();
+
+    // Fit it into the smallest context window it goes to, leaving room for the answer
+    QString model = m_backendParams.value("model").toString();
+    if (model.isEmpty() && m_project)
+        model = m_project->model();
+    int contextWindow = Tokenizer::contextWindow(model);
+    if (m_strikeRequested && m_project) {
+        for (const ProjectConfig::StrikeVariant &variant : m_project->config().strikeVariants) {
+            if (!variant.model.isEmpty())
+                contextWindow = qMin(contextWindow, Tokenizer::contextWindow(variant.model));
         }
-        item->setText(2, promptSliceSummary(slice));
-        m_promptSliceTree->setCurrentItem(item);
-        m_sliceViewer->setEnabled(true);
-        m_partialResponseBuffer.clear();
     }
+    const int maxTokens = m_backendParams.value("max_tokens", m_project ? m_project->maxTokens() : 0).toInt();
+
+    const ContextPlanner::Policy policy = ContextPlanner::Policy::forProject(m_project);
+    const ContextPlanner::Plan plan =
+        ContextPlanner(m_session, tokenizer(), policy).plan(slicesExpanded, contextWindow - maxTokens);
+    const QStringList planReport = plan.report();
+    for (const QString &line : planReport)
+        qDebug() << "[sendPreparedSession] Context planner:" << line;
+    if (policy.history != ContextPlanner::Off && !plan.fits()) {
+        m_strikeRequested = false;
+        QMessageBox::warning(this, "Prompt Too Large",
+                             QString("The prompt needs %1 tokens, but only %2 fit next to the %3 reserved for the answer "
+                                     "in the context window of %4, even without the earlier slices.\n\n"
+                                     "Shorten the prompt or its includes, or lower the max tokens.")
+                                 .arg(plan.tokensAfter).arg(plan.budget).arg(maxTokens).arg(model));
+        return;
+    }
+    slicesExpanded = plan.slices;
+
+    // The prompt stays in the input until it is really sent, so a refused one can be edited
+    m_appendUserPrompt->clear();
 
-    // Prepare and send messages to AI backend
-    QVector<PromptSlice> slicesExpanded = m_session.expandedSlices();
     QList<AIBackend::Message> messages;
     for (const PromptSlice &slice : slicesExpanded) {
         AIBackend::Message::Role role;
@@ -938,69 +1214,295 @@ void SessionTabWidget::onSendClicked()
         messages.append({role, slice.content});
     }
 
-    QVariantMap params;
-    m_currentRequestId = QStringLiteral("session_%1_%2")
-                             .arg(QDateTime::currentMSecsSinceEpoch())
-                             .arg(QRandomGenerator::global()->bounded(INT_MAX));
+    // <!-- predict: path --> in the prompt: the cached file is the expected answer (a rewrite)
+    QString predictedPath;
+    const QString prediction = m_session.predictedOutput(&predictedPath);
+
+    // A plain send is a single stream with the tab's settings
+    QVector<ProjectConfig::StrikeVariant> variants;
+    if (m_strikeRequested && m_project)
+        variants = m_project->config().strikeVariants;
+    const bool strike = !variants.isEmpty();
+    if (!strike)
+        variants.append(ProjectConfig::StrikeVariant());
+    m_strikeRequested = false;
+
+    // Alternative answers come back as choices of the same request, so the prompt is processed once
+    const int choiceCount = m_choiceCountSpin->value();
+
+    // One empty assistant slice per stream and choice; alternatives become sibling slices
+    QHash<QString, ResponseStream> streams;
+    int appendedSlices = 0;
+    for (int i = 0; i < variants.size(); ++i) {
+        const ProjectConfig::StrikeVariant &variant = variants.at(i);
+
+        ResponseStream stream;
+        stream.params = m_backendParams;
+        if (!variant.model.isEmpty())
+            stream.params["model"] = variant.model;
+        if (variant.temperature >= 0.0)
+            stream.params["temperature"] = variant.temperature;
+        if (variant.topP >= 0.0)
+            stream.params["top_p"] = variant.topP;
+        if (choiceCount > 1)
+            stream.params["n"] = choiceCount;
+        if (!prediction.isEmpty())
+            stream.params["prediction"] = prediction;
+        // Labels the request's telemetry record
+        stream.params["session"] = QFileInfo(m_sessionFilePath).completeBaseName();
+        if (strike)
+            stream.label = variant.label.isEmpty() ? QString("Variant %1").arg(i + 1) : variant.label;
+
+        // On the Responses API only the slices after the last stored response are uploaded
+        if (choiceCount == 1 && stream.params.value("endpoint").toString() == QLatin1String("responses")) {
+            continueStoredResponse(stream.params, messages);
+            if (!strike)
+                stream.messages = messages;
+        }
+
+        for (int c = 0; c < choiceCount; ++c) {
+            m_session.appendAssistantSlice(QString());
+            ResponseStream::Choice choice;
+            choice.sliceIndex = m_session.slices().size() - 1;
+            stream.choices.append(choice);
+            ++appendedSlices;
+        }
+
+        const QString requestId = QStringLiteral("session_%1_%2")
+                                      .arg(QDateTime::currentMSecsSinceEpoch())
+                                      .arg(QRandomGenerator::global()->bounded(INT_MAX));
+        streams.insert(requestId, stream);
+    }
+
+    if (!m_session.save(m_sessionFilePath)) {
+        QMessageBox::warning(this, "Error", "Failed to save session after adding assistant slice.");
+        return;
+    }
+
+    // Update UI with the assistant slices
+    QTreeWidgetItem *firstItem = nullptr;
+    for (int index = m_session.slices().size() - appendedSlices; index < m_session.slices().size(); ++index) {
+        const PromptSlice &slice = m_session.slices().at(index);
+        auto item = new QTreeWidgetItem(m_promptSliceTree);
+        item->setData(0, Qt::UserRole, index);
+        item->setText(0, slice.timestamp);
+        item->setText(1, "Assistant");
+        item->setText(2, promptSliceSummary(slice));
+        if (!firstItem)
+            firstItem = item;
+    }
 
-    m_aiBackend->startRequest(messages, params, m_currentRequestId);
+    if (!saveBatch->commit()) {
+        QMessageBox::warning(this, "Error", "Failed to save session before sending.");
+        return;
+    }
+
+    m_streams = streams;
+    if (firstItem) {
+        m_promptSliceTree->setCurrentItem(firstItem);
+        m_sliceViewer->setEnabled(true);
+    }
+
+    // All variants go out at once and stream concurrently. A start can fail synchronously
+    // (e.g. no API key): onErrorOccurred() then drops that stream, or all of them, right away
+    const QStringList requestIds = m_streams.keys();
+    for (const QString &requestId : requestIds) {
+        auto it = m_streams.find(requestId);
+        if (it == m_streams.end())
+            continue;
+        it->elapsed.start();
+        const QVariantMap params = it->params;
+        m_aiBackend->startRequest(messages, params, requestId);
+    }
+
+    // Every start failed; onErrorOccurred() already restored the UI
+    if (m_streams.isEmpty())
+        return;
+
+    if (!planReport.isEmpty() && m_statusBar)
+        m_statusBar->showMessage(QString("Left out %1 tokens to fit the context window: %2")
+                                     .arg(plan.tokensSaved()).arg(planReport.join("; ")), 15000);
+    else if (strike && m_statusBar)
+        m_statusBar->showMessage(QString("Striking %1 variants...").arg(m_streams.size()));
+    else if (choiceCount > 1 && m_statusBar)
+        m_statusBar->showMessage(QString("Requesting %1 alternative answers...").arg(choiceCount));
+    else if (!prediction.isEmpty() && m_statusBar)
+        m_statusBar->showMessage(QString("Sending with %1 as the predicted output...").arg(predictedPath));
 
     m_sendButton->setEnabled(false);
     m_saveButton->setEnabled(false);
     m_unsavedChanges = false;
 }
 
-void SessionTabWidget::onPartialResponse(const QString &requestId, const QString &partialText)
+void SessionTabWidget::onChoicePartialResponse(const QString &requestId, int choiceIndex, const QString &partialText)
 {
-    //qDebug() << "[onPartialResponse] Received chunk for requestId:" << requestId << "Chunk length:" << partialText.length();
+    //qDebug() << "[onChoicePartialResponse] Received chunk for requestId:" << requestId << "Chunk length:" << partialText.length();
 
-    if (requestId != m_currentRequestId) {
-        qDebug() << "[onPartialResponse] Ignoring chunk for unknown requestId.";
+    // Chunks of other tabs' requests arrive here too
+    auto it = m_streams.find(requestId);
+    if (it == m_streams.end())
+        return;
+
+    if (choiceIndex < 0 || choiceIndex >= it->choices.size()) {
+        qWarning() << "[onChoicePartialResponse] Unexpected choice" << choiceIndex << "for requestId:" << requestId;
         return;
     }
 
-    m_partialResponseBuffer += partialText;
+    if (it->firstTokenMs < 0)
+        it->firstTokenMs = it->elapsed.elapsed();
 
-    m_sliceViewer->blockSignals(true);
-    m_updatingEditor = true;
-    m_sliceViewer->setPlainText(m_partialResponseBuffer);
-    m_updatingEditor = false;
-    m_sliceViewer->blockSignals(false);
+    // Only buffer here; the viewer is updated by flushPendingStream() once per frame and
+    // the slice content is committed once when the stream ends
+    ResponseStream::Choice &choice = it->choices[choiceIndex];
+    choice.buffer += partialText;
+    choice.pending += partialText;
 
-    QVector<PromptSlice> &slices = m_session.slices();
+    if (!m_streamFlushTimer->isActive())
+        m_streamFlushTimer->start();
+}
+
+void SessionTabWidget::flushPendingStream()
+{
+    // Only render while the viewer shows a streaming slice; updateUiForSelectedSlice()
+    // repopulates it from the stream buffer when the slice is selected again
     int selectedIndex = m_promptSliceTree->indexOfTopLevelItem(m_promptSliceTree->currentItem());
-    if (selectedIndex >= 0 && selectedIndex < slices.size()) {
-        PromptSlice &slice = slices[selectedIndex];
-        if (slice.role == MessageRole::Assistant) {
-            slice.content = m_partialResponseBuffer;
-            //qDebug() << "[onPartialResponse] Updated assistant slice content.";
+
+    QString pendingText;
+    for (auto it = m_streams.begin(); it != m_streams.end(); ++it) {
+        for (ResponseStream::Choice &choice : it->choices) {
+            if (choice.sliceIndex == selectedIndex)
+                pendingText = choice.pending;
+            choice.pending.clear();
         }
     }
 
+    if (pendingText.isEmpty() || m_sliceViewer->isHidden())
+        return;
+
+    // Append only the new text so the highlighter re-runs on the touched blocks only
+    m_sliceViewer->blockSignals(true);
+    m_updatingEditor = true;
+    QTextCursor appendCursor(m_sliceViewer->document());
+    appendCursor.movePosition(QTextCursor::End);
+    appendCursor.insertText(pendingText);
+    m_updatingEditor = false;
+    m_sliceViewer->blockSignals(false);
+
     QTextCursor cursor = m_sliceViewer->textCursor();
     cursor.movePosition(QTextCursor::End);
     m_sliceViewer->setTextCursor(cursor);
 }
 
+QString SessionTabWidget::strikeHeader(const QString &label, const QVariantMap &params, qint64 elapsedMs,
+                                       qint64 firstTokenMs, const QVariantMap &usage, bool fromCache)
+{
+    // Kept as a comment so the markdown view hides it while the slice stays self-describing
+    QString header = QString("<!-- strike: %1 | %2, temperature %3, top_p %4 | %5 ms")
+                         .arg(label, params.value("model").toString(),
+                              params.value("temperature").toString(), params.value("top_p").toString())
+                         .arg(elapsedMs);
+    if (firstTokenMs >= 0)
+        header += QString(" (first token %1 ms)").arg(firstTokenMs);
+    if (!usage.isEmpty()) {
+        header += QString(" | %1 prompt + %2 completion tokens")
+                      .arg(usage.value("prompt_tokens").toLongLong())
+                      .arg(usage.value("completion_tokens").toLongLong());
+    }
+    const QString promptCache = promptCacheSummary(usage);
+    if (!promptCache.isEmpty())
+        header += " | " + promptCache;
+    const QString prediction = predictionSummary(usage);
+    if (!prediction.isEmpty())
+        header += " | " + prediction;
+    if (fromCache)
+        header += " | from cache";
+    header += " -->\n\n";
+    return header;
+}
+
+QString SessionTabWidget::promptCacheSummary(const QVariantMap &usage)
+{
+    // Reported by the service as usage.prompt_tokens_details.cached_tokens
+    const qint64 promptTokens = usage.value("prompt_tokens").toLongLong();
+    const QVariantMap details = usage.value("prompt_tokens_details").toMap();
+    if (promptTokens <= 0 || !details.contains("cached_tokens"))
+        return QString();
+    const qint64 cachedTokens = details.value("cached_tokens").toLongLong();
+    return QString("prompt cache: %1 of %2 tokens (%3%)")
+        .arg(cachedTokens)
+        .arg(promptTokens)
+        .arg(cachedTokens * 100 / promptTokens);
+}
+
+QString SessionTabWidget::predictionSummary(const QVariantMap &usage)
+{
+    // Only reported for requests with a predicted output
+    const QVariantMap details = usage.value("completion_tokens_details").toMap();
+    if (!details.contains("accepted_prediction_tokens") && !details.contains("rejected_prediction_tokens"))
+        return QString();
+    return QString("prediction: %1 accepted, %2 rejected tokens")
+        .arg(details.value("accepted_prediction_tokens").toLongLong())
+        .arg(details.value("rejected_prediction_tokens").toLongLong());
+}
+
+QString SessionTabWidget::choiceHeader(int choiceIndex, int choiceCount)
+{
+    // Tells sibling alternatives of one request apart once they are committed
+    return QString("<!-- choice: %1/%2 -->\n\n").arg(choiceIndex + 1).arg(choiceCount);
+}
+
 void SessionTabWidget::onFinished(const QString &requestId, const QString &fullResponse)
 {
+    auto it = m_streams.find(requestId);
+    if (it == m_streams.end())
+        return;
+
     qDebug() << "[onFinished] Received full response for requestId:" << requestId << "Response length:" << fullResponse.length();
 
-    if (requestId != m_currentRequestId) {
-        qDebug() << "[onFinished] Ignoring finished signal for unknown requestId.";
+    ResponseStream stream = it.value();
+    m_streams.erase(it);
+
+    const qint64 elapsedMs = stream.elapsed.elapsed();
+    qDebug() << "[onFinished]" << (stream.label.isEmpty() ? QStringLiteral("Response") : stream.label)
+             << "took" << elapsedMs << "ms, first token after" << stream.firstTokenMs << "ms, usage:" << stream.usage;
+
+    // Commit every streamed choice to its slice exactly once; choice 0 is the full response
+    commitResponseStream(stream, elapsedMs, fullResponse);
+    recordStoredResponse(stream, fullResponse);
+
+    if (!m_streams.isEmpty()) {
+        // Other strike variants are still streaming: only refresh this request's slice summaries
+        const QVector<PromptSlice> &slices = m_session.slices();
+        for (const ResponseStream::Choice &choice : std::as_const(stream.choices)) {
+            QTreeWidgetItem *item = m_promptSliceTree->topLevelItem(choice.sliceIndex);
+            if (item && choice.sliceIndex < slices.size())
+                item->setText(2, promptSliceSummary(slices.at(choice.sliceIndex)));
+        }
+        if (m_statusBar)
+            m_statusBar->showMessage(QString("Striking: %1 variants still streaming...").arg(m_streams.size()));
         return;
     }
 
-    QVector<PromptSlice> &slices = m_session.slices();
-    int selectedIndex = m_promptSliceTree->indexOfTopLevelItem(m_promptSliceTree->currentItem());
-    if (selectedIndex >= 0 && selectedIndex < slices.size()) {
-        PromptSlice &slice = slices[selectedIndex];
-        if (slice.role == MessageRole::Assistant) {
-            slice.content = fullResponse;
-            qDebug() << "[onFinished] Updated assistant slice content with full response.";
-        }
+    finishResponseStreams();
+
+    // Shows how much of the prompt the service had cached and what a predicted output saved
+    QStringList usageNotes;
+    for (const QString &note : {promptCacheSummary(stream.usage), predictionSummary(stream.usage)}) {
+        if (!note.isEmpty())
+            usageNotes << note;
     }
+    if (!usageNotes.isEmpty()) {
+        qDebug() << "[onFinished]" << usageNotes;
+        if (m_statusBar)
+            m_statusBar->showMessage(QString("Response in %1 ms, %2").arg(elapsedMs).arg(usageNotes.join(", ")), 15000);
+    }
+}
+
+void SessionTabWidget::finishResponseStreams()
+{
+    m_streamFlushTimer->stop();
 
+    // Rebuilding the tree reselects the last slice, which renders the full response once
     buildPromptSliceTree();
 
     int lastIndex = m_promptSliceTree->topLevelItemCount() - 1;
@@ -1008,12 +1510,6 @@ void SessionTabWidget::onFinished(const QString &requestId, const QString &fullR
         m_promptSliceTree->setCurrentItem(m_promptSliceTree->topLevelItem(lastIndex));
     }
 
-    m_sliceViewer->blockSignals(true);
-    m_updatingEditor = true;
-    m_sliceViewer->setPlainText(fullResponse);
-    m_updatingEditor = false;
-    m_sliceViewer->blockSignals(false);
-
     if (!saveSession()) {
         QMessageBox::warning(this, "Error", "Failed to save session after assistant response.");
         qWarning() << "[onFinished] Failed to save session after assistant response.";
@@ -1023,8 +1519,6 @@ void SessionTabWidget::onFinished(const QString &requestId, const QString &fullR
 
     m_sendButton->setEnabled(true);
     m_saveButton->setEnabled(false);
-    m_currentRequestId.clear();
-    m_partialResponseBuffer.clear();
     m_unsavedChanges = false;
 }
 
@@ -1032,6 +1526,7 @@ void SessionTabWidget::onEditTitleDescClicked()
 {
     if (!m_sessionFilePath.isEmpty()) {
         DescriptionGenerator* gen = new DescriptionGenerator(&m_session, m_aiBackend, this);
+        gen->setRequestParams(m_backendParams);
 
         // Show dialog UI for interactive editing
         gen->showDialog();
@@ -1053,32 +1548,141 @@ void SessionTabWidget::onEditTitleDescClicked()
 
 void SessionTabWidget::onErrorOccurred(const QString &requestId, const QString &errorString)
 {
+    auto it = m_streams.find(requestId);
+    if (it == m_streams.end())
+        return;
+
     qWarning() << "[onErrorOccurred] Error for requestId:" << requestId << "Error:" << errorString;
 
-    if (requestId != m_currentRequestId) {
-        qDebug() << "[onErrorOccurred] Ignoring error for unknown requestId.";
-        return;
+    ResponseStream stream = it.value();
+    m_streams.erase(it);
+
+    // Keep whatever was streamed before the error in the assistant slices
+    commitResponseStream(stream, stream.elapsed.elapsed(), stream.choices.value(0).buffer);
+
+    if (stream.label.isEmpty()) {
+        m_streamFlushTimer->stop();
+        QMessageBox::critical(this, "AI Backend Error", errorString);
+    } else {
+        QMessageBox::critical(this, "AI Backend Error", QString("%1: %2").arg(stream.label, errorString));
     }
 
-    QMessageBox::critical(this, "AI Backend Error", errorString);
+    if (!m_streams.isEmpty())
+        return;
+
+    // A strike keeps the variants that did answer, and several choices keep the partial alternatives
+    if (!stream.label.isEmpty() || stream.choices.size() > 1) {
+        finishResponseStreams();
+        return;
+    }
 
     m_sendButton->setEnabled(true);
     m_saveButton->setEnabled(false);
-    m_currentRequestId.clear();
-    m_partialResponseBuffer.clear();
     m_unsavedChanges = false;
 }
 
+void SessionTabWidget::commitResponseStream(const ResponseStream &stream, qint64 elapsedMs,
+                                            const QString &firstChoiceText)
+{
+    QVector<PromptSlice> &slices = m_session.slices();
+    const int choiceCount = stream.choices.size();
+    for (int c = 0; c < choiceCount; ++c) {
+        const ResponseStream::Choice &choice = stream.choices.at(c);
+        if (choice.sliceIndex < 0 || choice.sliceIndex >= slices.size()
+            || slices[choice.sliceIndex].role != MessageRole::Assistant)
+            continue;
+
+        QString header;
+        if (!stream.label.isEmpty()) {
+            const QString label = choiceCount > 1 ? QString("%1 #%2").arg(stream.label).arg(c + 1) : stream.label;
+            header = strikeHeader(label, stream.params, elapsedMs, stream.firstTokenMs, stream.usage, stream.fromCache);
+        } else if (choiceCount > 1) {
+            header = choiceHeader(c, choiceCount);
+        }
+
+        slices[choice.sliceIndex].content = header + (c == 0 ? firstChoiceText : choice.buffer);
+    }
+    qDebug() << "[commitResponseStream] Updated" << choiceCount << "assistant slice(s) with the response.";
+}
+
 void SessionTabWidget::updateBackendConfig(const QVariantMap &config)
 {
-    if (m_aiBackend) {
-        m_aiBackend->setConfig(config);
+    m_backendParams = config;
+    updateStrikeButton();
+}
+
+void SessionTabWidget::onUsageReported(const QString &requestId, const QVariantMap &usage)
+{
+    auto it = m_streams.find(requestId);
+    if (it != m_streams.end())
+        it->usage = usage;
+}
+
+void SessionTabWidget::onServedFromCache(const QString &requestId)
+{
+    auto it = m_streams.find(requestId);
+    if (it == m_streams.end())
+        return;
+
+    it->fromCache = true;
+    if (m_statusBar)
+        m_statusBar->showMessage("Response served from cache (identical request sent before).", 5000);
+}
+
+void SessionTabWidget::onResponseStored(const QString &requestId, const QString &responseId)
+{
+    auto it = m_streams.find(requestId);
+    if (it != m_streams.end())
+        it->responseId = responseId;
+}
+
+void SessionTabWidget::continueStoredResponse(QVariantMap &params, const QList<AIBackend::Message> &messages) const
+{
+    const QVariantMap metadata = m_session.storedResponse();
+    const QString responseId = metadata.value("response_id").toString();
+    const int count = metadata.value("response_messages").toInt();
+    if (responseId.isEmpty() || count <= 0 || count >= messages.size())
+        return;
+
+    // An edited slice (or a changed include) before the new ones means a full upload
+    if (OpenAIResponsesBackend::conversationDigest(messages, count) != metadata.value("response_digest").toString()) {
+        qDebug() << "[continueStoredResponse] Conversation changed since" << responseId << "- sending it in full";
+        return;
     }
+
+    params["previous_response_id"] = responseId;
+    params["previous_message_count"] = count;
+}
+
+void SessionTabWidget::recordStoredResponse(const ResponseStream &stream, const QString &fullResponse)
+{
+    if (stream.responseId.isEmpty() || stream.messages.isEmpty())
+        return;
+
+    // The stored response holds the conversation as sent followed by its answer
+    QList<AIBackend::Message> conversation = stream.messages;
+    conversation.append({AIBackend::Message::Assistant, fullResponse});
+
+    QVariantMap response;
+    response["response_id"] = stream.responseId;
+    response["response_messages"] = conversation.size();
+    response["response_digest"] = OpenAIResponsesBackend::conversationDigest(conversation, conversation.size());
+    if (!m_session.setStoredResponse(response))
+        qWarning() << "[recordStoredResponse] Failed to store response id" << stream.responseId;
+}
+
+void SessionTabWidget::updateStrikeButton()
+{
+    // Only offered when the project defines variants to strike with
+    const bool hasVariants = m_project && !m_project->config().strikeVariants.isEmpty();
+    m_strikeButton->setVisible(hasVariants);
+    m_strikeButton->setEnabled(hasVariants && m_sendButton->isEnabled() && !m_runningCommandPipes);
 }
 
 void SessionTabWidget::onStatusChanged(const QString &requestId, const QString &status)
 {
-    Q_UNUSED(requestId);
+    if (!m_streams.contains(requestId))
+        return;
     qDebug() << "[AIBackend] Status changed:" << status;
 }
 
@@ -1101,16 +1705,34 @@ bool SessionTabWidget::saveSession()
 
 bool SessionTabWidget::eventFilter(QObject *obj, QEvent *event)
 {
+    if (obj == m_sendButton && event->type() == QEvent::EnabledChange)
+        updateStrikeButton();
+
+    // Connect while the prompt is being typed so the send doesn't pay for the handshake
+    if (obj == m_appendUserPrompt && event->type() == QEvent::FocusIn && m_aiBackend)
+        m_aiBackend->prewarm();
+
     if (obj == m_appendUserPrompt && event->type() == QEvent::KeyPress) {
         QKeyEvent *keyEvent = static_cast<QKeyEvent*>(event);
         if ((keyEvent->key() == Qt::Key_Return || keyEvent->key() == Qt::Key_Enter) &&
             (keyEvent->modifiers() & Qt::ShiftModifier)) {
-            if (m_sendButton->isEnabled()) {
+            if (m_sendButton->isEnabled() && !m_runningCommandPipes) {
                 onSendClicked();
                 return true; // event handled
             }
         }
     }
+    if (event->type() == QEvent::ToolTip
+        && (obj == m_appendUserPrompt->viewport() || obj == m_sliceViewer->viewport())) {
+        QPlainTextEdit *editor = obj == m_appendUserPrompt->viewport() ? m_appendUserPrompt : m_sliceViewer;
+        QHelpEvent *helpEvent = static_cast<QHelpEvent*>(event);
+        const QString tip = includeTokenToolTip(editor->cursorForPosition(helpEvent->pos()));
+        if (!tip.isEmpty()) {
+            QToolTip::showText(helpEvent->globalPos(), tip, editor);
+            return true;
+        }
+        QToolTip::hideText();
+    }
     if (obj == m_editTitleDescBtn) {
         if (event->type() == QEvent::Enter) {
             if (m_editTitleDescBtn) {
@@ -1162,6 +1784,38 @@ void SessionTabWidget::onDeleteAfterClicked()
     }
 }
 
+void SessionTabWidget::onKeepAlternativeClicked()
+{
+    auto selectedItems = m_promptSliceTree->selectedItems();
+    if (selectedItems.isEmpty() || !m_streams.isEmpty())
+        return;
+
+    int selectedIndex = selectedItems.first()->data(0, Qt::UserRole).toInt();
+    int first = 0;
+    int last = 0;
+    if (!m_session.alternativeRange(selectedIndex, &first, &last) || first == last) {
+        if (m_statusBar) {
+            m_statusBar->showMessage("Selected slice has no alternatives.", 3000);
+        }
+        return;
+    }
+
+    int keptIndex = m_session.keepAlternative(selectedIndex);
+
+    buildPromptSliceTree();
+    if (keptIndex < m_promptSliceTree->topLevelItemCount()) {
+        m_promptSliceTree->setCurrentItem(m_promptSliceTree->topLevelItem(keptIndex));
+    }
+
+    // Same as Delete All After: the dropped alternatives stay on disk until saved
+    markUnsavedChanges(true);
+
+    if (m_statusBar) {
+        m_statusBar->showMessage(QString("Kept 1 of %1 alternatives. Press Refresh to restore the others from disk.")
+                                     .arg(last - first + 1), 3000);
+    }
+}
+
 void SessionTabWidget::contextMenuEvent(QContextMenuEvent *event)
 {
     // If you handle context menu via customContextMenuRequested signal,
@@ -1213,11 +1867,26 @@ void SessionTabWidget::onRefreshClicked()
     if (!confirmDiscardUnsavedChanges())
         return;
 
-    if (!m_session.load(m_sessionFilePath)) {
+    if (!reloadSession()) {
         QMessageBox::warning(this, "Refresh", "Failed to reload session file.");
         return;
     }
 
+    if (m_statusBar) {
+        m_statusBar->showMessage("Session refreshed from disk.", 3000);
+    }
+}
+
+bool SessionTabWidget::reloadSession()
+{
+    // Reloading replaces the session's command pipe manager
+    if (m_runningCommandPipes) {
+        if (CommandPipeManager *pipes = m_session.commandPipeManager())
+            pipes->cancel();
+    }
+
+    if (!m_session.load(m_sessionFilePath))
+        return false;
 
     // Clear editors and disable until a slice is selected
     m_updatingEditor = true;
@@ -1227,14 +1896,11 @@ void SessionTabWidget::onRefreshClicked()
     m_appendUserPrompt->setEnabled(false);
     m_updatingEditor = false;
 
-    m_partialResponseBuffer.clear();
     m_unsavedChanges = false;
     m_saveButton->setEnabled(false);
     m_sendButton->setEnabled(false);
 
     buildPromptSliceTree();
 
-    if (m_statusBar) {
-        m_statusBar->showMessage("Session refreshed from disk.", 3000);
-    }
+    return true;
 }
@@ -11,19 +11,26 @@
 #include <QStatusBar>
 #include <QLineEdit>
 #include <QLabel>
+#include <QSpinBox>
+#include <QTimer>
+#include <QHash>
+#include <QElapsedTimer>
+
+#include <memory>
 
 #include "project.h"
 #include "session.h"
 #include "aibackend.h"
-#include "openaibackend.h"
 #include "qmarkdowntextedit/qmarkdowntextedit.h"
 
+class Tokenizer;
+
 class SessionTabWidget : public QWidget
 {
     Q_OBJECT
 
 public:
-    explicit SessionTabWidget(const QString& sessionPath, Project* project,
+    explicit SessionTabWidget(const QString& sessionPath, Project* project, AIBackend* aiBackend,
                               QWidget *parent = nullptr, bool isTempSession = false,
                               QStatusBar* statusBar = nullptr);
     ~SessionTabWidget();
@@ -34,6 +41,11 @@ public:
     void updateBackendConfig(const QVariantMap &config);
 
     bool confirmDiscardUnsavedChanges();
+    bool hasUnsavedChanges() const { return m_unsavedChanges; }
+    // A response is streaming or command pipes are running
+    bool isBusy() const { return !m_streams.isEmpty() || m_runningCommandPipes; }
+    // Reload the session from its file, dropping unsaved edits (as the Refresh button does)
+    bool reloadSession();
 
     Session& session() { return m_session; }
     AIBackend* aiBackend() const { return m_aiBackend; }
@@ -47,17 +59,25 @@ protected:
 private slots:
     void onSaveClicked();
     void onSendClicked();
+    void onStrikeClicked();
     void onForkClicked();
     void onDeleteAfterClicked();
+    void onKeepAlternativeClicked();
     void onOpenMarkdownFileClicked();
     void onOpenCacheClicked();
     void onRefreshClicked();
     void onPromptSliceSelected();
 
-    void onPartialResponse(const QString &requestId, const QString &partialText);
+    void onChoicePartialResponse(const QString &requestId, int choiceIndex, const QString &partialText);
     void onFinished(const QString &requestId, const QString &fullResponse);
     void onErrorOccurred(const QString &requestId, const QString &errorString);
     void onStatusChanged(const QString &requestId, const QString &status);
+    void onUsageReported(const QString &requestId, const QVariantMap &usage);
+    void onServedFromCache(const QString &requestId);
+    void onResponseStored(const QString &requestId, const QString &responseId);
+
+    void onCommandPipeProgress(int finishedCount, int totalCount);
+    void onCommandPipesFinished(const QStringList &succeeded, const QMap<QString, QString> &errors, bool cancelled);
 
 private:
     void loadSession();
@@ -66,11 +86,63 @@ private:
     void updateUiForSelectedSlice(int selectedIndex);
     void updateButtonStates();
     void markUnsavedChanges(bool changed);
+    void flushPendingStream();
+    void sendSession(bool strike);
+    void sendPreparedSession();
+    void finishResponseStreams();
+    void updateStrikeButton();
+    // Tokenizer of the project model
+    const Tokenizer &tokenizer() const;
+    // Show the prompt's token total against the model's context window on the send button
+    void updateTokenBudget();
+    // Recount the tokens of every slice on a worker thread, then update the tree and the budget
+    void countSliceTokens();
+    // Token count of the include marker under 'cursor', empty if there is none
+    QString includeTokenToolTip(const QTextCursor &cursor) const;
+    static QString strikeHeader(const QString &label, const QVariantMap &params, qint64 elapsedMs,
+                                qint64 firstTokenMs, const QVariantMap &usage, bool fromCache = false);
+    static QString choiceHeader(int choiceIndex, int choiceCount);
+    // "prompt cache: N of M tokens (P%)" from a usage block, empty if the service reports no cache
+    static QString promptCacheSummary(const QVariantMap &usage);
+    // "prediction: N accepted, M rejected tokens" from a usage block, empty without a prediction
+    static QString predictionSummary(const QVariantMap &usage);
+    // Responses API: continue the response stored in the session metadata if the
+    // conversation still starts with the slices it holds
+    void continueStoredResponse(QVariantMap &params, const QList<AIBackend::Message> &messages) const;
     void onEditTitleDescClicked();
 
 
+    // One streamed response; a strike runs several at once. Every choice of a request
+    // (params "n" > 1) streams into its own sibling assistant slice.
+    struct ResponseStream {
+        struct Choice {
+            int sliceIndex = -1;
+            QString buffer;     // Text received so far; committed to the slice when the stream ends
+            QString pending;    // Not yet appended to m_sliceViewer; flushed at most once per frame
+        };
+        QVector<Choice> choices;
+        QString label;          // Strike variant label (empty for a plain send)
+        QVariantMap params;     // Request params (model, temperature, top_p, ...)
+        QElapsedTimer elapsed;
+        qint64 firstTokenMs = -1;
+        QVariantMap usage;
+        bool fromCache = false; // Replayed from the response cache
+        QString responseId;     // Server-side stored response (Responses API)
+        QList<AIBackend::Message> messages; // Conversation as sent, if the response may be continued
+    };
+
+    // Remember a plain send's stored response in the session metadata for the next send
+    void recordStoredResponse(const ResponseStream &stream, const QString &fullResponse);
+
+    // Write the streamed choices (with strike/choice headers) into their assistant slices
+    void commitResponseStream(const ResponseStream &stream, qint64 elapsedMs, const QString &firstChoiceText);
+
+    // Application-wide backend (owned by MainWindow); this tab only owns its requests
     AIBackend *m_aiBackend = nullptr;
-    QString m_currentRequestId;
+    // Active requests of this tab, keyed by requestId
+    QHash<QString, ResponseStream> m_streams;
+    // Project settings sent with every request of this tab
+    QVariantMap m_backendParams;
 
     QString m_sessionFilePath;
     Project* m_project = nullptr;
@@ -93,9 +165,24 @@ private:
 
     QMenu* m_editMenu = nullptr;
     QMenu* m_contextMenu = nullptr;
-
-    // Buffer for partial response text (optional)
-    QString m_partialResponseBuffer;
+    QAction* m_keepAlternativeAction = nullptr;
+
+    QTimer* m_streamFlushTimer = nullptr;
+    // Recounts the prompt tokens once typing pauses
+    QTimer* m_tokenCountTimer = nullptr;
+    // Tokens of every slice, by slice index, as of the last finished count
+    QVector<int> m_sliceTokenCounts;
+    quint64 m_sliceTokenCountGeneration = 0;
+    QPushButton* m_strikeButton = nullptr;
+    // Number of alternative answers requested per send (OpenAI "n")
+    QSpinBox* m_choiceCountSpin = nullptr;
+    // The pending send fans out to the project's strike variants
+    bool m_strikeRequested = false;
+    // Send is waiting for command pipes; the send button cancels them meanwhile
+    bool m_runningCommandPipes = false;
+    // Open from sendSession() until sendPreparedSession() commits, so the prompt, the
+    // command pipe outputs and the assistant slices are written in one go
+    std::unique_ptr<Session::SaveBatch> m_sendSaveBatch;
     bool m_updatingEditor = false;
 
     void onSaveSliceAsMarkdown();
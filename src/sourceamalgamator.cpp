@@ -0,0 +1,375 @@
+#include "sourceamalgamator.h"
+
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QFileSystemWatcher>
+#include <QTimer>
+#include <QSet>
+#include <QElapsedTimer>
+#include <QFutureWatcher>
+#include <QtConcurrent/QtConcurrentMap>
+#include <QtConcurrent/QtConcurrentRun>
+#include <QDebug>
+
+namespace {
+
+QString resolvedSrcFolder(const ProjectConfig &config)
+{
+    QString srcFolder = config.srcFolder;
+    if (!QDir(srcFolder).isAbsolute()) {
+        srcFolder = QDir(config.rootFolder).filePath(srcFolder);
+    }
+    return srcFolder;
+}
+
+struct ReadJob {
+    QString path;
+    QString relativePath;
+    qint64 mtime = 0;
+    qint64 size = 0;
+};
+
+// Runs on a worker thread: one bulk read, line endings normalized like the old line-by-line copy
+QByteArray renderBlock(const ReadJob &job)
+{
+    QByteArray block;
+    block.reserve(job.size + job.relativePath.size() + 32);
+    block += "### `" + job.relativePath.toUtf8() + "`\n";
+    block += "```cpp\n";
+
+    QFile inFile(job.path);
+    if (!inFile.open(QIODevice::ReadOnly)) {
+        block += "[Error: Could not open file]\n";
+        qWarning() << "[SourceAmalgamator] Failed to open source file for reading:" << job.path;
+    } else {
+        QByteArray content = inFile.readAll();
+        inFile.close();
+        if (content.contains('\r')) {
+            content.replace("\r\n", "\n");
+            content.replace('\r', '\n');
+        }
+        if (!content.isEmpty() && !content.endsWith('\n'))
+            content += '\n';
+        block += content;
+    }
+
+    block += "```\n\n";
+    return block;
+}
+
+} // namespace
+
+SourceAmalgamator::SourceAmalgamator(QObject *parent)
+    : QObject(parent)
+    , m_state(std::make_shared<State>())
+{
+}
+
+SourceAmalgamator::~SourceAmalgamator()
+{
+}
+
+QString SourceAmalgamator::configKey(const ProjectConfig &config)
+{
+    return QStringList{config.rootFolder, resolvedSrcFolder(config), config.sourceFileTypes.join('|')}.join('\n');
+}
+
+std::function<SourceAmalgamator::Result()> SourceAmalgamator::task(const ProjectConfig &config) const
+{
+    std::shared_ptr<State> state = m_state;
+    return [state, config]() { return current(*state, config); };
+}
+
+SourceAmalgamator::Result SourceAmalgamator::current(State &state, const ProjectConfig &config)
+{
+    {
+        QMutexLocker locker(&state.mutex);
+        if (state.outputValid && state.outputKey == configKey(config)) {
+            qDebug() << "[SourceAmalgamator::current] Using background-maintained output";
+            Result result;
+            result.data = state.output;
+            result.fileCount = state.files.size();
+            return result;
+        }
+    }
+
+    return build(state, config);
+}
+
+SourceAmalgamator::Result SourceAmalgamator::build(State &state, const ProjectConfig &config)
+{
+    Result result;
+    QElapsedTimer timer;
+    timer.start();
+
+    const QString srcFolder = resolvedSrcFolder(config);
+    if (srcFolder.isEmpty()) {
+        result.error = "Project source folder is empty";
+        return result;
+    }
+    if (!QDir(srcFolder).exists()) {
+        result.error = QString("Source folder does not exist: %1").arg(srcFolder);
+        return result;
+    }
+
+    quint64 generation;
+    {
+        QMutexLocker locker(&state.mutex);
+        generation = state.generation;
+    }
+
+    result.filePaths = scanSourceFiles(config);
+    if (result.filePaths.isEmpty()) {
+        result.error = "No source files found in source folder";
+        return result;
+    }
+
+    const QDir rootDir(config.rootFolder);
+
+    // Stat everything, then only read what is new or changed
+    QVector<ReadJob> jobs;
+    jobs.reserve(result.filePaths.size());
+    QVector<ReadJob> stale;
+    {
+        QMutexLocker locker(&state.mutex);
+        for (const QString &path : result.filePaths) {
+            QFileInfo fi(path);
+            ReadJob job;
+            job.path = path;
+            job.relativePath = rootDir.relativeFilePath(path);
+            job.mtime = fi.lastModified().toMSecsSinceEpoch();
+            job.size = fi.size();
+            jobs.append(job);
+
+            auto cached = state.files.constFind(path);
+            if (cached == state.files.constEnd() || cached->mtime != job.mtime || cached->size != job.size
+                || cached->relativePath != job.relativePath)
+                stale.append(job);
+        }
+    }
+
+    const QList<QByteArray> blocks = QtConcurrent::blockingMapped<QList<QByteArray>>(stale, renderBlock);
+    result.readCount = stale.size();
+
+    QMutexLocker locker(&state.mutex);
+
+    for (int i = 0; i < stale.size(); ++i) {
+        CachedFile entry;
+        entry.mtime = stale.at(i).mtime;
+        entry.size = stale.at(i).size;
+        entry.relativePath = stale.at(i).relativePath;
+        entry.block = blocks.at(i);
+        state.files.insert(stale.at(i).path, entry);
+    }
+
+    // Forget files that are no longer part of the tree
+    const QSet<QString> current(result.filePaths.begin(), result.filePaths.end());
+    for (auto it = state.files.begin(); it != state.files.end();) {
+        if (!current.contains(it.key()))
+            it = state.files.erase(it);
+        else
+            ++it;
+    }
+
+    qsizetype total = 0;
+    for (const ReadJob &job : jobs)
+        total += state.files.value(job.path).block.size();
+
+    result.data.reserve(total);
+    for (const ReadJob &job : jobs)
+        result.data += state.files.value(job.path).block;
+    result.fileCount = jobs.size();
+
+    // Nothing changed under us while building: this is the current output
+    if (state.generation == generation) {
+        state.output = result.data;
+        state.outputKey = configKey(config);
+        state.outputValid = true;
+    }
+
+    qDebug() << "[SourceAmalgamator::build]" << result.fileCount << "files," << result.readCount << "re-read,"
+             << result.data.size() << "bytes in" << timer.elapsed() << "ms";
+    return result;
+}
+
+void SourceAmalgamator::configure(const ProjectConfig &config)
+{
+    const bool keyChanged = configKey(config) != configKey(m_config);
+    m_config = config;
+
+    if (keyChanged) {
+        QMutexLocker locker(&m_state->mutex);
+        m_state->outputValid = false;
+        ++m_state->generation;
+    }
+
+    if (!config.watchSources) {
+        if (m_watching) {
+            qDebug() << "[SourceAmalgamator::configure] Source watching disabled";
+            delete m_watcher;
+            m_watcher = nullptr;
+            m_watching = false;
+        }
+        return;
+    }
+
+    if (!m_watcher) {
+        m_watcher = new QFileSystemWatcher(this);
+        connect(m_watcher, &QFileSystemWatcher::fileChanged, this, &SourceAmalgamator::scheduleRebuild);
+        connect(m_watcher, &QFileSystemWatcher::directoryChanged, this, &SourceAmalgamator::scheduleRebuild);
+    }
+    if (!m_rebuildTimer) {
+        // Editors and builds touch many files at once; rebuild once things settle
+        m_rebuildTimer = new QTimer(this);
+        m_rebuildTimer->setSingleShot(true);
+        m_rebuildTimer->setInterval(500);
+        connect(m_rebuildTimer, &QTimer::timeout, this, &SourceAmalgamator::rebuildInBackground);
+    }
+
+    m_watching = true;
+    qDebug() << "[SourceAmalgamator::configure] Watching sources in" << resolvedSrcFolder(config);
+    rebuildInBackground();
+}
+
+void SourceAmalgamator::scheduleRebuild()
+{
+    {
+        QMutexLocker locker(&m_state->mutex);
+        m_state->outputValid = false;
+        ++m_state->generation;
+    }
+    m_rebuildTimer->start();
+}
+
+void SourceAmalgamator::rebuildInBackground()
+{
+    if (!m_watching)
+        return;
+
+    if (m_rebuildRunning) {
+        m_rebuildPending = true;
+        return;
+    }
+    m_rebuildRunning = true;
+
+    auto *watcher = new QFutureWatcher<Result>(this);
+    connect(watcher, &QFutureWatcher<Result>::finished, this, [this, watcher]() {
+        watcher->deleteLater();
+        m_rebuildRunning = false;
+
+        const Result result = watcher->result();
+        if (!result.error.isEmpty())
+            qWarning() << "[SourceAmalgamator] Background rebuild failed:" << result.error;
+        else if (m_watching)
+            updateWatchedPaths(result.filePaths);
+
+        if (m_rebuildPending) {
+            m_rebuildPending = false;
+            rebuildInBackground();
+        }
+    });
+
+    std::shared_ptr<State> state = m_state;
+    const ProjectConfig config = m_config;
+    watcher->setFuture(QtConcurrent::run([state, config]() { return build(*state, config); }));
+}
+
+void SourceAmalgamator::updateWatchedPaths(const QStringList &filePaths)
+{
+    if (!m_watcher)
+        return;
+
+    // Watch every source file for edits and every folder holding one for added/removed files
+    QSet<QString> wanted(filePaths.begin(), filePaths.end());
+    wanted.insert(QDir::cleanPath(resolvedSrcFolder(m_config)));
+    for (const QString &path : filePaths)
+        wanted.insert(QFileInfo(path).absolutePath());
+
+    const QStringList watchedList = m_watcher->files() + m_watcher->directories();
+    const QSet<QString> watched(watchedList.begin(), watchedList.end());
+
+    const QSet<QString> toRemove = watched - wanted;
+    const QSet<QString> toAdd = wanted - watched;
+    if (!toRemove.isEmpty())
+        m_watcher->removePaths(QStringList(toRemove.begin(), toRemove.end()));
+    if (!toAdd.isEmpty())
+        m_watcher->addPaths(QStringList(toAdd.begin(), toAdd.end()));
+}
+
+QStringList SourceAmalgamator::scanSourceFiles(const ProjectConfig &config)
+{
+    QStringList results;
+
+    QString srcFolder = resolvedSrcFolder(config);
+    QStringList sourceFileTypes = config.sourceFileTypes;
+
+    if (srcFolder.isEmpty()) {
+        qWarning() << "[scanSourceFiles] Source folder is empty";
+        return results;
+    }
+
+    QDir dir(srcFolder);
+    if (!dir.exists()) {
+        qWarning() << "[scanSourceFiles] Source folder does not exist:" << srcFolder;
+        return results;
+    }
+
+    // We want to include CMakeLists.txt and .ui files as well, so add them explicitly
+    QStringList extraPatterns = { "CMakeLists.txt", "*.ui" };
+
+    // Combine sourceFileTypes and extraPatterns
+    QStringList allPatterns = sourceFileTypes;
+    for (const QString &pat : extraPatterns) {
+        if (!allPatterns.contains(pat))
+            allPatterns.append(pat);
+    }
+
+    qDebug() << "[scanSourceFiles] Using patterns:" << allPatterns;
+
+    // Recursive iterator excluding "build" folder
+    QDirIterator it(dir.absolutePath(), allPatterns, QDir::Files | QDir::NoSymLinks | QDir::Readable,
+                    QDirIterator::Subdirectories);
+
+    while (it.hasNext()) {
+        QString filePath = it.next();
+
+        //TODO: REPLACE THIS WITH EXCLUDE SETTINGS
+        // Exclude any path containing build
+        QString normalizedPath = QDir::toNativeSeparators(filePath).toLower();
+        if (normalizedPath.contains(QDir::toNativeSeparators("/qmarkdowntextedit/")) ||
+            normalizedPath.contains(QDir::toNativeSeparators("\\qmarkdowntextedit\\"))) {
+            qDebug() << "[scanSourceFiles] Skipping file in qmarkdowntextedit folder:" << filePath;
+            continue;
+        }
+
+        if (normalizedPath.contains(QDir::toNativeSeparators("/build/")) ||
+            normalizedPath.contains(QDir::toNativeSeparators("\\build\\"))) {
+            qDebug() << "[scanSourceFiles] Skipping file in build folder:" << filePath;
+            continue;
+        }
+
+        // Also exclude if path ends with build folder (e.g. .../build or ...\build)
+        QFileInfo fi(filePath);
+        QStringList parts = fi.absoluteFilePath().split(QDir::separator());
+        if (parts.contains("build")) {
+            qDebug() << "[scanSourceFiles] Skipping file due to build folder in path:" << filePath;
+            continue;
+        }
+
+        if (parts.contains("newconfig.json")) {
+            qDebug() << "skipping VK:" << filePath;
+            continue;
+        }
+
+        results.append(filePath);
+    }
+
+    // Sort alphabetically for consistent output
+    results.sort();
+
+    qDebug() << "[scanSourceFiles] Total files found:" << results.size();
+
+    return results;
+}
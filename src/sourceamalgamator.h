@@ -0,0 +1,95 @@
+#ifndef SOURCEAMALGAMATOR_H
+#define SOURCEAMALGAMATOR_H
+
+#pragma once
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QByteArray>
+#include <QHash>
+#include <QMutex>
+#include <memory>
+#include <functional>
+
+#include "projectconfig.h"
+
+class QFileSystemWatcher;
+class QTimer;
+
+/**
+ * @brief Builds the amalgamated project source (src/src.txt) incrementally.
+ *
+ * Every source file's rendered block is cached by path, mtime and size, so a
+ * rebuild only re-reads files that changed, and those are read in parallel.
+ * The output is assembled in memory and written with a single bulk write.
+ *
+ * With watching enabled, a QFileSystemWatcher on the source tree rebuilds the
+ * output in the background after every change, so amalgamateSrc only has to
+ * write out the current result at send time.
+ *
+ * amalgamate() is thread-safe and is meant to be called from worker threads;
+ * the cache lives in shared state that outlives the owning project.
+ */
+class SourceAmalgamator : public QObject
+{
+    Q_OBJECT
+public:
+    struct Result {
+        QByteArray data;
+        int fileCount = 0;
+        int readCount = 0;      // files that had to be (re-)read
+        QString error;          // empty on success
+        QStringList filePaths;
+    };
+
+    explicit SourceAmalgamator(QObject *parent = nullptr);
+    ~SourceAmalgamator() override;
+
+    // Task for a worker thread producing the amalgamated source: the background-maintained
+    // output when it is current for this configuration, otherwise a rebuild from the
+    // per-file cache. The task shares the cache, so it stays valid if the project goes away.
+    std::function<Result()> task(const ProjectConfig &config) const;
+
+    // Apply project settings: enables or disables background watching
+    void configure(const ProjectConfig &config);
+    bool isWatching() const { return m_watching; }
+
+    static QStringList scanSourceFiles(const ProjectConfig &config);
+
+private:
+    struct CachedFile {
+        qint64 mtime = 0;
+        qint64 size = -1;
+        QString relativePath;
+        QByteArray block;       // rendered "### `path`" section
+    };
+
+    struct State {
+        QMutex mutex;
+        QHash<QString, CachedFile> files;
+        QByteArray output;
+        QString outputKey;      // configuration the output was built for
+        bool outputValid = false;
+        quint64 generation = 0; // bumped on every watched change
+    };
+
+    static Result current(State &state, const ProjectConfig &config);
+    static Result build(State &state, const ProjectConfig &config);
+    static QString configKey(const ProjectConfig &config);
+
+    void scheduleRebuild();
+    void rebuildInBackground();
+    void updateWatchedPaths(const QStringList &filePaths);
+
+    std::shared_ptr<State> m_state;
+    ProjectConfig m_config;
+    bool m_watching = false;
+    bool m_rebuildRunning = false;
+    bool m_rebuildPending = false;
+
+    QFileSystemWatcher *m_watcher = nullptr;
+    QTimer *m_rebuildTimer = nullptr;
+};
+
+#endif // SOURCEAMALGAMATOR_H
@@ -0,0 +1,466 @@
+#include "ssestreamparser.h"
+
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonParseError>
+
+#include <cstring>
+
+namespace {
+
+// Drop the consumed prefix only when it is both large and most of the buffer
+const qsizetype kCompactThreshold = 64 * 1024;
+
+struct Cursor {
+    const char *p;
+    const char *end;
+};
+
+// Object member name inside the JSON text; null for names with escapes
+struct Key {
+    const char *data = nullptr;
+    qsizetype size = 0;
+};
+
+enum class Lookup {
+    Found,
+    Missing,
+    Malformed
+};
+
+bool isJsonSpace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+void skipSpace(Cursor &c)
+{
+    while (c.p < c.end && isJsonSpace(*c.p))
+        ++c.p;
+}
+
+bool expect(Cursor &c, char ch)
+{
+    skipSpace(c);
+    if (c.p < c.end && *c.p == ch) {
+        ++c.p;
+        return true;
+    }
+    return false;
+}
+
+// Span of a string token without its quotes
+bool scanString(Cursor &c, const char *&begin, const char *&stop, bool &hasEscapes)
+{
+    skipSpace(c);
+    if (c.p >= c.end || *c.p != '"')
+        return false;
+    ++c.p;
+
+    begin = c.p;
+    hasEscapes = false;
+    while (c.p < c.end) {
+        const char ch = *c.p;
+        if (ch == '"') {
+            stop = c.p;
+            ++c.p;
+            return true;
+        }
+        if (ch == '\\') {
+            hasEscapes = true;
+            c.p += 2;
+            continue;
+        }
+        ++c.p;
+    }
+    return false;
+}
+
+bool skipValue(Cursor &c)
+{
+    skipSpace(c);
+    if (c.p >= c.end)
+        return false;
+
+    const char *begin;
+    const char *stop;
+    bool hasEscapes;
+
+    if (*c.p == '"')
+        return scanString(c, begin, stop, hasEscapes);
+
+    if (*c.p == '{' || *c.p == '[') {
+        int level = 0;
+        while (c.p < c.end) {
+            const char ch = *c.p;
+            if (ch == '"') {
+                if (!scanString(c, begin, stop, hasEscapes))
+                    return false;
+                continue;
+            }
+            if (ch == '{' || ch == '[') {
+                ++level;
+            } else if (ch == '}' || ch == ']') {
+                if (--level == 0) {
+                    ++c.p;
+                    return true;
+                }
+            }
+            ++c.p;
+        }
+        return false;
+    }
+
+    // Number, true, false or null
+    const char *start = c.p;
+    while (c.p < c.end && *c.p != ',' && *c.p != '}' && *c.p != ']' && !isJsonSpace(*c.p))
+        ++c.p;
+    return c.p > start;
+}
+
+// With the cursor just inside an object, move it to the value of 'key'
+Lookup findMember(Cursor &c, const char *key)
+{
+    const qsizetype keyLength = qsizetype(strlen(key));
+
+    skipSpace(c);
+    if (c.p < c.end && *c.p == '}')
+        return Lookup::Missing;
+
+    while (true) {
+        const char *begin;
+        const char *stop;
+        bool hasEscapes;
+        if (!scanString(c, begin, stop, hasEscapes) || !expect(c, ':'))
+            return Lookup::Malformed;
+
+        if (!hasEscapes && stop - begin == keyLength && memcmp(begin, key, keyLength) == 0) {
+            skipSpace(c);
+            return Lookup::Found;
+        }
+
+        if (!skipValue(c))
+            return Lookup::Malformed;
+
+        skipSpace(c);
+        if (c.p < c.end && *c.p == ',') {
+            ++c.p;
+            continue;
+        }
+        if (c.p < c.end && *c.p == '}')
+            return Lookup::Missing;
+        return Lookup::Malformed;
+    }
+}
+
+bool keyIs(const Key &key, const char *name)
+{
+    const qsizetype length = qsizetype(strlen(name));
+    return key.data && key.size == length && memcmp(key.data, name, length) == 0;
+}
+
+bool skipNull(Cursor &c)
+{
+    skipSpace(c);
+    if (c.end - c.p >= 4 && memcmp(c.p, "null", 4) == 0) {
+        c.p += 4;
+        return true;
+    }
+    return false;
+}
+
+bool parseInt(Cursor &c, int &value)
+{
+    skipSpace(c);
+    const char *start = c.p;
+    value = 0;
+    while (c.p < c.end && *c.p >= '0' && *c.p <= '9') {
+        value = value * 10 + (*c.p - '0');
+        ++c.p;
+    }
+    return c.p > start;
+}
+
+// Calls onMember(key, cursor) for every member of the object the cursor is inside (just
+// after its '{'); onMember must consume the value. Keys with escapes are passed as empty.
+template<typename OnMember>
+bool forEachMember(Cursor &c, OnMember onMember)
+{
+    skipSpace(c);
+    if (c.p < c.end && *c.p == '}') {
+        ++c.p;
+        return true;
+    }
+
+    while (true) {
+        const char *begin;
+        const char *stop;
+        bool hasEscapes;
+        if (!scanString(c, begin, stop, hasEscapes) || !expect(c, ':'))
+            return false;
+
+        const Key key = hasEscapes ? Key() : Key{begin, stop - begin};
+        if (!onMember(key, c))
+            return false;
+
+        skipSpace(c);
+        if (c.p < c.end && *c.p == ',') {
+            ++c.p;
+            continue;
+        }
+        if (c.p < c.end && *c.p == '}') {
+            ++c.p;
+            return true;
+        }
+        return false;
+    }
+}
+
+int hexValue(char ch)
+{
+    if (ch >= '0' && ch <= '9') return ch - '0';
+    if (ch >= 'a' && ch <= 'f') return ch - 'a' + 10;
+    if (ch >= 'A' && ch <= 'F') return ch - 'A' + 10;
+    return -1;
+}
+
+bool decodeString(const char *begin, const char *stop, QString &out)
+{
+    out.clear();
+    out.reserve(stop - begin);
+
+    const char *run = begin;
+    const char *p = begin;
+    while (p < stop) {
+        if (*p != '\\') {
+            ++p;
+            continue;
+        }
+
+        // Flush the unescaped UTF-8 run before the escape
+        if (p > run)
+            out.append(QString::fromUtf8(run, p - run));
+
+        if (p + 1 >= stop)
+            return false;
+
+        const char esc = p[1];
+        p += 2;
+        switch (esc) {
+        case '"': out.append(QLatin1Char('"')); break;
+        case '\\': out.append(QLatin1Char('\\')); break;
+        case '/': out.append(QLatin1Char('/')); break;
+        case 'b': out.append(QLatin1Char('\b')); break;
+        case 'f': out.append(QLatin1Char('\f')); break;
+        case 'n': out.append(QLatin1Char('\n')); break;
+        case 'r': out.append(QLatin1Char('\r')); break;
+        case 't': out.append(QLatin1Char('\t')); break;
+        case 'u': {
+            if (stop - p < 4)
+                return false;
+            int code = 0;
+            for (int i = 0; i < 4; ++i) {
+                const int digit = hexValue(p[i]);
+                if (digit < 0)
+                    return false;
+                code = code * 16 + digit;
+            }
+            // Surrogate pairs arrive as two escapes and are appended as two UTF-16 units
+            out.append(QChar(char16_t(code)));
+            p += 4;
+            break;
+        }
+        default:
+            return false;
+        }
+        run = p;
+    }
+
+    if (stop > run)
+        out.append(QString::fromUtf8(run, stop - run));
+    return true;
+}
+
+} // namespace
+
+void SseStreamParser::append(const QByteArray &chunk)
+{
+    if (m_offset > 0 && (m_offset == m_buffer.size()
+                         || (m_offset >= kCompactThreshold && m_offset * 2 >= m_buffer.size()))) {
+        m_buffer.remove(0, m_offset);
+        m_offset = 0;
+    }
+    m_buffer.append(chunk);
+}
+
+bool SseStreamParser::nextData(QByteArray &data)
+{
+    while (m_offset < m_buffer.size()) {
+        const char *base = m_buffer.constData();
+        const char *lineStart = base + m_offset;
+        const char *newline = static_cast<const char *>(memchr(lineStart, '\n', m_buffer.size() - m_offset));
+        if (!newline)
+            return false; // incomplete line: wait for more data
+
+        m_offset = (newline - base) + 1;
+
+        // Blank lines separate events; event:, id:, retry: and ':' comments carry no content
+        const char *lineEnd = newline;
+        if (lineEnd - lineStart < 5 || memcmp(lineStart, "data:", 5) != 0)
+            continue;
+
+        const char *payload = lineStart + 5;
+        while (payload < lineEnd && isJsonSpace(*payload))
+            ++payload;
+        while (lineEnd > payload && isJsonSpace(lineEnd[-1]))
+            --lineEnd;
+
+        data = QByteArray::fromRawData(payload, lineEnd - payload);
+        return true;
+    }
+    return false;
+}
+
+bool SseStreamParser::isDone(const QByteArray &data)
+{
+    return data.size() == 6 && memcmp(data.data(), "[DONE]", 6) == 0;
+}
+
+bool SseStreamParser::hasUsage(const QByteArray &json)
+{
+    static const char key[] = "\"usage\":";
+    const qsizetype keyLength = sizeof(key) - 1;
+
+    qsizetype pos = json.indexOf(key);
+    if (pos < 0)
+        return false;
+
+    Cursor c{json.constData() + pos + keyLength, json.constData() + json.size()};
+    skipSpace(c);
+    return c.p < c.end && *c.p == '{';
+}
+
+void SseStreamParser::reset()
+{
+    m_buffer.clear();
+    m_offset = 0;
+}
+
+SseStreamParser::DeltaResult SseStreamParser::extractDeltas(const QByteArray &json, QVector<ChoiceDelta> &deltas)
+{
+    // Targeted walk to choices[i].index / choices[i].delta.content; everything else is skipped unparsed
+    deltas.clear();
+    Cursor c{json.constData(), json.constData() + json.size()};
+
+    if (!expect(c, '{'))
+        return Unrecognized;
+    if (findMember(c, "choices") != Lookup::Found || !expect(c, '['))
+        return Unrecognized;
+
+    skipSpace(c);
+    if (c.p < c.end && *c.p == ']')
+        return NoContent; // e.g. the trailing usage chunk
+
+    while (true) {
+        if (!expect(c, '{'))
+            return Unrecognized;
+
+        ChoiceDelta delta;
+        bool hasContent = false;
+
+        bool wellFormed = forEachMember(c, [&](const Key &key, Cursor &value) {
+            if (keyIs(key, "index"))
+                return parseInt(value, delta.index);
+            if (!keyIs(key, "delta"))
+                return skipValue(value);
+            if (skipNull(value))
+                return true;
+            if (!expect(value, '{'))
+                return false;
+
+            return forEachMember(value, [&](const Key &deltaKey, Cursor &field) {
+                if (!keyIs(deltaKey, "content"))
+                    return skipValue(field);
+                if (skipNull(field))
+                    return true;
+
+                const char *begin;
+                const char *stop;
+                bool hasEscapes;
+                if (!scanString(field, begin, stop, hasEscapes))
+                    return false;
+
+                hasContent = true;
+                if (!hasEscapes) {
+                    delta.content = QString::fromUtf8(begin, stop - begin);
+                    return true;
+                }
+                return decodeString(begin, stop, delta.content);
+            });
+        });
+
+        if (!wellFormed)
+            return Unrecognized;
+        if (hasContent)
+            deltas.append(delta);
+
+        skipSpace(c);
+        if (c.p < c.end && *c.p == ',') {
+            ++c.p;
+            continue;
+        }
+        if (c.p < c.end && *c.p == ']')
+            break;
+        return Unrecognized;
+    }
+
+    return deltas.isEmpty() ? NoContent : Content;
+}
+
+SseStreamParser::ChatFrame SseStreamParser::decodeChatFrame(const QByteArray &data, QVector<ChoiceDelta> &deltas,
+                                                            QVariantMap &usage, QString *errorOut)
+{
+    deltas.clear();
+    usage.clear();
+
+    if (isDone(data))
+        return ChatDone;
+    if (data.isEmpty())
+        return ChatChunk;
+
+    const DeltaResult result = extractDeltas(data, deltas);
+    if (result == Content)
+        return ChatChunk;
+    // The usage chunk (empty choices) is rare enough to parse fully
+    if (result == NoContent && !hasUsage(data))
+        return ChatChunk;
+
+    deltas.clear();
+    QJsonParseError parseError;
+    const QJsonDocument doc = QJsonDocument::fromJson(data, &parseError);
+    if (parseError.error != QJsonParseError::NoError) {
+        if (errorOut)
+            *errorOut = parseError.errorString();
+        return ChatInvalid;
+    }
+    if (!doc.isObject())
+        return ChatChunk;
+
+    const QJsonObject obj = doc.object();
+    if (obj.value("usage").isObject())
+        usage = obj.value("usage").toObject().toVariantMap();
+
+    const QJsonArray choices = obj.value("choices").toArray();
+    for (int i = 0; i < choices.size(); ++i) {
+        const QJsonObject choice = choices.at(i).toObject();
+        const QJsonValue content = choice.value("delta").toObject().value("content");
+        if (!content.isString())
+            continue;
+        ChoiceDelta delta;
+        delta.index = choice.value("index").toInt(i);
+        delta.content = content.toString();
+        deltas.append(delta);
+    }
+    return ChatChunk;
+}
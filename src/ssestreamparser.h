@@ -0,0 +1,75 @@
+#ifndef SSESTREAMPARSER_H
+#define SSESTREAMPARSER_H
+
+#pragma once
+
+#include <QByteArray>
+#include <QString>
+#include <QVariantMap>
+#include <QVector>
+
+/**
+ * @brief Incremental parser for server-sent event streams (text/event-stream).
+ *
+ * Network chunks are appended to one buffer that is consumed through a read
+ * offset; the consumed prefix is only dropped once it dominates the buffer,
+ * so a line costs a memchr rather than shifting the rest of the buffer.
+ * nextData() hands out the payload of every "data:" line as a raw-data
+ * QByteArray over the buffer, without copying it.
+ *
+ * extractDeltas() pulls the content deltas of every choice (index and
+ * delta.content) out of a chat completion chunk with a targeted scanner that
+ * skips everything else without building a JSON document. Frames it does not recognise are
+ * reported as Unrecognized so the caller can fall back to QJsonDocument.
+ * decodeChatFrame() combines both the way a chat completion stream is consumed.
+ */
+class SseStreamParser
+{
+public:
+    enum DeltaResult {
+        Content,        // at least one content delta extracted (may be empty)
+        NoContent,      // well-formed chunk without delta content (role-only, finish, empty choices)
+        Unrecognized    // not the usual chunk shape: parse it fully
+    };
+
+    struct ChoiceDelta {
+        int index = 0;          // choices[i].index (requests with n > 1 stream several choices)
+        QString content;
+    };
+
+    enum ChatFrame {
+        ChatChunk,      // a chunk; its deltas and usage may both be empty
+        ChatDone,       // the "[DONE]" terminator
+        ChatInvalid     // not JSON: the stream is broken
+    };
+
+    void append(const QByteArray &chunk);
+
+    // Next "data:" payload, trimmed. It refers to the buffer (QByteArray::fromRawData) and stays
+    // valid until the next append() or reset(); copy it to keep it longer.
+    bool nextData(QByteArray &data);
+
+    void reset();
+
+    // True for the "[DONE]" payload that terminates a chat completion stream
+    static bool isDone(const QByteArray &data);
+
+    // Bytes received but not consumed yet
+    qsizetype pendingBytes() const { return m_buffer.size() - m_offset; }
+
+    static DeltaResult extractDeltas(const QByteArray &json, QVector<ChoiceDelta> &deltas);
+
+    // True if the chunk carries a "usage" object (not null)
+    static bool hasUsage(const QByteArray &json);
+
+    // Decodes one "data:" payload of a chat completion stream: the scanner first, QJsonDocument
+    // for frames it does not recognise and for the usage chunk. Clears 'deltas' and 'usage' first.
+    static ChatFrame decodeChatFrame(const QByteArray &data, QVector<ChoiceDelta> &deltas, QVariantMap &usage,
+                                     QString *errorOut = nullptr);
+
+private:
+    QByteArray m_buffer;
+    qsizetype m_offset = 0;
+};
+
+#endif // SSESTREAMPARSER_H
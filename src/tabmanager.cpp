@@ -9,14 +9,17 @@
 #include <QPointer>
 #include <QHash>
 
-TabManager::TabManager(DraggableTabWidget* mainTabWidget, QWidget* projectTab, Project* project, QObject* parent)
+TabManager::TabManager(DraggableTabWidget* mainTabWidget, QWidget* projectTab, Project* project,
+                       AIBackend* aiBackend, QObject* parent)
     : QObject(parent)
     , m_mainTabWidget(mainTabWidget)
     , m_projectTab(projectTab)
     , m_project(project)
+    , m_aiBackend(aiBackend)
 {
     Q_ASSERT(mainTabWidget);
     Q_ASSERT(projectTab);
+    Q_ASSERT(aiBackend);
 
     // Connect signals on main tab widget
     setupTabWidgetConnections(m_mainTabWidget);
@@ -50,7 +53,7 @@ SessionTabWidget* TabManager::openSession(const QString& sessionFilePath)
     }
 
     // Create new session tab widget
-    SessionTabWidget* tab = new SessionTabWidget(absPath, m_project, m_mainTabWidget);
+    SessionTabWidget* tab = new SessionTabWidget(absPath, m_project, m_aiBackend, m_mainTabWidget);
     m_openSessions.insert(absPath, tab);
 
     // Add to main tab widget
@@ -10,13 +10,15 @@
 
 class SessionTabWidget;
 class Project;
+class AIBackend;
 class DetachedWindow;
 
 class TabManager : public QObject
 {
     Q_OBJECT
 public:
-    explicit TabManager(DraggableTabWidget* mainTabWidget, QWidget* projectTab, Project* project, QObject* parent = nullptr);
+    explicit TabManager(DraggableTabWidget* mainTabWidget, QWidget* projectTab, Project* project,
+                        AIBackend* aiBackend, QObject* parent = nullptr);
     ~TabManager() override;
 
     // Open a session tab by file path; returns pointer to tab widget
@@ -54,6 +56,8 @@ private:
     DraggableTabWidget* m_mainTabWidget = nullptr;
     QWidget* m_projectTab = nullptr;
     Project* m_project = nullptr;
+    // Shared by every session tab, wherever the tab is docked
+    AIBackend* m_aiBackend = nullptr;
 
     // Map session file path -> session tab widget
     QMap<QString, SessionTabWidget*> m_openSessions;
@@ -0,0 +1,478 @@
+#include "tokenizer.h"
+
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QStandardPaths>
+#include <QMutexLocker>
+#include <QDebug>
+
+#include <climits>
+#include <vector>
+
+namespace {
+
+// Character classes of the pre-tokenization regexes
+inline bool isLetter(uint c) { return QChar::isLetter(c); }          // \p{L}
+inline bool isNumber(uint c) { return QChar::isNumber(c); }          // \p{N}
+inline bool isSpace(uint c) { return QChar::isSpace(c); }            // \s
+inline bool isNewline(uint c) { return c == '\r' || c == '\n'; }
+// [^\r\n\p{L}\p{N}]
+inline bool isPrefix(uint c) { return !isNewline(c) && !isLetter(c) && !isNumber(c); }
+// [^\s\p{L}\p{N}]
+inline bool isSymbol(uint c) { return !isSpace(c) && !isLetter(c) && !isNumber(c); }
+
+inline bool isMark(QChar::Category category)
+{
+    return category == QChar::Mark_NonSpacing || category == QChar::Mark_SpacingCombining
+           || category == QChar::Mark_Enclosing;
+}
+
+// o200k: [\p{Lu}\p{Lt}\p{Lm}\p{Lo}\p{M}]
+inline bool isUpperClass(uint c)
+{
+    const QChar::Category category = QChar::category(c);
+    return category == QChar::Letter_Uppercase || category == QChar::Letter_Titlecase
+           || category == QChar::Letter_Modifier || category == QChar::Letter_Other || isMark(category);
+}
+
+// o200k: [\p{Ll}\p{Lm}\p{Lo}\p{M}]
+inline bool isLowerClass(uint c)
+{
+    const QChar::Category category = QChar::category(c);
+    return category == QChar::Letter_Lowercase || category == QChar::Letter_Modifier
+           || category == QChar::Letter_Other || isMark(category);
+}
+
+// (?i:'s|'t|'re|'ve|'m|'ll|'d) at 'pos'; its length or 0
+int contractionLength(const uint *text, int size, int pos)
+{
+    if (pos + 1 >= size || text[pos] != '\'')
+        return 0;
+    auto lower = [text](int i) { return (text[i] >= 'A' && text[i] <= 'Z') ? text[i] + 32 : text[i]; };
+
+    const uint first = lower(pos + 1);
+    if (first == 's' || first == 't' || first == 'm' || first == 'd')
+        return 2;
+    if (pos + 2 < size) {
+        const uint second = lower(pos + 2);
+        if ((first == 'r' && second == 'e') || (first == 'v' && second == 'e') || (first == 'l' && second == 'l'))
+            return 3;
+    }
+    return 0;
+}
+
+// \s*[\r\n]+ | \s+(?!\S) | \s+ at a whitespace character
+int whitespaceEnd(const uint *text, int size, int pos)
+{
+    int end = pos;
+    int lastNewline = -1;
+    while (end < size && isSpace(text[end])) {
+        if (isNewline(text[end]))
+            lastNewline = end;
+        ++end;
+    }
+
+    if (lastNewline >= 0)
+        return lastNewline + 1;
+    // Leave the last space to prefix the following word
+    if (end == size || end - pos == 1)
+        return end;
+    return end - 1;
+}
+
+// " ?[^\s\p{L}\p{N}]+" and the newlines (o200k: also slashes) after it; -1 if there is no symbol
+int symbolsEnd(const uint *text, int size, int pos, bool slashTrails)
+{
+    int end = pos;
+    if (text[end] == ' ')
+        ++end;
+    if (end >= size || !isSymbol(text[end]))
+        return -1;
+    while (end < size && isSymbol(text[end]))
+        ++end;
+    while (end < size && (isNewline(text[end]) || (slashTrails && text[end] == '/')))
+        ++end;
+    return end;
+}
+
+// \p{N}{1,3}
+int numberEnd(const uint *text, int size, int pos)
+{
+    int end = pos;
+    while (end < size && end - pos < 3 && isNumber(text[end]))
+        ++end;
+    return end;
+}
+
+/*
+ * cl100k_base:
+ *   (?i:'s|'t|'re|'ve|'m|'ll|'d)|[^\r\n\p{L}\p{N}]?\p{L}+|\p{N}{1,3}| ?[^\s\p{L}\p{N}]+[\r\n]*
+ *   |\s*[\r\n]+|\s+(?!\S)|\s+
+ */
+int cl100kPieceEnd(const uint *text, int size, int pos)
+{
+    if (const int length = contractionLength(text, size, pos))
+        return pos + length;
+
+    int end = pos;
+    if (isPrefix(text[pos]) && pos + 1 < size && isLetter(text[pos + 1]))
+        ++end;
+    if (isLetter(text[end])) {
+        while (end < size && isLetter(text[end]))
+            ++end;
+        return end;
+    }
+
+    if (isNumber(text[pos]))
+        return numberEnd(text, size, pos);
+
+    end = symbolsEnd(text, size, pos, false);
+    if (end >= 0)
+        return end;
+
+    return whitespaceEnd(text, size, pos);
+}
+
+// o200k: [\p{Lu}\p{Lt}\p{Lm}\p{Lo}\p{M}]*[\p{Ll}\p{Lm}\p{Lo}\p{M}]+ at 'pos'; -1 if it doesn't match
+int casedWordEnd(const uint *text, int size, int pos)
+{
+    int end = pos;
+    while (end < size && isUpperClass(text[end]))
+        ++end;
+    // Backtrack like the regex: the upper-class run gives back characters until the
+    // lower-class run can start, e.g. "\u4e2d\u6587ABC" matches "\u4e2d\u6587" (\p{Lo} is in both)
+    for (int start = end; start >= pos; --start) {
+        if (start == size || !isLowerClass(text[start]))
+            continue;
+        int lowerEnd = start;
+        while (lowerEnd < size && isLowerClass(text[lowerEnd]))
+            ++lowerEnd;
+        return lowerEnd;
+    }
+    return -1;
+}
+
+// o200k: [\p{Lu}\p{Lt}\p{Lm}\p{Lo}\p{M}]+[\p{Ll}\p{Lm}\p{Lo}\p{M}]* at 'pos'; -1 if it doesn't match
+int upperWordEnd(const uint *text, int size, int pos)
+{
+    int end = pos;
+    while (end < size && isUpperClass(text[end]))
+        ++end;
+    if (end == pos)
+        return -1;
+    while (end < size && isLowerClass(text[end]))
+        ++end;
+    return end;
+}
+
+/*
+ * o200k_base:
+ *   [^\r\n\p{L}\p{N}]?[\p{Lu}\p{Lt}\p{Lm}\p{Lo}\p{M}]*[\p{Ll}\p{Lm}\p{Lo}\p{M}]+(?i:'s|'t|'re|'ve|'m|'ll|'d)?
+ *   |[^\r\n\p{L}\p{N}]?[\p{Lu}\p{Lt}\p{Lm}\p{Lo}\p{M}]+[\p{Ll}\p{Lm}\p{Lo}\p{M}]*(?i:'s|'t|'re|'ve|'m|'ll|'d)?
+ *   |\p{N}{1,3}| ?[^\s\p{L}\p{N}]+[\r\n/]*|\s*[\r\n]+|\s+(?!\S)|\s+
+ */
+int o200kPieceEnd(const uint *text, int size, int pos)
+{
+    // Alternatives in regex order, each first with the optional prefix character
+    const bool prefix = isPrefix(text[pos]) && pos + 1 < size;
+    int end = prefix ? casedWordEnd(text, size, pos + 1) : -1;
+    if (end < 0)
+        end = casedWordEnd(text, size, pos);
+    if (end < 0 && prefix)
+        end = upperWordEnd(text, size, pos + 1);
+    if (end < 0)
+        end = upperWordEnd(text, size, pos);
+    if (end >= 0)
+        return end + contractionLength(text, size, end);
+
+    if (isNumber(text[pos]))
+        return numberEnd(text, size, pos);
+
+    end = symbolsEnd(text, size, pos, true);
+    if (end >= 0)
+        return end;
+
+    return whitespaceEnd(text, size, pos);
+}
+
+void appendUtf8(QByteArray &out, uint c)
+{
+    if (c < 0x80) {
+        out.append(char(c));
+    } else if (c < 0x800) {
+        out.append(char(0xC0 | (c >> 6)));
+        out.append(char(0x80 | (c & 0x3F)));
+    } else if (c < 0x10000) {
+        out.append(char(0xE0 | (c >> 12)));
+        out.append(char(0x80 | ((c >> 6) & 0x3F)));
+        out.append(char(0x80 | (c & 0x3F)));
+    } else {
+        out.append(char(0xF0 | (c >> 18)));
+        out.append(char(0x80 | ((c >> 12) & 0x3F)));
+        out.append(char(0x80 | ((c >> 6) & 0x3F)));
+        out.append(char(0x80 | (c & 0x3F)));
+    }
+}
+
+} // namespace
+
+Tokenizer::Tokenizer(Encoding encoding)
+    : m_encoding(encoding)
+    , m_countCache(kCountCacheEntries)
+{
+    const QString fileName = rankFileName(encoding);
+    const QStringList folders = rankFileSearchPaths();
+    for (const QString &folder : folders) {
+        const QString path = QDir(folder).filePath(fileName);
+        if (QFileInfo::exists(path) && loadRanks(path)) {
+            qDebug() << "[Tokenizer::Tokenizer] Loaded" << m_ranks.size() << "ranks from" << path;
+            return;
+        }
+    }
+    qWarning() << "[Tokenizer::Tokenizer] No" << fileName << "in" << folders << "- token counts are estimated";
+}
+
+const Tokenizer &Tokenizer::forModel(const QString &model)
+{
+    static const Tokenizer cl100k(Cl100kBase);
+    if (encodingForModel(model) == Cl100kBase)
+        return cl100k;
+    static const Tokenizer o200k(O200kBase);
+    return o200k;
+}
+
+Tokenizer::Encoding Tokenizer::encodingForModel(const QString &model)
+{
+    static const char *const o200kPrefixes[] = {
+        "gpt-4o", "chatgpt-4o", "gpt-4.1", "gpt-4.5", "gpt-5", "gpt-oss", "o1", "o3", "o4"
+    };
+    const QString name = model.trimmed().toLower();
+    for (const char *prefix : o200kPrefixes) {
+        if (name.startsWith(QLatin1String(prefix)))
+            return O200kBase;
+    }
+    return Cl100kBase;
+}
+
+int Tokenizer::contextWindow(const QString &model)
+{
+    const QString name = model.trimmed().toLower();
+    if (name.startsWith("gpt-5"))
+        return 400000;
+    if (name.startsWith("gpt-4.1"))
+        return 1047576;
+    if (name.startsWith("o1-mini"))
+        return 128000;
+    if (name.startsWith("o1") || name.startsWith("o3") || name.startsWith("o4"))
+        return 200000;
+    if (name.startsWith("gpt-4o") || name.startsWith("chatgpt-4o") || name.startsWith("gpt-4.5")
+        || name.startsWith("gpt-4-turbo") || name.startsWith("gpt-4-1106") || name.startsWith("gpt-4-0125"))
+        return 128000;
+    if (name.startsWith("gpt-4-32k"))
+        return 32768;
+    if (name.startsWith("gpt-4"))
+        return 8192;
+    if (name.startsWith("gpt-3.5-turbo"))
+        return 16385;
+    return 128000;
+}
+
+QString Tokenizer::rankFileName(Encoding encoding)
+{
+    return encoding == O200kBase ? QStringLiteral("o200k_base.tiktoken") : QStringLiteral("cl100k_base.tiktoken");
+}
+
+QStringList Tokenizer::rankFileSearchPaths()
+{
+    QStringList folders;
+    const QString envDir = qEnvironmentVariable("VIBEKODER_TOKENIZER_DIR");
+    if (!envDir.isEmpty())
+        folders << envDir;
+    folders << QDir(QStandardPaths::writableLocation(QStandardPaths::AppConfigLocation)).filePath("tokenizers");
+    folders << QDir(QCoreApplication::applicationDirPath()).filePath("tokenizers");
+    return folders;
+}
+
+bool Tokenizer::loadRanks(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning() << "[Tokenizer::loadRanks] Failed to open" << path;
+        return false;
+    }
+
+    // One "<base64 token bytes> <rank>" per line
+    QList<QByteArray> tokens;
+    QList<int> ranks;
+    qsizetype totalBytes = 0;
+    while (!file.atEnd()) {
+        const QByteArray line = file.readLine().trimmed();
+        if (line.isEmpty())
+            continue;
+        const int space = line.indexOf(' ');
+        bool ok = false;
+        const int rank = space > 0 ? line.mid(space + 1).toInt(&ok) : -1;
+        if (!ok) {
+            qWarning() << "[Tokenizer::loadRanks] Malformed line in" << path << ":" << line.left(80);
+            return false;
+        }
+        tokens.append(QByteArray::fromBase64(line.left(space)));
+        ranks.append(rank);
+        totalBytes += tokens.last().size();
+    }
+
+    // The map's keys point into one buffer that is never resized afterwards
+    m_tokenBytes.reserve(totalBytes);
+    for (const QByteArray &token : tokens)
+        m_tokenBytes.append(token);
+
+    m_ranks.reserve(size_t(tokens.size()));
+    const char *data = m_tokenBytes.constData();
+    for (int i = 0; i < tokens.size(); ++i) {
+        m_ranks.emplace(std::string_view(data, size_t(tokens.at(i).size())), ranks.at(i));
+        data += tokens.at(i).size();
+    }
+    return !m_ranks.empty();
+}
+
+int Tokenizer::count(const QString &text) const
+{
+    if (text.isEmpty())
+        return 0;
+    if (!isExact())
+        return int((text.toUtf8().size() + 3) / 4);
+
+    const QList<uint> codePoints = text.toUcs4();
+    const uint *data = codePoints.constData();
+    const int size = int(codePoints.size());
+
+    int tokens = 0;
+    QByteArray piece;
+    for (int pos = 0; pos < size;) {
+        int end = m_encoding == O200kBase ? o200kPieceEnd(data, size, pos) : cl100kPieceEnd(data, size, pos);
+        if (end <= pos)
+            end = pos + 1;
+
+        piece.clear();
+        for (int i = pos; i < end; ++i)
+            appendUtf8(piece, data[i]);
+        tokens += bytePairCount(piece);
+        pos = end;
+    }
+    return tokens;
+}
+
+QStringList Tokenizer::preTokenize(const QString &text, Encoding encoding)
+{
+    const QList<uint> codePoints = text.toUcs4();
+    const uint *data = codePoints.constData();
+    const int size = int(codePoints.size());
+
+    QStringList pieces;
+    QByteArray piece;
+    for (int pos = 0; pos < size;) {
+        int end = encoding == O200kBase ? o200kPieceEnd(data, size, pos) : cl100kPieceEnd(data, size, pos);
+        if (end <= pos)
+            end = pos + 1;
+
+        piece.clear();
+        for (int i = pos; i < end; ++i)
+            appendUtf8(piece, data[i]);
+        pieces << QString::fromUtf8(piece);
+        pos = end;
+    }
+    return pieces;
+}
+
+QString Tokenizer::textKey(const QString &text)
+{
+    return QStringLiteral("text|")
+           + QString::fromLatin1(QCryptographicHash::hash(text.toUtf8(), QCryptographicHash::Sha1).toHex());
+}
+
+int Tokenizer::countCached(const QString &text) const
+{
+    return countCached(textKey(text), text);
+}
+
+int Tokenizer::countCached(const QString &key, const QString &text) const
+{
+    {
+        QMutexLocker locker(&m_cacheMutex);
+        if (const int *tokens = m_countCache.object(key))
+            return *tokens;
+    }
+
+    const int tokens = count(text);
+
+    QMutexLocker locker(&m_cacheMutex);
+    m_countCache.insert(key, new int(tokens));
+    return tokens;
+}
+
+int Tokenizer::cachedCount(const QString &key) const
+{
+    QMutexLocker locker(&m_cacheMutex);
+    const int *tokens = m_countCache.object(key);
+    return tokens ? *tokens : -1;
+}
+
+int Tokenizer::rank(const char *data, int size) const
+{
+    auto it = m_ranks.find(std::string_view(data, size_t(size)));
+    return it == m_ranks.end() ? -1 : it->second;
+}
+
+int Tokenizer::bytePairCount(const QByteArray &piece) const
+{
+    const int size = int(piece.size());
+    if (size <= 1)
+        return size;
+    const char *data = piece.constData();
+    if (rank(data, size) >= 0)
+        return 1;
+
+    // tiktoken's byte_pair_merge: parts start where the tokens start, each with the rank
+    // of merging it with the next part; the lowest-ranked pair is merged until none is known
+    struct Part {
+        int start;
+        int rank;
+    };
+    std::vector<Part> parts;
+    parts.reserve(size_t(size) + 1);
+    for (int i = 0; i + 1 < size; ++i) {
+        const int pairRank = rank(data + i, 2);
+        parts.push_back({i, pairRank < 0 ? INT_MAX : pairRank});
+    }
+    parts.push_back({size - 1, INT_MAX});
+    parts.push_back({size, INT_MAX});
+
+    auto mergedRank = [&](size_t i) {
+        if (i + 3 >= parts.size())
+            return INT_MAX;
+        const int merged = rank(data + parts[i].start, parts[i + 3].start - parts[i].start);
+        return merged < 0 ? INT_MAX : merged;
+    };
+
+    for (;;) {
+        size_t best = 0;
+        int bestRank = INT_MAX;
+        for (size_t i = 0; i + 1 < parts.size(); ++i) {
+            if (parts[i].rank < bestRank) {
+                bestRank = parts[i].rank;
+                best = i;
+            }
+        }
+        if (bestRank == INT_MAX)
+            break;
+
+        parts[best].rank = mergedRank(best);
+        if (best > 0)
+            parts[best - 1].rank = mergedRank(best - 1);
+        parts.erase(parts.begin() + best + 1);
+    }
+    return int(parts.size()) - 1;
+}
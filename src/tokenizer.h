@@ -0,0 +1,88 @@
+#ifndef TOKENIZER_H
+#define TOKENIZER_H
+
+#pragma once
+
+#include <QString>
+#include <QStringList>
+#include <QByteArray>
+#include <QCache>
+#include <QMutex>
+
+#include <string_view>
+#include <unordered_map>
+
+/**
+ * @brief In-process byte pair encoding tokenizer compatible with tiktoken's
+ * cl100k_base and o200k_base encodings, used to count prompt tokens before sending.
+ *
+ * Text is first split into pieces by a hand-written scanner equivalent to the
+ * encoding's pre-tokenization regex; every piece is then encoded by merging the
+ * lowest-ranked byte pairs until no pair is in the vocabulary. Only counts are
+ * produced, special tokens are never recognised (like encode_ordinary).
+ *
+ * The vocabularies are the tiktoken rank files (cl100k_base.tiktoken,
+ * o200k_base.tiktoken), looked up in $VIBEKODER_TOKENIZER_DIR, the application
+ * config folder's "tokenizers" folder and the "tokenizers" folder next to the
+ * executable. Without one, counts fall back to an estimate of 4 bytes per token.
+ */
+class Tokenizer
+{
+public:
+    enum Encoding {
+        Cl100kBase,
+        O200kBase
+    };
+
+    // Chat framing around every message (<|start|>role<|message|>...<|end|>) and the reply
+    static constexpr int kTokensPerMessage = 4;
+    static constexpr int kReplyPrimingTokens = 3;
+
+    // Shared tokenizer for the encoding the model uses; the rank file is loaded on first use
+    static const Tokenizer &forModel(const QString &model);
+    static Encoding encodingForModel(const QString &model);
+    // Context window (prompt plus answer) of the model, in tokens
+    static int contextWindow(const QString &model);
+
+    static QString rankFileName(Encoding encoding);
+    static QStringList rankFileSearchPaths();
+
+    Encoding encoding() const { return m_encoding; }
+    // False when no rank file was found and counts are estimates
+    bool isExact() const { return !m_ranks.empty(); }
+
+    int count(const QString &text) const;
+    // As count(), remembered under the SHA-1 of the text (see textKey())
+    int countCached(const QString &text) const;
+    // As count(), remembered under 'key' (e.g. the content hash of a stored include)
+    int countCached(const QString &key, const QString &text) const;
+    // Count remembered under 'key', or -1; lets callers skip reading text that was counted before
+    int cachedCount(const QString &key) const;
+    // Key countCached(text) remembers a text under
+    static QString textKey(const QString &text);
+
+    // Pieces the encoding's pre-tokenization regex splits the text into
+    static QStringList preTokenize(const QString &text, Encoding encoding);
+
+private:
+    explicit Tokenizer(Encoding encoding);
+    Tokenizer(const Tokenizer &) = delete;
+    Tokenizer &operator=(const Tokenizer &) = delete;
+
+    bool loadRanks(const QString &path);
+
+    // Number of tokens the UTF-8 bytes of one piece encode to
+    int bytePairCount(const QByteArray &piece) const;
+    int rank(const char *data, int size) const;
+
+    Encoding m_encoding;
+    QByteArray m_tokenBytes;    // every token's bytes back to back; m_ranks views into it
+    std::unordered_map<std::string_view, int> m_ranks;
+
+    // Counts of the most recently used texts; the least recently used go first
+    static constexpr int kCountCacheEntries = 8192;
+    mutable QMutex m_cacheMutex;
+    mutable QCache<QString, int> m_countCache;
+};
+
+#endif // TOKENIZER_H
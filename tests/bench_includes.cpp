@@ -0,0 +1,116 @@
+#include "benchmark.h"
+#include "project.h"
+#include "session.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QTemporaryDir>
+#include <QDebug>
+
+#include <algorithm>
+
+/*
+ * Caches and expands a slice with 200 includes of 50 KB files through Session
+ * (include store, expansion cache) and PromptCompiler: the cost of caching the
+ * includes once, of the first and of every later expansion, and of compiling
+ * the whole prompt.
+ */
+
+namespace {
+
+const int kIncludeFiles = 200;
+const int kIncludeFileBytes = 50 * 1024;
+const int kIncludeRepeats = 5;
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Caches and expands 200 includes of 50 KB and reports the timings.");
+    const Benchmark::Options options = Benchmark::parseArguments(parser, app);
+
+    QTemporaryDir root;
+    if (!root.isValid() || !QDir(root.path()).mkpath("docs") || !QDir(root.path()).mkpath("sessions")) {
+        qCritical() << "[bench_includes] Failed to create a temporary project folder";
+        return 1;
+    }
+
+    Project project;
+    project.setValue("folders.root", root.path());
+    project.setValue("folders.docs", QDir(root.path()).filePath("docs"));
+    project.setValue("folders.src", QDir(root.path()).filePath("src"));
+    project.setValue("folders.sessions", QDir(root.path()).filePath("sessions"));
+
+    QByteArray line = "Lorem ipsum dolor sit amet, consectetur adipiscing elit, sed do eiusmod tempor.\n";
+    QByteArray body;
+    while (body.size() < kIncludeFileBytes)
+        body += line;
+    body.truncate(kIncludeFileBytes);
+
+    QString prompt = QStringLiteral("Review these documents.\n\n");
+    for (int i = 0; i < kIncludeFiles; ++i) {
+        const QString relPath = QString("docs/doc_%1.md").arg(i, 3, 10, QChar('0'));
+        QFile file(QDir(root.path()).filePath(relPath));
+        // Distinct contents, so the include store can't share one object between them
+        if (!file.open(QIODevice::WriteOnly) || file.write(QByteArray::number(i) + '\n' + body) < 0) {
+            qCritical() << "[bench_includes] Failed to write" << file.fileName();
+            return 1;
+        }
+        prompt += QString("## %1\n<!-- include: %1 -->\n\n").arg(relPath);
+    }
+
+    Session session(&project);
+    session.appendSystemSlice("You are a helpful assistant.");
+    session.appendUserSlice(prompt);
+    const QString sessionPath = QDir(root.path()).filePath("sessions/bench.md");
+    if (!session.save(sessionPath)) {
+        qCritical() << "[bench_includes] Failed to write session:" << sessionPath;
+        return 1;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    if (!session.refreshCacheAndSave()) {
+        qCritical() << "[bench_includes] Caching the includes failed";
+        return 1;
+    }
+    const qint64 cacheMs = timer.elapsed();
+
+    timer.restart();
+    QVector<PromptSlice> expanded = session.expandedSlices();
+    const qint64 expandColdMs = timer.elapsed();
+
+    // Unchanged slices come from the expansion cache; compilePrompt() always recompiles
+    QVector<qint64> expandWarm;
+    QVector<qint64> compile;
+    qint64 promptChars = 0;
+    for (int i = 0; i < kIncludeRepeats; ++i) {
+        timer.restart();
+        expanded = session.expandedSlices();
+        expandWarm.append(timer.nsecsElapsed() / 1000);
+
+        timer.restart();
+        promptChars = session.compilePrompt().size();
+        compile.append(timer.elapsed());
+    }
+    std::sort(expandWarm.begin(), expandWarm.end());
+    std::sort(compile.begin(), compile.end());
+
+    QJsonObject result;
+    result["includes"] = kIncludeFiles;
+    result["include_bytes"] = kIncludeFileBytes;
+    result["cache_ms"] = cacheMs;
+    result["expand_cold_ms"] = expandColdMs;
+    result["expand_warm_us_p50"] = Benchmark::percentile(expandWarm, 0.50);
+    result["compile_prompt_ms_p50"] = Benchmark::percentile(compile, 0.50);
+    result["compile_prompt_ms_max"] = compile.last();
+    result["prompt_chars"] = promptChars;
+    result["expanded_chars"] = expanded.size() > 1 ? qint64(expanded.at(1).content.size()) : 0;
+    result["peak_rss_kb"] = Benchmark::peakRssKB();
+    return Benchmark::report("includes", result, options);
+}
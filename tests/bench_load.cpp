@@ -0,0 +1,60 @@
+#include "benchmark.h"
+#include "loadharness.h"
+#include "mockopenaiserver.h"
+#include "openaibackend.h"
+#include "requestscheduler.h"
+
+#include <QApplication>
+#include <QCommandLineOption>
+#include <QCommandLineParser>
+#include <QDebug>
+
+/*
+ * Streams into N session tabs at once from a local MockOpenAIServer (synthetic
+ * tokens, or the recorded SSE stream given with --input) and reports what the
+ * user sees: time to first render, rendered throughput and GUI event loop
+ * latency. Errors can be injected with the mock server's options.
+ */
+
+int main(int argc, char *argv[])
+{
+    QApplication app(argc, argv);
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Streams into session tabs from a mock server and reports the latencies.");
+    QCommandLineOption tabsOption("tabs", "Number of session tabs streaming at once.", "count", "8");
+    QCommandLineOption timeoutOption("timeout", "Give up after this many seconds.", "secs", "120");
+    parser.addOptions({tabsOption, timeoutOption});
+    MockOpenAIServer::addOptions(parser);
+    const Benchmark::Options options = Benchmark::parseArguments(parser, app);
+
+    MockOpenAIServer::Options mockOptions = MockOpenAIServer::optionsFromArguments(parser);
+    mockOptions.replayFile = options.inputPath;
+    MockOpenAIServer server(mockOptions);
+    QString error;
+    if (!server.listen(0, &error)) {
+        qCritical().noquote() << "[bench_load] Mock server failed:" << error;
+        return 1;
+    }
+
+    // Same backend chain as MainWindow, minus the response cache that would hide the streams
+    RequestScheduler backend(new OpenAIBackend());
+    QVariantMap backendConfig;
+    backendConfig["api_base_url"] = server.baseUrl();
+    backendConfig["access_token"] = "mock";
+    backendConfig["model"] = "mock-model";
+
+    LoadHarness::Options harnessOptions;
+    harnessOptions.tabs = qMax(1, parser.value(tabsOption).toInt());
+    harnessOptions.timeoutSecs = qMax(1, parser.value(timeoutOption).toInt());
+
+    LoadHarness harness(&backend, backendConfig, harnessOptions);
+    QObject::connect(&harness, &LoadHarness::finished, &app, [&](const QJsonObject &result) {
+        const int reported = Benchmark::report("load", result, options);
+        app.exit(result.value("timed_out").toBool() ? 1 : reported);
+    });
+    if (!harness.start(&error)) {
+        qCritical().noquote() << "[bench_load] Benchmark failed:" << error;
+        return 1;
+    }
+    return app.exec();
+}
@@ -0,0 +1,97 @@
+#include "benchmark.h"
+#include "session.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QTemporaryDir>
+#include <QDebug>
+
+#include <algorithm>
+
+/*
+ * Loads synthetic session files of 1 MB, 10 MB and 100 MB through
+ * Session::load(): a long conversation of alternating prompts and answers of
+ * a few KB, with code blocks and include markers.
+ */
+
+namespace {
+
+const int kParseRepeats = 3;
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Loads session files of 1, 10 and 100 MB and reports the timings.");
+    const Benchmark::Options options = Benchmark::parseArguments(parser, app);
+
+    QTemporaryDir root;
+    if (!root.isValid()) {
+        qCritical() << "[bench_parse] Failed to create a temporary folder";
+        return 1;
+    }
+
+    QString answer;
+    while (answer.size() < 4096) {
+        answer += QStringLiteral("The parser splits the file at slice separators and keeps **markdown** as it is.\n\n"
+                                 "```cpp\nfor (const PromptSlice &slice : slices)\n    total += slice.content.size();\n```\n\n");
+    }
+    const QString prompt = QStringLiteral("Explain the next part, <!-- cached: docs/Vision.md --> included.");
+
+    QJsonArray sizes;
+    for (const qint64 targetBytes : {qint64(1) << 20, qint64(10) << 20, qint64(100) << 20}) {
+        const QString path = QDir(root.path()).filePath(QString("parse_%1mb.md").arg(targetBytes >> 20));
+        {
+            Session session;
+            session.appendSystemSlice("You are a helpful assistant.");
+            qint64 bytes = 0;
+            while (bytes < targetBytes) {
+                session.appendUserSlice(prompt);
+                session.appendAssistantSlice(answer);
+                bytes += (prompt.size() + answer.size()) + 200;    // plus separators and timestamps
+            }
+            if (!session.save(path)) {
+                qCritical() << "[bench_parse] Failed to write session:" << path;
+                return 1;
+            }
+        }
+
+        QVector<qint64> loadMs;
+        int slices = 0;
+        for (int i = 0; i < kParseRepeats; ++i) {
+            Session session;
+            QElapsedTimer timer;
+            timer.start();
+            if (!session.load(path)) {
+                qCritical() << "[bench_parse] Failed to load session:" << path;
+                return 1;
+            }
+            loadMs.append(timer.elapsed());
+            slices = session.slices().size();
+        }
+        std::sort(loadMs.begin(), loadMs.end());
+
+        const qint64 fileBytes = QFileInfo(path).size();
+        const qint64 medianMs = Benchmark::percentile(loadMs, 0.50);
+        sizes.append(QJsonObject{
+            {"file_bytes", fileBytes},
+            {"slices", slices},
+            {"load_ms_p50", medianMs},
+            {"load_ms_max", loadMs.last()},
+            {"mb_per_second", medianMs > 0 ? (fileBytes / 1048576.0) / (medianMs / 1000.0) : 0.0},
+        });
+        QFile::remove(path);
+    }
+
+    QJsonObject result;
+    result["sizes"] = sizes;
+    result["peak_rss_kb"] = Benchmark::peakRssKB();
+    return Benchmark::report("parse", result, options);
+}
@@ -0,0 +1,267 @@
+#include "benchmark.h"
+#include "ssestreamparser.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QStringList>
+#include <QDebug>
+
+#include <atomic>
+#include <cerrno>
+
+/*
+ * Replays a chat completion stream through SseStreamParser in network-sized
+ * chunks and decodes every frame with decodeChatFrame(), as
+ * OpenAIBackend::processStreamData does, against a baseline that runs every
+ * frame through QJsonDocument. Reports deltas per second and heap
+ * allocations and frees per delta (counted on glibc only).
+ */
+
+#if defined(__GLIBC__)
+// This executable's malloc family forwards to glibc's and counts calls while a section enables
+// it. Qt and operator new allocate through it, so the counts cover the whole decode path.
+extern "C" void *__libc_malloc(size_t size);
+extern "C" void *__libc_calloc(size_t count, size_t size);
+extern "C" void *__libc_realloc(void *ptr, size_t size);
+extern "C" void *__libc_memalign(size_t alignment, size_t size);
+extern "C" void __libc_free(void *ptr);
+
+namespace {
+
+std::atomic<bool> g_counting{false};
+std::atomic<quint64> g_allocations{0};
+std::atomic<quint64> g_frees{0};
+
+inline void countAllocation()
+{
+    if (g_counting.load(std::memory_order_relaxed))
+        g_allocations.fetch_add(1, std::memory_order_relaxed);
+}
+
+} // namespace
+
+extern "C" void *malloc(size_t size) noexcept
+{
+    countAllocation();
+    return __libc_malloc(size);
+}
+
+extern "C" void *calloc(size_t count, size_t size) noexcept
+{
+    countAllocation();
+    return __libc_calloc(count, size);
+}
+
+extern "C" void *realloc(void *ptr, size_t size) noexcept
+{
+    countAllocation();
+    return __libc_realloc(ptr, size);
+}
+
+extern "C" void *memalign(size_t alignment, size_t size) noexcept
+{
+    countAllocation();
+    return __libc_memalign(alignment, size);
+}
+
+extern "C" void *aligned_alloc(size_t alignment, size_t size) noexcept
+{
+    countAllocation();
+    return __libc_memalign(alignment, size);
+}
+
+extern "C" int posix_memalign(void **ptr, size_t alignment, size_t size) noexcept
+{
+    if (alignment < sizeof(void *) || (alignment & (alignment - 1)) != 0)
+        return EINVAL;
+    countAllocation();
+    void *memory = __libc_memalign(alignment, size);
+    if (!memory && size != 0)
+        return ENOMEM;
+    *ptr = memory;
+    return 0;
+}
+
+extern "C" void free(void *ptr) noexcept
+{
+    if (ptr && g_counting.load(std::memory_order_relaxed))
+        g_frees.fetch_add(1, std::memory_order_relaxed);
+    __libc_free(ptr);
+}
+#endif
+
+namespace {
+
+const int kSseFrames = 100000;
+const int kSseNetworkChunkBytes = 1400;     // about one TCP segment per readyRead
+
+struct HeapCounts {
+    qint64 allocations = -1;    // -1 where they can't be counted
+    qint64 frees = -1;
+};
+
+// Heap calls made by 'work'
+template<typename Work>
+HeapCounts countHeap(Work work)
+{
+    HeapCounts counts;
+#if defined(__GLIBC__)
+    g_allocations.store(0);
+    g_frees.store(0);
+    g_counting.store(true);
+    work();
+    g_counting.store(false);
+    counts.allocations = qint64(g_allocations.load());
+    counts.frees = qint64(g_frees.load());
+#else
+    work();
+#endif
+    return counts;
+}
+
+// A stream as the chat completions API sends it: one chunk object per token, then the usage chunk
+QByteArray syntheticSseStream(int frames)
+{
+    static const QStringList words = {
+        QStringLiteral("The "), QStringLiteral("quick"), QStringLiteral(" brown"), QStringLiteral(" fox"),
+        QStringLiteral(" jumps"), QStringLiteral(" over"), QStringLiteral(" the"), QStringLiteral(" lazy"),
+        QStringLiteral(" dog"), QStringLiteral(".\n\n"), QStringLiteral("```cpp\n"), QStringLiteral("int"),
+        QStringLiteral(" main"), QStringLiteral("()\n"), QStringLiteral("{\n"), QStringLiteral("    \"quoted\""),
+        QStringLiteral("\n}\n"), QStringLiteral("```\n"), QStringLiteral("- **item**"), QStringLiteral(" \\ path"),
+    };
+
+    QByteArray stream;
+    stream.reserve(qsizetype(frames) * 220);
+    for (int i = 0; i < frames; ++i) {
+        QByteArray content = words.at(i % words.size()).toUtf8();
+        content.replace('\\', "\\\\").replace('"', "\\\"").replace('\n', "\\n");
+        stream += "data: {\"id\":\"chatcmpl-bench\",\"object\":\"chat.completion.chunk\",\"created\":1700000000,"
+                  "\"model\":\"gpt-4o\",\"system_fingerprint\":\"fp_bench\",\"choices\":[{\"index\":0,"
+                  "\"delta\":{\"content\":\"" + content + "\"},\"logprobs\":null,\"finish_reason\":null}]}\n\n";
+    }
+    stream += "data: {\"id\":\"chatcmpl-bench\",\"object\":\"chat.completion.chunk\",\"choices\":[],"
+              "\"usage\":{\"prompt_tokens\":12,\"completion_tokens\":" + QByteArray::number(frames)
+              + ",\"total_tokens\":" + QByteArray::number(frames + 12) + "}}\n\n";
+    stream += "data: [DONE]\n\n";
+    return stream;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Decodes a chat completion stream and reports deltas per second "
+                                     "and heap calls per delta.");
+    const Benchmark::Options options = Benchmark::parseArguments(parser, app);
+
+    QByteArray stream;
+    if (options.inputPath.isEmpty()) {
+        stream = syntheticSseStream(kSseFrames);
+    } else {
+        QFile file(options.inputPath);
+        if (!file.open(QIODevice::ReadOnly)) {
+            qCritical() << "[bench_sse] Failed to open" << options.inputPath;
+            return 1;
+        }
+        stream = file.readAll();
+    }
+
+    // The network delivers the stream in segments that cut through lines
+    QVector<QByteArray> chunks;
+    for (qsizetype pos = 0; pos < stream.size(); pos += kSseNetworkChunkBytes)
+        chunks.append(stream.mid(pos, kSseNetworkChunkBytes));
+
+    // The backend's path, with its buffers hoisted out of the loop the same way
+    qint64 deltaCount = 0;
+    qint64 contentChars = 0;
+    bool usageSeen = false;
+    bool broken = false;
+    QElapsedTimer timer;
+    timer.start();
+    const HeapCounts decodeHeap = countHeap([&]() {
+        SseStreamParser parser;
+        QByteArray data;
+        QVector<SseStreamParser::ChoiceDelta> deltas;
+        QVariantMap usage;
+        for (const QByteArray &chunk : std::as_const(chunks)) {
+            parser.append(chunk);
+            while (parser.nextData(data)) {
+                const SseStreamParser::ChatFrame frame = SseStreamParser::decodeChatFrame(data, deltas, usage);
+                if (frame == SseStreamParser::ChatInvalid)
+                    broken = true;
+                if (frame != SseStreamParser::ChatChunk)
+                    continue;
+                usageSeen = usageSeen || !usage.isEmpty();
+                for (const SseStreamParser::ChoiceDelta &delta : std::as_const(deltas)) {
+                    if (delta.content.isEmpty())
+                        continue;
+                    ++deltaCount;
+                    contentChars += delta.content.size();
+                }
+            }
+        }
+    });
+    const qint64 decodeNs = timer.nsecsElapsed();
+
+    // Baseline: every frame through QJsonDocument
+    qint64 jsonDeltas = 0;
+    timer.restart();
+    const HeapCounts jsonHeap = countHeap([&]() {
+        SseStreamParser parser;
+        QByteArray data;
+        for (const QByteArray &chunk : std::as_const(chunks)) {
+            parser.append(chunk);
+            while (parser.nextData(data)) {
+                if (data.isEmpty() || SseStreamParser::isDone(data))
+                    continue;
+                const QJsonArray choices = QJsonDocument::fromJson(data).object().value("choices").toArray();
+                for (const QJsonValue &choice : choices) {
+                    if (!choice.toObject().value("delta").toObject().value("content").toString().isEmpty())
+                        ++jsonDeltas;
+                }
+            }
+        }
+    });
+    const qint64 jsonNs = timer.nsecsElapsed();
+
+    if (broken || deltaCount == 0) {
+        qCritical() << "[bench_sse] The stream is malformed or has no content deltas";
+        return 1;
+    }
+    if (jsonDeltas != deltaCount)
+        qWarning() << "[bench_sse] Decoded" << deltaCount << "deltas, the baseline" << jsonDeltas;
+
+    auto perSecond = [](qint64 count, qint64 ns) { return ns > 0 ? count * 1e9 / ns : 0.0; };
+    auto perDelta = [](qint64 calls, qint64 deltas) {
+        return calls < 0 || deltas == 0 ? -1.0 : double(calls) / deltas;
+    };
+
+    QJsonObject result;
+    result["input"] = options.inputPath.isEmpty() ? QStringLiteral("synthetic") : options.inputPath;
+    result["stream_bytes"] = qint64(stream.size());
+    result["network_chunks"] = int(chunks.size());
+    result["deltas"] = deltaCount;
+    result["content_chars"] = contentChars;
+    result["usage_reported"] = usageSeen;
+    result["decode"] = QJsonObject{
+        {"ms", decodeNs / 1000000},
+        {"deltas_per_second", perSecond(deltaCount, decodeNs)},
+        {"allocations_per_delta", perDelta(decodeHeap.allocations, deltaCount)},
+        {"frees_per_delta", perDelta(decodeHeap.frees, deltaCount)},
+    };
+    result["qjsondocument"] = QJsonObject{
+        {"ms", jsonNs / 1000000},
+        {"deltas_per_second", perSecond(jsonDeltas, jsonNs)},
+        {"allocations_per_delta", perDelta(jsonHeap.allocations, jsonDeltas)},
+        {"frees_per_delta", perDelta(jsonHeap.frees, jsonDeltas)},
+    };
+    result["peak_rss_kb"] = Benchmark::peakRssKB();
+    return Benchmark::report("sse", result, options);
+}
@@ -0,0 +1,237 @@
+#include "benchmark.h"
+#include "aibackend.h"
+#include "project.h"
+#include "session.h"
+#include "sessiontabwidget.h"
+#include "ssestreamparser.h"
+#include "qmarkdowntextedit/qmarkdowntextedit.h"
+
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QTemporaryDir>
+#include <QTextDocument>
+#include <QTimer>
+#include <QDebug>
+
+#include <algorithm>
+
+/*
+ * Replays a 100k-token stream (or a recorded SSE capture, --input) into a real
+ * SessionTabWidget, the way OpenAIBackend delivers it: one delta per event loop
+ * pass. The tab buffers the deltas and flushes them into its viewer once per
+ * frame; a 60 Hz probe timer measures how late the event loop gets to it, which
+ * is what the user sees as dropped frames.
+ */
+
+namespace {
+
+const int kSyntheticStreamTokens = 100000;
+const double kFrameMs = 1000.0 / 60.0;
+const int kFrameProbeMs = 16;
+
+// An answer with prose, lists and code blocks, cut into token-sized deltas
+QStringList syntheticDeltas(int tokens)
+{
+    static const QStringList paragraphs = {
+        QStringLiteral("## Step %1\n\nThe quick brown fox jumps over the lazy dog while the **session** keeps "
+                       "streaming `tokens` into the viewer, one small delta at a time.\n\n"),
+        QStringLiteral("- first item with *emphasis*\n- second item with a [link](https://example.com)\n"
+                       "- third item\n\n"),
+        QStringLiteral("```cpp\nint main(int argc, char *argv[])\n{\n    QApplication a(argc, argv);\n"
+                       "    return a.exec();\n}\n```\n\n"),
+    };
+
+    QStringList deltas;
+    deltas.reserve(tokens);
+    for (int step = 1; deltas.size() < tokens; ++step) {
+        const QString text = paragraphs.at(step % paragraphs.size()).arg(step);
+        for (int pos = 0; pos < text.size() && deltas.size() < tokens; pos += 4)
+            deltas.append(text.mid(pos, 4));
+    }
+    return deltas;
+}
+
+bool recordedDeltas(const QString &path, QStringList &deltas, QString *errorOut)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        *errorOut = QString("Failed to open %1").arg(path);
+        return false;
+    }
+
+    SseStreamParser parser;
+    parser.append(file.readAll());
+    QByteArray data;
+    QVector<SseStreamParser::ChoiceDelta> choices;
+    while (parser.nextData(data)) {
+        if (SseStreamParser::isDone(data))
+            break;
+        choices.clear();
+        if (SseStreamParser::extractDeltas(data, choices) != SseStreamParser::Content)
+            continue;
+        for (const SseStreamParser::ChoiceDelta &choice : std::as_const(choices)) {
+            if (choice.index == 0 && !choice.content.isEmpty())
+                deltas.append(choice.content);
+        }
+    }
+
+    if (deltas.isEmpty()) {
+        *errorOut = QString("No content deltas in %1").arg(path);
+        return false;
+    }
+    return true;
+}
+
+// Answers every request with the same deltas, one per event loop pass
+class ReplayBackend : public AIBackend
+{
+public:
+    explicit ReplayBackend(const QStringList &deltas)
+        : m_deltas(deltas)
+    {
+        m_feeder.setInterval(0);
+        QObject::connect(&m_feeder, &QTimer::timeout, this, [this]() { feed(); });
+    }
+
+    void startRequest(const QList<Message> &, const QVariantMap &, const QString &requestId) override
+    {
+        m_requestId = requestId;
+        m_next = 0;
+        m_full.clear();
+        emit statusChanged(requestId, QStringLiteral("started"));
+        m_feeder.start();
+    }
+
+    void cancelRequest(const QString &) override { m_feeder.stop(); }
+    bool supportsStreaming() const override { return true; }
+    QString backendName() const override { return QStringLiteral("Replay"); }
+
+private:
+    void feed()
+    {
+        if (m_next >= m_deltas.size()) {
+            m_feeder.stop();
+            emit finished(m_requestId, m_full);
+            return;
+        }
+        const QString &delta = m_deltas.at(m_next++);
+        m_full += delta;
+        emit partialResponse(m_requestId, delta);
+        emit choicePartialResponse(m_requestId, 0, delta);
+    }
+
+    QStringList m_deltas;
+    QTimer m_feeder;
+    QString m_requestId;
+    QString m_full;
+    int m_next = 0;
+};
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QApplication app(argc, argv);
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Replays a stream into a session tab and reports the frames dropped.");
+    const Benchmark::Options options = Benchmark::parseArguments(parser, app);
+
+    QString error;
+    QStringList deltas;
+    if (options.inputPath.isEmpty()) {
+        deltas = syntheticDeltas(kSyntheticStreamTokens);
+    } else if (!recordedDeltas(options.inputPath, deltas, &error)) {
+        qCritical().noquote() << "[bench_stream_render]" << error;
+        return 1;
+    }
+
+    QTemporaryDir sessionsDir;
+    Project project;
+    project.setValue("api.access_token", "replay");
+    project.setValue("api.model", "gpt-4o");
+    project.setValue("folders.sessions", sessionsDir.path());
+
+    const QString sessionPath = QDir(sessionsDir.path()).filePath("bench.md");
+    {
+        Session session(&project);
+        session.appendSystemSlice("You are a helpful assistant.");
+        session.appendUserSlice("Explain the quick brown fox.");
+        if (!sessionsDir.isValid() || !session.save(sessionPath)) {
+            qCritical() << "[bench_stream_render] Failed to write session:" << sessionPath;
+            return 1;
+        }
+    }
+
+    ReplayBackend backend(deltas);
+    SessionTabWidget tab(sessionPath, &project, &backend);
+    tab.resize(900, 1000);
+    tab.show();
+
+    QMarkdownTextEdit *viewer = tab.findChild<QMarkdownTextEdit *>();
+    if (!viewer) {
+        qCritical() << "[bench_stream_render] Session tab has no slice viewer";
+        return 1;
+    }
+
+    // Every flush of the tab is one change of the viewer's document
+    QElapsedTimer clock;
+    int flushes = 0;
+    int renderedChars = 0;
+    QObject::connect(viewer->document(), &QTextDocument::contentsChanged, [&]() {
+        if (!clock.isValid())
+            return;
+        ++flushes;
+        renderedChars = viewer->document()->characterCount() - 1;
+    });
+
+    // A frame is lost for every frame period the event loop was late
+    QVector<qint64> lateUs;
+    int framesDropped = 0;
+    QElapsedTimer frameClock;
+    QTimer frameProbe;
+    frameProbe.setInterval(kFrameProbeMs);
+    frameProbe.setTimerType(Qt::PreciseTimer);
+    QObject::connect(&frameProbe, &QTimer::timeout, [&]() {
+        const qint64 late = qMax<qint64>(0, frameClock.nsecsElapsed() / 1000 - kFrameProbeMs * 1000);
+        frameClock.start();
+        lateUs.append(late);
+        framesDropped += int(late / 1000.0 / kFrameMs);
+    });
+
+    QObject::connect(&backend, &AIBackend::finished, &app, [&]() {
+        // Let the tab flush and commit the last frame first
+        QTimer::singleShot(100, &app, &QApplication::quit);
+    });
+
+    QTimer::singleShot(0, &tab, [&]() {
+        clock.start();
+        frameClock.start();
+        frameProbe.start();
+        QMetaObject::invokeMethod(&tab, "onSendClicked");
+    });
+    app.exec();
+    frameProbe.stop();
+    const qint64 wallMs = clock.elapsed();
+
+    std::sort(lateUs.begin(), lateUs.end());
+
+    QJsonObject result;
+    result["input"] = options.inputPath.isEmpty() ? QStringLiteral("synthetic") : options.inputPath;
+    result["deltas"] = int(deltas.size());
+    result["rendered_chars"] = renderedChars;
+    result["wall_ms"] = wallMs;
+    result["flushes"] = flushes;
+    result["frames"] = int(lateUs.size());
+    result["frames_dropped"] = framesDropped;
+    result["frame_late_us"] = QJsonObject{
+        {"p50", Benchmark::percentile(lateUs, 0.50)},
+        {"p95", Benchmark::percentile(lateUs, 0.95)},
+        {"p99", Benchmark::percentile(lateUs, 0.99)},
+        {"max", lateUs.isEmpty() ? 0 : lateUs.last()},
+    };
+    result["peak_rss_kb"] = Benchmark::peakRssKB();
+    return Benchmark::report("stream-render", result, options);
+}
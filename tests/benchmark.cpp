@@ -0,0 +1,92 @@
+#include "benchmark.h"
+
+#include <QCommandLineOption>
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QFile>
+#include <QJsonDocument>
+#include <QLoggingCategory>
+#include <QDebug>
+
+#if defined(Q_OS_UNIX)
+#include <sys/resource.h>
+#endif
+
+namespace {
+
+qint64 g_cpuStartMs = 0;
+
+} // namespace
+
+Benchmark::Options Benchmark::parseArguments(QCommandLineParser &parser, const QCoreApplication &app)
+{
+    QCommandLineOption inputOption("input", "Recorded input; synthetic when absent.", "file");
+    QCommandLineOption outputOption("output", "Also write the JSON report to this file.", "file");
+    parser.addHelpOption();
+    parser.addOptions({inputOption, outputOption});
+    parser.process(app);
+
+    // Per-item debug logging would dominate the timings
+    QLoggingCategory::setFilterRules(QStringLiteral("*.debug=false"));
+    g_cpuStartMs = cpuTimeMs();
+
+    Options options;
+    options.inputPath = parser.value(inputOption);
+    options.outputPath = parser.value(outputOption);
+    return options;
+}
+
+int Benchmark::report(const QString &name, QJsonObject result, const Options &options)
+{
+    result["benchmark"] = name;
+    result["cpu_time_ms"] = cpuTimeMs() - g_cpuStartMs;
+
+    const QByteArray json = QJsonDocument(result).toJson(QJsonDocument::Indented);
+    qInfo().noquote() << json;
+
+    if (!options.outputPath.isEmpty()) {
+        QFile file(options.outputPath);
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate) || file.write(json) < 0) {
+            qWarning() << "[Benchmark::report] Failed to write report:" << options.outputPath;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+qint64 Benchmark::cpuTimeMs()
+{
+#if defined(Q_OS_UNIX)
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return -1;
+    return (qint64(usage.ru_utime.tv_sec) + usage.ru_stime.tv_sec) * 1000
+           + (qint64(usage.ru_utime.tv_usec) + usage.ru_stime.tv_usec) / 1000;
+#else
+    return -1;
+#endif
+}
+
+qint64 Benchmark::peakRssKB()
+{
+#if defined(Q_OS_UNIX)
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return -1;
+#if defined(Q_OS_MACOS)
+    return qint64(usage.ru_maxrss) / 1024;  // bytes on macOS
+#else
+    return qint64(usage.ru_maxrss);         // kilobytes on Linux
+#endif
+#else
+    return -1;
+#endif
+}
+
+qint64 Benchmark::percentile(const QVector<qint64> &sorted, double q)
+{
+    if (sorted.isEmpty())
+        return 0;
+    const int index = qBound(0, int(q * (sorted.size() - 1) + 0.5), int(sorted.size()) - 1);
+    return sorted.at(index);
+}
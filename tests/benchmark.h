@@ -0,0 +1,45 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#pragma once
+
+#include <QJsonObject>
+#include <QString>
+#include <QVector>
+
+class QCommandLineParser;
+class QCoreApplication;
+
+/**
+ * @brief Common part of the benchmark executables (bench_*) under tests/.
+ *
+ * Every benchmark drives the application's own code in-process with synthetic
+ * or recorded input and prints a JSON report that includes the process CPU
+ * time, so a regression shows up without a profiler. Common options:
+ *  --input <file>    recorded input (e.g. an SSE capture); synthetic when absent
+ *  --output <file>   also write the JSON report to this file
+ */
+class Benchmark
+{
+public:
+    struct Options {
+        QString inputPath;
+        QString outputPath;
+    };
+
+    // Adds the common options to 'parser' (next to the benchmark's own), processes the
+    // arguments and silences debug logging, which would dominate the timings
+    static Options parseArguments(QCommandLineParser &parser, const QCoreApplication &app);
+
+    // Prints 'result' with the CPU time since parseArguments() and writes it to the output file
+    static int report(const QString &name, QJsonObject result, const Options &options);
+
+    // Process CPU time (user plus system) in milliseconds, -1 where unknown
+    static qint64 cpuTimeMs();
+    // Peak resident set size in kilobytes, -1 where unknown
+    static qint64 peakRssKB();
+
+    static qint64 percentile(const QVector<qint64> &sorted, double q);
+};
+
+#endif // BENCHMARK_H
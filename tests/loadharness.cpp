@@ -0,0 +1,232 @@
+#include "loadharness.h"
+#include "benchmark.h"
+#include "aibackend.h"
+#include "project.h"
+#include "session.h"
+#include "sessiontabwidget.h"
+#include "qmarkdowntextedit/qmarkdowntextedit.h"
+
+#include <QApplication>
+#include <QDir>
+#include <QJsonArray>
+#include <QTabWidget>
+#include <QTextDocument>
+#include <QDebug>
+
+#include <algorithm>
+
+namespace {
+
+const int kEventLoopProbeIntervalMs = 5;
+const int kDialogWatchIntervalMs = 50;
+
+} // namespace
+
+LoadHarness::LoadHarness(AIBackend *backend, const QVariantMap &backendConfig, const Options &options,
+                         QObject *parent)
+    : QObject(parent)
+    , m_backend(backend)
+    , m_backendConfig(backendConfig)
+    , m_options(options)
+{
+    m_eventLoopProbe.setInterval(kEventLoopProbeIntervalMs);
+    m_eventLoopProbe.setTimerType(Qt::PreciseTimer);
+    connect(&m_eventLoopProbe, &QTimer::timeout, this, &LoadHarness::sampleEventLoop);
+
+    m_dialogWatcher.setInterval(kDialogWatchIntervalMs);
+    connect(&m_dialogWatcher, &QTimer::timeout, this, &LoadHarness::dismissModalDialogs);
+
+    m_timeout.setSingleShot(true);
+    connect(&m_timeout, &QTimer::timeout, this, [this]() { report(true); });
+}
+
+LoadHarness::~LoadHarness()
+{
+    delete m_window;
+}
+
+bool LoadHarness::start(QString *errorOut)
+{
+    if (!m_sessionsDir.isValid()) {
+        if (errorOut)
+            *errorOut = "Failed to create a temporary sessions folder.";
+        return false;
+    }
+
+    m_backend->setConfig(m_backendConfig);
+
+    m_project = new Project(this);
+    m_project->setValue("api.access_token", m_backendConfig.value("access_token"));
+    m_project->setValue("api.model", m_backendConfig.value("model"));
+    m_project->setValue("folders.sessions", m_sessionsDir.path());
+
+    connect(m_backend, &AIBackend::finished, this, [this](const QString &, const QString &) { onBackendDone(); });
+    connect(m_backend, &AIBackend::errorOccurred, this, [this](const QString &, const QString &) {
+        ++m_failedRequests;
+        onBackendDone();
+    });
+    connect(m_backend, &AIBackend::usageReported, this, [this](const QString &, const QVariantMap &usage) {
+        m_completionTokens += usage.value("completion_tokens").toLongLong();
+    });
+
+    m_window = new QTabWidget();
+    m_window->setWindowTitle(QString("VibeKoder benchmark (%1 tabs)").arg(m_options.tabs));
+    m_window->resize(900, 1000);
+
+    for (int i = 0; i < m_options.tabs; ++i) {
+        const QString path = QDir(m_sessionsDir.path()).filePath(QString("bench_%1.md").arg(i + 1, 3, 10, QChar('0')));
+
+        Session session(m_project);
+        session.appendSystemSlice("You are a helpful assistant.");
+        session.appendUserSlice(m_options.prompt);
+        if (!session.save(path)) {
+            if (errorOut)
+                *errorOut = QString("Failed to write session: %1").arg(path);
+            return false;
+        }
+
+        TabRun run;
+        run.tab = new SessionTabWidget(path, m_project, m_backend, m_window);
+        m_window->addTab(run.tab, QString::number(i + 1));
+        m_runs.append(run);
+
+        QMarkdownTextEdit *viewer = run.tab->findChild<QMarkdownTextEdit *>();
+        if (!viewer) {
+            if (errorOut)
+                *errorOut = "Session tab has no slice viewer.";
+            return false;
+        }
+        QTextDocument *document = viewer->document();
+        connect(document, &QTextDocument::contentsChanged, this, [this, i, document]() {
+            if (!m_clock.isValid())
+                return;
+            TabRun &tabRun = m_runs[i];
+            const int chars = document->characterCount() - 1;
+            // Sending selects the new, empty assistant slice; streamed text follows
+            if (chars <= 0) {
+                tabRun.armed = true;
+                return;
+            }
+            if (!tabRun.armed)
+                return;
+            const qint64 now = m_clock.elapsed();
+            if (tabRun.firstRenderMs < 0)
+                tabRun.firstRenderMs = now;
+            tabRun.lastRenderMs = now;
+            tabRun.renderedChars = chars;
+        });
+    }
+
+    m_window->show();
+
+    // Send once the window is up and the event loop runs
+    QTimer::singleShot(0, this, &LoadHarness::sendAll);
+    return true;
+}
+
+void LoadHarness::sendAll()
+{
+    qDebug() << "[LoadHarness::sendAll] Sending" << m_runs.size() << "sessions";
+
+    m_probeClock.start();
+    m_eventLoopProbe.start();
+    m_dialogWatcher.start();
+    m_timeout.start(m_options.timeoutSecs * 1000);
+    m_clock.start();
+
+    for (const TabRun &run : std::as_const(m_runs))
+        QMetaObject::invokeMethod(run.tab, "onSendClicked");
+}
+
+void LoadHarness::onBackendDone()
+{
+    ++m_doneRequests;
+    if (m_doneRequests < m_runs.size())
+        return;
+
+    // Let the tabs render and save the last response first
+    QTimer::singleShot(100, this, [this]() { report(false); });
+}
+
+void LoadHarness::sampleEventLoop()
+{
+    const qint64 now = m_probeClock.elapsed();
+    if (m_lastProbeMs >= 0)
+        m_eventLoopLatencyMs.append(qMax<qint64>(0, now - m_lastProbeMs - kEventLoopProbeIntervalMs));
+    m_lastProbeMs = now;
+}
+
+void LoadHarness::dismissModalDialogs()
+{
+    // Injected errors raise message boxes; a benchmark must not wait for a click
+    if (QWidget *modal = QApplication::activeModalWidget()) {
+        ++m_dismissedDialogs;
+        modal->close();
+    }
+}
+
+void LoadHarness::report(bool timedOut)
+{
+    if (m_reported)
+        return;
+    m_reported = true;
+
+    m_eventLoopProbe.stop();
+    m_dialogWatcher.stop();
+    m_timeout.stop();
+
+    const qint64 wallMs = m_clock.elapsed();
+
+    QVector<qint64> firstRender;
+    qint64 renderStart = -1;
+    qint64 renderEnd = -1;
+    qint64 renderedChars = 0;
+    QJsonArray tabs;
+    for (const TabRun &run : std::as_const(m_runs)) {
+        QJsonObject tab;
+        tab["first_render_ms"] = run.firstRenderMs;
+        tab["last_render_ms"] = run.lastRenderMs;
+        tab["rendered_chars"] = run.renderedChars;
+        tabs.append(tab);
+
+        if (run.firstRenderMs < 0)
+            continue;
+        firstRender.append(run.firstRenderMs);
+        renderStart = renderStart < 0 ? run.firstRenderMs : qMin(renderStart, run.firstRenderMs);
+        renderEnd = qMax(renderEnd, run.lastRenderMs);
+        renderedChars += run.renderedChars;
+    }
+    std::sort(firstRender.begin(), firstRender.end());
+
+    QVector<qint64> latency = m_eventLoopLatencyMs;
+    std::sort(latency.begin(), latency.end());
+
+    const double renderSecs = renderEnd > renderStart ? (renderEnd - renderStart) / 1000.0 : 0.0;
+
+    QJsonObject result;
+    result["tabs"] = int(m_runs.size());
+    result["timed_out"] = timedOut;
+    result["wall_ms"] = wallMs;
+    result["requests_done"] = m_doneRequests;
+    result["requests_failed"] = m_failedRequests;
+    result["dialogs_dismissed"] = m_dismissedDialogs;
+    result["time_to_first_render_ms"] = QJsonObject{
+        {"p50", Benchmark::percentile(firstRender, 0.50)},
+        {"p90", Benchmark::percentile(firstRender, 0.90)},
+        {"max", firstRender.isEmpty() ? 0 : firstRender.last()},
+    };
+    result["completion_tokens"] = m_completionTokens;
+    result["tokens_per_second_rendered"] = renderSecs > 0 ? m_completionTokens / renderSecs : 0.0;
+    result["chars_per_second_rendered"] = renderSecs > 0 ? renderedChars / renderSecs : 0.0;
+    result["event_loop_latency_ms"] = QJsonObject{
+        {"samples", int(latency.size())},
+        {"p50", Benchmark::percentile(latency, 0.50)},
+        {"p95", Benchmark::percentile(latency, 0.95)},
+        {"p99", Benchmark::percentile(latency, 0.99)},
+        {"max", latency.isEmpty() ? 0 : latency.last()},
+    };
+    result["peak_rss_kb"] = Benchmark::peakRssKB();
+    result["per_tab"] = tabs;
+
+    emit finished(result);
+}
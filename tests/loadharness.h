@@ -0,0 +1,90 @@
+#ifndef LOADHARNESS_H
+#define LOADHARNESS_H
+
+#pragma once
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QJsonObject>
+#include <QTemporaryDir>
+#include <QTimer>
+#include <QVector>
+#include <QVariantMap>
+
+class AIBackend;
+class Project;
+class QTabWidget;
+class SessionTabWidget;
+
+/**
+ * @brief End-to-end streaming benchmark over real session tabs.
+ *
+ * Opens N SessionTabWidgets on throwaway sessions, sends all of them at once
+ * through the given backend (normally OpenAIBackend pointed at a
+ * MockOpenAIServer) and measures what the user sees: time to first render
+ * and rendered throughput per tab, GUI event loop latency percentiles while
+ * streaming, and the peak resident set size. Modal error dialogs raised by
+ * the tabs (injected errors) are dismissed and counted. Used by bench_load.
+ */
+class LoadHarness : public QObject
+{
+    Q_OBJECT
+public:
+    struct Options {
+        int tabs = 8;
+        int timeoutSecs = 120;
+        QString prompt = QStringLiteral("Explain the quick brown fox.");
+    };
+
+    // 'backendConfig' is applied to the backend (api_base_url, access_token, ...)
+    LoadHarness(AIBackend *backend, const QVariantMap &backendConfig, const Options &options,
+                QObject *parent = nullptr);
+    ~LoadHarness() override;
+
+    bool start(QString *errorOut = nullptr);
+
+signals:
+    // The measurements, for Benchmark::report(); "timed_out" is set when not every request finished
+    void finished(const QJsonObject &result);
+
+private:
+    struct TabRun {
+        SessionTabWidget *tab = nullptr;
+        bool armed = false;         // Viewer was cleared for the new assistant slice
+        qint64 firstRenderMs = -1;
+        qint64 lastRenderMs = -1;
+        int renderedChars = 0;
+    };
+
+    void sendAll();
+    void onBackendDone();
+    void sampleEventLoop();
+    void dismissModalDialogs();
+    void report(bool timedOut);
+
+    AIBackend *m_backend = nullptr;
+    QVariantMap m_backendConfig;
+    Options m_options;
+
+    QTemporaryDir m_sessionsDir;
+    Project *m_project = nullptr;
+    QTabWidget *m_window = nullptr;
+    QVector<TabRun> m_runs;
+
+    QElapsedTimer m_clock;          // Started when the requests are sent
+    int m_doneRequests = 0;
+    int m_failedRequests = 0;
+    int m_dismissedDialogs = 0;
+    qint64 m_completionTokens = 0;
+    bool m_reported = false;
+
+    QTimer m_eventLoopProbe;
+    QElapsedTimer m_probeClock;
+    qint64 m_lastProbeMs = -1;
+    QVector<qint64> m_eventLoopLatencyMs;
+
+    QTimer m_dialogWatcher;
+    QTimer m_timeout;
+};
+
+#endif // LOADHARNESS_H
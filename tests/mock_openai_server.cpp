@@ -0,0 +1,38 @@
+#include "mockopenaiserver.h"
+
+#include <QCommandLineOption>
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDebug>
+
+/*
+ * Runs MockOpenAIServer on its own, for trying the app (or anything else
+ * speaking the OpenAI API) against it: start VibeKoder with
+ * VIBEKODER_API_BASE_URL set to the printed address.
+ */
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Local mock of the OpenAI chat completions, Responses, Files and Batch APIs.");
+    parser.addHelpOption();
+    QCommandLineOption portOption("port", "Port to listen on (0: any free port).", "port", "0");
+    QCommandLineOption replayOption("replay", "Replay a recorded SSE stream instead of synthetic tokens.", "file");
+    parser.addOptions({portOption, replayOption});
+    MockOpenAIServer::addOptions(parser);
+    parser.process(app);
+
+    MockOpenAIServer::Options options = MockOpenAIServer::optionsFromArguments(parser);
+    options.replayFile = parser.value(replayOption);
+
+    MockOpenAIServer server(options);
+    QString error;
+    if (!server.listen(quint16(parser.value(portOption).toUInt()), &error)) {
+        qCritical().noquote() << "[mock_openai_server] Failed to listen:" << error;
+        return 1;
+    }
+
+    qInfo().noquote() << "Mock OpenAI server at" << server.baseUrl();
+    return app.exec();
+}
@@ -0,0 +1,649 @@
+#include "mockopenaiserver.h"
+
+#include <QCommandLineOption>
+#include <QCommandLineParser>
+#include <QTcpSocket>
+#include <QTimer>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QDebug>
+
+namespace {
+
+const char kChatCompletionsPath[] = "/v1/chat/completions";
+const char kResponsesPath[] = "/v1/responses";
+const char kFilesPath[] = "/v1/files";
+const char kBatchesPath[] = "/v1/batches";
+
+// Synthetic responses cycle through these words, one token each
+const char *const kWords[] = {
+    "The ", "quick ", "brown ", "fox ", "jumps ", "over ", "the ", "lazy ", "dog", ".\n\n",
+    "```cpp\n", "int ", "main", "() ", "{ ", "return ", "0", "; ", "}\n", "```\n\n",
+};
+const int kWordCount = int(sizeof(kWords) / sizeof(kWords[0]));
+
+// Content of the first choice of a recorded chat completion chunk
+QByteArray replayContent(const QByteArray &frame)
+{
+    const QJsonArray choices = QJsonDocument::fromJson(frame).object().value("choices").toArray();
+    return choices.at(0).toObject().value("delta").toObject().value("content").toString().toUtf8();
+}
+
+// Characters of a message's content, either a string or an array of text parts
+int contentChars(const QJsonValue &content)
+{
+    if (content.isString())
+        return content.toString().size();
+    int chars = 0;
+    const QJsonArray parts = content.toArray();
+    for (const QJsonValue &part : parts)
+        chars += part.toObject().value("text").toString().size();
+    return chars;
+}
+
+QByteArray errorJson(const QString &message, const QString &type = QStringLiteral("invalid_request_error"))
+{
+    QJsonObject error;
+    error["message"] = message;
+    error["type"] = type;
+    return QJsonDocument(QJsonObject{{"error", error}}).toJson(QJsonDocument::Compact);
+}
+
+} // namespace
+
+MockOpenAIServer::MockOpenAIServer(const Options &options, QObject *parent)
+    : QObject(parent)
+    , m_options(options)
+    , m_random(options.seed)
+{
+    connect(&m_server, &QTcpServer::newConnection, this, &MockOpenAIServer::onNewConnection);
+}
+
+MockOpenAIServer::~MockOpenAIServer()
+{
+    qDebug() << "[MockOpenAIServer] Served" << m_stats.requests << "requests:" << m_stats.completed << "completed,"
+             << m_stats.rateLimited << "rate limited," << m_stats.stalled << "stalled," << m_stats.dropped << "dropped,"
+             << m_stats.batches << "batches";
+}
+
+void MockOpenAIServer::addOptions(QCommandLineParser &parser)
+{
+    const Options defaults;
+    parser.addOptions({
+        QCommandLineOption("tokens-per-second", "Token rate (0: unthrottled).", "rate",
+                           QString::number(defaults.tokensPerSecond)),
+        QCommandLineOption("chunk-tokens", "Tokens per network chunk.", "count",
+                           QString::number(defaults.tokensPerChunk)),
+        QCommandLineOption("response-tokens", "Synthetic response length in tokens.", "count",
+                           QString::number(defaults.responseTokens)),
+        QCommandLineOption("rate-limit-rate", "Share of requests rejected with 429.", "rate", "0"),
+        QCommandLineOption("stall-rate", "Share of streams that stall once.", "rate", "0"),
+        QCommandLineOption("stall-ms", "Stall duration in milliseconds.", "ms", QString::number(defaults.stallMs)),
+        QCommandLineOption("drop-rate", "Share of streams dropped mid-stream.", "rate", "0"),
+        QCommandLineOption("seed", "Seed of the error injection.", "seed", QString::number(defaults.seed)),
+    });
+}
+
+MockOpenAIServer::Options MockOpenAIServer::optionsFromArguments(const QCommandLineParser &parser)
+{
+    Options options;
+    options.tokensPerSecond = parser.value("tokens-per-second").toInt();
+    options.tokensPerChunk = parser.value("chunk-tokens").toInt();
+    options.responseTokens = parser.value("response-tokens").toInt();
+    options.rateLimitRate = parser.value("rate-limit-rate").toDouble();
+    options.stallRate = parser.value("stall-rate").toDouble();
+    options.stallMs = parser.value("stall-ms").toInt();
+    options.dropRate = parser.value("drop-rate").toDouble();
+    options.seed = parser.value("seed").toUInt();
+    return options;
+}
+
+bool MockOpenAIServer::listen(quint16 port, QString *errorOut)
+{
+    if (!m_options.replayFile.isEmpty() && !loadReplay(errorOut))
+        return false;
+
+    if (!m_server.listen(QHostAddress::LocalHost, port)) {
+        if (errorOut)
+            *errorOut = m_server.errorString();
+        return false;
+    }
+
+    qDebug() << "[MockOpenAIServer::listen] Listening on" << baseUrl();
+    return true;
+}
+
+QString MockOpenAIServer::baseUrl() const
+{
+    return QString("http://127.0.0.1:%1").arg(m_server.serverPort());
+}
+
+bool MockOpenAIServer::loadReplay(QString *errorOut)
+{
+    QFile file(m_options.replayFile);
+    if (!file.open(QIODevice::ReadOnly)) {
+        if (errorOut)
+            *errorOut = QString("Failed to open recorded stream: %1").arg(m_options.replayFile);
+        return false;
+    }
+
+    m_replayFrames.clear();
+    const QList<QByteArray> lines = file.readAll().split('\n');
+    for (const QByteArray &line : lines) {
+        if (!line.startsWith("data:"))
+            continue;
+        QByteArray payload = line.mid(5).trimmed();
+        if (payload.isEmpty() || payload == "[DONE]")
+            continue;
+        m_replayFrames.append(payload);
+    }
+
+    if (m_replayFrames.isEmpty()) {
+        if (errorOut)
+            *errorOut = QString("No data frames in recorded stream: %1").arg(m_options.replayFile);
+        return false;
+    }
+
+    qDebug() << "[MockOpenAIServer::loadReplay] Loaded" << m_replayFrames.size() << "frames";
+    return true;
+}
+
+void MockOpenAIServer::onNewConnection()
+{
+    while (QTcpSocket *socket = m_server.nextPendingConnection()) {
+        Stream stream;
+        stream.socket = socket;
+        stream.timer = new QTimer(socket);
+        stream.timer->setSingleShot(true);
+        stream.timer->setTimerType(Qt::PreciseTimer);
+        m_streams.insert(socket, stream);
+
+        connect(socket, &QTcpSocket::readyRead, this, [this, socket]() { onReadyRead(socket); });
+        connect(stream.timer, &QTimer::timeout, this, [this, socket]() { sendNextChunk(socket); });
+        connect(socket, &QTcpSocket::disconnected, this, [this, socket]() {
+            m_streams.remove(socket);
+            socket->deleteLater();
+        });
+    }
+}
+
+void MockOpenAIServer::onReadyRead(QTcpSocket *socket)
+{
+    auto it = m_streams.find(socket);
+    if (it == m_streams.end() || it->started)
+        return;
+
+    it->request += socket->readAll();
+
+    const int headerEnd = it->request.indexOf("\r\n\r\n");
+    if (headerEnd < 0)
+        return;
+
+    const QList<QByteArray> headerLines = it->request.left(headerEnd).split('\n');
+    const QList<QByteArray> requestLine = headerLines.value(0).trimmed().split(' ');
+    qsizetype contentLength = 0;
+    for (const QByteArray &line : headerLines) {
+        const int colon = line.indexOf(':');
+        if (colon > 0 && line.left(colon).trimmed().toLower() == "content-length")
+            contentLength = line.mid(colon + 1).trimmed().toLongLong();
+    }
+
+    const qsizetype bodyStart = headerEnd + 4;
+    if (it->request.size() - bodyStart < contentLength)
+        return;
+
+    it->started = true;
+    startResponse(*it, requestLine.value(0), requestLine.value(1), it->request.mid(bodyStart, contentLength));
+}
+
+void MockOpenAIServer::startResponse(Stream &stream, const QByteArray &method, const QByteArray &path,
+                                     const QByteArray &body)
+{
+    ++m_stats.requests;
+
+    if (path.startsWith(kFilesPath) || path.startsWith(kBatchesPath)) {
+        handleFilesAndBatches(stream.socket, method, path, body);
+        return;
+    }
+
+    if (method != "POST" || (path != kChatCompletionsPath && path != kResponsesPath)) {
+        sendJson(stream.socket, 404, "Not Found", errorJson("Unknown endpoint"));
+        return;
+    }
+
+    if (m_random.generateDouble() < m_options.rateLimitRate) {
+        ++m_stats.rateLimited;
+        sendJson(stream.socket, 429, "Too Many Requests", errorJson("Rate limit reached (mock)", "rate_limit_exceeded"),
+                 "Retry-After: 1\r\n");
+        return;
+    }
+
+    startStream(stream, path == kResponsesPath, body);
+}
+
+void MockOpenAIServer::startStream(Stream &stream, bool responsesApi, const QByteArray &body)
+{
+    const QJsonObject request = QJsonDocument::fromJson(body).object();
+    stream.responsesApi = responsesApi;
+    stream.model = request.value("model").toString("mock-model").toUtf8();
+
+    if (responsesApi) {
+        // A continuation needs a response stored earlier, as on the real API
+        const QByteArray previous = request.value("previous_response_id").toString().toUtf8();
+        if (!previous.isEmpty() && !m_storedResponses.contains(previous)) {
+            sendJson(stream.socket, 404, "Not Found",
+                     errorJson(QString("Previous response with id '%1' not found.").arg(QString::fromUtf8(previous))));
+            return;
+        }
+        stream.includeUsage = true;
+    } else {
+        stream.choices = qBound(1, request.value("n").toInt(1), 8);
+        stream.includeUsage = request.value("stream_options").toObject().value("include_usage").toBool();
+    }
+
+    const QJsonArray messages = request.value(responsesApi ? "input" : "messages").toArray();
+    for (const QJsonValue &message : messages)
+        stream.promptChars += contentChars(message.toObject().value("content"));
+
+    if (m_replayFrames.isEmpty()) {
+        const int count = qMax(1, m_options.responseTokens);
+        stream.tokens.reserve(count);
+        for (int i = 0; i < count; ++i)
+            stream.tokens.append(QByteArray(kWords[i % kWordCount]));
+    } else if (responsesApi) {
+        // Recorded chat completion chunks; only their text carries over
+        for (const QByteArray &frame : std::as_const(m_replayFrames)) {
+            const QByteArray content = replayContent(frame);
+            if (!content.isEmpty())
+                stream.tokens.append(content);
+        }
+        if (stream.tokens.isEmpty())
+            stream.tokens.append(QByteArray(kWords[0]));
+    } else {
+        stream.tokens = m_replayFrames;
+    }
+
+    if (m_random.generateDouble() < m_options.stallRate) {
+        stream.stallAt = m_random.bounded(stream.tokens.size());
+        ++m_stats.stalled;
+    }
+    if (m_random.generateDouble() < m_options.dropRate)
+        stream.dropAt = m_random.bounded(stream.tokens.size());
+
+    // Chunked, so a connection dropped before the terminating chunk is a truncated body to the client
+    stream.socket->write("HTTP/1.1 200 OK\r\n"
+                         "Content-Type: text/event-stream\r\n"
+                         "Cache-Control: no-cache\r\n"
+                         "Transfer-Encoding: chunked\r\n"
+                         "Connection: close\r\n"
+                         "\r\n");
+    stream.timer->start(qMax(0, m_options.firstTokenDelayMs));
+}
+
+QByteArray MockOpenAIServer::chunkFrame(const Stream &stream, int choiceIndex, const QByteArray &content) const
+{
+    QJsonObject delta;
+    delta["content"] = QString::fromUtf8(content);
+    QJsonObject choice;
+    choice["index"] = choiceIndex;
+    choice["delta"] = delta;
+    QJsonObject chunk;
+    chunk["id"] = "chatcmpl-mock";
+    chunk["object"] = "chat.completion.chunk";
+    chunk["model"] = QString::fromUtf8(stream.model);
+    chunk["choices"] = QJsonArray{choice};
+    return QJsonDocument(chunk).toJson(QJsonDocument::Compact);
+}
+
+QByteArray MockOpenAIServer::responsesEvent(const QByteArray &type, const QJsonObject &event) const
+{
+    QJsonObject typed = event;
+    typed["type"] = QString::fromLatin1(type);
+    return "event: " + type + "\ndata: " + QJsonDocument(typed).toJson(QJsonDocument::Compact) + "\n\n";
+}
+
+void MockOpenAIServer::writeChunk(QTcpSocket *socket, const QByteArray &data)
+{
+    // An empty chunk would end the body
+    if (data.isEmpty())
+        return;
+    socket->write(QByteArray::number(data.size(), 16) + "\r\n" + data + "\r\n");
+}
+
+void MockOpenAIServer::sendNextChunk(QTcpSocket *socket)
+{
+    auto it = m_streams.find(socket);
+    if (it == m_streams.end())
+        return;
+    Stream &stream = *it;
+
+    const int perChunk = qMax(1, m_options.tokensPerChunk);
+    const bool recordedFrames = !m_replayFrames.isEmpty() && !stream.responsesApi;
+
+    QByteArray chunk;
+    for (int i = 0; i < perChunk && stream.nextToken < stream.tokens.size(); ++i, ++stream.nextToken) {
+        if (stream.nextToken == stream.dropAt) {
+            ++m_stats.dropped;
+            // No terminating chunk: the client sees the body cut short
+            writeChunk(socket, chunk);
+            socket->flush();
+            socket->abort();
+            return;
+        }
+
+        const QByteArray &token = stream.tokens.at(stream.nextToken);
+        if (stream.responsesApi) {
+            chunk += responsesEvent("response.output_text.delta",
+                                    QJsonObject{{"item_id", "msg_mock"},
+                                                {"output_index", 0},
+                                                {"content_index", 0},
+                                                {"delta", QString::fromUtf8(token)}});
+        } else if (recordedFrames) {
+            chunk += "data: " + token + "\n\n";
+        } else {
+            for (int choice = 0; choice < stream.choices; ++choice)
+                chunk += "data: " + chunkFrame(stream, choice, token) + "\n\n";
+        }
+        ++m_stats.tokensSent;
+    }
+    writeChunk(socket, chunk);
+
+    if (stream.nextToken >= stream.tokens.size()) {
+        finishStream(stream);
+        return;
+    }
+
+    int delayMs = m_options.tokensPerSecond > 0 ? 1000 * perChunk / m_options.tokensPerSecond : 0;
+    if (stream.stallAt >= 0 && stream.nextToken >= stream.stallAt) {
+        stream.stallAt = -1;
+        delayMs = m_options.stallMs;
+    }
+    stream.timer->start(delayMs);
+}
+
+void MockOpenAIServer::finishStream(Stream &stream)
+{
+    const int completionTokens = int(stream.tokens.size()) * stream.choices;
+    const int promptTokens = stream.promptChars / 4;
+
+    if (stream.responsesApi) {
+        const QByteArray responseId = "resp_mock" + QByteArray::number(m_nextId++);
+        m_storedResponses.insert(responseId);
+
+        QJsonObject usage;
+        usage["input_tokens"] = promptTokens;
+        usage["input_tokens_details"] = QJsonObject{{"cached_tokens", 0}};
+        usage["output_tokens"] = completionTokens;
+        usage["total_tokens"] = promptTokens + completionTokens;
+        QJsonObject response;
+        response["id"] = QString::fromLatin1(responseId);
+        response["object"] = "response";
+        response["status"] = "completed";
+        response["model"] = QString::fromUtf8(stream.model);
+        response["store"] = true;
+        response["usage"] = usage;
+        writeChunk(stream.socket, responsesEvent("response.completed", QJsonObject{{"response", response}}));
+    } else {
+        QByteArray tail;
+        if (stream.includeUsage) {
+            QJsonObject usage;
+            usage["prompt_tokens"] = promptTokens;
+            usage["completion_tokens"] = completionTokens;
+            usage["total_tokens"] = promptTokens + completionTokens;
+            QJsonObject chunk;
+            chunk["id"] = "chatcmpl-mock";
+            chunk["object"] = "chat.completion.chunk";
+            chunk["model"] = QString::fromUtf8(stream.model);
+            chunk["choices"] = QJsonArray();
+            chunk["usage"] = usage;
+            tail += "data: " + QJsonDocument(chunk).toJson(QJsonDocument::Compact) + "\n\n";
+        }
+        tail += "data: [DONE]\n\n";
+        writeChunk(stream.socket, tail);
+    }
+
+    stream.socket->write("0\r\n\r\n");
+    stream.socket->disconnectFromHost();
+    ++m_stats.completed;
+}
+
+void MockOpenAIServer::handleFilesAndBatches(QTcpSocket *socket, const QByteArray &method, const QByteArray &path,
+                                             const QByteArray &body)
+{
+    // /v1/files, /v1/files/<id>/content, /v1/batches, /v1/batches/<id>, /v1/batches/<id>/cancel
+    const QList<QByteArray> parts = path.mid(1).split('/');
+    const QByteArray collection = parts.value(1);
+    const QByteArray id = parts.value(2);
+    const QByteArray action = parts.value(3);
+
+    if (collection == "files") {
+        if (method == "POST" && parts.size() == 2) {
+            uploadFile(socket, body);
+            return;
+        }
+        if (method == "GET" && action == "content" && m_files.contains(id)) {
+            sendResponse(socket, 200, "OK", "application/jsonl", m_files.value(id));
+            return;
+        }
+    } else if (collection == "batches") {
+        if (method == "POST" && parts.size() == 2) {
+            createBatch(socket, body);
+            return;
+        }
+        auto it = m_batches.find(id);
+        if (it != m_batches.end()) {
+            Batch &batch = *it;
+            if (method == "GET" && parts.size() == 3) {
+                // One poll in progress, the next one done
+                if (batch.status == "validating")
+                    batch.status = "in_progress";
+                else if (batch.status == "in_progress")
+                    runBatch(batch);
+                else if (batch.status == "cancelling")
+                    batch.status = "cancelled";
+                sendJson(socket, 200, "OK", batchJson(id, batch));
+                return;
+            }
+            if (method == "POST" && action == "cancel") {
+                if (batch.status == "validating" || batch.status == "in_progress")
+                    batch.status = "cancelling";
+                sendJson(socket, 200, "OK", batchJson(id, batch));
+                return;
+            }
+        }
+    }
+
+    sendJson(socket, 404, "Not Found", errorJson(QString("No such object: %1").arg(QString::fromUtf8(path))));
+}
+
+void MockOpenAIServer::uploadFile(QTcpSocket *socket, const QByteArray &body)
+{
+    // multipart/form-data: the first line is the boundary delimiter; the upload is the part named "file"
+    const qsizetype firstLineEnd = body.indexOf("\r\n");
+    if (firstLineEnd <= 0) {
+        sendJson(socket, 400, "Bad Request", errorJson("Expected a multipart/form-data body"));
+        return;
+    }
+    const QByteArray delimiter = "\r\n" + body.left(firstLineEnd);
+
+    QByteArray content;
+    bool found = false;
+    qsizetype pos = firstLineEnd + 2;
+    while (!found && pos < body.size()) {
+        const qsizetype headersEnd = body.indexOf("\r\n\r\n", pos);
+        const qsizetype partEnd = body.indexOf(delimiter, pos);
+        if (headersEnd < 0 || partEnd < headersEnd)
+            break;
+        if (body.mid(pos, headersEnd - pos).contains("name=\"file\"")) {
+            content = body.mid(headersEnd + 4, partEnd - headersEnd - 4);
+            found = true;
+        }
+        pos = partEnd + delimiter.size() + 2;
+    }
+    if (!found) {
+        sendJson(socket, 400, "Bad Request", errorJson("Missing the 'file' part"));
+        return;
+    }
+
+    const QByteArray fileId = "file-mock" + QByteArray::number(m_nextId++);
+    m_files.insert(fileId, content);
+
+    QJsonObject file;
+    file["id"] = QString::fromLatin1(fileId);
+    file["object"] = "file";
+    file["bytes"] = int(content.size());
+    file["purpose"] = "batch";
+    sendJson(socket, 200, "OK", QJsonDocument(file).toJson(QJsonDocument::Compact));
+}
+
+void MockOpenAIServer::createBatch(QTcpSocket *socket, const QByteArray &body)
+{
+    const QJsonObject request = QJsonDocument::fromJson(body).object();
+    const QByteArray inputFileId = request.value("input_file_id").toString().toUtf8();
+    if (!m_files.contains(inputFileId)) {
+        sendJson(socket, 400, "Bad Request",
+                 errorJson(QString("No such file: %1").arg(QString::fromUtf8(inputFileId))));
+        return;
+    }
+
+    Batch batch;
+    batch.inputFileId = inputFileId;
+    batch.status = "validating";
+    const QList<QByteArray> lines = m_files.value(inputFileId).split('\n');
+    for (const QByteArray &line : lines) {
+        if (!line.trimmed().isEmpty())
+            ++batch.total;
+    }
+
+    const QByteArray batchId = "batch_mock" + QByteArray::number(m_nextId++);
+    m_batches.insert(batchId, batch);
+    ++m_stats.batches;
+
+    sendJson(socket, 200, "OK", batchJson(batchId, batch));
+}
+
+void MockOpenAIServer::runBatch(Batch &batch)
+{
+    const QString answer = QString::fromUtf8(syntheticAnswer());
+    QByteArray output;
+    QByteArray errors;
+
+    const QList<QByteArray> lines = m_files.value(batch.inputFileId).split('\n');
+    for (const QByteArray &line : lines) {
+        if (line.trimmed().isEmpty())
+            continue;
+        const QJsonObject request = QJsonDocument::fromJson(line).object();
+        const QJsonObject body = request.value("body").toObject();
+        const QString requestId = QString("batch_req_mock%1").arg(m_nextId++);
+
+        QJsonObject response;
+        response["request_id"] = requestId;
+        if (m_random.generateDouble() < m_options.rateLimitRate) {
+            response["status_code"] = 429;
+            response["body"] = QJsonDocument::fromJson(errorJson("Rate limit reached (mock)", "rate_limit_exceeded")).object();
+        } else {
+            int promptChars = 0;
+            const QJsonArray messages = body.value("messages").toArray();
+            for (const QJsonValue &message : messages)
+                promptChars += contentChars(message.toObject().value("content"));
+
+            QJsonObject message;
+            message["role"] = "assistant";
+            message["content"] = answer;
+            QJsonObject choice;
+            choice["index"] = 0;
+            choice["message"] = message;
+            choice["finish_reason"] = "stop";
+            QJsonObject usage;
+            usage["prompt_tokens"] = promptChars / 4;
+            usage["completion_tokens"] = qMax(1, m_options.responseTokens);
+            usage["total_tokens"] = promptChars / 4 + qMax(1, m_options.responseTokens);
+            QJsonObject completion;
+            completion["id"] = "chatcmpl-mock";
+            completion["object"] = "chat.completion";
+            completion["model"] = body.value("model").toString("mock-model");
+            completion["choices"] = QJsonArray{choice};
+            completion["usage"] = usage;
+            response["status_code"] = 200;
+            response["body"] = completion;
+        }
+
+        QJsonObject result;
+        result["id"] = requestId;
+        result["custom_id"] = request.value("custom_id");
+        result["response"] = response;
+        result["error"] = QJsonValue::Null;
+        const QByteArray resultLine = QJsonDocument(result).toJson(QJsonDocument::Compact) + '\n';
+        if (response.value("status_code").toInt() == 200) {
+            output += resultLine;
+            ++batch.completed;
+        } else {
+            errors += resultLine;
+            ++batch.failed;
+        }
+    }
+
+    if (!output.isEmpty()) {
+        batch.outputFileId = "file-mock" + QByteArray::number(m_nextId++);
+        m_files.insert(batch.outputFileId, output);
+    }
+    if (!errors.isEmpty()) {
+        batch.errorFileId = "file-mock" + QByteArray::number(m_nextId++);
+        m_files.insert(batch.errorFileId, errors);
+    }
+    batch.status = "completed";
+}
+
+QByteArray MockOpenAIServer::batchJson(const QByteArray &id, const Batch &batch) const
+{
+    QJsonObject counts;
+    counts["total"] = batch.total;
+    counts["completed"] = batch.completed;
+    counts["failed"] = batch.failed;
+
+    QJsonObject json;
+    json["id"] = QString::fromLatin1(id);
+    json["object"] = "batch";
+    json["endpoint"] = QString::fromLatin1(kChatCompletionsPath);
+    json["input_file_id"] = QString::fromLatin1(batch.inputFileId);
+    json["completion_window"] = "24h";
+    json["status"] = QString::fromLatin1(batch.status);
+    json["output_file_id"] = batch.outputFileId.isEmpty() ? QJsonValue() : QJsonValue(QString::fromLatin1(batch.outputFileId));
+    json["error_file_id"] = batch.errorFileId.isEmpty() ? QJsonValue() : QJsonValue(QString::fromLatin1(batch.errorFileId));
+    json["request_counts"] = counts;
+    return QJsonDocument(json).toJson(QJsonDocument::Compact);
+}
+
+QByteArray MockOpenAIServer::syntheticAnswer() const
+{
+    QByteArray answer;
+    if (m_replayFrames.isEmpty()) {
+        for (int i = 0; i < qMax(1, m_options.responseTokens); ++i)
+            answer += kWords[i % kWordCount];
+    } else {
+        for (const QByteArray &frame : m_replayFrames)
+            answer += replayContent(frame);
+    }
+    return answer;
+}
+
+void MockOpenAIServer::sendJson(QTcpSocket *socket, int status, const QByteArray &reason, const QByteArray &body,
+                                const QByteArray &extraHeaders)
+{
+    sendResponse(socket, status, reason, "application/json", body, extraHeaders);
+}
+
+void MockOpenAIServer::sendResponse(QTcpSocket *socket, int status, const QByteArray &reason,
+                                    const QByteArray &contentType, const QByteArray &body,
+                                    const QByteArray &extraHeaders)
+{
+    QByteArray response = "HTTP/1.1 " + QByteArray::number(status) + ' ' + reason + "\r\n"
+                          "Content-Type: " + contentType + "\r\n"
+                          "Content-Length: " + QByteArray::number(body.size()) + "\r\n"
+                          "Connection: close\r\n"
+                          + extraHeaders + "\r\n" + body;
+    socket->write(response);
+    socket->disconnectFromHost();
+}
@@ -0,0 +1,145 @@
+#ifndef MOCKOPENAISERVER_H
+#define MOCKOPENAISERVER_H
+
+#pragma once
+
+#include <QObject>
+#include <QTcpServer>
+#include <QHash>
+#include <QJsonObject>
+#include <QSet>
+#include <QByteArray>
+#include <QList>
+#include <QRandomGenerator>
+
+class QCommandLineParser;
+class QTcpSocket;
+class QTimer;
+
+/**
+ * @brief Local stand-in for the OpenAI endpoints VibeKoder talks to.
+ *
+ * Answers POST /v1/chat/completions and POST /v1/responses with an SSE stream
+ * at a configurable token rate and chunk size, either synthetic or replayed
+ * from a recorded chat completions stream (the raw "data: ..." lines of a real
+ * response). Streams use chunked transfer encoding, so a dropped connection is
+ * a truncated response to the client rather than a short but complete one.
+ * Errors can be injected per request: 429 rejections, mid-stream stalls and
+ * dropped connections, drawn from a seeded generator so runs are reproducible.
+ *
+ * The Files and Batch endpoints BatchClient uses are served from memory: an
+ * uploaded batch is in progress on the first poll and completed on the next,
+ * with one synthetic answer per request line.
+ *
+ * Point the backends at it through the "api_base_url" config key or the
+ * VIBEKODER_API_BASE_URL environment variable.
+ */
+class MockOpenAIServer : public QObject
+{
+    Q_OBJECT
+public:
+    struct Options {
+        int tokensPerSecond = 50;       // 0: as fast as the socket takes them
+        int tokensPerChunk = 1;         // tokens written per network chunk
+        int responseTokens = 300;       // synthetic response length
+        int firstTokenDelayMs = 200;
+        double rateLimitRate = 0.0;     // share of requests rejected with 429
+        double stallRate = 0.0;         // share of streams that pause once mid-stream
+        int stallMs = 5000;
+        double dropRate = 0.0;          // share of streams whose connection drops mid-stream
+        QString replayFile;             // recorded SSE stream replayed instead of synthetic tokens
+        quint32 seed = 1;
+    };
+
+    struct Stats {
+        int requests = 0;
+        int rateLimited = 0;
+        int stalled = 0;
+        int dropped = 0;
+        int completed = 0;
+        int batches = 0;
+        qint64 tokensSent = 0;
+    };
+
+    explicit MockOpenAIServer(const Options &options, QObject *parent = nullptr);
+    ~MockOpenAIServer() override;
+
+    // The stream and error injection options shared by the executables that run the server;
+    // the replay file is left to them
+    static void addOptions(QCommandLineParser &parser);
+    static Options optionsFromArguments(const QCommandLineParser &parser);
+
+    // Port 0 picks a free port
+    bool listen(quint16 port = 0, QString *errorOut = nullptr);
+    quint16 port() const { return m_server.serverPort(); }
+    QString baseUrl() const;
+
+    const Stats &stats() const { return m_stats; }
+
+private:
+    struct Stream {
+        QTcpSocket *socket = nullptr;
+        QTimer *timer = nullptr;
+        QByteArray request;         // Raw request bytes until the body is complete
+        QList<QByteArray> tokens;   // Content of every token, or recorded frames when replaying
+        int choices = 1;
+        int nextToken = 0;
+        int stallAt = -1;           // Token index to pause at (-1: never)
+        int dropAt = -1;            // Token index to drop the connection at (-1: never)
+        bool responsesApi = false;  // Responses API events instead of chat completion chunks
+        bool includeUsage = false;
+        bool started = false;
+        QByteArray model;
+        int promptChars = 0;
+    };
+
+    struct Batch {
+        QByteArray inputFileId;
+        QByteArray outputFileId;
+        QByteArray errorFileId;
+        QByteArray status;
+        int total = 0;
+        int completed = 0;
+        int failed = 0;
+    };
+
+    void onNewConnection();
+    void onReadyRead(QTcpSocket *socket);
+    void startResponse(Stream &stream, const QByteArray &method, const QByteArray &path, const QByteArray &body);
+    void startStream(Stream &stream, bool responsesApi, const QByteArray &body);
+    void sendNextChunk(QTcpSocket *socket);
+    void finishStream(Stream &stream);
+    void writeChunk(QTcpSocket *socket, const QByteArray &data);
+
+    void handleFilesAndBatches(QTcpSocket *socket, const QByteArray &method, const QByteArray &path,
+                               const QByteArray &body);
+    void uploadFile(QTcpSocket *socket, const QByteArray &body);
+    void createBatch(QTcpSocket *socket, const QByteArray &body);
+    void runBatch(Batch &batch);
+    QByteArray batchJson(const QByteArray &id, const Batch &batch) const;
+
+    void sendJson(QTcpSocket *socket, int status, const QByteArray &reason, const QByteArray &body,
+                  const QByteArray &extraHeaders = QByteArray());
+    void sendResponse(QTcpSocket *socket, int status, const QByteArray &reason, const QByteArray &contentType,
+                      const QByteArray &body, const QByteArray &extraHeaders = QByteArray());
+
+    QByteArray chunkFrame(const Stream &stream, int choiceIndex, const QByteArray &content) const;
+    QByteArray responsesEvent(const QByteArray &type, const QJsonObject &event) const;
+    QByteArray syntheticAnswer() const;
+    bool loadReplay(QString *errorOut);
+
+    Options m_options;
+    Stats m_stats;
+    QTcpServer m_server;
+    QRandomGenerator m_random;
+    QHash<QTcpSocket *, Stream> m_streams;
+    // Recorded "data:" payloads (JSON chunks), without the final [DONE]
+    QList<QByteArray> m_replayFrames;
+
+    int m_nextId = 1;
+    QSet<QByteArray> m_storedResponses;     // Ids a Responses API request may continue from
+    QHash<QByteArray, QByteArray> m_files;  // Uploaded and generated files by id
+    QHash<QByteArray, Batch> m_batches;
+};
+
+#endif // MOCKOPENAISERVER_H
@@ -0,0 +1,219 @@
+#include "batchclient.h"
+#include "project.h"
+#include "session.h"
+
+#include <QtTest>
+#include <QDir>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTemporaryDir>
+
+namespace {
+
+// Answers the Batch API calls BatchClient makes, synchronously, for one batch
+class FakeBatchTransport : public BatchTransport
+{
+public:
+    void send(const QByteArray &verb, const QString &path, const QByteArray &body,
+              const QByteArray &contentType, Callback done) override
+    {
+        Q_UNUSED(contentType);
+        requests << verb + ' ' + path.toUtf8();
+
+        Response response;
+        response.status = 200;
+        if (verb == "POST" && path == QLatin1String("/v1/files")) {
+            uploaded = body;
+            response.body = R"({"id":"file-in"})";
+        } else if (verb == "POST" && path == QLatin1String("/v1/batches")) {
+            response.body = R"({"id":"batch_1","status":"validating"})";
+        } else if (verb == "GET" && path == QLatin1String("/v1/batches/batch_1")) {
+            response.body = QJsonDocument(QJsonObject{
+                {"id", "batch_1"},
+                {"status", status},
+                {"output_file_id", status == QLatin1String("completed") ? "file-out" : ""},
+                {"request_counts", QJsonObject{{"total", 1}, {"completed", 0}, {"failed", 0}}},
+            }).toJson(QJsonDocument::Compact);
+        } else if (verb == "GET" && path == QLatin1String("/v1/files/file-out/content")) {
+            response.body = output;
+        } else {
+            response.status = 404;
+        }
+        done(response);
+    }
+
+    QString status = QStringLiteral("in_progress");
+    QByteArray output;
+    QByteArray uploaded;
+    QList<QByteArray> requests;
+};
+
+QByteArray answerLine(const QString &customId, const QString &content)
+{
+    const QJsonObject message{{"role", "assistant"}, {"content", content}};
+    const QJsonObject body{{"choices", QJsonArray{QJsonObject{{"index", 0}, {"message", message}}}}};
+    const QJsonObject line{
+        {"id", "batch_req_1"},
+        {"custom_id", customId},
+        {"response", QJsonObject{{"status_code", 200}, {"body", body}}},
+        {"error", QJsonValue::Null},
+    };
+    return QJsonDocument(line).toJson(QJsonDocument::Compact) + '\n';
+}
+
+QByteArray fileBytes(const QString &path)
+{
+    QFile file(path);
+    return file.open(QIODevice::ReadOnly) ? file.readAll() : QByteArray();
+}
+
+} // namespace
+
+class TestBatchClient : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+    void cleanup();
+    void submitLeavesSessionUntouched();
+    void appliesAnswer();
+    void keepsAnswerOfChangedSession();
+
+private:
+    bool submit(BatchClient &client);
+    QString sessionsFolder() const { return QDir(m_root->path()).filePath("sessions"); }
+
+    QTemporaryDir *m_root = nullptr;
+    Project *m_project = nullptr;
+    FakeBatchTransport *m_transport = nullptr;
+    QString m_sessionPath;
+};
+
+void TestBatchClient::init()
+{
+    m_root = new QTemporaryDir;
+    QVERIFY(m_root->isValid());
+    QVERIFY(QDir(m_root->path()).mkpath("docs"));
+    QVERIFY(QDir(m_root->path()).mkpath("sessions"));
+
+    QFile doc(QDir(m_root->path()).filePath("docs/spec.md"));
+    QVERIFY(doc.open(QIODevice::WriteOnly));
+    doc.write("The spec says: batch answers arrive later.\n");
+    doc.close();
+
+    m_project = new Project;
+    m_project->setValue("folders.root", m_root->path());
+    m_project->setValue("folders.docs", QDir(m_root->path()).filePath("docs"));
+    m_project->setValue("folders.sessions", sessionsFolder());
+
+    m_sessionPath = QDir(sessionsFolder()).filePath("001.md");
+    Session session(m_project);
+    session.appendSystemSlice("You are a helpful assistant.");
+    session.appendUserSlice("Summarize this:\n<!-- include: docs/spec.md -->");
+    QVERIFY(session.save(m_sessionPath));
+
+    m_transport = new FakeBatchTransport;
+}
+
+void TestBatchClient::cleanup()
+{
+    delete m_project;
+    m_project = nullptr;
+    delete m_root;
+    m_root = nullptr;
+    // Owned by the client of the test function
+    m_transport = nullptr;
+}
+
+bool TestBatchClient::submit(BatchClient &client)
+{
+    client.setPollInterval(10);
+    QString error;
+    const bool ok = client.submit({m_sessionPath}, sessionsFolder(), QVariantMap{{"model", "gpt-4o"}}, &error);
+    if (!error.isEmpty())
+        qWarning() << "submit:" << error;
+    return ok;
+}
+
+void TestBatchClient::submitLeavesSessionUntouched()
+{
+    const QByteArray before = fileBytes(m_sessionPath);
+    BatchClient client(m_project, m_transport);
+
+    QVERIFY(submit(client));
+    QVERIFY(client.isRunning());
+    QCOMPARE(client.batchId(), QString("batch_1"));
+
+    // The include was expanded into the request, but the session file was not rewritten
+    QVERIFY(m_transport->uploaded.contains("batch answers arrive later"));
+    QCOMPARE(fileBytes(m_sessionPath), before);
+    QCOMPARE(BatchClient::pendingStateFiles(sessionsFolder()).size(), 1);
+}
+
+void TestBatchClient::appliesAnswer()
+{
+    BatchClient client(m_project, m_transport);
+    QSignalSpy updated(&client, &BatchClient::sessionUpdated);
+    QSignalSpy finished(&client, &BatchClient::finished);
+
+    QVERIFY(submit(client));
+    m_transport->output = answerLine("session-1", "Batches are asynchronous.");
+    m_transport->status = "completed";
+
+    QVERIFY(finished.wait(5000));
+    QCOMPARE(finished.first().at(0).toInt(), 1);
+    QVERIFY(finished.first().at(1).toStringList().isEmpty());
+    QCOMPARE(updated.size(), 1);
+    QVERIFY(m_transport->requests.contains("GET /v1/files/file-out/content"));
+
+    Session session(m_project);
+    QVERIFY(session.load(m_sessionPath));
+    QCOMPARE(session.slices().size(), 3);
+    QCOMPARE(session.slices().last().role, MessageRole::Assistant);
+    QCOMPARE(session.slices().last().content.trimmed(), QString("Batches are asynchronous."));
+    QVERIFY(BatchClient::pendingStateFiles(sessionsFolder()).isEmpty());
+}
+
+void TestBatchClient::keepsAnswerOfChangedSession()
+{
+    BatchClient client(m_project, m_transport);
+    QSignalSpy updated(&client, &BatchClient::sessionUpdated);
+    QSignalSpy finished(&client, &BatchClient::finished);
+
+    QVERIFY(submit(client));
+
+    // The conversation moves on interactively while the batch is pending
+    {
+        Session session(m_project);
+        QVERIFY(session.load(m_sessionPath));
+        session.appendAssistantSlice("An interactive answer.");
+        session.appendUserSlice("A different question.");
+        QVERIFY(session.save(m_sessionPath));
+    }
+    const QByteArray changed = fileBytes(m_sessionPath);
+
+    m_transport->output = answerLine("session-1", "Batches are asynchronous.");
+    m_transport->status = "completed";
+
+    QVERIFY(finished.wait(5000));
+    QCOMPARE(finished.first().at(0).toInt(), 0);
+    const QStringList errors = finished.first().at(1).toStringList();
+    QCOMPARE(errors.size(), 1);
+    QVERIFY(errors.first().contains("changed since the batch was sent"));
+    QCOMPARE(updated.size(), 0);
+
+    // The session keeps the user's turn; the answer is kept aside
+    QCOMPARE(fileBytes(m_sessionPath), changed);
+    const QStringList answers = QDir(BatchClient::batchesFolder(sessionsFolder())).entryList({"001_*.md"}, QDir::Files);
+    QCOMPARE(answers.size(), 1);
+    const QString answerPath = QDir(BatchClient::batchesFolder(sessionsFolder())).filePath(answers.first());
+    QCOMPARE(fileBytes(answerPath), QByteArray("Batches are asynchronous."));
+    QVERIFY(BatchClient::pendingStateFiles(sessionsFolder()).isEmpty());
+}
+
+QTEST_GUILESS_MAIN(TestBatchClient)
+
+#include "tst_batchclient.moc"
@@ -0,0 +1,221 @@
+#include "contextplanner.h"
+#include "session.h"
+#include "tokenizer.h"
+
+#include <QtTest>
+
+// Budgets are derived from the tokenizer's own counts, so the tests hold with and without a rank file
+class TestContextPlanner : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+    void fitsUntouched();
+    void policyOff();
+    void shortensOldestAnswer();
+    void dropsOldestAnswer();
+    void keepsLatestExchangeWhenTooLarge();
+    void dedupesRepeatedInclude();
+    void keepsIncludeOfDroppedExchange();
+
+private:
+    ContextPlanner::Plan plan(ContextPlanner::HistoryPolicy history, int budget) const;
+    ContextPlanner::Plan plan(ContextPlanner::HistoryPolicy history, const QVector<PromptSlice> &expanded,
+                              int budget) const;
+    int total() const;
+    static int total(const QVector<PromptSlice> &slices);
+    // Saves a session that includes the same cached document in two exchanges; returns it expanded
+    QVector<PromptSlice> includeTwice();
+
+    static QString longAnswer(const QString &name);
+
+    Session m_session;
+    QTemporaryDir m_dir;
+};
+
+void TestContextPlanner::init()
+{
+    QVector<PromptSlice> &slices = m_session.slices();
+    slices.clear();
+    slices.append({MessageRole::System, "You are a careful C++ reviewer.", QString()});
+    slices.append({MessageRole::User, "Review the tokenizer.", QString()});
+    slices.append({MessageRole::Assistant, longAnswer("first"), QString()});
+    slices.append({MessageRole::User, "And the context planner?", QString()});
+    slices.append({MessageRole::Assistant, longAnswer("second"), QString()});
+    slices.append({MessageRole::User, "Summarize both reviews.", QString()});
+}
+
+ContextPlanner::Plan TestContextPlanner::plan(ContextPlanner::HistoryPolicy history, int budget) const
+{
+    return plan(history, m_session.slices(), budget);
+}
+
+ContextPlanner::Plan TestContextPlanner::plan(ContextPlanner::HistoryPolicy history,
+                                              const QVector<PromptSlice> &expanded, int budget) const
+{
+    ContextPlanner::Policy policy;
+    policy.history = history;
+    return ContextPlanner(m_session, Tokenizer::forModel("gpt-4o"), policy).plan(expanded, budget);
+}
+
+int TestContextPlanner::total() const
+{
+    return total(m_session.slices());
+}
+
+int TestContextPlanner::total(const QVector<PromptSlice> &slices)
+{
+    const Tokenizer &tokenizer = Tokenizer::forModel("gpt-4o");
+    int tokens = Tokenizer::kReplyPrimingTokens;
+    for (const PromptSlice &slice : slices)
+        tokens += tokenizer.count(slice.content) + Tokenizer::kTokensPerMessage;
+    return tokens;
+}
+
+QVector<PromptSlice> TestContextPlanner::includeTwice()
+{
+    QVector<PromptSlice> &slices = m_session.slices();
+    slices.clear();
+    slices.append({MessageRole::System, "You are a careful C++ reviewer.", QString()});
+    slices.append({MessageRole::User, "Review this spec.\n<!-- cached: docs/spec.md -->\n", QString()});
+    slices.append({MessageRole::Assistant, longAnswer("first"), QString()});
+    slices.append({MessageRole::User, "Check it again.\n<!-- cached: docs/spec.md -->\n", QString()});
+    slices.append({MessageRole::Assistant, "It still holds.", QString()});
+    slices.append({MessageRole::User, "Summarize both reviews.", QString()});
+
+    // Not cached through the include store: plain files in the session cache folder resolve too
+    const QString sessionPath = m_dir.filePath("session.md");
+    QDir(m_dir.path()).mkpath("session/docs");
+    QFile spec(m_dir.filePath("session/docs/spec.md"));
+    QString text;
+    for (int i = 0; i < 50; ++i)
+        text += QString("Requirement %1: the planner keeps every reference resolvable.\n").arg(i);
+    if (!spec.open(QIODevice::WriteOnly) || spec.write(text.toUtf8()) < 0 || !m_session.save(sessionPath)
+        || !m_session.load(sessionPath))
+        return {};
+    spec.close();
+
+    return m_session.expandedSlices();
+}
+
+QString TestContextPlanner::longAnswer(const QString &name)
+{
+    QString answer;
+    for (int i = 0; i < 200; ++i)
+        answer += QString("Line %1 of the %2 answer, long enough to be worth shortening.\n").arg(i).arg(name);
+    return answer;
+}
+
+void TestContextPlanner::fitsUntouched()
+{
+    const ContextPlanner::Plan result = plan(ContextPlanner::Shorten, total());
+
+    QVERIFY(result.fits());
+    QVERIFY(result.removals.isEmpty());
+    QCOMPARE(result.tokensBefore, total());
+    QCOMPARE(result.tokensAfter, result.tokensBefore);
+    QCOMPARE(result.slices.size(), m_session.slices().size());
+}
+
+void TestContextPlanner::policyOff()
+{
+    const ContextPlanner::Plan result = plan(ContextPlanner::Off, 10);
+
+    QVERIFY(result.removals.isEmpty());
+    QVERIFY(!result.fits());
+    QCOMPARE(result.tokensBefore, total());
+    QCOMPARE(result.tokensAfter, result.tokensBefore);
+    QCOMPARE(result.slices.size(), m_session.slices().size());
+    QCOMPARE(result.slices.at(2).content, m_session.slices().at(2).content);
+}
+
+void TestContextPlanner::shortensOldestAnswer()
+{
+    const ContextPlanner::Plan result = plan(ContextPlanner::Shorten, total() - 1);
+
+    QVERIFY(result.fits());
+    QCOMPARE(result.removals.size(), 1);
+    QCOMPARE(result.removals.first().sliceIndex, 2);
+    QCOMPARE(result.removals.first().description, QString("shortened"));
+    QCOMPARE(result.tokensSaved(), result.removals.first().tokens);
+
+    QCOMPARE(result.slices.size(), m_session.slices().size());
+    QVERIFY(result.slices.at(2).content.startsWith("Line 0 of the first answer"));
+    QVERIFY(result.slices.at(2).content.size() < m_session.slices().at(2).content.size());
+    // The answer the latest prompt replies to is kept whole
+    QCOMPARE(result.slices.at(4).content, m_session.slices().at(4).content);
+}
+
+void TestContextPlanner::dropsOldestAnswer()
+{
+    const ContextPlanner::Plan result = plan(ContextPlanner::Drop, total() - 1);
+
+    QVERIFY(result.fits());
+    QCOMPARE(result.removals.size(), 1);
+    QCOMPARE(result.removals.first().sliceIndex, 2);
+    QCOMPARE(result.removals.first().description, QString("dropped"));
+
+    QCOMPARE(result.slices.size(), m_session.slices().size() - 1);
+    QCOMPARE(result.slices.at(2).content, m_session.slices().at(3).content);
+}
+
+void TestContextPlanner::keepsLatestExchangeWhenTooLarge()
+{
+    const ContextPlanner::Plan result = plan(ContextPlanner::Shorten, 10);
+
+    // Everything that may go is gone and it still does not fit: the caller refuses to send
+    QVERIFY(!result.fits());
+    // The first exchange goes as a whole, prompt and answer; the one the latest prompt follows stays
+    QCOMPARE(result.slices.size(), 4);
+    QCOMPARE(result.slices.at(0).role, MessageRole::System);
+    QCOMPARE(result.slices.at(1).content, m_session.slices().at(3).content);
+    QCOMPARE(result.slices.at(2).content, m_session.slices().at(4).content);
+    QCOMPARE(result.slices.at(3).content, m_session.slices().at(5).content);
+
+    QVector<int> dropped;
+    for (const ContextPlanner::Removal &removal : result.removals) {
+        if (removal.description == QLatin1String("dropped"))
+            dropped.append(removal.sliceIndex);
+    }
+    QCOMPARE(dropped, QVector<int>({1, 2}));
+}
+
+void TestContextPlanner::dedupesRepeatedInclude()
+{
+    const QVector<PromptSlice> expanded = includeTwice();
+    QCOMPARE(expanded.size(), 6);
+
+    const ContextPlanner::Plan result = plan(ContextPlanner::Shorten, expanded, total(expanded));
+
+    QVERIFY(result.fits());
+    QCOMPARE(result.slices.size(), expanded.size());
+    QCOMPARE(result.slices.at(1).content, expanded.at(1).content);
+    QVERIFY(result.slices.at(3).content.contains("[docs/spec.md: unchanged, see the copy above]"));
+    QCOMPARE(result.removals.size(), 1);
+    QCOMPARE(result.removals.first().sliceIndex, 3);
+    QCOMPARE(result.removals.first().description, QString("repeated include docs/spec.md"));
+    QVERIFY(result.tokensAfter < result.tokensBefore);
+}
+
+void TestContextPlanner::keepsIncludeOfDroppedExchange()
+{
+    const QVector<PromptSlice> expanded = includeTwice();
+    QCOMPARE(expanded.size(), 6);
+
+    // Fits once the first exchange, which holds the first copy, is gone
+    const ContextPlanner::Plan result =
+        plan(ContextPlanner::Shorten, expanded, total(expanded.mid(3)) + total({expanded.first()})
+                                                    - Tokenizer::kReplyPrimingTokens);
+
+    QVERIFY(result.fits());
+    QCOMPARE(result.slices.size(), 4);
+    QCOMPARE(result.slices.at(1).content, expanded.at(3).content);
+    QVERIFY(!result.slices.at(1).content.contains("see the copy above"));
+    for (const ContextPlanner::Removal &removal : result.removals)
+        QVERIFY(!removal.description.startsWith("repeated include"));
+}
+
+QTEST_GUILESS_MAIN(TestContextPlanner)
+
+#include "tst_contextplanner.moc"
@@ -0,0 +1,110 @@
+#include "tokenizer.h"
+
+#include <QtTest>
+
+// Reference splits come from tiktoken's pre-tokenization regexes, run through Python's regex module
+class TestTokenizer : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void preTokenize_data();
+    void preTokenize();
+    void countKnownTexts_data();
+    void countKnownTexts();
+    void countCached();
+};
+
+void TestTokenizer::preTokenize_data()
+{
+    QTest::addColumn<int>("encoding");
+    QTest::addColumn<QString>("text");
+    QTest::addColumn<QStringList>("pieces");
+
+    const int cl100k = Tokenizer::Cl100kBase;
+    const int o200k = Tokenizer::O200kBase;
+
+    QTest::newRow("cl100k words") << cl100k << QString("tiktoken is great!")
+                                  << QStringList{"tiktoken", " is", " great", "!"};
+    QTest::newRow("cl100k contractions") << cl100k << QString("I'm here, they'll go; we've WON'T")
+        << QStringList{"I", "'m", " here", ",", " they", "'ll", " go", ";", " we", "'ve", " WON", "'T"};
+    QTest::newRow("cl100k numbers") << cl100k << QString("12345 67") << QStringList{"123", "45", " ", "67"};
+    QTest::newRow("cl100k whitespace") << cl100k << QString("  leading\n\n  indented\tcode  ")
+        << QStringList{" ", " leading", "\n\n", " ", " indented", "\tcode", "  "};
+    QTest::newRow("cl100k code") << cl100k << QString("int main() {\n    return 0;\n}\n")
+        << QStringList{"int", " main", "()", " {\n", "   ", " return", " ", "0", ";\n", "}\n"};
+    QTest::newRow("cl100k camel case") << cl100k << QString("HTTPServer parseJSON XMLHttpRequest")
+        << QStringList{"HTTPServer", " parseJSON", " XMLHttpRequest"};
+    QTest::newRow("cl100k slashes") << cl100k << QString("a/b//c\n/d")
+                                    << QStringList{"a", "/b", "//", "c", "\n", "/d"};
+    QTest::newRow("cl100k cjk") << cl100k << QString::fromUtf8(u8"\u4e2d\u6587ABC")
+                                << QStringList{QString::fromUtf8(u8"\u4e2d\u6587ABC")};
+
+    QTest::newRow("o200k words") << o200k << QString("tiktoken is great!")
+                                 << QStringList{"tiktoken", " is", " great", "!"};
+    QTest::newRow("o200k contractions") << o200k << QString("I'm here, they'll go; we've WON'T")
+        << QStringList{"I'm", " here", ",", " they'll", " go", ";", " we've", " WON'T"};
+    QTest::newRow("o200k numbers") << o200k << QString("12345 67") << QStringList{"123", "45", " ", "67"};
+    QTest::newRow("o200k whitespace") << o200k << QString("x  \n\n y") << QStringList{"x", "  \n\n", " y"};
+    QTest::newRow("o200k code") << o200k << QString("int main() {\n    return 0;\n}\n")
+        << QStringList{"int", " main", "()", " {\n", "   ", " return", " ", "0", ";\n", "}\n"};
+    QTest::newRow("o200k camel case") << o200k << QString("HTTPServer parseJSON XMLHttpRequest")
+        << QStringList{"HTTPServer", " parse", "JSON", " XMLHttp", "Request"};
+    QTest::newRow("o200k slashes") << o200k << QString("a/b//c\n/d")
+                                   << QStringList{"a", "/b", "//", "c", "\n", "/d"};
+    QTest::newRow("o200k accents") << o200k << QString::fromUtf8(u8"caf\u00e9 na\u00efve \u00c9COLE")
+        << QStringList{QString::fromUtf8(u8"caf\u00e9"), QString::fromUtf8(u8" na\u00efve"),
+                       QString::fromUtf8(u8" \u00c9COLE")};
+    // \p{Lo} is in both letter classes: the upper run gives back characters to the lower run
+    QTest::newRow("o200k cjk then upper") << o200k << QString::fromUtf8(u8"\u4e2d\u6587ABC")
+        << QStringList{QString::fromUtf8(u8"\u4e2d\u6587"), "ABC"};
+    QTest::newRow("o200k upper then cjk") << o200k << QString::fromUtf8(u8"ABC\u4e2d\u6587")
+        << QStringList{QString::fromUtf8(u8"ABC\u4e2d\u6587")};
+}
+
+void TestTokenizer::preTokenize()
+{
+    QFETCH(int, encoding);
+    QFETCH(QString, text);
+    QFETCH(QStringList, pieces);
+
+    QCOMPARE(Tokenizer::preTokenize(text, Tokenizer::Encoding(encoding)), pieces);
+}
+
+void TestTokenizer::countKnownTexts_data()
+{
+    QTest::addColumn<QString>("model");
+    QTest::addColumn<QString>("text");
+    QTest::addColumn<int>("tokens");
+
+    QTest::newRow("cl100k hello") << QString("gpt-4") << QString("hello world") << 2;
+    QTest::newRow("cl100k tiktoken") << QString("gpt-4") << QString("tiktoken is great!") << 6;
+}
+
+void TestTokenizer::countKnownTexts()
+{
+    QFETCH(QString, model);
+    QFETCH(QString, text);
+    QFETCH(int, tokens);
+
+    const Tokenizer &tokenizer = Tokenizer::forModel(model);
+    if (!tokenizer.isExact())
+        QSKIP("No rank file found (set VIBEKODER_TOKENIZER_DIR)");
+    QCOMPARE(tokenizer.count(text), tokens);
+}
+
+void TestTokenizer::countCached()
+{
+    const Tokenizer &tokenizer = Tokenizer::forModel("gpt-4o");
+    const QString text("The cache is keyed on the text, not on its 32-bit hash.");
+    const QString key = Tokenizer::textKey(text);
+
+    QVERIFY(key != Tokenizer::textKey(text + " "));
+    QCOMPARE(tokenizer.countCached(text), tokenizer.count(text));
+    QCOMPARE(tokenizer.cachedCount(key), tokenizer.count(text));
+    QCOMPARE(tokenizer.cachedCount(Tokenizer::textKey("never counted")), -1);
+}
+
+QTEST_GUILESS_MAIN(TestTokenizer)
+
+#include "tst_tokenizer.moc"